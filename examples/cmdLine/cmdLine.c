@@ -2277,9 +2277,10 @@ static uint8_t mtAfIncomingMsgExt(IncomingMsgExtFormat_t *msg)
 	consolePrint("SecurityUse: 0x%02X\n", msg->SecurityUse);
 	consolePrint("TimeStamp: 0x%08X\n", msg->TimeStamp);
 	consolePrint("TransSeqNum: 0x%02X\n", msg->TransSeqNum);
-	consolePrint("Len: 0x%02X\n", msg->Len);
+	consolePrint("Len: 0x%04X\n", msg->Len);
 	uint32_t i;
-	for (i = 0; i < msg->Len; i++)
+	// longer messages stay in the ZNP, see afDataRetrieve
+	for (i = 0; (i < msg->Len) && (i < MT_AF_INCOMING_EXT_MAX_LEN); i++)
 	{
 		consolePrint("Data[%d]: 0x%02X\n", i, msg->Data[i]);
 	}
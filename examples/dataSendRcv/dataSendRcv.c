@@ -52,6 +52,7 @@
 #include "rpcTransport.h"
 #include "dbgPrint.h"
 #include "hostConsole.h"
+#include "netStart.h"
 
 /*********************************************************************
  * MACROS
@@ -92,10 +93,6 @@ static uint8_t mtAfDataConfirmCb(DataConfirmFormat_t *msg);
 static uint8_t mtAfIncomingMsgCb(IncomingMsgFormat_t *msg);
 
 //helper functions
-static uint8_t setNVStartup(uint8_t startupOption);
-static uint8_t setNVChanList(uint32_t chanList);
-static uint8_t setNVPanID(uint32_t panId);
-static uint8_t setNVDevType(uint8_t devType);
 static int32_t startNetwork(void);
 static int32_t registerAf(void);
 
@@ -406,111 +403,30 @@ static uint8_t mtAfIncomingMsgCb(IncomingMsgFormat_t *msg)
 /********************************************************************
  * HELPER FUNCTIONS
  */
-// helper functions for building and sending the NV messages
-static uint8_t setNVStartup(uint8_t startupOption)
-{
-	uint8_t status;
-	OsalNvWriteFormat_t nvWrite;
-
-	// sending startup option
-	nvWrite.Id = ZCD_NV_STARTUP_OPTION;
-	nvWrite.Offset = 0;
-	nvWrite.Len = 1;
-	nvWrite.Value[0] = startupOption;
-	status = sysOsalNvWrite(&nvWrite);
-
-	dbg_print(PRINT_LEVEL_INFO, "\n");
-
-	dbg_print(PRINT_LEVEL_INFO, "NV Write Startup Option cmd sent[%d]...\n",
-	        status);
-
-	return status;
-}
-
-static uint8_t setNVDevType(uint8_t devType)
-{
-	uint8_t status;
-	OsalNvWriteFormat_t nvWrite;
-
-	// setting dev type
-	nvWrite.Id = ZCD_NV_LOGICAL_TYPE;
-	nvWrite.Offset = 0;
-	nvWrite.Len = 1;
-	nvWrite.Value[0] = devType;
-	status = sysOsalNvWrite(&nvWrite);
-
-	dbg_print(PRINT_LEVEL_INFO, "\n");
-	dbg_print(PRINT_LEVEL_INFO, "NV Write Device Type cmd sent... [%d]\n",
-	        status);
-
-	return status;
-}
-
-static uint8_t setNVPanID(uint32_t panId)
-{
-	uint8_t status;
-	OsalNvWriteFormat_t nvWrite;
-
-	dbg_print(PRINT_LEVEL_INFO, "\n");
-	dbg_print(PRINT_LEVEL_INFO, "NV Write PAN ID cmd sending...\n");
-
-	nvWrite.Id = ZCD_NV_PANID;
-	nvWrite.Offset = 0;
-	nvWrite.Len = 2;
-	nvWrite.Value[0] = LO_UINT16(panId);
-	nvWrite.Value[1] = HI_UINT16(panId);
-	status = sysOsalNvWrite(&nvWrite);
-
-	dbg_print(PRINT_LEVEL_INFO, "\n");
-	dbg_print(PRINT_LEVEL_INFO, "NV Write PAN ID cmd sent...[%d]\n", status);
-
-	return status;
-}
-
-static uint8_t setNVChanList(uint32_t chanList)
-{
-	OsalNvWriteFormat_t nvWrite;
-	uint8_t status;
-	// setting chanList
-	nvWrite.Id = ZCD_NV_CHANLIST;
-	nvWrite.Offset = 0;
-	nvWrite.Len = 4;
-	nvWrite.Value[0] = BREAK_UINT32(chanList, 0);
-	nvWrite.Value[1] = BREAK_UINT32(chanList, 1);
-	nvWrite.Value[2] = BREAK_UINT32(chanList, 2);
-	nvWrite.Value[3] = BREAK_UINT32(chanList, 3);
-	status = sysOsalNvWrite(&nvWrite);
-
-	dbg_print(PRINT_LEVEL_INFO, "\n");
-	dbg_print(PRINT_LEVEL_INFO, "NV Write Channel List cmd sent...[%d]\n",
-	        status);
-
-	return status;
-}
-
-uint8_t dType;
 static int32_t startNetwork(void)
 {
-	char cDevType;
-	uint8_t devType;
+	netStartCfg_t cfg;
+	netStartStats_t stats;
 	int32_t status;
-	uint8_t newNwk = 0;
 	char sCh[128];
 
+	cfg.devType = NET_START_KEEP_TYPE;
+	cfg.panId = 0xFFFF;
+	cfg.chanList = 0;
+	cfg.timeout = 0;
+	cfg.registerCb = registerAf;
+
 	do
 	{
 		consolePrint("Do you wish to start/join a new network? (y/n)\n");
 		consoleGetLine(sCh, 128);
 		if (sCh[0] == 'n' || sCh[0] == 'N')
 		{
-			status = setNVStartup(0);
+			cfg.mode = NET_START_RESUME;
 		}
 		else if (sCh[0] == 'y' || sCh[0] == 'Y')
 		{
-			status = setNVStartup(
-			ZCD_STARTOPT_CLEAR_STATE | ZCD_STARTOPT_CLEAR_CONFIG);
-			newNwk = 1;
-
+			cfg.mode = NET_START_NEW;
 		}
 		else
 		{
@@ -518,114 +434,51 @@ static int32_t startNetwork(void)
 		}
 	} while (sCh[0] != 'y' && sCh[0] != 'Y' && sCh[0] != 'n' && sCh[0] != 'N');
 
-	if (status != MT_RPC_SUCCESS)
-	{
-		dbg_print(PRINT_LEVEL_WARNING, "network start failed\n");
-		return -1;
-	}
-	consolePrint("Resetting ZNP\n");
-	ResetReqFormat_t resReq;
-	resReq.Type = 1;
-	sysResetReq(&resReq);
-	//flush the rsp
-	rpcWaitMqClientMsg(5000);
-
-	if (newNwk)
+	if (cfg.mode == NET_START_NEW)
 	{
 #ifndef CC26xx
 		consolePrint(
 		        "Enter device type c: Coordinator, r: Router, e: End Device:\n");
 		consoleGetLine(sCh, 128);
-		cDevType = sCh[0];
 
-		switch (cDevType)
+		switch (sCh[0])
 		{
 		case 'c':
 		case 'C':
-			devType = DEVICETYPE_COORDINATOR;
+			cfg.devType = DEVICETYPE_COORDINATOR;
 			break;
 		case 'r':
 		case 'R':
-			devType = DEVICETYPE_ROUTER;
+			cfg.devType = DEVICETYPE_ROUTER;
 			break;
 		case 'e':
 		case 'E':
 		default:
-			devType = DEVICETYPE_ENDDEVICE;
+			cfg.devType = DEVICETYPE_ENDDEVICE;
 			break;
 		}
-		status = setNVDevType(devType);
-
-		if (status != MT_RPC_SUCCESS)
-		{
-			dbg_print(PRINT_LEVEL_WARNING, "setNVDevType failed\n");
-			return 0;
-		}
 #endif //CC26xx
 		//Select random PAN ID for Coord and join any PAN for RTR/ED
-		status = setNVPanID(0xFFFF);
-		if (status != MT_RPC_SUCCESS)
-		{
-			dbg_print(PRINT_LEVEL_WARNING, "setNVPanID failed\n");
-			return -1;
-		}
 		consolePrint("Enter channel 11-26:\n");
 		consoleGetLine(sCh, 128);
-
-		status = setNVChanList(1 << atoi(sCh));
-		if (status != MT_RPC_SUCCESS)
-		{
-			dbg_print(PRINT_LEVEL_INFO, "setNVPanID failed\n");
-			return -1;
-		}
-
+		cfg.chanList = 1 << atoi(sCh);
 	}
 
-	registerAf();
-	consolePrint("EndPoint: 1\n");
-
-	status = zdoInit();
-	if (status == NEW_NETWORK)
+	status = netStart(&cfg);
+	netStartGetStats(&stats);
+	if (status != 0)
 	{
-		dbg_print(PRINT_LEVEL_INFO, "zdoInit NEW_NETWORK\n");
-		status = MT_RPC_SUCCESS;
-	}
-	else if (status == RESTORED_NETWORK)
-	{
-		dbg_print(PRINT_LEVEL_INFO, "zdoInit RESTORED_NETWORK\n");
-		status = MT_RPC_SUCCESS;
-	}
-	else
-	{
-		dbg_print(PRINT_LEVEL_INFO, "zdoInit failed\n");
-		status = -1;
-	}
-
-	dbg_print(PRINT_LEVEL_INFO, "process zdoStatechange callbacks\n");
-
-	//flush AREQ ZDO State Change messages
-	while (status != -1)
-	{
-		status = rpcWaitMqClientMsg(5000);
-
-		if (((devType == DEVICETYPE_COORDINATOR) && (devState == DEV_ZB_COORD))
-		        || ((devType == DEVICETYPE_ROUTER) && (devState == DEV_ROUTER))
-		        || ((devType == DEVICETYPE_ENDDEVICE)
-		                && (devState == DEV_END_DEVICE)))
-		{
-			break;
-		}
-	}
-	//set startup option back to keep configuration in case of reset
-	status = setNVStartup(0);
-	if (devState < DEV_END_DEVICE)
-	{
-		//start network failed
+		dbg_print(PRINT_LEVEL_WARNING, "network start failed\n");
 		return -1;
 	}
 
+	consolePrint("EndPoint: 1\n");
+	consolePrint("Network up in %dms (%s, %d NV writes)\n", stats.totalTime,
+	        stats.resumed ? "resumed" : "ZNP reset", stats.nvWrites);
+
 	return 0;
 }
+
 static int32_t registerAf(void)
 {
 	int32_t status = 0;
@@ -708,14 +561,11 @@ uint32_t appInit(void)
 	int32_t status = 0;
 	uint32_t msgCnt = 0;
 
-	//Flush all messages from the que
-	while (status != -1)
+	//Flush all messages from the que, without waiting for more
+	status = rpcDrainMqClientMsg(0, 0);
+	if (status != -1)
 	{
-		status = rpcWaitMqClientMsg(10);
-		if (status != -1)
-		{
-			msgCnt++;
-		}
+		msgCnt = status;
 	}
 
 	dbg_print(PRINT_LEVEL_INFO, "flushed %d message from msg queue\n", msgCnt);
@@ -724,6 +574,11 @@ uint32_t appInit(void)
 	sysRegisterCallbacks(mtSysCb);
 	zdoRegisterCallbacks(mtZdoCb);
 	afRegisterCallbacks(mtAfCb);
+	if (netStartInit() != 0)
+	{
+		dbg_print(PRINT_LEVEL_ERROR, "appInit: netStartInit failed\n");
+		return 1;
+	}
 
 	return 0;
 }
@@ -744,11 +599,8 @@ void* appProcess(void *argument)
 	int32_t status;
 	uint32_t quit = 0;
 
-	//Flush all messages from the que
-	do
-	{
-		status = rpcWaitMqClientMsg(50);
-	} while (status != -1);
+	//Flush all messages from the que, without waiting for more
+	rpcDrainMqClientMsg(0, 0);
 
 	devState = DEV_HOLD;
 
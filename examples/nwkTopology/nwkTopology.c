@@ -51,16 +51,15 @@
 #include "mtParser.h"
 #include "mtSapi.h"
 #include "rpcTransport.h"
+#include "topoCrawl.h"
 #include "dbgPrint.h"
 #include "hostConsole.h"
+#include "netStart.h"
 
 /*********************************************************************
  * MACROS
  */
 
-#define MAX_CHILDREN 20
-#define MAX_NODE_LIST 64
-
 /*********************************************************************
  * TYPES
  */
@@ -87,17 +86,13 @@ void usage(char* exeName)
  */
 //ZDO Callbacks
 static uint8_t mtZdoStateChangeIndCb(uint8_t newDevState);
-static uint8_t mtZdoMgmtLqiRspCb(MgmtLqiRspFormat_t *msg);
+static void topoCrawlDoneCb(topoCrawlResult_t *result, void *arg);
 
 //SYS Callbacks
 
 static uint8_t mtSysResetIndCb(ResetIndFormat_t *msg);
 
 //helper functions
-static uint8_t setNVStartup(uint8_t startupOption);
-static uint8_t setNVChanList(uint32_t chanList);
-static uint8_t setNVPanID(uint32_t panId);
-static uint8_t setNVDevType(uint8_t devType);
 static int32_t startNetwork(void);
 static int32_t registerAf(void);
 
@@ -128,7 +123,7 @@ static mtZdoCb_t mtZdoCb =
 	        NULL,          // MT_ZDO_BIND_RSP
 	        NULL,        // MT_ZDO_UNBIND_RSP
 	        NULL,   // MT_ZDO_MGMT_NWK_DISC_RSP
-	        mtZdoMgmtLqiRspCb,       // MT_ZDO_MGMT_LQI_RSP
+	        NULL,       // MT_ZDO_MGMT_LQI_RSP
 	        NULL,       // MT_ZDO_MGMT_RTG_RSP
 	        NULL,      // MT_ZDO_MGMT_BIND_RSP
 	        NULL,     // MT_ZDO_MGMT_LEAVE_RSP
@@ -146,23 +141,9 @@ static mtZdoCb_t mtZdoCb =
 	        NULL,  //MT_ZDO_MATCH_DESC_RSP_SENT
 	        NULL, NULL };
 
-typedef struct
-{
-	uint16_t ChildAddr;
-	uint8_t Type;
-
-} ChildNode_t;
+uint8_t crawlDone = 0;
+topoCrawlResult_t crawlResult;
 
-typedef struct
-{
-	uint16_t NodeAddr;
-	uint8_t Type;
-	uint8_t ChildCount;
-	ChildNode_t childs[MAX_CHILDREN];
-} Node_t;
-
-Node_t nodeList[MAX_NODE_LIST];
-uint8_t nodeCount = 0;
 static uint8_t mtSysResetIndCb(ResetIndFormat_t *msg)
 {
 
@@ -242,150 +223,36 @@ static uint8_t mtZdoStateChangeIndCb(uint8_t newDevState)
 	return SUCCESS;
 }
 
-static uint8_t mtZdoMgmtLqiRspCb(MgmtLqiRspFormat_t *msg)
-{
-	uint8_t devType = 0;
-	uint8_t devRelation = 0;
-	uint8_t localNodeCount = nodeCount;
-	MgmtLqiReqFormat_t req;
-
-	if (msg->Status == MT_RPC_SUCCESS)
-	{
-		nodeCount++;
-		nodeList[localNodeCount].NodeAddr = msg->SrcAddr;
-		nodeList[localNodeCount].Type = (msg->SrcAddr == 0 ?
-		DEVICETYPE_COORDINATOR :
-		                                                DEVICETYPE_ROUTER);
-		nodeList[localNodeCount].ChildCount = 0;
-		uint32_t i;
-		for (i = 0; i < msg->NeighborLqiListCount; i++)
-		{
-			devType = msg->NeighborLqiList[i].DevTyp_RxOnWhenIdle_Relat & 3;
-			devRelation = ((msg->NeighborLqiList[i].DevTyp_RxOnWhenIdle_Relat
-			        >> 4) & 7);
-			if (devRelation == 1)
-			{
-				uint8_t cCount = nodeList[localNodeCount].ChildCount;
-				nodeList[localNodeCount].childs[cCount].ChildAddr =
-				        msg->NeighborLqiList[i].NetworkAddress;
-				nodeList[localNodeCount].childs[cCount].Type = devType;
-				nodeList[localNodeCount].ChildCount++;
-				if (devType == DEVICETYPE_ROUTER)
-				{
-					req.DstAddr = msg->NeighborLqiList[i].NetworkAddress;
-					req.StartIndex = 0;
-					zdoMgmtLqiReq(&req);
-				}
-			}
-		}
-	}
-	else
-	{
-		consolePrint("MgmtLqiRsp Status: FAIL 0x%02X\n", msg->Status);
-	}
-
-	return msg->Status;
-}
-
-// helper functions for building and sending the NV messages
-static uint8_t setNVStartup(uint8_t startupOption)
-{
-	uint8_t status;
-	OsalNvWriteFormat_t nvWrite;
-	// sending startup option
-
-	nvWrite.Id = ZCD_NV_STARTUP_OPTION;
-	nvWrite.Offset = 0;
-	nvWrite.Len = 1;
-	nvWrite.Value[0] = startupOption;
-	status = sysOsalNvWrite(&nvWrite);
-	dbg_print(PRINT_LEVEL_INFO, "\n");
-
-	dbg_print(PRINT_LEVEL_INFO, "NV Write Startup Option cmd sent[%d]...\n",
-	        status);
-
-	return status;
-}
-
-static uint8_t setNVDevType(uint8_t devType)
-{
-	uint8_t status;
-	OsalNvWriteFormat_t nvWrite;
-	// setting dev type
-	nvWrite.Id = ZCD_NV_LOGICAL_TYPE;
-	nvWrite.Offset = 0;
-	nvWrite.Len = 1;
-	nvWrite.Value[0] = devType;
-	status = sysOsalNvWrite(&nvWrite);
-	dbg_print(PRINT_LEVEL_INFO, "\n");
-	dbg_print(PRINT_LEVEL_INFO, "NV Write Device Type cmd sent... [%d]\n",
-	        status);
-
-	return status;
-}
-
-static uint8_t setNVPanID(uint32_t panId)
+static void topoCrawlDoneCb(topoCrawlResult_t *result, void *arg)
 {
-	uint8_t status;
-	OsalNvWriteFormat_t nvWrite;
-
-	dbg_print(PRINT_LEVEL_INFO, "\n");
-	dbg_print(PRINT_LEVEL_INFO, "NV Write PAN ID cmd sending...\n");
-
-	nvWrite.Id = ZCD_NV_PANID;
-	nvWrite.Offset = 0;
-	nvWrite.Len = 2;
-	nvWrite.Value[0] = LO_UINT16(panId);
-	nvWrite.Value[1] = HI_UINT16(panId);
-	status = sysOsalNvWrite(&nvWrite);
-	dbg_print(PRINT_LEVEL_INFO, "\n");
-	dbg_print(PRINT_LEVEL_INFO, "NV Write PAN ID cmd sent...[%d]\n", status);
-
-	return status;
-}
-
-static uint8_t setNVChanList(uint32_t chanList)
-{
-	OsalNvWriteFormat_t nvWrite;
-	uint8_t status;
-	// setting chanList
-	nvWrite.Id = ZCD_NV_CHANLIST;
-	nvWrite.Offset = 0;
-	nvWrite.Len = 4;
-	nvWrite.Value[0] = BREAK_UINT32(chanList, 0);
-	nvWrite.Value[1] = BREAK_UINT32(chanList, 1);
-	nvWrite.Value[2] = BREAK_UINT32(chanList, 2);
-	nvWrite.Value[3] = BREAK_UINT32(chanList, 3);
-	status = sysOsalNvWrite(&nvWrite);
-	dbg_print(PRINT_LEVEL_INFO, "\n");
-	dbg_print(PRINT_LEVEL_INFO, "NV Write Channel List cmd sent...[%d]\n",
-	        status);
-
-	return status;
+	memcpy(&crawlResult, result, sizeof(topoCrawlResult_t));
+	crawlDone = 1;
 }
 
 static int32_t startNetwork(void)
 {
-	char cDevType;
-	uint8_t devType;
+	netStartCfg_t cfg;
+	netStartStats_t stats;
 	int32_t status;
-	uint8_t newNwk = 0;
 	char sCh[128];
 
+	cfg.devType = NET_START_KEEP_TYPE;
+	cfg.panId = 0xFFFF;
+	cfg.chanList = 0;
+	cfg.timeout = 0;
+	cfg.registerCb = registerAf;
+
 	do
 	{
 		consolePrint("Do you wish to start/join a new network? (y/n)\n");
 		consoleGetLine(sCh, 128);
 		if (sCh[0] == 'n' || sCh[0] == 'N')
 		{
-			status = setNVStartup(0);
+			cfg.mode = NET_START_RESUME;
 		}
 		else if (sCh[0] == 'y' || sCh[0] == 'Y')
 		{
-			status = setNVStartup(
-			ZCD_STARTOPT_CLEAR_STATE | ZCD_STARTOPT_CLEAR_CONFIG);
-			newNwk = 1;
-
+			cfg.mode = NET_START_NEW;
 		}
 		else
 		{
@@ -393,112 +260,48 @@ static int32_t startNetwork(void)
 		}
 	} while (sCh[0] != 'y' && sCh[0] != 'Y' && sCh[0] != 'n' && sCh[0] != 'N');
 
-	if (status != MT_RPC_SUCCESS)
-	{
-		dbg_print(PRINT_LEVEL_WARNING, "network start failed\n");
-		return -1;
-	}
-	consolePrint("Resetting ZNP\n");
-	ResetReqFormat_t resReq;
-	resReq.Type = 1;
-	sysResetReq(&resReq);
-	//flush the rsp
-	rpcWaitMqClientMsg(5000);
-
-	if (newNwk)
+	if (cfg.mode == NET_START_NEW)
 	{
 #ifndef CC26xx
 		consolePrint(
 		        "Enter device type c: Coordinator, r: Router, e: End Device:\n");
 		consoleGetLine(sCh, 128);
-		cDevType = sCh[0];
 
-		switch (cDevType)
+		switch (sCh[0])
 		{
 		case 'c':
 		case 'C':
-			devType = DEVICETYPE_COORDINATOR;
+			cfg.devType = DEVICETYPE_COORDINATOR;
 			break;
 		case 'r':
 		case 'R':
-			devType = DEVICETYPE_ROUTER;
+			cfg.devType = DEVICETYPE_ROUTER;
 			break;
 		case 'e':
 		case 'E':
 		default:
-			devType = DEVICETYPE_ENDDEVICE;
+			cfg.devType = DEVICETYPE_ENDDEVICE;
 			break;
 		}
-		status = setNVDevType(devType);
-
-		if (status != MT_RPC_SUCCESS)
-		{
-			dbg_print(PRINT_LEVEL_WARNING, "setNVDevType failed\n");
-			return 0;
-		}
 #endif //CC26xx
 		//Select random PAN ID for Coord and join any PAN for RTR/ED
-		status = setNVPanID(0xFFFF);
-		if (status != MT_RPC_SUCCESS)
-		{
-			dbg_print(PRINT_LEVEL_WARNING, "setNVPanID failed\n");
-			return -1;
-		}
 		consolePrint("Enter channel 11-26:\n");
 		consoleGetLine(sCh, 128);
-
-		status = setNVChanList(1 << atoi(sCh));
-		if (status != MT_RPC_SUCCESS)
-		{
-			dbg_print(PRINT_LEVEL_INFO, "setNVPanID failed\n");
-			return -1;
-		}
-
-	}
-
-	registerAf();
-	consolePrint("EndPoint: 1\n");
-
-	status = zdoInit();
-	if (status == NEW_NETWORK)
-	{
-		dbg_print(PRINT_LEVEL_INFO, "zdoInit NEW_NETWORK\n");
-		status = MT_RPC_SUCCESS;
+		cfg.chanList = 1 << atoi(sCh);
 	}
-	else if (status == RESTORED_NETWORK)
-	{
-		dbg_print(PRINT_LEVEL_INFO, "zdoInit RESTORED_NETWORK\n");
-		status = MT_RPC_SUCCESS;
-	}
-	else
-	{
-		dbg_print(PRINT_LEVEL_INFO, "zdoInit failed\n");
-		status = -1;
-	}
-
-	dbg_print(PRINT_LEVEL_INFO, "process zdoStatechange callbacks\n");
 
-	//flush AREQ ZDO State Change messages
-	while (status != -1)
+	status = netStart(&cfg);
+	netStartGetStats(&stats);
+	if (status != 0)
 	{
-		status = rpcWaitMqClientMsg(5000);
-
-		if (((devType == DEVICETYPE_COORDINATOR) && (devState == DEV_ZB_COORD))
-		        || ((devType == DEVICETYPE_ROUTER) && (devState == DEV_ROUTER))
-		        || ((devType == DEVICETYPE_ENDDEVICE)
-		                && (devState == DEV_END_DEVICE)))
-		{
-			break;
-		}
-	}
-	//set startup option back to keep configuration in case of reset
-	status = setNVStartup(0);
-	if (devState < DEV_END_DEVICE)
-	{
-		//start network failed
+		dbg_print(PRINT_LEVEL_WARNING, "network start failed\n");
 		return -1;
 	}
 
+	consolePrint("EndPoint: 1\n");
+	consolePrint("Network up in %dms (%s, %d NV writes)\n", stats.totalTime,
+	        stats.resumed ? "resumed" : "ZNP reset", stats.nvWrites);
+
 	return 0;
 }
 
@@ -528,14 +331,11 @@ uint32_t appInit(void)
 	int32_t status = 0;
 	uint32_t msgCnt = 0;
 
-	//Flush all messages from the que
-	while (status != -1)
+	//Flush all messages from the que, without waiting for more
+	status = rpcDrainMqClientMsg(0, 0);
+	if (status != -1)
 	{
-		status = rpcWaitMqClientMsg(10);
-		if (status != -1)
-		{
-			msgCnt++;
-		}
+		msgCnt = status;
 	}
 
 	dbg_print(PRINT_LEVEL_INFO, "flushed %d message from msg queue\n", msgCnt);
@@ -544,17 +344,25 @@ uint32_t appInit(void)
 	sysRegisterCallbacks(mtSysCb);
 	zdoRegisterCallbacks(mtZdoCb);
 
+	if (topoCrawlInit() != 0)
+	{
+		dbg_print(PRINT_LEVEL_ERROR, "appInit: topoCrawlInit failed\n");
+		return 1;
+	}
+	if (netStartInit() != 0)
+	{
+		dbg_print(PRINT_LEVEL_ERROR, "appInit: netStartInit failed\n");
+		return 1;
+	}
+
 	return 0;
 }
 
 void* appProcess(void *argument)
 {
 	int32_t status = 0;
-	//Flush all messages from the que
-	while (status != -1)
-	{
-		status = rpcWaitMqClientMsg(50);
-	}
+	//Flush all messages from the que, without waiting for more
+	rpcDrainMqClientMsg(0, 0);
 	//init variable
 	devState = DEV_HOLD;
 	gSrcEndPoint = 1;
@@ -580,46 +388,64 @@ void* appProcess(void *argument)
 	status = sysOsalNvWrite(&nvWrite);
 	status = 0;
 	char cmd[128];
-	MgmtLqiReqFormat_t req;
-	req.DstAddr = 0;
-	req.StartIndex = 0;
+	topoCrawlNode_t node, child;
+	topoCrawlLink_t link;
 	while (1)
 	{
 		consolePrint("Press Enter to discover Network Topology:\n");
 
 		consoleGetLine(cmd, 128);
-		nodeCount = 0;
+		crawlDone = 0;
 
-		zdoMgmtLqiReq(&req);
-		while (status != -1)
+		if (topoCrawlStart(0, topoCrawlDoneCb, NULL) != 0)
 		{
-			status = rpcWaitMqClientMsg(1000);
+			continue;
 		}
-		status = 0;
-		uint8_t i;
-		for (i = 0; i < nodeCount; i++)
+		while (!crawlDone)
 		{
+			rpcWaitMqClientMsg(1000);
+		}
+
+		uint16_t i, l;
+		for (i = 0; i < crawlResult.nodes; i++)
+		{
+			topoCrawlGetNode(i, &node);
+			if (node.state == TOPO_CRAWL_NODE_LEAF)
+			{
+				continue;
+			}
+
 			char *devtype = (
-			        nodeList[i].Type == DEVICETYPE_ROUTER ?
+			        node.devType == DEVICETYPE_ROUTER ?
 			                "ROUTER" : "END DEVICE");
-			if (nodeList[i].Type == DEVICETYPE_COORDINATOR)
+			if (node.devType == DEVICETYPE_COORDINATOR)
 			{
 				devtype = "COORDINATOR";
 			}
-			consolePrint("Node Address: 0x%04X   Type: %s\n",
-			        nodeList[i].NodeAddr, devtype);
+			consolePrint("Node Address: 0x%04X   Type: %s%s\n", node.nwkAddr,
+			        devtype,
+			        (node.state == TOPO_CRAWL_NODE_FAILED ?
+			                "   (no response)" : ""));
 
-			consolePrint("Children: %d\n", nodeList[i].ChildCount);
-			uint8_t cI;
-			for (cI = 0; cI < nodeList[i].ChildCount; cI++)
+			consolePrint("Children:\n");
+			for (l = 0; l < crawlResult.links; l++)
 			{
-				uint8_t type = nodeList[i].childs[cI].Type;
-				consolePrint("\tAddress: 0x%04X   Type: %s\n",
-				        nodeList[i].childs[cI].ChildAddr,
-				        (type == DEVICETYPE_ROUTER ? "ROUTER" : "END DEVICE"));
+				topoCrawlGetLink(l, &link);
+				if ((link.from != i)
+				        || (link.relation != TOPO_CRAWL_REL_CHILD))
+				{
+					continue;
+				}
+				topoCrawlGetNode(link.to, &child);
+				consolePrint("\tAddress: 0x%04X   Type: %s   LQI: %d\n",
+				        child.nwkAddr,
+				        (child.devType == DEVICETYPE_ROUTER ?
+				                "ROUTER" : "END DEVICE"), link.lqi);
 			}
 			consolePrint("\n");
 		}
+		consolePrint("%d nodes, %d routers did not respond, %d ms\n",
+		        crawlResult.nodes, crawlResult.failed, crawlResult.time);
 	}
 	return 0;
 }
@@ -53,11 +53,15 @@
 #include "rpcTransport.h"
 #include "dbgPrint.h"
 #include "hostConsole.h"
+#include "devIntv.h"
 
 /*********************************************************************
  * MACROS
  */
 
+// devices interviewed before are read from here at start up
+#define INTERVIEW_CACHE_FILE "servDisc.cache"
+
 /*********************************************************************
  * TYPES
  */
@@ -76,8 +80,6 @@ uint8_t gDstEndPoint = 1;
  */
 //ZDO Callbacks
 static uint8_t mtZdoStateChangeIndCb(uint8_t newDevState);
-static uint8_t mtZdoSimpleDescRspCb(SimpleDescRspFormat_t *msg);
-static uint8_t mtZdoActiveEpRspCb(ActiveEpRspFormat_t *msg);
 static uint8_t mtZdoEndDeviceAnnceIndCb(EndDeviceAnnceIndFormat_t *msg);
 
 //SYS Callbacks
@@ -91,6 +93,9 @@ static uint8_t setNVPanID(uint32_t panId);
 static uint8_t setNVDevType(uint8_t devType);
 static int32_t startNetwork(void);
 static int32_t registerAf(void);
+static void printDevice(devIntvDevice_t *dev);
+static void interviewCb(uint8_t status, uint64_t extAddr,
+        devIntvDevice_t *dev, void *arg);
 
 /*********************************************************************
  * CALLBACK FUNCTIONS
@@ -106,8 +111,8 @@ static mtZdoCb_t mtZdoCb =
 	        NULL,      // MT_ZDO_IEEE_ADDR_RSP
 	        NULL,      // MT_ZDO_NODE_DESC_RSP
 	        NULL,     // MT_ZDO_POWER_DESC_RSP
-	        mtZdoSimpleDescRspCb,    // MT_ZDO_SIMPLE_DESC_RSP
-	        mtZdoActiveEpRspCb,      // MT_ZDO_ACTIVE_EP_RSP
+	        NULL,    // MT_ZDO_SIMPLE_DESC_RSP
+	        NULL,      // MT_ZDO_ACTIVE_EP_RSP
 	        NULL,     // MT_ZDO_MATCH_DESC_RSP
 	        NULL,   // MT_ZDO_COMPLEX_DESC_RSP
 	        NULL,      // MT_ZDO_USER_DESC_RSP
@@ -213,71 +218,71 @@ static uint8_t mtZdoStateChangeIndCb(uint8_t newDevState)
 
 	return SUCCESS;
 }
-static uint8_t mtZdoSimpleDescRspCb(SimpleDescRspFormat_t *msg)
+static uint8_t mtZdoEndDeviceAnnceIndCb(EndDeviceAnnceIndFormat_t *msg)
 {
+	devIntvDevice_t dev;
+
+	consolePrint("\nNew device joined network.\nNwkAddr: 0x%04X\n",
+	        msg->NwkAddr);
 
-	if (msg->Status == MT_RPC_SUCCESS)
+	// a device interviewed before, even before a restart, is not
+	// interviewed again
+	if (devIntvStart(msg->NwkAddr, msg->IEEEAddr, interviewCb, NULL)
+	        == DEV_INTV_CACHED)
 	{
-		consolePrint("\tEndpoint: 0x%02X\n", msg->Endpoint);
-		consolePrint("\tProfileID: 0x%04X\n", msg->ProfileID);
-		consolePrint("\tDeviceID: 0x%04X\n", msg->DeviceID);
-		consolePrint("\tDeviceVersion: 0x%02X\n", msg->DeviceVersion);
-		consolePrint("\tNumInClusters: %d\n", msg->NumInClusters);
-		uint32_t i;
-		for (i = 0; i < msg->NumInClusters; i++)
+		if (devIntvGet(msg->IEEEAddr, &dev) == 0)
 		{
-			consolePrint("\t\tInClusterList[%d]: 0x%04X\n", i,
-			        msg->InClusterList[i]);
+			printDevice(&dev);
 		}
-		consolePrint("\tNumOutClusters: %d\n", msg->NumOutClusters);
-		for (i = 0; i < msg->NumOutClusters; i++)
-		{
-			consolePrint("\t\tOutClusterList[%d]: 0x%04X\n", i,
-			        msg->OutClusterList[i]);
-		}
-		consolePrint("\n");
 	}
-	else
-	{
-		consolePrint("SimpleDescRsp Status: FAIL 0x%02X\n", msg->Status);
-	}
-
-	return msg->Status;
+	return 0;
 }
-static uint8_t mtZdoActiveEpRspCb(ActiveEpRspFormat_t *msg)
-{
 
-	SimpleDescReqFormat_t simReq;
-	if (msg->Status == MT_RPC_SUCCESS)
+static void interviewCb(uint8_t status, uint64_t extAddr,
+        devIntvDevice_t *dev, void *arg)
+{
+	if (dev != NULL)
 	{
-		simReq.DstAddr = msg->NwkAddr;
-		simReq.NwkAddrOfInterest = msg->NwkAddr;
-		consolePrint("Number of Endpoints: %d\n", msg->ActiveEPCount);
-		uint32_t i;
-		for (i = 0; i < msg->ActiveEPCount; i++)
-		{
-			simReq.Endpoint = msg->ActiveEPList[i];
-			zdoSimpleDescReq(&simReq);
-		}
+		printDevice(dev);
 	}
 	else
 	{
-		consolePrint("ActiveEpRsp Status: FAIL 0x%02X\n", msg->Status);
+		consolePrint("Interview of 0x%016llX failed\n",
+		        (unsigned long long) extAddr);
 	}
-
-	return msg->Status;
 }
 
-static uint8_t mtZdoEndDeviceAnnceIndCb(EndDeviceAnnceIndFormat_t *msg)
+static void printDevice(devIntvDevice_t *dev)
 {
+	SimpleDescRspFormat_t *desc;
+	uint32_t ep, i;
 
-	ActiveEpReqFormat_t actReq;
-	actReq.DstAddr = msg->NwkAddr;
-	actReq.NwkAddrOfInterest = msg->NwkAddr;
-	consolePrint("\nNew device joined network.\nNwkAddr: 0x%04X\n",
-	        msg->NwkAddr);
-	zdoActiveEpReq(&actReq);
-	return 0;
+	consolePrint("Number of Endpoints: %d\n", dev->activeEndpoints);
+	if (dev->numEndpoints < dev->activeEndpoints)
+	{
+		consolePrint("Endpoints described: %d\n", dev->numEndpoints);
+	}
+	for (ep = 0; ep < dev->numEndpoints; ep++)
+	{
+		desc = &dev->endpoints[ep];
+		consolePrint("\tEndpoint: 0x%02X\n", desc->Endpoint);
+		consolePrint("\tProfileID: 0x%04X\n", desc->ProfileID);
+		consolePrint("\tDeviceID: 0x%04X\n", desc->DeviceID);
+		consolePrint("\tDeviceVersion: 0x%02X\n", desc->DeviceVersion);
+		consolePrint("\tNumInClusters: %d\n", desc->NumInClusters);
+		for (i = 0; i < desc->NumInClusters; i++)
+		{
+			consolePrint("\t\tInClusterList[%d]: 0x%04X\n", i,
+			        desc->InClusterList[i]);
+		}
+		consolePrint("\tNumOutClusters: %d\n", desc->NumOutClusters);
+		for (i = 0; i < desc->NumOutClusters; i++)
+		{
+			consolePrint("\t\tOutClusterList[%d]: 0x%04X\n", i,
+			        desc->OutClusterList[i]);
+		}
+		consolePrint("\n");
+	}
 }
 
 // helper functions for building and sending the NV messages
@@ -539,6 +544,11 @@ uint32_t appInit(void)
 	//Register Callbacks MT system callbacks
 	sysRegisterCallbacks(mtSysCb);
 	zdoRegisterCallbacks(mtZdoCb);
+	if (devIntvInit(INTERVIEW_CACHE_FILE) != 0)
+	{
+		dbg_print(PRINT_LEVEL_ERROR, "appInit: devIntvInit failed\n");
+		return 1;
+	}
 
 	return 0;
 }
@@ -53,11 +53,14 @@
 #include "rpcTransport.h"
 #include "dbgPrint.h"
 #include "hostConsole.h"
+#include "netStart.h"
+#include "devReg.h"
 
 /*********************************************************************
  * MACROS
  */
-#define MAX_TEST_NODES      10
+// test nodes are kept at their device registry index
+#define MAX_TEST_NODES      DEV_REG_MAX_DEVICES
 #define TEST_EP             1
 #define TEST_PRIFILE        0x0104
 #define TEST_CLUSTER        0x6
@@ -107,11 +110,11 @@ static uint8_t mtSysResetIndCb(ResetIndFormat_t *msg);
 static uint8_t mtAfDataConfirmCb(DataConfirmFormat_t *msg);
 static uint8_t mtAfIncomingMsgCb(IncomingMsgFormat_t *msg);
 
+//device registry callbacks
+static void devRegEventCb(uint8_t event, uint16_t idx, devRegDevice_t *dev,
+        uint16_t oldNwkAddr);
+
 //helper functions
-static uint8_t setNVStartup(uint8_t startupOption);
-static uint8_t setNVChanList(uint32_t chanList);
-static uint8_t setNVPanID(uint32_t panId);
-static uint8_t setNVDevType(uint8_t devType);
 static int32_t startNetwork(char *cDevType, char* sCh);
 static int32_t registerAf(void);
 static void sendTestMsg(uint16_t nodeAddr, uint8_t txSeqNum);
@@ -261,25 +264,46 @@ static uint8_t mtZdoStateChangeIndCb(uint8_t newDevState)
 
 static uint8_t mtZdoEndDeviceAnnceIndCb(EndDeviceAnnceIndFormat_t *msg)
 {
-	uint32_t nodeIdx;
+	int32_t nodeIdx;
 	consolePrint("\nNew device joined network.\n");
 
-	//find empty slot
-	for (nodeIdx = 0; nodeIdx < MAX_TEST_NODES; nodeIdx++)
+	//the device registry has already seen the announcement
+	nodeIdx = devRegFindNwk(msg->NwkAddr);
+	if (nodeIdx >= 0)
 	{
 		if (testNodes[nodeIdx].nodeAddr == 0)
 		{
 			consolePrint("found new test node: %04x \n", msg->NwkAddr);
 			testNodes[nodeIdx].txSeqNum = 0;
 			testNodes[nodeIdx].rxSeqNum = 0;
-			testNodes[nodeIdx].nodeAddr = msg->NwkAddr;
-			break;
 		}
+		//a rejoined node may have a new address
+		testNodes[nodeIdx].nodeAddr = msg->NwkAddr;
 	}
 
 	return 0;
 }
 
+/********************************************************************
+ * DEVICE REGISTRY CALL BACK FUNCTIONS
+ */
+
+static void devRegEventCb(uint8_t event, uint16_t idx, devRegDevice_t *dev,
+        uint16_t oldNwkAddr)
+{
+	//testNodes is indexed by registry slot, a slot freed by a device
+	//that left may be given to the next device registered
+	if (event == DEV_REG_REMOVED)
+	{
+		consolePrint("test node left: %04x \n", dev->nwkAddr);
+		memset(&testNodes[idx], 0, sizeof(testNode_t));
+	}
+	else if ((event == DEV_REG_NWK_CHANGED) && (testNodes[idx].nodeAddr != 0))
+	{
+		testNodes[idx].nodeAddr = dev->nwkAddr;
+	}
+}
+
 /********************************************************************
  * AF CALL BACK FUNCTIONS
  */
@@ -300,7 +324,7 @@ static uint8_t mtAfDataConfirmCb(DataConfirmFormat_t *msg)
 
 static uint8_t mtAfIncomingMsgCb(IncomingMsgFormat_t *msg)
 {
-	uint32_t nodeIdx;
+	int32_t nodeIdx;
 
 	dbg_print(PRINT_LEVEL_INFO, "Incoming message\n");
 
@@ -309,17 +333,15 @@ static uint8_t mtAfIncomingMsgCb(IncomingMsgFormat_t *msg)
 	{
 		if ((cDevType[0] == 'c') || (cDevType[0] == 'C'))
 		{
-			//find node in list and update rxSeq
-			for (nodeIdx = 0; nodeIdx < MAX_TEST_NODES; nodeIdx++)
+			//find node in the registry and update rxSeq
+			nodeIdx = devRegFindNwk(msg->SrcAddr);
+			if ((nodeIdx >= 0)
+			        && (testNodes[nodeIdx].nodeAddr == msg->SrcAddr))
 			{
-				if (testNodes[nodeIdx].nodeAddr == msg->SrcAddr)
-				{
-					dbg_print(PRINT_LEVEL_INFO,
-					        "test message ack recived from node: %04x, seq: %04x\n",
-					        msg->SrcAddr, msg->Data[0]);
-					testNodes[nodeIdx].rxSeqNum = (uint32_t)(msg->Data[0]);
-					break;
-				}
+				dbg_print(PRINT_LEVEL_INFO,
+				        "test message ack recived from node: %04x, seq: %04x\n",
+				        msg->SrcAddr, msg->Data[0]);
+				testNodes[nodeIdx].rxSeqNum = (uint32_t)(msg->Data[0]);
 			}
 		}
 		else
@@ -341,200 +363,52 @@ static uint8_t mtAfIncomingMsgCb(IncomingMsgFormat_t *msg)
 /********************************************************************
  * HELPER FUNCTIONS
  */
-// helper functions for building and sending the NV messages
-static uint8_t setNVStartup(uint8_t startupOption)
-{
-	uint8_t status;
-	OsalNvWriteFormat_t nvWrite;
-	// sending startup option
-
-	nvWrite.Id = ZCD_NV_STARTUP_OPTION;
-	nvWrite.Offset = 0;
-	nvWrite.Len = 1;
-	nvWrite.Value[0] = startupOption;
-	status = sysOsalNvWrite(&nvWrite);
-//	status = sysNvWrite(ZCD_NV_STARTUP_OPTION, 0, pbuf, 1);
-	dbg_print(PRINT_LEVEL_INFO, "\n");
-
-	dbg_print(PRINT_LEVEL_INFO, "NV Write Startup Option cmd sent[%d]...\n",
-	        status);
-
-	return status;
-}
-
-static uint8_t setNVDevType(uint8_t devType)
-{
-	uint8_t status;
-	OsalNvWriteFormat_t nvWrite;
-	//uint8_t pbuf[1];
-	// setting dev type
-	nvWrite.Id = ZCD_NV_LOGICAL_TYPE;
-	nvWrite.Offset = 0;
-	nvWrite.Len = 1;
-	nvWrite.Value[0] = devType;
-	status = sysOsalNvWrite(&nvWrite);
-	//pbuf[0] = devType;
-	//status = sysNvWrite(ZCD_NV_LOGICAL_TYPE, 0, pbuf, 1);
-	dbg_print(PRINT_LEVEL_INFO, "\n");
-	dbg_print(PRINT_LEVEL_INFO, "NV Write Device Type cmd sent... [%d]\n",
-	        status);
-
-	return status;
-}
-
-static uint8_t setNVPanID(uint32_t panId)
-{
-	uint8_t status;
-	OsalNvWriteFormat_t nvWrite;
-
-	dbg_print(PRINT_LEVEL_INFO, "\n");
-	dbg_print(PRINT_LEVEL_INFO, "NV Write PAN ID cmd sending...\n");
-
-	nvWrite.Id = ZCD_NV_PANID;
-	nvWrite.Offset = 0;
-	nvWrite.Len = 2;
-	nvWrite.Value[0] = LO_UINT16(panId);
-	nvWrite.Value[1] = HI_UINT16(panId);
-	status = sysOsalNvWrite(&nvWrite);
-	//status = sysNvWrite(ZCD_NV_PANID, 0, pbuf, 2);
-	dbg_print(PRINT_LEVEL_INFO, "\n");
-	dbg_print(PRINT_LEVEL_INFO, "NV Write PAN ID cmd sent...[%d]\n", status);
-
-	return status;
-}
-
-static uint8_t setNVChanList(uint32_t chanList)
-{
-	OsalNvWriteFormat_t nvWrite;
-	uint8_t status;
-	// setting chanList
-	nvWrite.Id = ZCD_NV_CHANLIST;
-	nvWrite.Offset = 0;
-	nvWrite.Len = 4;
-	nvWrite.Value[0] = BREAK_UINT32(chanList, 0);
-	nvWrite.Value[1] = BREAK_UINT32(chanList, 1);
-	nvWrite.Value[2] = BREAK_UINT32(chanList, 2);
-	nvWrite.Value[3] = BREAK_UINT32(chanList, 3);
-	status = sysOsalNvWrite(&nvWrite);
-	//status = sysNvWrite(ZCD_NV_CHANLIST, 0, pbuf, 4);
-	dbg_print(PRINT_LEVEL_INFO, "\n");
-	dbg_print(PRINT_LEVEL_INFO, "NV Write Channel List cmd sent...[%d]\n",
-	        status);
-
-	return status;
-}
-
 static int32_t startNetwork(char *cDevType, char* sCh)
 {
-	uint8_t devType;
+	netStartCfg_t cfg;
+	netStartStats_t stats;
 	int32_t status;
 
-	status = setNVStartup(
-	ZCD_STARTOPT_CLEAR_STATE | ZCD_STARTOPT_CLEAR_CONFIG);
-	consolePrint("Resetting ZNP\n");
-	ResetReqFormat_t resReq;
-	resReq.Type = 1;
-	sysResetReq(&resReq);
-	//flush the rsp
-	rpcWaitMqClientMsg(5000);
-
-	if (status != MT_RPC_SUCCESS)
-	{
-		dbg_print(PRINT_LEVEL_WARNING, "network start failed\n");
-		return 0;
-	}
-
 	switch (cDevType[0])
 	{
 	case 'c':
 	case 'C':
-		devType = DEVICETYPE_COORDINATOR;
+		cfg.devType = DEVICETYPE_COORDINATOR;
 		break;
 	case 'r':
 	case 'R':
-		devType = DEVICETYPE_ROUTER;
+		cfg.devType = DEVICETYPE_ROUTER;
 		break;
 	case 'e':
 	case 'E':
 	default:
-		devType = DEVICETYPE_ENDDEVICE;
+		cfg.devType = DEVICETYPE_ENDDEVICE;
 		break;
 	}
-	status = setNVDevType(devType);
 
-	if (status != MT_RPC_SUCCESS)
-	{
-		dbg_print(PRINT_LEVEL_WARNING, "setNVDevType failed\n");
-		return 0;
-	}
-	//Select random PAN ID for Coord and join any PAN for RTR/ED
-	status = setNVPanID(0xFFFF);
-	if (status != MT_RPC_SUCCESS)
+	//Resume the network in NV if it was started with the same settings,
+	//select random PAN ID for Coord and join any PAN for RTR/ED
+	cfg.mode = NET_START_AUTO;
+	cfg.panId = 0xFFFF;
+	cfg.chanList = 1 << atoi(sCh);
+	cfg.timeout = 0;
+	cfg.registerCb = registerAf;
+
+	status = netStart(&cfg);
+	netStartGetStats(&stats);
+	if (status != 0)
 	{
-		dbg_print(PRINT_LEVEL_WARNING, "setNVPanID failed\n");
-		return 0;
-	}
-
-	status = setNVChanList(1 << atoi(sCh));
-	if (status != MT_RPC_SUCCESS)
-	{
-		dbg_print(PRINT_LEVEL_INFO, "setNVPanID failed\n");
-		return 0;
+		dbg_print(PRINT_LEVEL_WARNING, "network start failed\n");
+		return -1;
 	}
 
-	registerAf();
 	consolePrint("EndPoint: 1\n");
-
-	status = zdoInit();
-	if (status == NEW_NETWORK)
+	if (stats.restored)
 	{
-		dbg_print(PRINT_LEVEL_INFO, "zdoInit NEW_NETWORK\n");
-		status = MT_RPC_SUCCESS;
-	}
-	else if (status == RESTORED_NETWORK)
-	{
-		dbg_print(PRINT_LEVEL_INFO, "zdoInit RESTORED_NETWORK\n");
 		consolePrint("Network Restored\n");
-		status = MT_RPC_SUCCESS;
-	}
-	else
-	{
-		dbg_print(PRINT_LEVEL_INFO, "zdoInit failed\n");
-		status = -1;
-	}
-
-	dbg_print(PRINT_LEVEL_INFO, "process zdoStatechange callbacks\n");
-
-	//flush AREQ ZDO State Change messages
-	while (status != -1)
-	{
-		status = rpcWaitMqClientMsg(5000);
-
-		if (((devType == DEVICETYPE_COORDINATOR) && (devState == DEV_ZB_COORD))
-		        || ((devType == DEVICETYPE_ROUTER) && (devState == DEV_ROUTER))
-		        || ((devType == DEVICETYPE_ENDDEVICE)
-		                && (devState == DEV_END_DEVICE)))
-		{
-			break;
-		}
-	}
-
-	if (devState < DEV_END_DEVICE)
-	{
-		//start network failed
-		return -1;
-	}
-	else
-	{
-		//set startup option back to keep configuration in case of reset
-		status = setNVStartup(0);
-		if (status != MT_RPC_SUCCESS)
-		{
-			dbg_print(PRINT_LEVEL_WARNING, "setNVStartup failed\n");
-			return -1;
-		}
-
 	}
+	consolePrint("Network up in %dms (%s, %d NV writes)\n", stats.totalTime,
+	        stats.resumed ? "resumed" : "ZNP reset", stats.nvWrites);
 
 	return 0;
 }
@@ -584,14 +458,11 @@ uint32_t appInit(void)
 	int32_t status = 0;
 	uint32_t msgCnt = 0;
 
-	//Flush all messages from the que
-	while (status != -1)
+	//Flush all messages from the que, without waiting for more
+	status = rpcDrainMqClientMsg(0, 0);
+	if (status != -1)
 	{
-		status = rpcWaitMqClientMsg(10);
-		if (status != -1)
-		{
-			msgCnt++;
-		}
+		msgCnt = status;
 	}
 
 	dbg_print(PRINT_LEVEL_INFO, "flushed %d message from msg queue\n", msgCnt);
@@ -604,6 +475,17 @@ uint32_t appInit(void)
 	//clear the node test addrs
 	memset(testNodes, 0, sizeof(testNodes));
 
+	if (devRegInit(devRegEventCb) != 0)
+	{
+		dbg_print(PRINT_LEVEL_ERROR, "appInit: devRegInit failed\n");
+		return 1;
+	}
+	if (netStartInit() != 0)
+	{
+		dbg_print(PRINT_LEVEL_ERROR, "appInit: netStartInit failed\n");
+		return 1;
+	}
+
 	return 0;
 }
 
@@ -612,7 +494,8 @@ void* appMsgProcess(void *argument)
 {
 	if (initDone)
 	{
-		rpcWaitMqClientMsg(100);
+		// process everything that arrived since the last wakeup
+		rpcDrainMqClientMsg(100, 0);
 	}
 
 	return 0;
@@ -627,11 +510,8 @@ void* appProcess(void *context)
 	struct timespec req;
 	struct timespec rem;
 
-	//Flush all messages from the que
-	do
-	{
-		status = rpcWaitMqClientMsg(50);
-	} while (status != -1);
+	//Flush all messages from the que, without waiting for more
+	rpcDrainMqClientMsg(0, 0);
 
 	devState = DEV_HOLD;
 
@@ -54,10 +54,34 @@
 #define HI_UINT16(a) (((a) >> 8) & 0xFF)
 #define LO_UINT16(a) ((a) & 0xFF)
 
+// pass a decoded message to the observers and then to the application,
+// unless an observer consumed it
+#define AF_NOTIFY(pfn, msg) \
+	do \
+	{ \
+		uint8_t obsIdx, consumed = 0; \
+		for (obsIdx = 0; obsIdx < mtAfObsCnt; obsIdx++) \
+		{ \
+			if (mtAfObs[obsIdx].pfn) \
+			{ \
+				consumed |= mtAfObs[obsIdx].pfn(msg); \
+			} \
+		} \
+		if (mtAfCbs.pfn && !consumed) \
+		{ \
+			mtAfCbs.pfn(msg); \
+		} \
+	} while (0)
+
 /*********************************************************************
  * LOCAL VARIABLE
  */
 static mtAfCb_t mtAfCbs;
+static mtAfCb_t mtAfObs[MT_AF_MAX_OBSERVERS];
+static uint8_t mtAfObsCnt = 0;
+// a callback of the application or of an observer for each message,
+// NULL if nobody wants it
+static mtAfCb_t mtAfAny;
 extern uint8_t srspRpcBuff[RPC_MAX_LEN];
 extern uint8_t srspRpcLen;
 
@@ -65,6 +89,7 @@ extern uint8_t srspRpcLen;
  * LOCAL FUNCTIONS
  */
 static void processSrsp(uint8_t *rpcBuff, uint8_t rpcLen);
+static void updateCallbacks(void);
 
 uint8_t afRegister(RegisterFormat_t *req)
 {
@@ -101,11 +126,6 @@ uint8_t afRegister(RegisterFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
 		MT_AF_REGISTER, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -117,8 +137,26 @@ uint8_t afRegister(RegisterFormat_t *req)
 }
 
 uint8_t afDataRequest(DataRequestFormat_t *req)
+{
+	return afDataRequestRsp(req, NULL);
+}
+
+/*********************************************************************
+ * @fn      afDataRequestRsp
+ *
+ * @brief   afDataRequest() returning the SRSP to the caller rather than in
+ *          the shared srspRpcBuff, which the next SREQ overwrites
+ *
+ * @param   req - Pointer to command specific structure
+ * @param   rspStatus - set to the status of the SRSP if MT_RPC_SUCCESS
+ *          is returned, NULL if not needed
+ *
+ * @return  status of the RPC
+ */
+uint8_t afDataRequestRsp(DataRequestFormat_t *req, uint8_t *rspStatus)
 {
 	uint8_t status;
+	uint8_t srsp[RPC_MAX_LEN];
 	uint8_t cmInd = 0;
 	uint32_t cmdLen = 10 + req->Len;
 	uint8_t *cmd = malloc(cmdLen);
@@ -144,12 +182,11 @@ uint8_t afDataRequest(DataRequestFormat_t *req)
 
 		}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
-		MT_AF_DATA_REQUEST, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
+		status = rpcSendFrameSrsp((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
+		MT_AF_DATA_REQUEST, cmd, cmdLen, srsp);
+		if ((status == MT_RPC_SUCCESS) && (rspStatus != NULL))
 		{
-			rpcWaitMqClientMsg(50);
+			*rspStatus = srsp[2];
 		}
 
 		free(cmd);
@@ -163,10 +200,30 @@ uint8_t afDataRequest(DataRequestFormat_t *req)
 }
 
 uint8_t afDataRequestExt(DataRequestExtFormat_t *req)
+{
+	return afDataRequestExtRsp(req, NULL);
+}
+
+/*********************************************************************
+ * @fn      afDataRequestExtRsp
+ *
+ * @brief   afDataRequestExt() returning the SRSP to the caller rather than in
+ *          the shared srspRpcBuff, which the next SREQ overwrites
+ *
+ * @param   req - Pointer to command specific structure
+ * @param   rspStatus - set to the status of the SRSP if MT_RPC_SUCCESS
+ *          is returned, NULL if not needed
+ *
+ * @return  status of the RPC
+ */
+uint8_t afDataRequestExtRsp(DataRequestExtFormat_t *req, uint8_t *rspStatus)
 {
 	uint8_t status;
+	uint8_t srsp[RPC_MAX_LEN];
 	uint8_t cmInd = 0;
-	uint32_t cmdLen = 20 + req->Len;
+	// a payload too long for the frame is sent later with AF_DATA_STORE
+	uint16_t dataLen = (req->Len > MT_AF_DATA_EXT_MAX_LEN) ? 0 : req->Len;
+	uint32_t cmdLen = 20 + dataLen;
 	uint8_t *cmd = malloc(cmdLen);
 
 	if (cmd)
@@ -188,17 +245,16 @@ uint8_t afDataRequestExt(DataRequestExtFormat_t *req)
 		cmd[cmInd++] = req->Radius;
 		cmd[cmInd++] = (uint8_t)(req->Len & 0xFF);
 		cmd[cmInd++] = (uint8_t)((req->Len >> 8) & 0xFF);
-		for (idx = 0; idx < req->Len; idx++)
+		for (idx = 0; idx < dataLen; idx++)
 		{
 			cmd[cmInd++] = req->Data[idx];
 		}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
-		MT_AF_DATA_REQUEST_EXT, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
+		status = rpcSendFrameSrsp((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
+		MT_AF_DATA_REQUEST_EXT, cmd, cmdLen, srsp);
+		if ((status == MT_RPC_SUCCESS) && (rspStatus != NULL))
 		{
-			rpcWaitMqClientMsg(50);
+			*rspStatus = srsp[2];
 		}
 
 		free(cmd);
@@ -212,8 +268,26 @@ uint8_t afDataRequestExt(DataRequestExtFormat_t *req)
 }
 
 uint8_t afDataRequestSrcRtg(DataRequestSrcRtgFormat_t *req)
+{
+	return afDataRequestSrcRtgRsp(req, NULL);
+}
+
+/*********************************************************************
+ * @fn      afDataRequestSrcRtgRsp
+ *
+ * @brief   afDataRequestSrcRtg() returning the SRSP to the caller rather than in
+ *          the shared srspRpcBuff, which the next SREQ overwrites
+ *
+ * @param   req - Pointer to command specific structure
+ * @param   rspStatus - set to the status of the SRSP if MT_RPC_SUCCESS
+ *          is returned, NULL if not needed
+ *
+ * @return  status of the RPC
+ */
+uint8_t afDataRequestSrcRtgRsp(DataRequestSrcRtgFormat_t *req, uint8_t *rspStatus)
 {
 	uint8_t status;
+	uint8_t srsp[RPC_MAX_LEN];
 	uint8_t cmInd = 0;
 	uint32_t cmdLen = 11 + (req->RelayCount * 2) + req->Len;
 	uint8_t *cmd = malloc(cmdLen);
@@ -244,12 +318,11 @@ uint8_t afDataRequestSrcRtg(DataRequestSrcRtgFormat_t *req)
 			cmd[cmInd++] = req->Data[idx];
 		}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
-		MT_AF_DATA_REQUEST_SRC_RTG, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
+		status = rpcSendFrameSrsp((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
+		MT_AF_DATA_REQUEST_SRC_RTG, cmd, cmdLen, srsp);
+		if ((status == MT_RPC_SUCCESS) && (rspStatus != NULL))
 		{
-			rpcWaitMqClientMsg(50);
+			*rspStatus = srsp[2];
 		}
 
 		free(cmd);
@@ -283,11 +356,6 @@ uint8_t afInterPanCtl(InterPanCtlFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
 		MT_AF_INTER_PAN_CTL, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -299,8 +367,26 @@ uint8_t afInterPanCtl(InterPanCtlFormat_t *req)
 }
 
 uint8_t afDataStore(DataStoreFormat_t *req)
+{
+	return afDataStoreRsp(req, NULL);
+}
+
+/*********************************************************************
+ * @fn      afDataStoreRsp
+ *
+ * @brief   afDataStore() returning the SRSP to the caller rather than in
+ *          the shared srspRpcBuff, which the next SREQ overwrites
+ *
+ * @param   req - Pointer to command specific structure
+ * @param   rspStatus - set to the status of the SRSP if MT_RPC_SUCCESS
+ *          is returned, NULL if not needed
+ *
+ * @return  status of the RPC
+ */
+uint8_t afDataStoreRsp(DataStoreFormat_t *req, uint8_t *rspStatus)
 {
 	uint8_t status;
+	uint8_t srsp[RPC_MAX_LEN];
 	uint8_t cmInd = 0;
 	uint32_t cmdLen = 3 + req->Length;
 	uint8_t *cmd = malloc(cmdLen);
@@ -318,12 +404,11 @@ uint8_t afDataStore(DataStoreFormat_t *req)
 			cmd[cmInd++] = req->Data[idx];
 		}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
-		MT_AF_DATA_STORE, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
+		status = rpcSendFrameSrsp((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
+		MT_AF_DATA_STORE, cmd, cmdLen, srsp);
+		if ((status == MT_RPC_SUCCESS) && (rspStatus != NULL))
 		{
-			rpcWaitMqClientMsg(50);
+			*rspStatus = srsp[2];
 		}
 
 		free(cmd);
@@ -338,7 +423,7 @@ uint8_t afDataStore(DataStoreFormat_t *req)
 
 static void processDataConfirm(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtAfCbs.pfnAfDataConfirm)
+	if (mtAfAny.pfnAfDataConfirm)
 	{
 		uint8_t msgIdx = 2;
 		DataConfirmFormat_t rsp;
@@ -352,13 +437,13 @@ static void processDataConfirm(uint8_t *rpcBuff, uint8_t rpcLen)
 		rsp.Endpoint = rpcBuff[msgIdx++];
 		rsp.TransId = rpcBuff[msgIdx++];
 
-		mtAfCbs.pfnAfDataConfirm(&rsp);
+		AF_NOTIFY(pfnAfDataConfirm, &rsp);
 	}
 }
 
 static void processIncomingMsg(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtAfCbs.pfnAfIncomingMsg)
+	if (mtAfAny.pfnAfIncomingMsg)
 	{
 		uint8_t msgIdx = 2;
 		IncomingMsgFormat_t rsp;
@@ -393,13 +478,13 @@ static void processIncomingMsg(uint8_t *rpcBuff, uint8_t rpcLen)
 				rsp.Data[i] = rpcBuff[msgIdx++];
 			}
 		}
-		mtAfCbs.pfnAfIncomingMsg(&rsp);
+		AF_NOTIFY(pfnAfIncomingMsg, &rsp);
 	}
 }
 
 static void processIncomingMsgExt(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtAfCbs.pfnAfIncomingMsgExt)
+	if (mtAfAny.pfnAfIncomingMsgExt)
 	{
 		uint8_t msgIdx = 2;
 		IncomingMsgExtFormat_t rsp;
@@ -436,20 +521,44 @@ static void processIncomingMsgExt(uint8_t *rpcBuff, uint8_t rpcLen)
 		for (i = 0; i < 4; i++)
 			rsp.TimeStamp |= ((uint32_t) rpcBuff[msgIdx++]) << (i * 8);
 		rsp.TransSeqNum = rpcBuff[msgIdx++];
-		rsp.Len = rpcBuff[msgIdx++];
-		uint32_t ind;
-		for (ind = 0; ind < rsp.Len; ind++)
+		rsp.Len = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
+		msgIdx += 2;
+		// a message too long for the frame has no data, it is kept in
+		// the ZNP under its TimeStamp for AF_DATA_RETRIEVE
+		if (rsp.Len <= MT_AF_INCOMING_EXT_MAX_LEN)
 		{
-			rsp.Data[ind] = rpcBuff[msgIdx++];
+			uint32_t ind;
+			for (ind = 0; ind < rsp.Len; ind++)
+			{
+				rsp.Data[ind] = rpcBuff[msgIdx++];
+			}
 		}
 
-		mtAfCbs.pfnAfIncomingMsgExt(&rsp);
+		AF_NOTIFY(pfnAfIncomingMsgExt, &rsp);
 	}
 }
 
 uint8_t afDataRetrieve(DataRetrieveFormat_t *req)
+{
+	return afDataRetrieveRsp(req, NULL);
+}
+
+/*********************************************************************
+ * @fn      afDataRetrieveRsp
+ *
+ * @brief   afDataRetrieve() returning the SRSP to the caller rather than in
+ *          the shared srspRpcBuff, which the next SREQ overwrites
+ *
+ * @param   req - Pointer to command specific structure
+ * @param   rsp - filled in with the SRSP if MT_RPC_SUCCESS is
+ *          returned, NULL if not needed
+ *
+ * @return  status of the RPC
+ */
+uint8_t afDataRetrieveRsp(DataRetrieveFormat_t *req, DataRetrieveSrspFormat_t *rsp)
 {
 	uint8_t status;
+	uint8_t srsp[RPC_MAX_LEN];
 	uint8_t cmInd = 0;
 	uint32_t cmdLen = 7;
 	uint8_t *cmd = malloc(cmdLen);
@@ -463,12 +572,17 @@ uint8_t afDataRetrieve(DataRetrieveFormat_t *req)
 		cmd[cmInd++] = (uint8_t)((req->Index >> 8) & 0xFF);
 		cmd[cmInd++] = req->Length;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
-		MT_AF_DATA_RETRIEVE, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
+		status = rpcSendFrameSrsp((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
+		MT_AF_DATA_RETRIEVE, cmd, cmdLen, srsp);
+		if ((status == MT_RPC_SUCCESS) && (rsp != NULL))
 		{
-			rpcWaitMqClientMsg(50);
+			rsp->Status = srsp[2];
+			rsp->Length = srsp[3];
+			if (rsp->Length > MT_AF_DATA_RETRIEVE_MAX_LEN)
+			{
+				rsp->Length = MT_AF_DATA_RETRIEVE_MAX_LEN;
+			}
+			memcpy(rsp->Data, &srsp[4], rsp->Length);
 		}
 
 		free(cmd);
@@ -483,7 +597,7 @@ uint8_t afDataRetrieve(DataRetrieveFormat_t *req)
 
 static void processDataRetrieveSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtAfCbs.pfnAfDataRetrieveSrsp)
+	if (mtAfAny.pfnAfDataRetrieveSrsp)
 	{
 		uint8_t msgIdx = 2;
 		DataRetrieveSrspFormat_t rsp;
@@ -503,7 +617,7 @@ static void processDataRetrieveSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 				rsp.Data[i] = rpcBuff[msgIdx++];
 			}
 		}
-		mtAfCbs.pfnAfDataRetrieveSrsp(&rsp);
+		AF_NOTIFY(pfnAfDataRetrieveSrsp, &rsp);
 	}
 }
 
@@ -524,11 +638,6 @@ uint8_t afApsfConfigSet(ApsfConfigSetFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
 		MT_AF_APSF_CONFIG_SET, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -541,7 +650,7 @@ uint8_t afApsfConfigSet(ApsfConfigSetFormat_t *req)
 
 static void processReflectError(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtAfCbs.pfnAfReflectError)
+	if (mtAfAny.pfnAfReflectError)
 	{
 		uint8_t msgIdx = 2;
 		ReflectErrorFormat_t rsp;
@@ -558,7 +667,7 @@ static void processReflectError(uint8_t *rpcBuff, uint8_t rpcLen)
 		rsp.DstAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
 		msgIdx += 2;
 
-		mtAfCbs.pfnAfReflectError(&rsp);
+		AF_NOTIFY(pfnAfReflectError, &rsp);
 	}
 }
 
@@ -574,6 +683,96 @@ static void processReflectError(uint8_t *rpcBuff, uint8_t rpcLen)
 void afRegisterCallbacks(mtAfCb_t cbs)
 {
 	memcpy(&mtAfCbs, &cbs, sizeof(mtAfCb_t));
+
+	updateCallbacks();
+}
+
+/*********************************************************************
+ * @fn      afRegisterObserver
+ *
+ * @brief   register callbacks of a framework module. Observers get
+ *          the messages before the application callbacks, which are
+ *          still called unless an observer returns non zero to
+ *          consume the message. NULL entries are ignored.
+ *
+ * @param   cbs - observer callbacks, registering the same callbacks
+ *          again has no effect
+ *
+ * @return  status, -1 if MT_AF_MAX_OBSERVERS are already registered
+ */
+int32_t afRegisterObserver(mtAfCb_t *cbs)
+{
+	uint8_t obsIdx;
+
+	for (obsIdx = 0; obsIdx < mtAfObsCnt; obsIdx++)
+	{
+		if (memcmp(&mtAfObs[obsIdx], cbs, sizeof(mtAfCb_t)) == 0)
+		{
+			return 0;
+		}
+	}
+
+	if (mtAfObsCnt >= MT_AF_MAX_OBSERVERS)
+	{
+		dbg_print(PRINT_LEVEL_WARNING, "afRegisterObserver: no free entry\n");
+		return -1;
+	}
+
+	memcpy(&mtAfObs[mtAfObsCnt++], cbs, sizeof(mtAfCb_t));
+
+	updateCallbacks();
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      updateCallbacks
+ *
+ * @brief   merge the application and observer callbacks and update
+ *          the AREQ filter
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+static void updateCallbacks(void)
+{
+	uint8_t idx;
+
+	memcpy(&mtAfAny, &mtAfCbs, sizeof(mtAfCb_t));
+	for (idx = 0; idx < mtAfObsCnt; idx++)
+	{
+		if (mtAfAny.pfnAfDataConfirm == NULL)
+		{
+			mtAfAny.pfnAfDataConfirm = mtAfObs[idx].pfnAfDataConfirm;
+		}
+		if (mtAfAny.pfnAfIncomingMsg == NULL)
+		{
+			mtAfAny.pfnAfIncomingMsg = mtAfObs[idx].pfnAfIncomingMsg;
+		}
+		if (mtAfAny.pfnAfIncomingMsgExt == NULL)
+		{
+			mtAfAny.pfnAfIncomingMsgExt = mtAfObs[idx].pfnAfIncomingMsgExt;
+		}
+		if (mtAfAny.pfnAfDataRetrieveSrsp == NULL)
+		{
+			mtAfAny.pfnAfDataRetrieveSrsp = mtAfObs[idx].pfnAfDataRetrieveSrsp;
+		}
+		if (mtAfAny.pfnAfReflectError == NULL)
+		{
+			mtAfAny.pfnAfReflectError = mtAfObs[idx].pfnAfReflectError;
+		}
+	}
+
+	//only let the RPC thread queue the AREQs we have a callback for
+	rpcAreqFilterCb(MT_RPC_SYS_AF, MT_AF_DATA_CONFIRM,
+	        (mtAfAny.pfnAfDataConfirm != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_AF, MT_AF_INCOMING_MSG,
+	        (mtAfAny.pfnAfIncomingMsg != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_AF, MT_AF_INCOMING_MSG_EXT,
+	        (mtAfAny.pfnAfIncomingMsgExt != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_AF, MT_AF_REFLECT_ERROR,
+	        (mtAfAny.pfnAfReflectError != NULL));
 }
 
 /*************************************************************************************************
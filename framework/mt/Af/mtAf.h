@@ -45,6 +45,21 @@ extern "C"
 
 #include <stdint.h>
 
+// maximum number of framework modules observing the AF messages, the
+// services take 8 and the rest is left to the application
+#define MT_AF_MAX_OBSERVERS (16)
+
+// data that fits in an AF_DATA_REQUEST_EXT frame, longer payloads are
+// staged in the ZNP with AF_DATA_STORE
+#define MT_AF_DATA_EXT_MAX_LEN   (230)
+// data that fits in an AF_DATA_STORE frame
+#define MT_AF_DATA_STORE_MAX_LEN (247)
+// data that fits in an AF_INCOMING_MSG_EXT frame, longer messages are
+// kept in the ZNP and read with AF_DATA_RETRIEVE
+#define MT_AF_INCOMING_EXT_MAX_LEN (223)
+// data that fits in an AF_DATA_RETRIEVE SRSP
+#define MT_AF_DATA_RETRIEVE_MAX_LEN (248)
+
 typedef uint16_t cId_t;
 // Simple Description Format Structure
 
@@ -129,6 +144,12 @@ typedef struct
 #define MT_AF_INCOMING_MSG_EXT               0x82
 #define MT_AF_REFLECT_ERROR                  0x83
 
+/* AF_DATA_REQUEST options */
+#define AF_ACK_REQUEST                       0x10
+#define AF_DISCV_ROUTE                       0x20
+#define AF_EN_SECURITY                       0x40
+#define AF_SKIP_ROUTING                      0x80
+
 #define afStatus_SUCCESS                     0x00
 #define afStatus_FAILED                      0x01
 #define afStatus_INVALID_PARAMETER           0x02
@@ -174,7 +195,7 @@ typedef struct
 	uint8_t Options;
 	uint8_t Radius;
 	uint16_t Len;
-	uint8_t Data[230];
+	uint8_t Data[MT_AF_DATA_EXT_MAX_LEN];
 } DataRequestExtFormat_t;
 
 typedef struct
@@ -202,7 +223,7 @@ typedef struct
 {
 	uint16_t Index;
 	uint8_t Length;
-	uint8_t Data[247];
+	uint8_t Data[MT_AF_DATA_STORE_MAX_LEN];
 } DataStoreFormat_t;
 
 typedef struct
@@ -242,8 +263,8 @@ typedef struct
 	uint8_t SecurityUse;
 	uint32_t TimeStamp;
 	uint8_t TransSeqNum;
-	uint8_t Len;
-	uint8_t Data[99];
+	uint16_t Len;
+	uint8_t Data[MT_AF_INCOMING_EXT_MAX_LEN];
 } IncomingMsgExtFormat_t;
 
 typedef struct
@@ -257,7 +278,7 @@ typedef struct
 {
 	uint8_t Status;
 	uint8_t Length;
-	uint8_t Data[248];
+	uint8_t Data[MT_AF_DATA_RETRIEVE_MAX_LEN];
 } DataRetrieveSrspFormat_t;
 
 typedef struct
@@ -292,6 +313,7 @@ typedef struct
 } mtAfCb_t;
 
 void afRegisterCallbacks(mtAfCb_t cbs);
+int32_t afRegisterObserver(mtAfCb_t *cbs);
 void afProcess(uint8_t *rpcBuff, uint8_t rpcLen);
 uint8_t afRegister(RegisterFormat_t *req);
 uint8_t afDataRequest(DataRequestFormat_t *req);
@@ -301,6 +323,13 @@ uint8_t afInterPanCtl(InterPanCtlFormat_t *req);
 uint8_t afDataStore(DataStoreFormat_t *req);
 uint8_t afDataRetrieve(DataRetrieveFormat_t *req);
 uint8_t afApsfConfigSet(ApsfConfigSetFormat_t *req);
+uint8_t afDataRequestRsp(DataRequestFormat_t *req, uint8_t *rspStatus);
+uint8_t afDataRequestExtRsp(DataRequestExtFormat_t *req, uint8_t *rspStatus);
+uint8_t afDataRequestSrcRtgRsp(DataRequestSrcRtgFormat_t *req,
+        uint8_t *rspStatus);
+uint8_t afDataStoreRsp(DataStoreFormat_t *req, uint8_t *rspStatus);
+uint8_t afDataRetrieveRsp(DataRetrieveFormat_t *req,
+        DataRetrieveSrspFormat_t *rsp);
 
 //uint8_t afRegisterExtended(SimpleDescriptionFormat_t *simpleDesc);
 //uint8_t afDataRequest(afAddrType_t *dstAddr, uint8_t srcEP, uint16_t cID,
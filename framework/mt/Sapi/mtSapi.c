@@ -140,11 +140,6 @@ uint8_t zbAppRegisterReq(AppRegisterReqFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
 		MT_SAPI_APP_REGISTER_REQ, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -172,11 +167,6 @@ uint8_t zbStartReq()
 	status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
 	MT_SAPI_START_REQ, NULL, 0);
 
-	if (status == MT_RPC_SUCCESS)
-	{
-		rpcWaitMqClientMsg(50);
-	}
-
 	return status;
 }
 
@@ -207,11 +197,6 @@ uint8_t zbPermitJoiningReq(PermitJoiningReqFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
 		MT_SAPI_PERMIT_JOINING_REQ, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -250,11 +235,6 @@ uint8_t zbBindDevice(BindDeviceFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
 		MT_SAPI_BIND_DEVICE, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -290,11 +270,6 @@ uint8_t zbAllowBind(AllowBindFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
 		MT_SAPI_ALLOW_BIND, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -344,11 +319,6 @@ uint8_t zbSendDataReq(SendDataReqFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
 		MT_SAPI_SEND_DATA_REQ, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -384,11 +354,6 @@ uint8_t zbFindDeviceReq(FindDeviceReqFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
 		MT_SAPI_FIND_DEVICE_REQ, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -430,11 +395,6 @@ uint8_t zbWriteConfiguration(WriteConfigurationFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
 		MT_SAPI_WRITE_CONFIGURATION, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -455,8 +415,27 @@ uint8_t zbWriteConfiguration(WriteConfigurationFormat_t *req)
  * @return   status, either Success (0) or Failure (1).
  */
 uint8_t zbGetDeviceInfo(GetDeviceInfoFormat_t *req)
+{
+	return zbGetDeviceInfoRsp(req, NULL);
+}
+
+/*********************************************************************
+ * @fn      zbGetDeviceInfoRsp
+ *
+ * @brief   zbGetDeviceInfo() returning the SRSP to the caller rather than
+ *           in the shared srspRpcBuff, which the next SREQ overwrites.
+ *
+ * @param   req - Pointer to command specific structure.
+ * @param   rsp - filled in with the SRSP if MT_RPC_SUCCESS is
+ *           returned, NULL if not needed.
+ *
+ * @return   status, either Success (0) or Failure (1).
+ */
+uint8_t zbGetDeviceInfoRsp(GetDeviceInfoFormat_t *req,
+        GetDeviceInfoSrspFormat_t *rsp)
 {
 	uint8_t status;
+	uint8_t srsp[RPC_MAX_LEN];
 	uint8_t cmInd = 0;
 	uint32_t cmdLen = 1;
 	uint8_t *cmd = malloc(cmdLen);
@@ -466,12 +445,12 @@ uint8_t zbGetDeviceInfo(GetDeviceInfoFormat_t *req)
 
 		cmd[cmInd++] = req->Param;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
-		MT_SAPI_GET_DEVICE_INFO, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
+		status = rpcSendFrameSrsp((MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
+		MT_SAPI_GET_DEVICE_INFO, cmd, cmdLen, srsp);
+		if ((status == MT_RPC_SUCCESS) && (rsp != NULL))
 		{
-			rpcWaitMqClientMsg(50);
+			rsp->Param = srsp[2];
+			memcpy(rsp->Value, &srsp[3], sizeof(rsp->Value));
 		}
 
 		free(cmd);
@@ -509,11 +488,6 @@ uint8_t zbReadConfiguration(ReadConfigurationFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
 		MT_SAPI_READ_CONFIGURATION, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -905,5 +879,19 @@ void sapiProcess(uint8_t *rpcBuff, uint8_t rpcLen)
 void sapiRegisterCallbacks(mtSapiCb_t cbs)
 {
 	memcpy(&mtSapiCbs, &cbs, sizeof(mtSapiCb_t));
+
+	//only let the RPC thread queue the AREQs we have a callback for
+	rpcAreqFilterCb(MT_RPC_SYS_SAPI, MT_SAPI_START_CNF,
+	        (mtSapiCbs.pfnSapiStartCnf != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_SAPI, MT_SAPI_BIND_CNF,
+	        (mtSapiCbs.pfnSapiBindCnf != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_SAPI, MT_SAPI_ALLOW_BIND_CNF,
+	        (mtSapiCbs.pfnSapiAllowBindCnf != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_SAPI, MT_SAPI_SEND_DATA_CNF,
+	        (mtSapiCbs.pfnSapiSendDataCnf != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_SAPI, MT_SAPI_FIND_DEVICE_CNF,
+	        (mtSapiCbs.pfnSapiFindDeviceCnf != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_SAPI, MT_SAPI_RECEIVE_DATA_IND,
+	        (mtSapiCbs.pfnSapiReceiveDataInd != NULL));
 }
 
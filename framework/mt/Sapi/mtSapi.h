@@ -74,6 +74,16 @@ extern "C"
 #define MT_SAPI_FIND_DEVICE_CNF                0x85
 #define MT_SAPI_RECEIVE_DATA_IND                0x87
 
+// GetDeviceInfoFormat_t Param
+#define ZB_INFO_DEV_STATE                   0x00
+#define ZB_INFO_IEEE_ADDR                   0x01
+#define ZB_INFO_SHORT_ADDR                  0x02
+#define ZB_INFO_PARENT_SHORT_ADDR           0x03
+#define ZB_INFO_PARENT_IEEE_ADDR            0x04
+#define ZB_INFO_CHANNEL                     0x05
+#define ZB_INFO_PAN_ID                      0x06
+#define ZB_INFO_EXT_PAN_ID                  0x07
+
 typedef struct
 {
 	uint8_t AppEndpoint;
@@ -223,6 +233,8 @@ uint8_t zbSendDataReq(SendDataReqFormat_t *req);
 uint8_t zbFindDeviceReq(FindDeviceReqFormat_t *req);
 uint8_t zbWriteConfiguration(WriteConfigurationFormat_t *req);
 uint8_t zbGetDeviceInfo(GetDeviceInfoFormat_t *req);
+uint8_t zbGetDeviceInfoRsp(GetDeviceInfoFormat_t *req,
+        GetDeviceInfoSrspFormat_t *rsp);
 uint8_t zbReadConfiguration(ReadConfigurationFormat_t *req);
 
 #ifdef __cplusplus
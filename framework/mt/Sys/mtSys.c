@@ -54,10 +54,34 @@
 #define HI_UINT16(a) (((a) >> 8) & 0xFF)
 #define LO_UINT16(a) ((a) & 0xFF)
 
+// pass a decoded AREQ to the observers and then to the application,
+// unless an observer consumed it
+#define SYS_NOTIFY(pfn, msg) \
+	do \
+	{ \
+		uint8_t obsIdx, consumed = 0; \
+		for (obsIdx = 0; obsIdx < mtSysObsCnt; obsIdx++) \
+		{ \
+			if (mtSysObs[obsIdx].pfn) \
+			{ \
+				consumed |= mtSysObs[obsIdx].pfn(msg); \
+			} \
+		} \
+		if (mtSysCbs.pfn && !consumed) \
+		{ \
+			mtSysCbs.pfn(msg); \
+		} \
+	} while (0)
+
 /*********************************************************************
  * LOCAL VARIABLE
  */
 static mtSysCb_t mtSysCbs;
+static mtSysCb_t mtSysObs[MT_SYS_MAX_OBSERVERS];
+static uint8_t mtSysObsCnt = 0;
+// a callback of the application or of an observer for each AREQ,
+// NULL if nobody wants it
+static mtSysCb_t mtSysAny;
 extern uint8_t srspRpcBuff[RPC_MAX_LEN];
 extern uint8_t srspRpcLen;
 
@@ -66,6 +90,7 @@ extern uint8_t srspRpcLen;
  */
 static void processSrsp(uint8_t *rpcBuff, uint8_t rpcLen);
 static void processResetInd(uint8_t *rpcBuff, uint8_t rpcLen);
+static void updateCallbacks(void);
 
 /*********************************************************************
  * @fn      sysPing
@@ -84,11 +109,6 @@ uint8_t sysPing()
 	status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
 	MT_SYS_PING, NULL, 0);
 
-	if (status == MT_RPC_SUCCESS)
-	{
-		rpcWaitMqClientMsg(50);
-	}
-
 	return status;
 }
 
@@ -148,11 +168,6 @@ uint8_t sysSetExtAddr(SetExtAddrFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
 		MT_SYS_SET_EXTADDR, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -179,11 +194,6 @@ uint8_t sysGetExtAddr()
 	status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
 	MT_SYS_GET_EXTADDR, NULL, 0);
 
-	if (status == MT_RPC_SUCCESS)
-	{
-		rpcWaitMqClientMsg(50);
-	}
-
 	return status;
 }
 
@@ -244,11 +254,6 @@ uint8_t sysRamRead(RamReadFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
 		MT_SYS_RAM_READ, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -329,11 +334,6 @@ uint8_t sysRamWrite(RamWriteFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
 		MT_SYS_RAM_WRITE, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -368,11 +368,6 @@ uint8_t sysResetReq(ResetReqFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_AREQ | MT_RPC_SYS_SYS),
 		MT_SYS_RESET_REQ, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -396,7 +391,7 @@ uint8_t sysResetReq(ResetReqFormat_t *req)
  */
 static void processResetInd(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtSysCbs.pfnSysResetInd)
+	if (mtSysAny.pfnSysResetInd)
 	{
 		uint8_t msgIdx = 2;
 		ResetIndFormat_t rsp;
@@ -414,7 +409,7 @@ static void processResetInd(uint8_t *rpcBuff, uint8_t rpcLen)
 		rsp.MinorRel = rpcBuff[msgIdx++];
 		rsp.HwRev = rpcBuff[msgIdx++];
 
-		mtSysCbs.pfnSysResetInd(&rsp);
+		SYS_NOTIFY(pfnSysResetInd, &rsp);
 	}
 }
 
@@ -435,11 +430,6 @@ uint8_t sysVersion()
 	status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
 	MT_SYS_VERSION, NULL, 0);
 
-	if (status == MT_RPC_SUCCESS)
-	{
-		rpcWaitMqClientMsg(50);
-	}
-
 	return status;
 }
 
@@ -488,8 +478,26 @@ static void processVersionSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
  * @return   status, either Success (0) or Failure (1).
  */
 uint8_t sysOsalNvRead(OsalNvReadFormat_t *req)
+{
+	return sysOsalNvReadRsp(req, NULL);
+}
+
+/*********************************************************************
+ * @fn      sysOsalNvReadRsp
+ *
+ * @brief   sysOsalNvRead() returning the SRSP to the caller rather than in
+ *           the shared srspRpcBuff, which the next SREQ overwrites.
+ *
+ * @param   req - Pointer to command specific structure.
+ * @param   rsp - filled in with the SRSP if MT_RPC_SUCCESS is
+ *           returned, NULL if not needed.
+ *
+ * @return   status, either Success (0) or Failure (1).
+ */
+uint8_t sysOsalNvReadRsp(OsalNvReadFormat_t *req, OsalNvReadSrspFormat_t *rsp)
 {
 	uint8_t status;
+	uint8_t srsp[RPC_MAX_LEN];
 	uint8_t cmInd = 0;
 	uint32_t cmdLen = 3;
 	uint8_t *cmd = malloc(cmdLen);
@@ -501,12 +509,17 @@ uint8_t sysOsalNvRead(OsalNvReadFormat_t *req)
 		cmd[cmInd++] = (uint8_t)((req->Id >> 8) & 0xFF);
 		cmd[cmInd++] = req->Offset;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
-		MT_SYS_OSAL_NV_READ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
+		status = rpcSendFrameSrsp((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
+		MT_SYS_OSAL_NV_READ, cmd, cmdLen, srsp);
+		if ((status == MT_RPC_SUCCESS) && (rsp != NULL))
 		{
-			rpcWaitMqClientMsg(50);
+			rsp->Status = srsp[2];
+			rsp->Len = srsp[3];
+			if (rsp->Len > sizeof(rsp->Value))
+			{
+				rsp->Len = sizeof(rsp->Value);
+			}
+			memcpy(rsp->Value, &srsp[4], rsp->Len);
 		}
 
 		free(cmd);
@@ -567,8 +580,26 @@ static void processOsalNvReadSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
  * @return   status, either Success (0) or Failure (1).
  */
 uint8_t sysOsalNvWrite(OsalNvWriteFormat_t *req)
+{
+	return sysOsalNvWriteRsp(req, NULL);
+}
+
+/*********************************************************************
+ * @fn      sysOsalNvWriteRsp
+ *
+ * @brief   sysOsalNvWrite() returning the SRSP to the caller rather than in
+ *           the shared srspRpcBuff, which the next SREQ overwrites.
+ *
+ * @param   req - Pointer to command specific structure.
+ * @param   rspStatus - set to the status of the SRSP if MT_RPC_SUCCESS
+ *           is returned, NULL if not needed.
+ *
+ * @return   status, either Success (0) or Failure (1).
+ */
+uint8_t sysOsalNvWriteRsp(OsalNvWriteFormat_t *req, uint8_t *rspStatus)
 {
 	uint8_t status;
+	uint8_t srsp[RPC_MAX_LEN];
 	uint8_t cmInd = 0;
 	uint32_t cmdLen = 4 + req->Len;
 	uint8_t *cmd = malloc(cmdLen);
@@ -587,12 +618,11 @@ uint8_t sysOsalNvWrite(OsalNvWriteFormat_t *req)
 			cmd[cmInd++] = req->Value[idx];
 		}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
-		MT_SYS_OSAL_NV_WRITE, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
+		status = rpcSendFrameSrsp((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
+		MT_SYS_OSAL_NV_WRITE, cmd, cmdLen, srsp);
+		if ((status == MT_RPC_SUCCESS) && (rspStatus != NULL))
 		{
-			rpcWaitMqClientMsg(50);
+			*rspStatus = srsp[2];
 		}
 
 		free(cmd);
@@ -616,8 +646,26 @@ uint8_t sysOsalNvWrite(OsalNvWriteFormat_t *req)
  * @return   status, either Success (0) or Failure (1).
  */
 uint8_t sysOsalNvItemInit(OsalNvItemInitFormat_t *req)
+{
+	return sysOsalNvItemInitRsp(req, NULL);
+}
+
+/*********************************************************************
+ * @fn      sysOsalNvItemInitRsp
+ *
+ * @brief   sysOsalNvItemInit() returning the SRSP to the caller rather than in
+ *           the shared srspRpcBuff, which the next SREQ overwrites.
+ *
+ * @param   req - Pointer to command specific structure.
+ * @param   rspStatus - set to the status of the SRSP if MT_RPC_SUCCESS
+ *           is returned, NULL if not needed.
+ *
+ * @return   status, either Success (0) or Failure (1).
+ */
+uint8_t sysOsalNvItemInitRsp(OsalNvItemInitFormat_t *req, uint8_t *rspStatus)
 {
 	uint8_t status;
+	uint8_t srsp[RPC_MAX_LEN];
 	uint8_t cmInd = 0;
 	uint32_t cmdLen = 5 + req->InitLen;
 	uint8_t *cmd = malloc(cmdLen);
@@ -637,12 +685,11 @@ uint8_t sysOsalNvItemInit(OsalNvItemInitFormat_t *req)
 			cmd[cmInd++] = req->InitData[idx];
 		}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
-		MT_SYS_OSAL_NV_ITEM_INIT, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
+		status = rpcSendFrameSrsp((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
+		MT_SYS_OSAL_NV_ITEM_INIT, cmd, cmdLen, srsp);
+		if ((status == MT_RPC_SUCCESS) && (rspStatus != NULL))
 		{
-			rpcWaitMqClientMsg(50);
+			*rspStatus = srsp[2];
 		}
 
 		free(cmd);
@@ -666,8 +713,26 @@ uint8_t sysOsalNvItemInit(OsalNvItemInitFormat_t *req)
  * @return   status, either Success (0) or Failure (1).
  */
 uint8_t sysOsalNvDelete(OsalNvDeleteFormat_t *req)
+{
+	return sysOsalNvDeleteRsp(req, NULL);
+}
+
+/*********************************************************************
+ * @fn      sysOsalNvDeleteRsp
+ *
+ * @brief   sysOsalNvDelete() returning the SRSP to the caller rather than in
+ *           the shared srspRpcBuff, which the next SREQ overwrites.
+ *
+ * @param   req - Pointer to command specific structure.
+ * @param   rspStatus - set to the status of the SRSP if MT_RPC_SUCCESS
+ *           is returned, NULL if not needed.
+ *
+ * @return   status, either Success (0) or Failure (1).
+ */
+uint8_t sysOsalNvDeleteRsp(OsalNvDeleteFormat_t *req, uint8_t *rspStatus)
 {
 	uint8_t status;
+	uint8_t srsp[RPC_MAX_LEN];
 	uint8_t cmInd = 0;
 	uint32_t cmdLen = 4;
 	uint8_t *cmd = malloc(cmdLen);
@@ -680,12 +745,11 @@ uint8_t sysOsalNvDelete(OsalNvDeleteFormat_t *req)
 		cmd[cmInd++] = (uint8_t)(req->ItemLen & 0xFF);
 		cmd[cmInd++] = (uint8_t)((req->ItemLen >> 8) & 0xFF);
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
-		MT_SYS_OSAL_NV_DELETE, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
+		status = rpcSendFrameSrsp((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
+		MT_SYS_OSAL_NV_DELETE, cmd, cmdLen, srsp);
+		if ((status == MT_RPC_SUCCESS) && (rspStatus != NULL))
 		{
-			rpcWaitMqClientMsg(50);
+			*rspStatus = srsp[2];
 		}
 
 		free(cmd);
@@ -709,8 +773,26 @@ uint8_t sysOsalNvDelete(OsalNvDeleteFormat_t *req)
  * @return   status, either Success (0) or Failure (1).
  */
 uint8_t sysOsalNvLength(OsalNvLengthFormat_t *req)
+{
+	return sysOsalNvLengthRsp(req, NULL);
+}
+
+/*********************************************************************
+ * @fn      sysOsalNvLengthRsp
+ *
+ * @brief   sysOsalNvLength() returning the SRSP to the caller rather than in
+ *           the shared srspRpcBuff, which the next SREQ overwrites.
+ *
+ * @param   req - Pointer to command specific structure.
+ * @param   rsp - filled in with the SRSP if MT_RPC_SUCCESS is
+ *           returned, NULL if not needed.
+ *
+ * @return   status, either Success (0) or Failure (1).
+ */
+uint8_t sysOsalNvLengthRsp(OsalNvLengthFormat_t *req, OsalNvLengthSrspFormat_t *rsp)
 {
 	uint8_t status;
+	uint8_t srsp[RPC_MAX_LEN];
 	uint8_t cmInd = 0;
 	uint32_t cmdLen = 2;
 	uint8_t *cmd = malloc(cmdLen);
@@ -721,12 +803,11 @@ uint8_t sysOsalNvLength(OsalNvLengthFormat_t *req)
 		cmd[cmInd++] = (uint8_t)(req->Id & 0xFF);
 		cmd[cmInd++] = (uint8_t)((req->Id >> 8) & 0xFF);
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
-		MT_SYS_OSAL_NV_LENGTH, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
+		status = rpcSendFrameSrsp((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
+		MT_SYS_OSAL_NV_LENGTH, cmd, cmdLen, srsp);
+		if ((status == MT_RPC_SUCCESS) && (rsp != NULL))
 		{
-			rpcWaitMqClientMsg(50);
+			rsp->ItemLen = BUILD_UINT16(srsp[2], srsp[3]);
 		}
 
 		free(cmd);
@@ -798,11 +879,6 @@ uint8_t sysOsalStartTimer(OsalStartTimerFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
 		MT_SYS_OSAL_START_TIMER, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -837,11 +913,6 @@ uint8_t sysOsalStopTimer(OsalStopTimerFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
 		MT_SYS_OSAL_STOP_TIMER, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -864,7 +935,7 @@ uint8_t sysOsalStopTimer(OsalStopTimerFormat_t *req)
  */
 static void processOsalTimerExpired(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtSysCbs.pfnSysOsalTimerExpired)
+	if (mtSysAny.pfnSysOsalTimerExpired)
 	{
 		uint8_t msgIdx = 2;
 		OsalTimerExpiredFormat_t rsp;
@@ -877,7 +948,7 @@ static void processOsalTimerExpired(uint8_t *rpcBuff, uint8_t rpcLen)
 
 		rsp.Id = rpcBuff[msgIdx++];
 
-		mtSysCbs.pfnSysOsalTimerExpired(&rsp);
+		SYS_NOTIFY(pfnSysOsalTimerExpired, &rsp);
 	}
 }
 
@@ -906,11 +977,6 @@ uint8_t sysStackTune(StackTuneFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
 		MT_SYS_STACK_TUNE, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -976,11 +1042,6 @@ uint8_t sysAdcRead(AdcReadFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
 		MT_SYS_ADC_READ, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -1047,11 +1108,6 @@ uint8_t sysGpio(GpioFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
 		MT_SYS_GPIO, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -1108,11 +1164,6 @@ uint8_t sysRandom()
 	status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
 	MT_SYS_RANDOM, NULL, 0);
 
-	if (status == MT_RPC_SUCCESS)
-	{
-		rpcWaitMqClientMsg(50);
-	}
-
 	return status;
 }
 
@@ -1181,11 +1232,6 @@ uint8_t sysSetTime(SetTimeFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
 		MT_SYS_SET_TIME, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -1212,11 +1258,6 @@ uint8_t sysGetTime()
 	status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
 	MT_SYS_GET_TIME, NULL, 0);
 
-	if (status == MT_RPC_SUCCESS)
-	{
-		rpcWaitMqClientMsg(50);
-	}
-
 	return status;
 }
 
@@ -1284,11 +1325,6 @@ uint8_t sysSetTxPower(SetTxPowerFormat_t *req)
 		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
 		MT_SYS_SET_TX_POWER, cmd, cmdLen);
 
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-		}
-
 		free(cmd);
 		return status;
 	}
@@ -1340,6 +1376,82 @@ static void processSetTxPowerSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 void sysRegisterCallbacks(mtSysCb_t cbs)
 {
 	memcpy(&mtSysCbs, &cbs, sizeof(mtSysCb_t));
+
+	updateCallbacks();
+}
+
+/*********************************************************************
+ * @fn      sysRegisterObserver
+ *
+ * @brief   register callbacks of a framework module. Observers get
+ *          the AREQs (MT_SYS_RESET_IND, MT_SYS_OSAL_TIMER_EXPIRED)
+ *          before the application callbacks, which are still called
+ *          unless an observer returns non zero to consume the message.
+ *          The SRSP entries are ignored.
+ *
+ * @param   cbs - observer callbacks, registering the same callbacks
+ *          again has no effect
+ *
+ * @return  status, -1 if MT_SYS_MAX_OBSERVERS are already registered
+ */
+int32_t sysRegisterObserver(mtSysCb_t *cbs)
+{
+	uint8_t obsIdx;
+
+	for (obsIdx = 0; obsIdx < mtSysObsCnt; obsIdx++)
+	{
+		if (memcmp(&mtSysObs[obsIdx], cbs, sizeof(mtSysCb_t)) == 0)
+		{
+			return 0;
+		}
+	}
+
+	if (mtSysObsCnt >= MT_SYS_MAX_OBSERVERS)
+	{
+		dbg_print(PRINT_LEVEL_WARNING, "sysRegisterObserver: no free entry\n");
+		return -1;
+	}
+
+	memcpy(&mtSysObs[mtSysObsCnt++], cbs, sizeof(mtSysCb_t));
+
+	updateCallbacks();
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      updateCallbacks
+ *
+ * @brief   merge the application and observer callbacks of the AREQs
+ *          and update the AREQ filter
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+static void updateCallbacks(void)
+{
+	uint8_t idx;
+
+	memcpy(&mtSysAny, &mtSysCbs, sizeof(mtSysCb_t));
+	for (idx = 0; idx < mtSysObsCnt; idx++)
+	{
+		if (mtSysAny.pfnSysResetInd == NULL)
+		{
+			mtSysAny.pfnSysResetInd = mtSysObs[idx].pfnSysResetInd;
+		}
+		if (mtSysAny.pfnSysOsalTimerExpired == NULL)
+		{
+			mtSysAny.pfnSysOsalTimerExpired =
+			        mtSysObs[idx].pfnSysOsalTimerExpired;
+		}
+	}
+
+	//only let the RPC thread queue the AREQs we have a callback for
+	rpcAreqFilterCb(MT_RPC_SYS_SYS, MT_SYS_RESET_IND,
+	        (mtSysAny.pfnSysResetInd != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_SYS, MT_SYS_OSAL_TIMER_EXPIRED,
+	        (mtSysAny.pfnSysOsalTimerExpired != NULL));
 }
 
 /*********************************************************************
@@ -45,6 +45,10 @@ extern "C"
 
 #include <stdint.h>
 
+// maximum number of framework modules observing the SYS AREQs, the
+// services take 1 and the rest is left to the application
+#define MT_SYS_MAX_OBSERVERS (4)
+
 /***************************************************************************************************
  * SYS COMMANDS
  ***************************************************************************************************/
@@ -472,6 +476,7 @@ typedef struct
                 (uint8_t)((uint32_t)(((var)>>((ByteNum) * 8)) & 0x00FF))
 
 void sysRegisterCallbacks(mtSysCb_t cbs);
+int32_t sysRegisterObserver(mtSysCb_t *cbs);
 void sysProcess(uint8_t *rpcBuff, uint8_t rpcLen);
 //uint8_t sysNvWrite(uint16_t NvItemId, uint8_t offset, uint8_t *data,
 //		uint8_t dataLen);
@@ -490,6 +495,12 @@ uint8_t sysOsalNvWrite(OsalNvWriteFormat_t *req);
 uint8_t sysOsalNvItemInit(OsalNvItemInitFormat_t *req);
 uint8_t sysOsalNvDelete(OsalNvDeleteFormat_t *req);
 uint8_t sysOsalNvLength(OsalNvLengthFormat_t *req);
+uint8_t sysOsalNvReadRsp(OsalNvReadFormat_t *req, OsalNvReadSrspFormat_t *rsp);
+uint8_t sysOsalNvWriteRsp(OsalNvWriteFormat_t *req, uint8_t *rspStatus);
+uint8_t sysOsalNvItemInitRsp(OsalNvItemInitFormat_t *req, uint8_t *rspStatus);
+uint8_t sysOsalNvDeleteRsp(OsalNvDeleteFormat_t *req, uint8_t *rspStatus);
+uint8_t sysOsalNvLengthRsp(OsalNvLengthFormat_t *req,
+        OsalNvLengthSrspFormat_t *rsp);
 uint8_t sysOsalStartTimer(OsalStartTimerFormat_t *req);
 uint8_t sysOsalStopTimer(OsalStopTimerFormat_t *req);
 uint8_t sysStackTune(StackTuneFormat_t *req);
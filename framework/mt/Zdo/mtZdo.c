@@ -55,10 +55,44 @@
  */
 #define STARTDELAY 0
 
+// calls the observers, then the application callback unless an
+// observer consumed the message
+#define ZDO_NOTIFY(pfn, msg) \
+	do \
+	{ \
+		uint8_t obsIdx, consumed = 0; \
+		for (obsIdx = 0; obsIdx < mtZdoObsCnt; obsIdx++) \
+		{ \
+			if (mtZdoObs[obsIdx].pfn) \
+			{ \
+				consumed |= mtZdoObs[obsIdx].pfn(msg); \
+			} \
+		} \
+		if (mtZdoCbs.pfn && !consumed) \
+		{ \
+			mtZdoCbs.pfn(msg); \
+		} \
+	} while (0)
+
+// takes the observer callback if nobody else wants the message
+#define ZDO_MERGE(pfn) \
+	do \
+	{ \
+		if (mtZdoAny.pfn == NULL) \
+		{ \
+			mtZdoAny.pfn = mtZdoObs[idx].pfn; \
+		} \
+	} while (0)
+
 /*********************************************************************
  * LOCAL VARIABLES
  */
 static mtZdoCb_t mtZdoCbs;
+static mtZdoCb_t mtZdoObs[MT_ZDO_MAX_OBSERVERS];
+static uint8_t mtZdoObsCnt = 0;
+// a callback of the application or of an observer for each message,
+// NULL if nobody wants it
+static mtZdoCb_t mtZdoAny;
 extern uint8_t srspRpcBuff[RPC_MAX_LEN];
 extern uint8_t srspRpcLen;
 
@@ -68,6 +102,8 @@ extern uint8_t srspRpcLen;
 static void processSrsp(uint8_t *rpcBuff, uint8_t rpcLen);
 static void processStateChange(uint8_t *rpcBuff, uint8_t rpcLen);
 static void processNwkAddrRsp(uint8_t *rpcBuff, uint8_t rpcLen);
+static void updateCallbacks(void);
+static uint8_t zdoSendSreq(uint8_t cmd1, uint8_t *cmd, uint32_t cmdLen);
 
 /*********************************************************************
  * @fn      processStateChange
@@ -83,12 +119,39 @@ static void processStateChange(uint8_t *rpcBuff, uint8_t rpcLen)
 
 	uint8_t zdoState = rpcBuff[2];
 	//passes the state to the callback function
-	if (mtZdoCbs.pfnmtZdoStateChangeInd)
+	if (mtZdoAny.pfnmtZdoStateChangeInd)
 	{
-		mtZdoCbs.pfnmtZdoStateChangeInd(zdoState);
+		ZDO_NOTIFY(pfnmtZdoStateChangeInd, zdoState);
 	}
 }
 
+/*********************************************************************
+ * @fn      zdoSendSreq
+ *
+ * @brief   send a ZDO SREQ and get the status of its SRSP, read from
+ *          a buffer of our own rather than the shared srspRpcBuff
+ *
+ * @param   cmd1 - MT_ZDO_xxx
+ * @param   cmd - payload
+ * @param   cmdLen - length of cmd
+ *
+ * @return  status of the SRSP, or the RPC error
+ */
+static uint8_t zdoSendSreq(uint8_t cmd1, uint8_t *cmd, uint32_t cmdLen)
+{
+	uint8_t srsp[RPC_MAX_LEN];
+	uint8_t status;
+
+	status = rpcSendFrameSrsp((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO), cmd1, cmd,
+	        cmdLen, srsp);
+	if (status == MT_RPC_SUCCESS)
+	{
+		status = srsp[2];
+	}
+
+	return status;
+}
+
 /*********************************************************************
  * @fn      zdoNwkAddrReq
  *
@@ -113,14 +176,7 @@ uint8_t zdoNwkAddrReq(NwkAddrReqFormat_t *req)
 		cmd[cmInd++] = req->ReqType;
 		cmd[cmInd++] = req->StartIndex;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_NWK_ADDR_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_NWK_ADDR_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -156,14 +212,7 @@ uint8_t zdoIeeeAddrReq(IeeeAddrReqFormat_t *req)
 		cmd[cmInd++] = req->ReqType;
 		cmd[cmInd++] = req->StartIndex;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_IEEE_ADDR_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_IEEE_ADDR_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -199,14 +248,7 @@ uint8_t zdoNodeDescReq(NodeDescReqFormat_t *req)
 		cmd[cmInd++] = (uint8_t)(req->NwkAddrOfInterest & 0xFF);
 		cmd[cmInd++] = (uint8_t)((req->NwkAddrOfInterest >> 8) & 0xFF);
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_NODE_DESC_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_NODE_DESC_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -242,14 +284,7 @@ uint8_t zdoPowerDescReq(PowerDescReqFormat_t *req)
 		cmd[cmInd++] = (uint8_t)(req->NwkAddrOfInterest & 0xFF);
 		cmd[cmInd++] = (uint8_t)((req->NwkAddrOfInterest >> 8) & 0xFF);
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_POWER_DESC_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_POWER_DESC_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -286,14 +321,7 @@ uint8_t zdoSimpleDescReq(SimpleDescReqFormat_t *req)
 		cmd[cmInd++] = (uint8_t)((req->NwkAddrOfInterest >> 8) & 0xFF);
 		cmd[cmInd++] = req->Endpoint;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_SIMPLE_DESC_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_SIMPLE_DESC_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -329,14 +357,7 @@ uint8_t zdoActiveEpReq(ActiveEpReqFormat_t *req)
 		cmd[cmInd++] = (uint8_t)(req->NwkAddrOfInterest & 0xFF);
 		cmd[cmInd++] = (uint8_t)((req->NwkAddrOfInterest >> 8) & 0xFF);
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_ACTIVE_EP_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_ACTIVE_EP_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -388,14 +409,7 @@ uint8_t zdoMatchDescReq(MatchDescReqFormat_t *req)
 			cmd[cmInd++] = (uint8_t)((req->OutClusterList[idx] >> 8) & 0xFF);
 		}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MATCH_DESC_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_MATCH_DESC_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -431,14 +445,7 @@ uint8_t zdoComplexDescReq(ComplexDescReqFormat_t *req)
 		cmd[cmInd++] = (uint8_t)(req->NwkAddrOfInterest & 0xFF);
 		cmd[cmInd++] = (uint8_t)((req->NwkAddrOfInterest >> 8) & 0xFF);
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_COMPLEX_DESC_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_COMPLEX_DESC_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -474,14 +481,7 @@ uint8_t zdoUserDescReq(UserDescReqFormat_t *req)
 		cmd[cmInd++] = (uint8_t)(req->NwkAddrOfInterest & 0xFF);
 		cmd[cmInd++] = (uint8_t)((req->NwkAddrOfInterest >> 8) & 0xFF);
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_USER_DESC_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_USER_DESC_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -518,14 +518,7 @@ uint8_t zdoDeviceAnnce(DeviceAnnceFormat_t *req)
 		cmInd += 8;
 		cmd[cmInd++] = req->Capabilities;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_DEVICE_ANNCE, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_DEVICE_ANNCE, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -568,14 +561,7 @@ uint8_t zdoUserDescSet(UserDescSetFormat_t *req)
 			cmd[cmInd++] = req->UserDescriptor[idx];
 		}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_USER_DESC_SET, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_USER_DESC_SET, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -609,14 +595,7 @@ uint8_t zdoServerDiscReq(ServerDiscReqFormat_t *req)
 		cmd[cmInd++] = (uint8_t)(req->ServerMask & 0xFF);
 		cmd[cmInd++] = (uint8_t)((req->ServerMask >> 8) & 0xFF);
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_SERVER_DISC_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_SERVER_DISC_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -671,14 +650,7 @@ uint8_t zdoEndDeviceBindReq(EndDeviceBindReqFormat_t *req)
 			cmd[cmInd++] = (uint8_t)((req->OutClusterList[idx] >> 8) & 0xFF);
 		}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_END_DEVICE_BIND_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_END_DEVICE_BIND_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -724,14 +696,7 @@ uint8_t zdoBindReq(BindReqFormat_t *req)
 		if (endP)
 			cmd[cmInd++] = req->DstEndpoint;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_BIND_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_BIND_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -777,14 +742,7 @@ uint8_t zdoUnbindReq(UnbindReqFormat_t *req)
 		if (endP)
 			cmd[cmInd++] = req->DstEndpoint;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_UNBIND_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_UNBIND_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -822,14 +780,7 @@ uint8_t zdoMgmtNwkDiscReq(MgmtNwkDiscReqFormat_t *req)
 		cmd[cmInd++] = req->ScanDuration;
 		cmd[cmInd++] = req->StartIndex;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MGMT_NWK_DISC_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_MGMT_NWK_DISC_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -864,14 +815,7 @@ uint8_t zdoMgmtLqiReq(MgmtLqiReqFormat_t *req)
 		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
 		cmd[cmInd++] = req->StartIndex;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MGMT_LQI_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_MGMT_LQI_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -906,14 +850,7 @@ uint8_t zdoMgmtRtgReq(MgmtRtgReqFormat_t *req)
 		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
 		cmd[cmInd++] = req->StartIndex;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MGMT_RTG_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_MGMT_RTG_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -948,14 +885,7 @@ uint8_t zdoMgmtBindReq(MgmtBindReqFormat_t *req)
 		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
 		cmd[cmInd++] = req->StartIndex;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MGMT_BIND_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_MGMT_BIND_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -992,14 +922,7 @@ uint8_t zdoMgmtLeaveReq(MgmtLeaveReqFormat_t *req)
 		cmInd += 8;
 		cmd[cmInd++] = req->RemoveChildre_Rejoin;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MGMT_LEAVE_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_MGMT_LEAVE_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -1036,14 +959,7 @@ uint8_t zdoMgmtDirectJoinReq(MgmtDirectJoinReqFormat_t *req)
 		cmInd += 8;
 		cmd[cmInd++] = req->CapInfo;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MGMT_DIRECT_JOIN_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_MGMT_DIRECT_JOIN_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -1080,14 +996,7 @@ uint8_t zdoMgmtPermitJoinReq(MgmtPermitJoinReqFormat_t *req)
 		cmd[cmInd++] = req->Duration;
 		cmd[cmInd++] = req->TCSignificance;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MGMT_PERMIT_JOIN_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_MGMT_PERMIT_JOIN_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -1128,14 +1037,7 @@ uint8_t zdoMgmtNwkUpdateReq(MgmtNwkUpdateReqFormat_t *req)
 		cmd[cmInd++] = (uint8_t)(req->NwkManagerAddr & 0xFF);
 		cmd[cmInd++] = (uint8_t)((req->NwkManagerAddr >> 8) & 0xFF);
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MGMT_NWK_UPDATE_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_MGMT_NWK_UPDATE_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -1168,14 +1070,7 @@ uint8_t zdoStartupFromApp(StartupFromAppFormat_t *req)
 
 		cmd[cmInd++] = LO_UINT16(req->StartDelay);
 		cmd[cmInd++] = HI_UINT16(req->StartDelay);
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_STARTUP_FROM_APP, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_STARTUP_FROM_APP, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -1208,14 +1103,7 @@ uint8_t zdoAutoFindDestination(AutoFindDestinationFormat_t *req)
 
 		cmd[cmInd++] = req->Endpoint;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_AUTO_FIND_DESTINATION, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_AUTO_FIND_DESTINATION, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -1253,14 +1141,7 @@ uint8_t zdoSetLinkKey(SetLinkKeyFormat_t *req)
 		memcpy((cmd + cmInd), req->LinkKeyData, 16);
 		cmInd += 16;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_SET_LINK_KEY, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_SET_LINK_KEY, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -1294,14 +1175,7 @@ uint8_t zdoRemoveLinkKey(RemoveLinkKeyFormat_t *req)
 		memcpy((cmd + cmInd), req->IEEEaddr, 8);
 		cmInd += 8;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_REMOVE_LINK_KEY, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_REMOVE_LINK_KEY, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -1335,14 +1209,7 @@ uint8_t zdoGetLinkKey(GetLinkKeyFormat_t *req)
 		memcpy((cmd + cmInd), req->IEEEaddr, 8);
 		cmInd += 8;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_GET_LINK_KEY, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_GET_LINK_KEY, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -1377,14 +1244,7 @@ uint8_t zdoNwkDiscoveryReq(NwkDiscoveryReqFormat_t *req)
 		cmInd += 4;
 		cmd[cmInd++] = req->ScanDuration;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_NWK_DISCOVERY_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_NWK_DISCOVERY_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -1425,14 +1285,7 @@ uint8_t zdoJoinReq(JoinReqFormat_t *req)
 		cmd[cmInd++] = req->ParentDepth;
 		cmd[cmInd++] = req->StackProfile;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_JOIN_REQ, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_JOIN_REQ, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -1466,14 +1319,7 @@ uint8_t zdoMsgCbRegister(MsgCbRegisterFormat_t *req)
 		cmd[cmInd++] = (uint8_t)(req->ClusterID & 0xFF);
 		cmd[cmInd++] = (uint8_t)((req->ClusterID >> 8) & 0xFF);
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MSG_CB_REGISTER, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_MSG_CB_REGISTER, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -1507,14 +1353,7 @@ uint8_t zdoMsgCbRemove(MsgCbRemoveFormat_t *req)
 		cmd[cmInd++] = (uint8_t)(req->ClusterID & 0xFF);
 		cmd[cmInd++] = (uint8_t)((req->ClusterID >> 8) & 0xFF);
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MSG_CB_REMOVE, cmd, cmdLen);
-
-		if (status == MT_RPC_SUCCESS)
-		{
-			rpcWaitMqClientMsg(50);
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_MSG_CB_REMOVE, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -1538,7 +1377,7 @@ uint8_t zdoMsgCbRemove(MsgCbRemoveFormat_t *req)
  */
 static void processGetLinkKey(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoGetLinkKey)
+	if (mtZdoAny.pfnZdoGetLinkKey)
 	{
 		uint8_t msgIdx = 2;
 		GetLinkKeySrspFormat_t rsp;
@@ -1557,7 +1396,7 @@ static void processGetLinkKey(uint8_t *rpcBuff, uint8_t rpcLen)
 		memcpy(rsp.LinkKeyData, &rpcBuff[msgIdx], 16);
 		msgIdx += 16;
 
-		mtZdoCbs.pfnZdoGetLinkKey(&rsp);
+		ZDO_NOTIFY(pfnZdoGetLinkKey, &rsp);
 	}
 }
 
@@ -1573,7 +1412,7 @@ static void processGetLinkKey(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processNwkAddrRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoNwkAddrRsp)
+	if (mtZdoAny.pfnZdoNwkAddrRsp)
 	{
 		uint8_t msgIdx = 2;
 		NwkAddrRspFormat_t rsp;
@@ -1604,7 +1443,7 @@ static void processNwkAddrRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 				msgIdx += 2;
 			}
 		}
-		mtZdoCbs.pfnZdoNwkAddrRsp(&rsp);
+		ZDO_NOTIFY(pfnZdoNwkAddrRsp, &rsp);
 	}
 }
 
@@ -1620,7 +1459,7 @@ static void processNwkAddrRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processIeeeAddrRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoIeeeAddrRsp)
+	if (mtZdoAny.pfnZdoIeeeAddrRsp)
 	{
 		uint8_t msgIdx = 2;
 		IeeeAddrRspFormat_t rsp;
@@ -1651,7 +1490,7 @@ static void processIeeeAddrRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 				msgIdx += 2;
 			}
 		}
-		mtZdoCbs.pfnZdoIeeeAddrRsp(&rsp);
+		ZDO_NOTIFY(pfnZdoIeeeAddrRsp, &rsp);
 	}
 }
 
@@ -1667,7 +1506,7 @@ static void processIeeeAddrRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processNodeDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoNodeDescRsp)
+	if (mtZdoAny.pfnZdoNodeDescRsp)
 	{
 		uint8_t msgIdx = 2;
 		NodeDescRspFormat_t rsp;
@@ -1700,7 +1539,7 @@ static void processNodeDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 		msgIdx += 2;
 		rsp.DescriptorCapabilities = rpcBuff[msgIdx++];
 
-		mtZdoCbs.pfnZdoNodeDescRsp(&rsp);
+		ZDO_NOTIFY(pfnZdoNodeDescRsp, &rsp);
 	}
 }
 
@@ -1716,7 +1555,7 @@ static void processNodeDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processPowerDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoPowerDescRsp)
+	if (mtZdoAny.pfnZdoPowerDescRsp)
 	{
 		uint8_t msgIdx = 2;
 		PowerDescRspFormat_t rsp;
@@ -1735,7 +1574,7 @@ static void processPowerDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 		rsp.CurrntPwrMode_AvalPwrSrcs = rpcBuff[msgIdx++];
 		rsp.CurrntPwrSrc_CurrntPwrSrcLvl = rpcBuff[msgIdx++];
 
-		mtZdoCbs.pfnZdoPowerDescRsp(&rsp);
+		ZDO_NOTIFY(pfnZdoPowerDescRsp, &rsp);
 	}
 }
 
@@ -1751,7 +1590,7 @@ static void processPowerDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processSimpleDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoSimpleDescRsp)
+	if (mtZdoAny.pfnZdoSimpleDescRsp)
 	{
 		uint8_t msgIdx = 2;
 		SimpleDescRspFormat_t rsp;
@@ -1792,7 +1631,7 @@ static void processSimpleDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 				msgIdx += 2;
 			}
 		}
-		mtZdoCbs.pfnZdoSimpleDescRsp(&rsp);
+		ZDO_NOTIFY(pfnZdoSimpleDescRsp, &rsp);
 	}
 }
 
@@ -1808,7 +1647,7 @@ static void processSimpleDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processActiveEpRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoActiveEpRsp)
+	if (mtZdoAny.pfnZdoActiveEpRsp)
 	{
 		uint8_t msgIdx = 2;
 		ActiveEpRspFormat_t rsp;
@@ -1833,7 +1672,7 @@ static void processActiveEpRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 				rsp.ActiveEPList[i] = rpcBuff[msgIdx++];
 			}
 		}
-		mtZdoCbs.pfnZdoActiveEpRsp(&rsp);
+		ZDO_NOTIFY(pfnZdoActiveEpRsp, &rsp);
 	}
 }
 
@@ -1849,7 +1688,7 @@ static void processActiveEpRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processMatchDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoMatchDescRsp)
+	if (mtZdoAny.pfnZdoMatchDescRsp)
 	{
 		uint8_t msgIdx = 2;
 		MatchDescRspFormat_t rsp;
@@ -1874,7 +1713,7 @@ static void processMatchDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 				rsp.MatchList[i] = rpcBuff[msgIdx++];
 			}
 		}
-		mtZdoCbs.pfnZdoMatchDescRsp(&rsp);
+		ZDO_NOTIFY(pfnZdoMatchDescRsp, &rsp);
 	}
 }
 
@@ -1890,7 +1729,7 @@ static void processMatchDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processComplexDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoComplexDescRsp)
+	if (mtZdoAny.pfnZdoComplexDescRsp)
 	{
 		uint8_t msgIdx = 2;
 		ComplexDescRspFormat_t rsp;
@@ -1915,7 +1754,7 @@ static void processComplexDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 				rsp.ComplexList[i] = rpcBuff[msgIdx++];
 			}
 		}
-		mtZdoCbs.pfnZdoComplexDescRsp(&rsp);
+		ZDO_NOTIFY(pfnZdoComplexDescRsp, &rsp);
 	}
 }
 
@@ -1931,7 +1770,7 @@ static void processComplexDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processUserDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoUserDescRsp)
+	if (mtZdoAny.pfnZdoUserDescRsp)
 	{
 		uint8_t msgIdx = 2;
 		UserDescRspFormat_t rsp;
@@ -1956,7 +1795,7 @@ static void processUserDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 				rsp.CUserDescriptor[i] = rpcBuff[msgIdx++];
 			}
 		}
-		mtZdoCbs.pfnZdoUserDescRsp(&rsp);
+		ZDO_NOTIFY(pfnZdoUserDescRsp, &rsp);
 	}
 }
 
@@ -1972,7 +1811,7 @@ static void processUserDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processUserDescConf(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoUserDescConf)
+	if (mtZdoAny.pfnZdoUserDescConf)
 	{
 		uint8_t msgIdx = 2;
 		UserDescConfFormat_t rsp;
@@ -1989,7 +1828,7 @@ static void processUserDescConf(uint8_t *rpcBuff, uint8_t rpcLen)
 		rsp.NwkAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
 		msgIdx += 2;
 
-		mtZdoCbs.pfnZdoUserDescConf(&rsp);
+		ZDO_NOTIFY(pfnZdoUserDescConf, &rsp);
 	}
 }
 
@@ -2005,7 +1844,7 @@ static void processUserDescConf(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processServerDiscRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoServerDiscRsp)
+	if (mtZdoAny.pfnZdoServerDiscRsp)
 	{
 		uint8_t msgIdx = 2;
 		ServerDiscRspFormat_t rsp;
@@ -2022,7 +1861,7 @@ static void processServerDiscRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 		rsp.ServerMask = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
 		msgIdx += 2;
 
-		mtZdoCbs.pfnZdoServerDiscRsp(&rsp);
+		ZDO_NOTIFY(pfnZdoServerDiscRsp, &rsp);
 	}
 }
 
@@ -2038,7 +1877,7 @@ static void processServerDiscRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processEndDeviceBindRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoEndDeviceBindRsp)
+	if (mtZdoAny.pfnZdoEndDeviceBindRsp)
 	{
 		uint8_t msgIdx = 2;
 		EndDeviceBindRspFormat_t rsp;
@@ -2053,7 +1892,7 @@ static void processEndDeviceBindRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 		msgIdx += 2;
 		rsp.Status = rpcBuff[msgIdx++];
 
-		mtZdoCbs.pfnZdoEndDeviceBindRsp(&rsp);
+		ZDO_NOTIFY(pfnZdoEndDeviceBindRsp, &rsp);
 	}
 }
 
@@ -2069,7 +1908,7 @@ static void processEndDeviceBindRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processBindRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoBindRsp)
+	if (mtZdoAny.pfnZdoBindRsp)
 	{
 		uint8_t msgIdx = 2;
 		BindRspFormat_t rsp;
@@ -2084,7 +1923,7 @@ static void processBindRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 		msgIdx += 2;
 		rsp.Status = rpcBuff[msgIdx++];
 
-		mtZdoCbs.pfnZdoBindRsp(&rsp);
+		ZDO_NOTIFY(pfnZdoBindRsp, &rsp);
 	}
 }
 
@@ -2100,7 +1939,7 @@ static void processBindRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processUnbindRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoUnbindRsp)
+	if (mtZdoAny.pfnZdoUnbindRsp)
 	{
 		uint8_t msgIdx = 2;
 		UnbindRspFormat_t rsp;
@@ -2115,7 +1954,7 @@ static void processUnbindRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 		msgIdx += 2;
 		rsp.Status = rpcBuff[msgIdx++];
 
-		mtZdoCbs.pfnZdoUnbindRsp(&rsp);
+		ZDO_NOTIFY(pfnZdoUnbindRsp, &rsp);
 	}
 }
 
@@ -2131,7 +1970,7 @@ static void processUnbindRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processMgmtNwkDiscRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoMgmtNwkDiscRsp)
+	if (mtZdoAny.pfnZdoMgmtNwkDiscRsp)
 	{
 		uint8_t msgIdx = 2;
 		MgmtNwkDiscRspFormat_t rsp;
@@ -2164,7 +2003,7 @@ static void processMgmtNwkDiscRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 				rsp.NetworkList[i].PermitJoin = rpcBuff[msgIdx++];
 			}
 		}
-		mtZdoCbs.pfnZdoMgmtNwkDiscRsp(&rsp);
+		ZDO_NOTIFY(pfnZdoMgmtNwkDiscRsp, &rsp);
 	}
 }
 
@@ -2180,7 +2019,7 @@ static void processMgmtNwkDiscRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processMgmtLqiRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoMgmtLqiRsp)
+	if (mtZdoAny.pfnZdoMgmtLqiRsp)
 	{
 		uint8_t msgIdx = 2;
 		MgmtLqiRspFormat_t rsp;
@@ -2224,7 +2063,7 @@ static void processMgmtLqiRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 			}
 		}
 		MgmtLqiRspFormat_t *copyy = &rsp;
-		mtZdoCbs.pfnZdoMgmtLqiRsp(copyy);
+		ZDO_NOTIFY(pfnZdoMgmtLqiRsp, copyy);
 	}
 }
 
@@ -2240,7 +2079,7 @@ static void processMgmtLqiRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processMgmtRtgRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoMgmtRtgRsp)
+	if (mtZdoAny.pfnZdoMgmtRtgRsp)
 	{
 		uint8_t msgIdx = 2;
 		MgmtRtgRspFormat_t rsp;
@@ -2271,7 +2110,7 @@ static void processMgmtRtgRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 				msgIdx += 2;
 			}
 		}
-		mtZdoCbs.pfnZdoMgmtRtgRsp(&rsp);
+		ZDO_NOTIFY(pfnZdoMgmtRtgRsp, &rsp);
 	}
 }
 
@@ -2287,7 +2126,7 @@ static void processMgmtRtgRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processMgmtBindRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoMgmtBindRsp)
+	if (mtZdoAny.pfnZdoMgmtBindRsp)
 	{
 		uint8_t msgIdx = 2;
 		MgmtBindRspFormat_t rsp;
@@ -2324,7 +2163,7 @@ static void processMgmtBindRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 				rsp.BindingTableList[i].DstEndpoint = rpcBuff[msgIdx++];
 			}
 		}
-		mtZdoCbs.pfnZdoMgmtBindRsp(&rsp);
+		ZDO_NOTIFY(pfnZdoMgmtBindRsp, &rsp);
 	}
 }
 
@@ -2340,7 +2179,7 @@ static void processMgmtBindRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processMgmtLeaveRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoMgmtLeaveRsp)
+	if (mtZdoAny.pfnZdoMgmtLeaveRsp)
 	{
 		uint8_t msgIdx = 2;
 		MgmtLeaveRspFormat_t rsp;
@@ -2355,7 +2194,7 @@ static void processMgmtLeaveRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 		msgIdx += 2;
 		rsp.Status = rpcBuff[msgIdx++];
 
-		mtZdoCbs.pfnZdoMgmtLeaveRsp(&rsp);
+		ZDO_NOTIFY(pfnZdoMgmtLeaveRsp, &rsp);
 	}
 }
 
@@ -2371,7 +2210,7 @@ static void processMgmtLeaveRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processMgmtDirectJoinRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoMgmtDirectJoinRsp)
+	if (mtZdoAny.pfnZdoMgmtDirectJoinRsp)
 	{
 		uint8_t msgIdx = 2;
 		MgmtDirectJoinRspFormat_t rsp;
@@ -2386,7 +2225,7 @@ static void processMgmtDirectJoinRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 		msgIdx += 2;
 		rsp.Status = rpcBuff[msgIdx++];
 
-		mtZdoCbs.pfnZdoMgmtDirectJoinRsp(&rsp);
+		ZDO_NOTIFY(pfnZdoMgmtDirectJoinRsp, &rsp);
 	}
 }
 
@@ -2402,7 +2241,7 @@ static void processMgmtDirectJoinRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processMgmtPermitJoinRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoMgmtPermitJoinRsp)
+	if (mtZdoAny.pfnZdoMgmtPermitJoinRsp)
 	{
 		uint8_t msgIdx = 2;
 		MgmtPermitJoinRspFormat_t rsp;
@@ -2417,7 +2256,7 @@ static void processMgmtPermitJoinRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 		msgIdx += 2;
 		rsp.Status = rpcBuff[msgIdx++];
 
-		mtZdoCbs.pfnZdoMgmtPermitJoinRsp(&rsp);
+		ZDO_NOTIFY(pfnZdoMgmtPermitJoinRsp, &rsp);
 	}
 }
 
@@ -2433,7 +2272,7 @@ static void processMgmtPermitJoinRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processEndDeviceAnnceInd(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoEndDeviceAnnceInd)
+	if (mtZdoAny.pfnZdoEndDeviceAnnceInd)
 	{
 		uint8_t msgIdx = 2;
 		EndDeviceAnnceIndFormat_t rsp;
@@ -2454,7 +2293,7 @@ static void processEndDeviceAnnceInd(uint8_t *rpcBuff, uint8_t rpcLen)
 			rsp.IEEEAddr |= ((uint64_t) rpcBuff[msgIdx++]) << (i * 8);
 		rsp.Capabilities = rpcBuff[msgIdx++];
 
-		mtZdoCbs.pfnZdoEndDeviceAnnceInd(&rsp);
+		ZDO_NOTIFY(pfnZdoEndDeviceAnnceInd, &rsp);
 	}
 }
 
@@ -2470,7 +2309,7 @@ static void processEndDeviceAnnceInd(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processMatchDescRspSent(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoMatchDescRspSent)
+	if (mtZdoAny.pfnZdoMatchDescRspSent)
 	{
 		uint8_t msgIdx = 2;
 		MatchDescRspSentFormat_t rsp;
@@ -2499,7 +2338,7 @@ static void processMatchDescRspSent(uint8_t *rpcBuff, uint8_t rpcLen)
 			msgIdx += 2;
 		}
 
-		mtZdoCbs.pfnZdoMatchDescRspSent(&rsp);
+		ZDO_NOTIFY(pfnZdoMatchDescRspSent, &rsp);
 	}
 }
 
@@ -2515,7 +2354,7 @@ static void processMatchDescRspSent(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processStatusErrorRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoStatusErrorRsp)
+	if (mtZdoAny.pfnZdoStatusErrorRsp)
 	{
 		uint8_t msgIdx = 2;
 		StatusErrorRspFormat_t rsp;
@@ -2530,7 +2369,7 @@ static void processStatusErrorRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 		msgIdx += 2;
 		rsp.Status = rpcBuff[msgIdx++];
 
-		mtZdoCbs.pfnZdoStatusErrorRsp(&rsp);
+		ZDO_NOTIFY(pfnZdoStatusErrorRsp, &rsp);
 	}
 }
 
@@ -2546,7 +2385,7 @@ static void processStatusErrorRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processSrcRtgInd(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoSrcRtgInd)
+	if (mtZdoAny.pfnZdoSrcRtgInd)
 	{
 		uint8_t msgIdx = 2;
 		SrcRtgIndFormat_t rsp;
@@ -2568,7 +2407,7 @@ static void processSrcRtgInd(uint8_t *rpcBuff, uint8_t rpcLen)
 			msgIdx += 2;
 		}
 
-		mtZdoCbs.pfnZdoSrcRtgInd(&rsp);
+		ZDO_NOTIFY(pfnZdoSrcRtgInd, &rsp);
 	}
 }
 /*********************************************************************
@@ -2583,7 +2422,7 @@ static void processSrcRtgInd(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processBeaconNotifyInd(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoBeaconNotifyInd)
+	if (mtZdoAny.pfnZdoBeaconNotifyInd)
 	{
 		uint8_t msgIdx = 2;
 		BeaconNotifyIndFormat_t rsp;
@@ -2623,7 +2462,7 @@ static void processBeaconNotifyInd(uint8_t *rpcBuff, uint8_t rpcLen)
 
 			}
 		}
-		mtZdoCbs.pfnZdoBeaconNotifyInd(&rsp);
+		ZDO_NOTIFY(pfnZdoBeaconNotifyInd, &rsp);
 	}
 }
 
@@ -2639,7 +2478,7 @@ static void processBeaconNotifyInd(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processJoinCnf(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoJoinCnf)
+	if (mtZdoAny.pfnZdoJoinCnf)
 	{
 		uint8_t msgIdx = 2;
 		JoinCnfFormat_t rsp;
@@ -2655,7 +2494,7 @@ static void processJoinCnf(uint8_t *rpcBuff, uint8_t rpcLen)
 		rsp.ParentAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
 		msgIdx += 2;
 
-		mtZdoCbs.pfnZdoJoinCnf(&rsp);
+		ZDO_NOTIFY(pfnZdoJoinCnf, &rsp);
 	}
 }
 
@@ -2671,7 +2510,7 @@ static void processJoinCnf(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processNwkDiscoveryCnf(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoNwkDiscoveryCnf)
+	if (mtZdoAny.pfnZdoNwkDiscoveryCnf)
 	{
 		uint8_t msgIdx = 2;
 		NwkDiscoveryCnfFormat_t rsp;
@@ -2683,7 +2522,7 @@ static void processNwkDiscoveryCnf(uint8_t *rpcBuff, uint8_t rpcLen)
 
 		rsp.Status = rpcBuff[msgIdx++];
 
-		mtZdoCbs.pfnZdoNwkDiscoveryCnf(&rsp);
+		ZDO_NOTIFY(pfnZdoNwkDiscoveryCnf, &rsp);
 	}
 }
 /*********************************************************************
@@ -2698,7 +2537,7 @@ static void processNwkDiscoveryCnf(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processLeaveInd(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoLeaveInd)
+	if (mtZdoAny.pfnZdoLeaveInd)
 	{
 		uint8_t msgIdx = 2;
 		LeaveIndFormat_t rsp;
@@ -2722,7 +2561,7 @@ static void processLeaveInd(uint8_t *rpcBuff, uint8_t rpcLen)
 		rsp.Remove = rpcBuff[msgIdx++];
 		rsp.Rejoin = rpcBuff[msgIdx++];
 
-		mtZdoCbs.pfnZdoLeaveInd(&rsp);
+		ZDO_NOTIFY(pfnZdoLeaveInd, &rsp);
 	}
 }
 
@@ -2738,7 +2577,7 @@ static void processLeaveInd(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processMsgCbIncoming(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoMsgCbIncoming)
+	if (mtZdoAny.pfnZdoMsgCbIncoming)
 	{
 		uint8_t msgIdx = 2;
 		MsgCbIncomingFormat_t rsp;
@@ -2770,7 +2609,7 @@ static void processMsgCbIncoming(uint8_t *rpcBuff, uint8_t rpcLen)
 		rsp.NotUsed = rpcBuff[msgIdx];
 		
 		
-		mtZdoCbs.pfnZdoMsgCbIncoming(&rsp);
+		ZDO_NOTIFY(pfnZdoMsgCbIncoming, &rsp);
 	}
 }
 
@@ -2796,19 +2635,7 @@ uint8_t zdoInit(void)
 		cmd[0] = LO_UINT16(STARTDELAY);
 		cmd[1] = HI_UINT16(STARTDELAY);
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_STARTUP_FROM_APP, cmd, cmdLen);
-
-		//read the SREQ from the queue
-		if (status == MT_RPC_SUCCESS)
-		{
-			//rpcSendFrame will block on the SRSP's, which will be
-			//pushed to the front of the queue
-			rpcWaitMqClientMsg(50);
-
-			//set status to status of srsp
-			status = srspRpcBuff[2];
-		}
+		status = zdoSendSreq(MT_ZDO_STARTUP_FROM_APP, cmd, cmdLen);
 
 		free(cmd);
 		return status;
@@ -3039,5 +2866,162 @@ static void processSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 void zdoRegisterCallbacks(mtZdoCb_t cbs)
 {
 	memcpy(&mtZdoCbs, &cbs, sizeof(mtZdoCb_t));
+
+	updateCallbacks();
+}
+
+/*********************************************************************
+ * @fn      zdoRegisterObserver
+ *
+ * @brief   register callbacks of a framework module. Observers get
+ *          the messages before the application callbacks, which are
+ *          still called unless an observer returns non zero to
+ *          consume the message. NULL entries are ignored.
+ *
+ * @param   cbs - observer callbacks, registering the same callbacks
+ *          again has no effect
+ *
+ * @return  status, -1 if MT_ZDO_MAX_OBSERVERS are already registered
+ */
+int32_t zdoRegisterObserver(mtZdoCb_t *cbs)
+{
+	uint8_t obsIdx;
+
+	for (obsIdx = 0; obsIdx < mtZdoObsCnt; obsIdx++)
+	{
+		if (memcmp(&mtZdoObs[obsIdx], cbs, sizeof(mtZdoCb_t)) == 0)
+		{
+			return 0;
+		}
+	}
+
+	if (mtZdoObsCnt >= MT_ZDO_MAX_OBSERVERS)
+	{
+		dbg_print(PRINT_LEVEL_WARNING, "zdoRegisterObserver: no free entry\n");
+		return -1;
+	}
+
+	memcpy(&mtZdoObs[mtZdoObsCnt++], cbs, sizeof(mtZdoCb_t));
+
+	updateCallbacks();
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      updateCallbacks
+ *
+ * @brief   merge the application and observer callbacks and set the
+ *          AREQ filter from them
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+static void updateCallbacks(void)
+{
+	uint8_t idx;
+
+	memcpy(&mtZdoAny, &mtZdoCbs, sizeof(mtZdoCb_t));
+	for (idx = 0; idx < mtZdoObsCnt; idx++)
+	{
+		ZDO_MERGE(pfnZdoNwkAddrRsp);
+		ZDO_MERGE(pfnZdoIeeeAddrRsp);
+		ZDO_MERGE(pfnZdoNodeDescRsp);
+		ZDO_MERGE(pfnZdoPowerDescRsp);
+		ZDO_MERGE(pfnZdoSimpleDescRsp);
+		ZDO_MERGE(pfnZdoActiveEpRsp);
+		ZDO_MERGE(pfnZdoMatchDescRsp);
+		ZDO_MERGE(pfnZdoComplexDescRsp);
+		ZDO_MERGE(pfnZdoUserDescRsp);
+		ZDO_MERGE(pfnZdoUserDescConf);
+		ZDO_MERGE(pfnZdoServerDiscRsp);
+		ZDO_MERGE(pfnZdoEndDeviceBindRsp);
+		ZDO_MERGE(pfnZdoBindRsp);
+		ZDO_MERGE(pfnZdoUnbindRsp);
+		ZDO_MERGE(pfnZdoMgmtNwkDiscRsp);
+		ZDO_MERGE(pfnZdoMgmtLqiRsp);
+		ZDO_MERGE(pfnZdoMgmtRtgRsp);
+		ZDO_MERGE(pfnZdoMgmtBindRsp);
+		ZDO_MERGE(pfnZdoMgmtLeaveRsp);
+		ZDO_MERGE(pfnZdoMgmtDirectJoinRsp);
+		ZDO_MERGE(pfnZdoMgmtPermitJoinRsp);
+		ZDO_MERGE(pfnmtZdoStateChangeInd);
+		ZDO_MERGE(pfnZdoEndDeviceAnnceInd);
+		ZDO_MERGE(pfnZdoSrcRtgInd);
+		ZDO_MERGE(pfnZdoBeaconNotifyInd);
+		ZDO_MERGE(pfnZdoJoinCnf);
+		ZDO_MERGE(pfnZdoNwkDiscoveryCnf);
+		ZDO_MERGE(pfnZdoConcentratorInd);
+		ZDO_MERGE(pfnZdoLeaveInd);
+		ZDO_MERGE(pfnZdoStatusErrorRsp);
+		ZDO_MERGE(pfnZdoMatchDescRspSent);
+		ZDO_MERGE(pfnZdoMsgCbIncoming);
+		ZDO_MERGE(pfnZdoGetLinkKey);
+	}
+
+	//only let the RPC thread queue the AREQs we have a callback for
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_NWK_ADDR_RSP,
+	        (mtZdoAny.pfnZdoNwkAddrRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_IEEE_ADDR_RSP,
+	        (mtZdoAny.pfnZdoIeeeAddrRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_NODE_DESC_RSP,
+	        (mtZdoAny.pfnZdoNodeDescRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_POWER_DESC_RSP,
+	        (mtZdoAny.pfnZdoPowerDescRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_SIMPLE_DESC_RSP,
+	        (mtZdoAny.pfnZdoSimpleDescRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_ACTIVE_EP_RSP,
+	        (mtZdoAny.pfnZdoActiveEpRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_MATCH_DESC_RSP,
+	        (mtZdoAny.pfnZdoMatchDescRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_COMPLEX_DESC_RSP,
+	        (mtZdoAny.pfnZdoComplexDescRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_USER_DESC_RSP,
+	        (mtZdoAny.pfnZdoUserDescRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_USER_DESC_CONF,
+	        (mtZdoAny.pfnZdoUserDescConf != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_SERVER_DISC_RSP,
+	        (mtZdoAny.pfnZdoServerDiscRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_END_DEVICE_BIND_RSP,
+	        (mtZdoAny.pfnZdoEndDeviceBindRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_BIND_RSP,
+	        (mtZdoAny.pfnZdoBindRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_UNBIND_RSP,
+	        (mtZdoAny.pfnZdoUnbindRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_MGMT_NWK_DISC_RSP,
+	        (mtZdoAny.pfnZdoMgmtNwkDiscRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_MGMT_LQI_RSP,
+	        (mtZdoAny.pfnZdoMgmtLqiRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_MGMT_RTG_RSP,
+	        (mtZdoAny.pfnZdoMgmtRtgRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_MGMT_BIND_RSP,
+	        (mtZdoAny.pfnZdoMgmtBindRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_MGMT_LEAVE_RSP,
+	        (mtZdoAny.pfnZdoMgmtLeaveRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_MGMT_DIRECT_JOIN_RSP,
+	        (mtZdoAny.pfnZdoMgmtDirectJoinRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_MGMT_PERMIT_JOIN_RSP,
+	        (mtZdoAny.pfnZdoMgmtPermitJoinRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_STATE_CHANGE_IND,
+	        (mtZdoAny.pfnmtZdoStateChangeInd != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_END_DEVICE_ANNCE_IND,
+	        (mtZdoAny.pfnZdoEndDeviceAnnceInd != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_MATCH_DESC_RSP_SENT,
+	        (mtZdoAny.pfnZdoMatchDescRspSent != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_STATUS_ERROR_RSP,
+	        (mtZdoAny.pfnZdoStatusErrorRsp != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_SRC_RTG_IND,
+	        (mtZdoAny.pfnZdoSrcRtgInd != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_BEACON_NOTIFY_IND,
+	        (mtZdoAny.pfnZdoBeaconNotifyInd != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_JOIN_CNF,
+	        (mtZdoAny.pfnZdoJoinCnf != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_NWK_DISCOVERY_CNF,
+	        (mtZdoAny.pfnZdoNwkDiscoveryCnf != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_LEAVE_IND,
+	        (mtZdoAny.pfnZdoLeaveInd != NULL));
+	rpcAreqFilterCb(MT_RPC_SYS_ZDO, MT_ZDO_MSG_CB_INCOMING,
+	        (mtZdoAny.pfnZdoMsgCbIncoming != NULL));
 }
 
@@ -144,6 +144,11 @@ extern "C"
 #define SUCCESS 0x00
 #define FAILURE 0x01
 #define MAX_MTU 0x0C
+
+// framework modules that can observe the ZDO messages, the services
+// take 11 and the rest is left to the application
+#define MT_ZDO_MAX_OBSERVERS 16
+
 #define HI_UINT16(a) (((a) >> 8) & 0xFF)
 #define LO_UINT16(a) ((a) & 0xFF)
 #define BREAK_UINT32(var, ByteNum) \
@@ -786,6 +791,7 @@ typedef struct
 } mtZdoCb_t;
 
 void zdoRegisterCallbacks(mtZdoCb_t cbs);
+int32_t zdoRegisterObserver(mtZdoCb_t *cbs);
 uint8_t zdoInit(void);
 uint8_t zdoNwkAddrReq(NwkAddrReqFormat_t *req);
 uint8_t zdoIeeeAddrReq(IeeeAddrReqFormat_t *req);
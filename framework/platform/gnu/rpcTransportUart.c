@@ -241,3 +241,24 @@ uint8_t rpcTransportRead(uint8_t* buf, uint8_t len)
 	return (ret);
 
 }
+
+/*********************************************************************
+ * @fn      rpcTransportPoll
+ *
+ * @brief   Reports whether bytes can be read without blocking.
+ *
+ * @param   -
+ *
+ * @return  number of bytes available (saturated at 255)
+ */
+uint8_t rpcTransportPoll(void)
+{
+	int bytes = 0;
+
+	if (ioctl(serialPortFd, FIONREAD, &bytes) < 0)
+	{
+		return 0;
+	}
+
+	return (bytes > 0xFF) ? 0xFF : (uint8_t) bytes;
+}
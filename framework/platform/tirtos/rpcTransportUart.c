@@ -192,3 +192,18 @@ uint8_t rpcTransportRead(uint8_t* buf, uint8_t len)
 
 	return ret;
 }
+
+/*********************************************************************
+ * @fn      rpcTransportPoll
+ *
+ * @brief   Reports whether bytes can be read without blocking.
+ *
+ * @param   -
+ *
+ * @return  number of bytes available, the TI-RTOS UART driver can not
+ *          report this so 0 is always returned
+ */
+uint8_t rpcTransportPoll(void)
+{
+	return 0;
+}
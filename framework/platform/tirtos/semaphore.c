@@ -178,13 +178,26 @@ int sem_wait(sem_t * sem)
 	return (sem_pend(sem, BIOS_WAIT_FOREVER));
 }
 
-int sem_timedwait(sem_t * sem, const struct timespec * abs_timeout)
+int sem_trywait(sem_t * sem)
 {
-	UInt timeout;
+	return (sem_pend(sem, BIOS_NO_WAIT));
+}
 
-	// calculate timeout
-	timeout = ((abs_timeout->tv_sec - time(0)) * (1000000UL / Clock_tickPeriod))
-	        + (abs_timeout->tv_nsec / (Clock_tickPeriod * 1000UL));
+int sem_timedwait(sem_t * sem, const struct timespec * abs_timeout)
+{
+	UInt timeout = BIOS_NO_WAIT;
+	struct timespec now;
+	int64_t us;
+
+	// calculate timeout, relative to the current time including its
+	// sub-second part
+	clock_gettime(CLOCK_REALTIME, &now);
+	us = ((int64_t) abs_timeout->tv_sec - (int64_t) now.tv_sec) * 1000000LL
+	        + (abs_timeout->tv_nsec - now.tv_nsec) / 1000L;
+	if (us > 0)
+	{
+		timeout = (UInt) (us / Clock_tickPeriod);
+	}
 
 	return (sem_pend(sem, timeout));
 }
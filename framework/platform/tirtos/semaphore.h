@@ -110,6 +110,8 @@ extern int sem_destroy(sem_t *sem);
 
 extern int sem_wait(sem_t * sem);
 
+extern int sem_trywait(sem_t * sem);
+
 extern int sem_timedwait(sem_t * sem, const struct timespec * abs_timeout);
 
 extern int sem_post(sem_t * sem);
@@ -96,10 +96,24 @@ time_t time(time_t * timer)
 
 int gettimeofday(struct timeval *tv, struct timezone *tz)
 {
+	//Clock_tickPeriod is num us per tick
+	uint64_t us = (uint64_t) Clock_getTicks() * Clock_tickPeriod;
+
 	(void) tz;
-	//Clock_tickPeriod is num ticks per us
-	tv->tv_sec = ((Clock_getTicks() * Clock_tickPeriod) / 1000000UL);
-	tv->tv_usec = (Clock_getTicks() * Clock_tickPeriod);
+	tv->tv_sec = (time_t) (us / 1000000UL);
+	tv->tv_usec = (long) (us % 1000000UL);
+
+	return 0;
+}
+
+int clock_gettime(clockid_t clk_id, struct timespec *tp)
+{
+	//Clock_tickPeriod is num us per tick
+	uint64_t us = (uint64_t) Clock_getTicks() * Clock_tickPeriod;
+
+	(void) clk_id;
+	tp->tv_sec = (time_t) (us / 1000000UL);
+	tp->tv_nsec = (long) (us % 1000000UL) * 1000L;
 
 	return 0;
 }
@@ -81,12 +81,19 @@ struct timezone
 
 typedef struct timespec timespec;
 
+// both clocks are based on the BIOS tick counter, which starts at boot
+typedef int clockid_t;
+
+#define CLOCK_REALTIME   (0)
+#define CLOCK_MONOTONIC  (1)
+
 /*********************************************************************
  * API FUNCTIONS
  */
 
 extern time_t time(time_t * timer);
 extern int gettimeofday(struct timeval *tv, struct timezone *tz);
+extern int clock_gettime(clockid_t clk_id, struct timespec *tp);
 extern int nanosleep(timespec* req, timespec* rem);
 #ifdef __cplusplus
 }
@@ -93,6 +93,44 @@ static void addToTail(llq_t *hndl, char *data, int length)
 	}
 }
 
+static int removeFromHead(llq_t *hndl, char *buffer)
+{
+	int rLength = 0;
+
+	if (hndl->head != NULL)
+	{
+		//wait to get access to the que
+		sem_wait(&(hndl->llqAccessSem));
+
+		hndl->temp = hndl->head->ptr;//将head的下一个节点存放到零时缓冲区
+		memcpy(buffer, hndl->head->data, hndl->head->length);//将Head节点的数据取出
+		rLength = (int) hndl->head->length; //获取Head节点数据的长度
+
+		//did head point to another element
+		//如果有多条数据即temp不为NULL
+		if (hndl->temp != NULL)
+		{
+			//free current head element and point head to next
+			free(hndl->head->data); //释放data空间
+			free(hndl->head);		//释放head空间
+			hndl->head = hndl->temp;//将temp数据指向Head指针
+		}
+		else
+		{
+			//no elements left in queue
+			free(hndl->head->data);
+			free(hndl->head);
+			hndl->head = NULL;
+			hndl->tail = NULL;
+		}
+
+		//release access sem
+		sem_post(&(hndl->llqAccessSem));
+	}
+
+	return rLength;
+}
+
 /*********************************************************************
  * @fn      llq_open
  *
@@ -146,36 +184,7 @@ int llq_timedreceive(llq_t *hndl, char *buffer, int maxLength,
 
 	if (sepmRnt != -1)
 	{
-		if (hndl->head != NULL)
-		{
-			//wait to get access to the que
-			sem_wait(&(hndl->llqAccessSem));
-
-			hndl->temp = hndl->head->ptr;//将head的下一个节点存放到零时缓冲区
-			memcpy(buffer, hndl->head->data, hndl->head->length);//将Head节点的数据取出
-			rLength = (int) hndl->head->length; //获取Head节点数据的长度
-
-			//did head point to another element
-			//如果有多条数据即temp不为NULL
-			if (hndl->temp != NULL)
-			{
-				//free current head element and point head to next
-				free(hndl->head->data); //释放data空间
-				free(hndl->head);		//释放head空间
-				hndl->head = hndl->temp;//将temp数据指向Head指针
-			}
-			else
-			{
-				//no elements left in queue
-				free(hndl->head->data);
-				free(hndl->head);
-				hndl->head = NULL;
-				hndl->tail = NULL;
-			}
-
-			//release access sem
-			sem_post(&(hndl->llqAccessSem));
-		}
+		rLength = removeFromHead(hndl, buffer);
 	}
 	else
 	{
@@ -200,6 +209,29 @@ int llq_receive(llq_t *hndl, char *buffer, int maxLength)
 	return llq_timedreceive(hndl, buffer, maxLength, NULL);
 }
 
+/*********************************************************************
+ * @fn      llq_tryreceive
+ *
+ * @brief   Read a message if one is queued, without blocking
+ *
+ * @param   llq_t *hndl - handle to queue to read the message from
+ * @Param	char *buffer - Pointer to buffer to read the message in to
+ * @Param	int maxLength - Max length of message to read
+ *
+ * @return   length of message read from queue, -1 if the queue is empty
+ */
+int llq_tryreceive(llq_t *hndl, char *buffer, int maxLength)
+{
+	int rLength = -1;
+
+	if (sem_trywait(&(hndl->llqCountSem)) == 0)
+	{
+		rLength = removeFromHead(hndl, buffer);
+	}
+
+	return rLength;
+}
+
 /*********************************************************************
  * @fn      llq_add
  *
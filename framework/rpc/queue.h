@@ -134,6 +134,19 @@ extern int llq_receive(llq_t *hndl, char *buffer, int maxLength);
 extern int llq_timedreceive(llq_t *hndl, char *buffer, int maxLength,
         const struct timespec * timeout);
 
+/*********************************************************************
+ * @fn      llq_tryreceive
+ *
+ * @brief   Read a message if one is queued, without blocking
+ *
+ * @param   llq_t *hndl - handle to queue to read the message from
+ * @Param	char *buffer - Pointer to buffer to read the message in to
+ * @Param	int maxLength - Max length of message to read
+ *
+ * @return   length of message read from queue, -1 if the queue is empty
+ */
+extern int llq_tryreceive(llq_t *hndl, char *buffer, int maxLength);
+
 #ifdef __cplusplus
 }
 #endif
@@ -56,6 +56,10 @@
 
 #include "rpc.h"
 #include "rpcTransport.h"
+#include "rpcDispatch.h"
+#include "rpcQos.h"
+#include "rpcTimer.h"
+#include "rpcRtt.h"
 #include "mtParser.h"
 #include "dbgPrint.h"
 
@@ -70,7 +74,6 @@
 #define SB_FORCE_BOOT              (0xF8)
 #define SB_FORCE_RUN               (SB_FORCE_BOOT ^ 0xFF)
 
-#define SRSP_TIMEOUT_MS            (2000) // 2000ms timeout
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -89,12 +92,59 @@ static sem_t rpcSem;
 static sem_t srspSem;
 
 // expected SRSP command ID
-static uint8_t expectedSrspCmdId;
+static uint8_t expectedSrspCmdId = 0xFF;
+static uint8_t expectedSrspCmd1;
 
-// RPC message queue for passing RPC frame from RPC process to APP process
+// SRSP handed over from the thread reading it to the SREQ waiting for it
+static uint8_t srspFrame[RPC_MAX_LEN];
+static uint8_t srspFrameLen;
+
+// SREQs given up on, their SRSPs may still come. The ZNP answers in
+// order, so they are known to be lost once an SRSP of another command
+// arrives.
+static uint8_t srspStaleCmd0 = 0xFF;
+static uint8_t srspStaleCmd1;
+static uint8_t srspStaleCnt = 0;
+
+// number of times an SREQ is sent again after an SRSP timeout
+static uint8_t rpcSrspRetries = 0;
+
+// RPC message queue for AREQs read by an SREQ waiting for its SRSP in
+// inline mode, frames for the APP process are queued per class by rpcQos
 //RPC消息队列
 static llq_t rpcLlq;
 
+// AREQ receive filter, one bit per (subsystem, cmd1). An AREQ is queued
+// if a callback is registered for it or it was explicitly accepted.
+static uint8_t rpcAreqFilterEnabled = 1;
+static uint8_t rpcAreqCbMask[MT_RPC_SYS_MAX][RPC_AREQ_FILTER_LEN];
+static uint8_t rpcAreqUserMask[MT_RPC_SYS_MAX][RPC_AREQ_FILTER_LEN];
+
+// number of AREQs dropped by the receive filter
+static uint32_t rpcAreqDropCnt = 0;
+
+// inline dispatch: frames are decoded and the callbacks invoked on the
+// thread calling rpcProcess() instead of being passed through rpcLlq
+static uint8_t rpcInlineEnabled = 0;
+
+// reader token, held by whichever thread is reading a frame from the
+// transport (the RPC thread, or an SREQ reading its own SRSP)
+static sem_t rpcRxSem;
+
+// set while the RPC thread is running callbacks in inline mode
+static volatile uint8_t rpcInlineBusy = 0;
+
+// set once the SRSP of the pending SREQ has been stored in srspFrame
+static volatile uint8_t srspReceived = 0;
+
+// posted for every frame processed in inline mode, so that
+// rpcWaitMqClientMsg() keeps its semantics for the application thread
+static sem_t rpcInlineEvtSem;
+
+// set when rpcInlineEvtSem was posted to wake up the application thread
+// for a timer rather than for a frame
+static volatile uint8_t rpcInlineKick = 0;
+
 /*********************************************************************
  * EXTERNAL VARIABLES
  */
@@ -109,6 +159,22 @@ static uint8_t calcFcs(uint8_t *msg, uint8_t len);
 // function for printing out RPC frames
 static void printRpcMsg(char* preMsg, uint8_t sof, uint8_t len, uint8_t *msg);
 
+// functions for reading and routing incoming RPC frames
+static int32_t rpcReadFrame(uint8_t *rpcBuff);
+static int32_t rpcHandleFrame(uint8_t *rpcBuff, uint8_t rpcLen, uint8_t pumped);
+
+// functions for inline dispatch
+static void rpcInlineProcess(uint8_t *rpcFrame, uint8_t rpcLen);
+static void rpcInlineDrain(void);
+
+// function for waiting for the SRSP of the pending SREQ
+static int32_t rpcWaitSrsp(uint64_t deadline);
+
+// functions for waiting on incoming frames
+static int32_t rpcTryFrame(uint8_t *rpcFrame);
+static int32_t rpcWaitFrame(uint8_t *rpcFrame, uint64_t deadline);
+static void rpcWakeConsumer(void);
+
 /*********************************************************************
  * API FUNCTIONS
  */
@@ -138,6 +204,8 @@ int32_t rpcOpen(char *_devicePath, uint32_t port)
 
 	sem_init(&rpcSem, 0, 1); // initialize mutex to 1 - binary semaphore
 	sem_init(&srspSem, 0, 0); // initialize mutex to 0 - binary semaphore
+	sem_init(&rpcRxSem, 0, 1); // reader token, free
+	sem_init(&rpcInlineEvtSem, 0, 0);
 
 	//rpcForceRun();
 
@@ -157,6 +225,8 @@ int32_t rpcInitMq(void)
 {
 
 	llq_open(&rpcLlq);
+	rpcQosInit();
+	rpcTimerInit(rpcWakeConsumer);
 	return 0;
 }
 
@@ -178,15 +248,18 @@ int32_t rpcGetMqClientMsg(void)
 	dbg_print(PRINT_LEVEL_INFO, "rpcWaitMqClient: waiting on queue\n");
 
 	// wait for incoming message queue
-	rpcLen = llq_receive(&rpcLlq, (char *) rpcFrame, RPC_MAX_LEN + 1);
+	rpcLen = rpcWaitFrame(rpcFrame, RPC_TIMER_NEVER);
 
 	if (rpcLen != -1)
 	{
-		dbg_print(PRINT_LEVEL_VERBOSE, "rpcWaitMqClient: processing MT[%d]\n",
-		        rpcLen);
+		if (!rpcInlineEnabled)
+		{
+			dbg_print(PRINT_LEVEL_VERBOSE,
+			        "rpcWaitMqClient: processing MT[%d]\n", rpcLen);
 
-		// process incoming message
-		mtProcess(rpcFrame, rpcLen);
+			// process incoming message, or hand it to its dispatch worker
+			rpcDispatchFrame(rpcFrame, rpcLen);
+		}
 	}
 	else
 	{
@@ -210,56 +283,79 @@ int32_t rpcGetMqClientMsg(void)
 int32_t rpcWaitMqClientMsg(uint32_t timeout)
 {
 	uint8_t rpcFrame[RPC_MAX_LEN + 1];
-	int32_t rpcLen, timeLeft = 0, mBefTime, mAftTime;
-	struct timespec to;
-	struct timeval befTime, aftTime;
-	
+	int32_t rpcLen;
+	uint64_t deadline, now;
+
 	// calculate timeout 计算超时时间
-	to.tv_sec = time(0) + (timeout / 1000); //秒
-	to.tv_nsec = (long) ((long) timeout % 1000) * 1000000L; //微秒
+	deadline = rpcTimerNow() + timeout;
 
 	dbg_print(PRINT_LEVEL_INFO, "rpcWaitMqClientMsg: timeout=%d\n", timeout);
-	dbg_print(PRINT_LEVEL_INFO,
-	        "rpcWaitMqClientMsg: waiting on queue %d:%d:%d\n", timeout,
-	        to.tv_sec, to.tv_nsec);
-
-	//获得当前精准时间(1970年1月1日到现在)
-	gettimeofday(&befTime, NULL);
 
 	//到队列中接收数据
-	rpcLen = llq_timedreceive(&rpcLlq, (char *) rpcFrame, RPC_MAX_LEN + 1, &to);
+	rpcLen = rpcWaitFrame(rpcFrame, deadline);
 
-	gettimeofday(&aftTime, NULL);
 	//有读取到数据
 	if (rpcLen != -1)
 	{
-		//获取运行llq_timedreceive前的时间
-		mBefTime = befTime.tv_sec * 1000;
-		mBefTime += befTime.tv_usec / 1000;
-
-		//获取运行llq_timedreceive后的时间
-		mAftTime = aftTime.tv_sec * 1000;
-		mAftTime += aftTime.tv_usec / 1000;
-		//得到llq_timedreceive运行的时间
-		timeLeft = mAftTime - mBefTime;
-
-		//剩余的空闲时间
-		timeLeft = timeout - timeLeft;
-		
-		dbg_print(PRINT_LEVEL_INFO, "rpcWaitMqClientMsg: processing MT[%d]\n",
-		        rpcLen);
-		// process incoming message
-		//处理MT的命令
-		mtProcess(rpcFrame, rpcLen);
+		if (!rpcInlineEnabled)
+		{
+			dbg_print(PRINT_LEVEL_INFO,
+			        "rpcWaitMqClientMsg: processing MT[%d]\n", rpcLen);
+			// process incoming message
+			//处理MT的命令
+			rpcDispatchFrame(rpcFrame, rpcLen);
+		}
 	}
 	else
 	{
-		dbg_print(PRINT_LEVEL_INFO, "rpcWaitMqClientMsg: Timed out [%d] - %s\n",
-		        rpcLen, strerror(errno));
+		dbg_print(PRINT_LEVEL_INFO, "rpcWaitMqClientMsg: Timed out\n");
 		return -1;
 	}
 
-	return timeLeft;
+	//剩余的空闲时间
+	now = rpcTimerNow();
+	return (now < deadline) ? (int32_t) (deadline - now) : 0;
+}
+
+/*********************************************************************
+ * @fn      rpcDrainMqClientMsg
+ *
+ * @brief   wait (with timeout) for incoming messages and process all the
+ *          queued ones, or up to maxMsgs, in a single wakeup
+ *
+ * @param   timeout - time to wait for the first message in ms
+ * @param   maxMsgs - maximum number of messages to process, 0 for no limit
+ *
+ * @return  number of messages processed, -1 on timeout
+ */
+int32_t rpcDrainMqClientMsg(uint32_t timeout, uint32_t maxMsgs)
+{
+	uint8_t rpcFrame[RPC_MAX_LEN + 1];
+	int32_t rpcLen;
+	uint32_t msgCnt = 0;
+
+	rpcLen = rpcWaitFrame(rpcFrame, rpcTimerNow() + timeout);
+	while (rpcLen != -1)
+	{
+		if (!rpcInlineEnabled)
+		{
+			// process incoming message, or hand it to its dispatch worker
+			rpcDispatchFrame(rpcFrame, rpcLen);
+		}
+
+		msgCnt++;
+		if ((maxMsgs != 0) && (msgCnt >= maxMsgs))
+		{
+			break;
+		}
+
+		rpcLen = rpcTryFrame(rpcFrame);
+	}
+
+	dbg_print(PRINT_LEVEL_VERBOSE, "rpcDrainMqClientMsg: processed %d\n",
+	        msgCnt);
+
+	return (msgCnt > 0) ? (int32_t) msgCnt : -1;
 }
 
 /*********************************************************************
@@ -289,9 +385,491 @@ void rpcForceRun(void)
  * @return  length of current Rx Buffer
  *************************************************************************************************/
 int32_t rpcProcess(void)
+{
+	uint8_t rpcBuff[RPC_MAX_LEN];
+	int32_t rpcLen;
+
+	if (rpcInlineEnabled)
+	{
+		// process AREQs read by an SREQ while we were busy in a callback
+		rpcInlineDrain();
+	}
+
+	// read a frame, an SREQ sent from a callback may be reading in parallel
+	sem_wait(&rpcRxSem);
+	rpcLen = rpcReadFrame(rpcBuff);
+	sem_post(&rpcRxSem);
+
+	if (rpcLen < 0)
+	{
+		return -1;
+	}
+
+	return rpcHandleFrame(rpcBuff, (uint8_t) rpcLen, 0);
+}
+
+/*************************************************************************************************
+ * @fn      rpcInlineDispatch()
+ *
+ * @brief   Enable or disable inline dispatch. When enabled rpcProcess() decodes incoming
+ *          frames and invokes the registered callbacks on the RPC thread, instead of
+ *          queuing them for rpcWaitMqClientMsg(). Callbacks may still send SREQs; the
+ *          SREQ then reads its SRSP from the transport itself. Must be called before
+ *          the RPC thread is started.
+ *
+ * @param   enable - 1 to dispatch inline, 0 to queue frames (default)
+ *
+ * @return  none
+ *************************************************************************************************/
+void rpcInlineDispatch(uint8_t enable)
+{
+	rpcInlineEnabled = (enable != 0);
+}
+
+/*************************************************************************************************
+ * @fn      rpcInlineDispatchEnabled()
+ *
+ * @brief   Check whether inline dispatch is enabled
+ *
+ * @param   none
+ *
+ * @return  1 if frames are dispatched on the RPC thread, 0 otherwise
+ *************************************************************************************************/
+uint8_t rpcInlineDispatchEnabled(void)
+{
+	return rpcInlineEnabled;
+}
+
+/*************************************************************************************************
+ * @fn      sendRpcFrame()
+ *
+ * @brief   builds the Frame and sends it to the transport layer - usually called by the
+ *          application thread(s)
+ *
+ * @param   cmd0 System, cmd1 subsystem, ptr to payload, lenght of payload
+ *
+ * @return  length of current Rx Buffer
+ *************************************************************************************************/
+uint8_t rpcSendFrame(uint8_t cmd0, uint8_t cmd1, uint8_t *payload,
+        uint8_t payload_len)
+{
+	return rpcSendFrameSrsp(cmd0, cmd1, payload, payload_len, NULL);
+}
+
+/*************************************************************************************************
+ * @fn      rpcSendFrameSrsp()
+ *
+ * @brief   Send a frame like rpcSendFrame() and copy the SRSP of an SREQ to a buffer of the
+ *          caller. srspRpcBuff is shared by all threads and may be overwritten by another
+ *          SREQ before the caller reads it, srsp is not. The SRSP is decoded, and its
+ *          callback invoked, before the next SREQ can be sent; SRSP callbacks must not
+ *          send SREQs.
+ *
+ * @param   cmd0 - cmd0 of the frame
+ * @param   cmd1 - cmd1 of the frame
+ * @param   payload - payload of the frame
+ * @param   payload_len - length of payload
+ * @param   srsp - RPC_MAX_LEN bytes filled in with the SRSP from cmd0 on, as in
+ *          srspRpcBuff, if MT_RPC_SUCCESS is returned. NULL if not needed.
+ *
+ * @return  status
+ *************************************************************************************************/
+uint8_t rpcSendFrameSrsp(uint8_t cmd0, uint8_t cmd1, uint8_t *payload,
+        uint8_t payload_len, uint8_t *srsp)
+{
+	uint8_t buf[RPC_MAX_LEN];
+	int32_t status = MT_RPC_SUCCESS;
+	uint8_t isSreq, attempt = 0, srspLen = 0;
+	uint32_t srspTimeout = 0;
+	uint64_t sentTime = 0;
+
+	isSreq = ((cmd0 & MT_RPC_CMD_TYPE_MASK) == MT_RPC_CMD_SREQ);
+
+	// block here if SREQ is in progress
+	dbg_print(PRINT_LEVEL_INFO, "rpcSendFrame: Blocking on RPC sem\n");
+	sem_wait(&rpcSem);
+	dbg_print(PRINT_LEVEL_INFO, "rpcSendFrame: Sending RPC\n");
+
+	// fill in header bytes
+	buf[0] = MT_RPC_SOF;
+	buf[1] = payload_len;
+	buf[2] = cmd0;
+	buf[3] = cmd1;
+
+	if (isSreq)
+	{
+		// calculate expected SRSP
+		expectedSrspCmdId = (cmd0 & MT_RPC_SUBSYSTEM_MASK);
+		expectedSrspCmd1 = cmd1;
+
+		// timeout from the round trip times seen for this command
+		srspTimeout = rpcRttTimeout(cmd0, cmd1);
+	}
+
+	if (payload_len > 0)
+	{
+		// copy payload to buffer
+		memcpy(buf + RPC_UART_HDR_LEN, payload, payload_len);
+	}
+
+	// calculate FCS field
+	buf[payload_len + RPC_UART_HDR_LEN] = calcFcs(
+	        &buf[RPC_UART_FRAME_START_IDX], payload_len + RPC_HDR_LEN);
+
+	do
+	{
+		srspReceived = 0;
+
+#ifdef HAL_UART_IP
+		// No SOF or FCS
+		rpcTransportWrite(buf+1, payload_len + RPC_HDR_LEN + RPC_UART_FCS_LEN);
+#else
+		// send out RPC  message
+		rpcTransportWrite(buf, payload_len + RPC_UART_HDR_LEN + RPC_UART_FCS_LEN);
+#endif
+
+		// print out message to be sent
+		printRpcMsg("SOC OUT -->", buf[0], payload_len, &buf[2]);
+
+		// wait for SRSP if necessary
+		if (isSreq)
+		{
+			sentTime = rpcTimerNow();
+
+			dbg_print(PRINT_LEVEL_INFO,
+			        "rpcSendFrame: waiting %dms for SRSP [%02x]\n",
+			        srspTimeout, expectedSrspCmdId);
+
+			//Wait for the SRSP
+			status = rpcWaitSrsp(sentTime + srspTimeout);
+			if (status == -1)
+			{
+				dbg_print(PRINT_LEVEL_WARNING,
+				        "rpcSendFrame: SRSP Error - CMD0: 0x%02X CMD1: 0x%02X\n",
+				        cmd0, cmd1);
+				status = MT_RPC_ERR_SUBSYSTEM;
+
+				// back off the timeout of this command
+				rpcRttBackoff(cmd0, cmd1);
+				srspTimeout = rpcRttTimeout(cmd0, cmd1);
+			}
+			else
+			{
+				dbg_print(PRINT_LEVEL_INFO, "rpcSendFrame: Receive SRSP\n");
+				status = MT_RPC_SUCCESS;
+
+				// a retried SREQ can not tell which transmission was
+				// answered, only first transmissions are sampled
+				if (attempt == 0)
+				{
+					rpcRttSample(cmd0, cmd1, (uint32_t) (rpcTimerNow() - sentTime));
+				}
+
+				// the frame is sent, reuse its buffer for the SRSP
+				srspLen = srspFrameLen;
+				memcpy(buf, srspFrame, srspLen);
+			}
+		}
+	} while (isSreq && (status != MT_RPC_SUCCESS) && (attempt++ < rpcSrspRetries));
+
+	if (isSreq)
+	{
+		//set expected SRSP to invalid
+		expectedSrspCmdId = 0xFF;
+
+		if (status != MT_RPC_SUCCESS)
+		{
+			// recognise the SRSP should it come late, see rpcHandleFrame()
+			if ((srspStaleCmd0 != (cmd0 & MT_RPC_SUBSYSTEM_MASK))
+			        || (srspStaleCmd1 != cmd1))
+			{
+				srspStaleCnt = 0;
+			}
+			srspStaleCmd0 = (cmd0 & MT_RPC_SUBSYSTEM_MASK);
+			srspStaleCmd1 = cmd1;
+			if (srspStaleCnt < 0xFF)
+			{
+				srspStaleCnt++;
+			}
+		}
+		else
+		{
+			// decode the SRSP before another SREQ can overwrite
+			// srspRpcBuff
+			mtProcess(buf, srspLen);
+			if (srsp != NULL)
+			{
+				memcpy(srsp, buf, srspLen);
+			}
+		}
+	}
+
+	//Unlock RPC sem
+	sem_post(&rpcSem);
+
+	return status;
+}
+
+/*************************************************************************************************
+ * @fn      rpcSetSrspRetries()
+ *
+ * @brief   Set how many times an SREQ is sent again when its SRSP times out. Each retry
+ *          doubles the timeout of the command. Only enable retries if the SREQs used are
+ *          safe to repeat, an SRSP may be late rather than lost.
+ *
+ * @param   retries - number of retries, 0 (default) to fail on the first timeout
+ *
+ * @return  none
+ *************************************************************************************************/
+void rpcSetSrspRetries(uint8_t retries)
+{
+	rpcSrspRetries = retries;
+}
+
+/*********************************************************************
+ * @fn      rpcAreqFilterEnable
+ *
+ * @brief   enable or disable the AREQ receive filter. When disabled
+ *          every AREQ is queued for the application.
+ *
+ * @param   enable - 1 to enable, 0 to disable
+ *
+ * @return  -
+ */
+void rpcAreqFilterEnable(uint8_t enable)
+{
+	rpcAreqFilterEnabled = enable;
+}
+
+/*********************************************************************
+ * @fn      rpcAreqFilterCb
+ *
+ * @brief   update the AREQ filter when a callback is (un)registered,
+ *          called by the MT subsystem modules.
+ *
+ * @param   subSys - MT subsystem (mtRpcSysType_t)
+ * @param   cmd1 - AREQ command ID
+ * @param   hasCb - 1 if a callback is registered for this AREQ
+ *
+ * @return  -
+ */
+void rpcAreqFilterCb(uint8_t subSys, uint8_t cmd1, uint8_t hasCb)
+{
+	if (subSys >= MT_RPC_SYS_MAX)
+	{
+		return;
+	}
+
+	if (hasCb)
+	{
+		rpcAreqCbMask[subSys][cmd1 >> 3] |= (1 << (cmd1 & 0x07));
+	}
+	else
+	{
+		rpcAreqCbMask[subSys][cmd1 >> 3] &= ~(1 << (cmd1 & 0x07));
+	}
+}
+
+/*********************************************************************
+ * @fn      rpcAreqFilterSet
+ *
+ * @brief   explicitly accept an AREQ regardless of the registered
+ *          callbacks, e.g. for an AREQ processed outside the MT modules.
+ *
+ * @param   subSys - MT subsystem (mtRpcSysType_t)
+ * @param   cmd1 - AREQ command ID
+ * @param   accept - 1 to always queue the AREQ, 0 to follow the callbacks
+ *
+ * @return  -
+ */
+void rpcAreqFilterSet(uint8_t subSys, uint8_t cmd1, uint8_t accept)
+{
+	if (subSys >= MT_RPC_SYS_MAX)
+	{
+		return;
+	}
+
+	if (accept)
+	{
+		rpcAreqUserMask[subSys][cmd1 >> 3] |= (1 << (cmd1 & 0x07));
+	}
+	else
+	{
+		rpcAreqUserMask[subSys][cmd1 >> 3] &= ~(1 << (cmd1 & 0x07));
+	}
+}
+
+/*********************************************************************
+ * @fn      rpcAreqFilterCheck
+ *
+ * @brief   check if an incoming AREQ passes the receive filter
+ *
+ * @param   cmd0 - Cmd0 of the AREQ
+ * @param   cmd1 - Cmd1 of the AREQ
+ *
+ * @return  1 if the AREQ should be queued, 0 if it should be dropped
+ */
+uint8_t rpcAreqFilterCheck(uint8_t cmd0, uint8_t cmd1)
+{
+	uint8_t subSys = cmd0 & MT_RPC_SUBSYSTEM_MASK;
+	uint8_t bit = (1 << (cmd1 & 0x07));
+
+	if (!rpcAreqFilterEnabled)
+	{
+		return 1;
+	}
+
+	if (subSys >= MT_RPC_SYS_MAX)
+	{
+		return 0;
+	}
+
+	return (((rpcAreqCbMask[subSys][cmd1 >> 3] | rpcAreqUserMask[subSys][cmd1
+	        >> 3]) & bit) != 0);
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      rpcTryFrame
+ *
+ * @brief   take an incoming frame without blocking. In inline mode the
+ *          frames are processed by the RPC thread and only its report
+ *          is taken.
+ *
+ * @param   rpcFrame - buffer of RPC_MAX_LEN + 1 bytes for the frame
+ *
+ * @return  length of the frame (0 in inline mode), -1 if none
+ */
+static int32_t rpcTryFrame(uint8_t *rpcFrame)
+{
+	if (rpcInlineEnabled)
+	{
+		return sem_trywait(&rpcInlineEvtSem);
+	}
+
+	return rpcQosTryReceive(rpcFrame, RPC_MAX_LEN + 1);
+}
+
+/*********************************************************************
+ * @fn      rpcWaitFrame
+ *
+ * @brief   wait for an incoming frame until a monotonic deadline. The
+ *          timers of the wheel are run while waiting; the wait is cut
+ *          short when one is due, and restarted after its callback.
+ *
+ * @param   rpcFrame - buffer of RPC_MAX_LEN + 1 bytes for the frame
+ * @param   deadline - see rpcTimerNow(), RPC_TIMER_NEVER to wait forever
+ *
+ * @return  length of the frame (0 in inline mode), -1 on timeout
+ */
+static int32_t rpcWaitFrame(uint8_t *rpcFrame, uint64_t deadline)
+{
+	int32_t rpcLen;
+	uint32_t timerDelay;
+	uint64_t now, wakeTime;
+	struct timespec to;
+
+	while (1)
+	{
+		// frames that are already queued go first
+		rpcLen = rpcTryFrame(rpcFrame);
+		if (rpcLen != -1)
+		{
+			return rpcLen;
+		}
+
+		timerDelay = rpcTimerProcess();
+
+		now = rpcTimerNow();
+		if (now >= deadline)
+		{
+			return rpcTryFrame(rpcFrame);
+		}
+
+		wakeTime = deadline;
+		if ((timerDelay != RPC_TIMER_FOREVER)
+		        && ((now + timerDelay) < wakeTime))
+		{
+			wakeTime = now + timerDelay;
+		}
+
+		if (wakeTime == RPC_TIMER_NEVER)
+		{
+			if (rpcInlineEnabled)
+			{
+				rpcLen = sem_wait(&rpcInlineEvtSem);
+			}
+			else
+			{
+				rpcLen = rpcQosReceive(rpcFrame, RPC_MAX_LEN + 1, NULL);
+			}
+		}
+		else
+		{
+			rpcTimerAbsTime(wakeTime, &to);
+			if (rpcInlineEnabled)
+			{
+				rpcLen = sem_timedwait(&rpcInlineEvtSem, &to);
+			}
+			else
+			{
+				rpcLen = rpcQosReceive(rpcFrame, RPC_MAX_LEN + 1, &to);
+			}
+		}
+
+		if (rpcLen != -1)
+		{
+			if (!rpcInlineEnabled || !rpcInlineKick)
+			{
+				return rpcLen;
+			}
+
+			// woken up for a new timer, not for a frame
+			rpcInlineKick = 0;
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      rpcWakeConsumer
+ *
+ * @brief   called by the timer wheel when a timer is started that is due
+ *          before the application thread wakes up
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+static void rpcWakeConsumer(void)
+{
+	if (rpcInlineEnabled)
+	{
+		rpcInlineKick = 1;
+		sem_post(&rpcInlineEvtSem);
+	}
+	else
+	{
+		rpcQosWakeup();
+	}
+}
+
+/*************************************************************************************************
+ * @fn      rpcReadFrame()
+ *
+ * @brief   Read bytes from transport layer and form an RPC frame. The caller must hold
+ *          the reader token (rpcRxSem).
+ *
+ * @param   rpcBuff - buffer of RPC_MAX_LEN bytes, the length byte is stored at index 0
+ *
+ * @return  length of the frame from cmd0 onwards, -1 on error
+ *************************************************************************************************/
+static int32_t rpcReadFrame(uint8_t *rpcBuff)
 {
 	uint8_t rpcLen, rpcTempLen, bytesRead, sofByte, rpcBuffIdx;
-	uint8_t retryAttempts = 0, len, rpcBuff[RPC_MAX_LEN];
+	uint8_t retryAttempts = 0, len;
 	uint8_t fcs;
 
 #ifndef HAL_UART_IP //No SOF for IP	//read first byte and check it is a SOF
@@ -390,49 +968,7 @@ int32_t rpcProcess(void)
 				return -1;
 			}
 
-			//如果CMD0的高3位是SRSP，即异步的应答 A synchronous response
-			if ((rpcBuff[1] & MT_RPC_CMD_TYPE_MASK) == MT_RPC_CMD_SRSP)
-			{
-				// SRSP command ID deteced
-				if (expectedSrspCmdId == (rpcBuff[1] & MT_RPC_SUBSYSTEM_MASK))
-				{
-					dbg_print(PRINT_LEVEL_INFO,
-					        "rpcProcess: processing expected srsp [%02X]\n",
-					        rpcBuff[1] & MT_RPC_SUBSYSTEM_MASK);
-
-					//unblock waiting sreq
-					sem_post(&srspSem);
-
-					dbg_print(PRINT_LEVEL_INFO,
-					        "rpcProcess: writing %d bytes SRSP to head of the queue\n",
-					        rpcLen);
-
-					// send message to queue
-					//将消息加入到队列中
-					llq_add(&rpcLlq, (char*) &rpcBuff[1], rpcLen, 1);
-				}
-				else
-				{
-					// unexpected SRSP discard
-					dbg_print(PRINT_LEVEL_WARNING,
-					        "rpcProcess: UNEXPECTED SREQ!: %02X%s:%02X%s",
-					        expectedSrspCmdId,
-					        (rpcBuff[1] & MT_RPC_SUBSYSTEM_MASK));
-					return 0;
-				}
-			}
-			else
-			{
-				// should be AREQ frame
-				dbg_print(PRINT_LEVEL_INFO,
-				        "rpcProcess: writing %d bytes AREQ to tail of the que\n",
-				        rpcLen);
-
-				// send message to queue
-				llq_add(&rpcLlq, (char*) &rpcBuff[1], rpcLen, 0);
-			}
-
-			return 0;
+			return rpcLen;
 		}
 		else
 		{
@@ -450,100 +986,224 @@ int32_t rpcProcess(void)
 	return -1;
 }
 
+
 /*************************************************************************************************
- * @fn      sendRpcFrame()
+ * @fn      rpcHandleFrame()
  *
- * @brief   builds the Frame and sends it to the transport layer - usually called by the
- *          application thread(s)
+ * @brief   Route a frame read by rpcReadFrame() - correlate SRSPs with the waiting SREQ,
+ *          filter AREQs and queue or (inline mode) process them
  *
- * @param   cmd0 System, cmd1 subsystem, ptr to payload, lenght of payload
+ * @param   rpcBuff - frame as read by rpcReadFrame()
+ * @param   rpcLen - length of the frame from cmd0 onwards
+ * @param   pumped - 1 if the frame was read by an SREQ waiting for its SRSP
  *
- * @return  length of current Rx Buffer
+ * @return  0
  *************************************************************************************************/
-uint8_t rpcSendFrame(uint8_t cmd0, uint8_t cmd1, uint8_t *payload,
-        uint8_t payload_len)
+static int32_t rpcHandleFrame(uint8_t *rpcBuff, uint8_t rpcLen, uint8_t pumped)
 {
-	uint8_t buf[RPC_MAX_LEN];
-	int32_t status = MT_RPC_SUCCESS;
+	//如果CMD0的高3位是SRSP，即异步的应答 A synchronous response
+	if ((rpcBuff[1] & MT_RPC_CMD_TYPE_MASK) == MT_RPC_CMD_SRSP)
+	{
+		// SRSP command ID deteced
+		if (srspStaleCnt)
+		{
+			if ((srspStaleCmd0 != (rpcBuff[1] & MT_RPC_SUBSYSTEM_MASK))
+			        || (srspStaleCmd1 != rpcBuff[2]))
+			{
+				// the ZNP answers in order, the SRSPs given up on are lost
+				srspStaleCnt = 0;
+			}
+			else if ((expectedSrspCmdId != srspStaleCmd0)
+			        || (expectedSrspCmd1 != srspStaleCmd1))
+			{
+				// no newer SREQ of this command was sent, this is the
+				// late SRSP of one given up on
+				srspStaleCnt--;
+				dbg_print(PRINT_LEVEL_WARNING,
+				        "rpcProcess: late SRSP %02X:%02X dropped\n", rpcBuff[1],
+				        rpcBuff[2]);
+				return 0;
+			}
+			else
+			{
+				// it can not be told from the SRSP of the SREQ waiting
+				// for it, which takes it
+				srspStaleCnt--;
+			}
+		}
 
-	// block here if SREQ is in progress
-	dbg_print(PRINT_LEVEL_INFO, "rpcSendFrame: Blocking on RPC sem\n");
-	sem_wait(&rpcSem);
-	dbg_print(PRINT_LEVEL_INFO, "rpcSendFrame: Sending RPC\n");
+		if ((expectedSrspCmdId == (rpcBuff[1] & MT_RPC_SUBSYSTEM_MASK))
+		        && (expectedSrspCmd1 == rpcBuff[2]) && !srspReceived)
+		{
+			dbg_print(PRINT_LEVEL_INFO,
+			        "rpcProcess: processing expected srsp [%02X]\n",
+			        rpcBuff[1] & MT_RPC_SUBSYSTEM_MASK);
 
-	// fill in header bytes
-	buf[0] = MT_RPC_SOF;
-	buf[1] = payload_len;
-	buf[2] = cmd0;
-	buf[3] = cmd1;
+			// hand the SRSP over to the waiting SREQ, which decodes it
+			memcpy(srspFrame, &rpcBuff[1], rpcLen);
+			srspFrameLen = rpcLen;
+			srspReceived = 1;
 
-	if ((cmd0 & MT_RPC_CMD_TYPE_MASK) == MT_RPC_CMD_SREQ)
+			if (!pumped)
+			{
+				//unblock waiting sreq
+				sem_post(&srspSem);
+			}
+		}
+		else
+		{
+			// unexpected SRSP discard
+			dbg_print(PRINT_LEVEL_WARNING,
+			        "rpcProcess: UNEXPECTED SREQ!: %02X%s:%02X%s",
+			        expectedSrspCmdId,
+			        (rpcBuff[1] & MT_RPC_SUBSYSTEM_MASK));
+			return 0;
+		}
+	}
+	else if (!rpcAreqFilterCheck(rpcBuff[1], rpcBuff[2]))
 	{
-		// calculate expected SRSP
-		expectedSrspCmdId = (cmd0 & MT_RPC_SUBSYSTEM_MASK);
+		// nobody is interested in this AREQ, drop it before it is
+		// copied to the queue and wakes up the application
+		rpcAreqDropCnt++;
+		dbg_print(PRINT_LEVEL_VERBOSE,
+		        "rpcProcess: AREQ %02X:%02X filtered [%d dropped]\n",
+		        rpcBuff[1], rpcBuff[2], rpcAreqDropCnt);
 	}
+	else if (rpcInlineEnabled && !pumped)
+	{
+		// AREQs deferred while we were busy go first, to keep ordering
+		rpcInlineDrain();
 
-	if (payload_len > 0)
+		dbg_print(PRINT_LEVEL_INFO,
+		        "rpcProcess: processing %d bytes AREQ inline\n", rpcLen);
+
+		rpcInlineProcess(&rpcBuff[1], rpcLen);
+	}
+	else if (rpcInlineEnabled)
 	{
-		// copy payload to buffer
-		memcpy(buf + RPC_UART_HDR_LEN, payload, payload_len);
+		// AREQ read by an SREQ waiting for its SRSP, the RPC thread
+		// processes it when it is done with its current callback
+		llq_add(&rpcLlq, (char*) &rpcBuff[1], rpcLen, 0);
 	}
+	else
+	{
+		// should be AREQ frame
+		dbg_print(PRINT_LEVEL_INFO,
+		        "rpcProcess: writing %d bytes AREQ to its class queue\n",
+		        rpcLen);
 
-	// calculate FCS field
-	buf[payload_len + RPC_UART_HDR_LEN] = calcFcs(
-	        &buf[RPC_UART_FRAME_START_IDX], payload_len + RPC_HDR_LEN);
+		// send message to queue
+		rpcQosAdd(&rpcBuff[1], rpcLen);
+	}
 
-#ifdef HAL_UART_IP
-	// No SOF or FCS
-	rpcTransportWrite(buf+1, payload_len + RPC_HDR_LEN + RPC_UART_FCS_LEN);
-#else
-	// send out RPC  message
-	rpcTransportWrite(buf, payload_len + RPC_UART_HDR_LEN + RPC_UART_FCS_LEN);
-#endif
+	return 0;
+}
+
+/*************************************************************************************************
+ * @fn      rpcInlineProcess()
+ *
+ * @brief   Decode an AREQ and invoke its callbacks on the calling thread. If an SREQ is
+ *          waiting while the callback runs, it is woken up to read its own SRSP.
+ *
+ * @param   rpcFrame - frame from cmd0 onwards
+ * @param   rpcLen - length of the frame
+ *
+ * @return  none
+ *************************************************************************************************/
+static void rpcInlineProcess(uint8_t *rpcFrame, uint8_t rpcLen)
+{
+	rpcInlineBusy = 1;
+
+	if (expectedSrspCmdId != 0xFF)
+	{
+		// an SREQ is in progress, let it read the transport while we are
+		// busy
+		sem_post(&srspSem);
+	}
+
+	rpcDispatchFrame(rpcFrame, rpcLen);
+
+	rpcInlineBusy = 0;
 
-	// print out message to be sent
-	printRpcMsg("SOC OUT -->", buf[0], payload_len, &buf[2]);
+	sem_post(&rpcInlineEvtSem);
+}
+
+/*************************************************************************************************
+ * @fn      rpcInlineDrain()
+ *
+ * @brief   Process the AREQs queued while the RPC thread was busy in a callback
+ *
+ * @param   none
+ *
+ * @return  none
+ *************************************************************************************************/
+static void rpcInlineDrain(void)
+{
+	uint8_t rpcFrame[RPC_MAX_LEN + 1];
+	int32_t rpcLen;
 
-	// wait for SRSP if necessary
-	if ((cmd0 & MT_RPC_CMD_TYPE_MASK) == MT_RPC_CMD_SREQ)
+	while ((rpcLen = llq_tryreceive(&rpcLlq, (char *) rpcFrame, RPC_MAX_LEN + 1))
+	        > 0)
 	{
-		// calculate timeout
-		struct timespec srspTimeOut =
-			{ time(0) + (SRSP_TIMEOUT_MS / 1000), (long) ((long) SRSP_TIMEOUT_MS
-			        % 1000) * 1000000 };
+		rpcInlineProcess(rpcFrame, rpcLen);
+	}
+}
 
-		dbg_print(PRINT_LEVEL_INFO, "rpcSendFrame: waiting for SRSP [%02x]\n",
-		        expectedSrspCmdId);
+/*************************************************************************************************
+ * @fn      rpcWaitSrsp()
+ *
+ * @brief   Wait for the SRSP of the pending SREQ. In inline mode, while the RPC thread
+ *          is busy in a callback (possibly the one that sent this SREQ) nobody else reads
+ *          the transport, so the waiter takes the reader token and pumps the frames itself
+ *          until its SRSP is in. The deadline is checked between frames, a read blocks
+ *          until the ZNP sends something.
+ *
+ * @param   deadline - monotonic time of the timeout, see rpcTimerNow()
+ *
+ * @return  0 if the SRSP was received, -1 on timeout
+ *************************************************************************************************/
+static int32_t rpcWaitSrsp(uint64_t deadline)
+{
+	uint8_t rpcBuff[RPC_MAX_LEN];
+	int32_t rpcLen;
+	struct timespec srspTimeOut;
 
-		//Wait for the SRSP
-		status = sem_timedwait(&srspSem, &srspTimeOut);
-		if (status == -1)
+	while (!srspReceived)
+	{
+		if (rpcInlineBusy)
 		{
-			dbg_print(PRINT_LEVEL_WARNING,
-			        "rpcSendFrame: SRSP Error - CMD0: 0x%02X CMD1: 0x%02X\n",
-			        cmd0, cmd1);
-			status = MT_RPC_ERR_SUBSYSTEM;
+			// the RPC thread only holds the token while reading, it may
+			// be reading our SRSP right now
+			sem_wait(&rpcRxSem);
+			while (!srspReceived && (rpcTimerNow() < deadline))
+			{
+				rpcLen = rpcReadFrame(rpcBuff);
+				if (rpcLen > 0)
+				{
+					rpcHandleFrame(rpcBuff, (uint8_t) rpcLen, 1);
+				}
+			}
+			sem_post(&rpcRxSem);
+
+			if (!srspReceived)
+			{
+				break;
+			}
 		}
 		else
 		{
-			dbg_print(PRINT_LEVEL_INFO, "rpcSendFrame: Receive SRSP\n");
-			status = MT_RPC_SUCCESS;
+			rpcTimerAbsTime(deadline, &srspTimeOut);
+			if ((sem_timedwait(&srspSem, &srspTimeOut) == -1)
+			        && (rpcTimerNow() >= deadline))
+			{
+				break;
+			}
 		}
-
-		//set expected SRSP to invalid
-		expectedSrspCmdId = 0xFF;
 	}
 
-	//Unlock RPC sem
-	sem_post(&rpcSem);
-
-	return status;
+	return (srspReceived ? 0 : -1);
 }
 
-/*********************************************************************
- * LOCAL FUNCTIONS
- */
-
 /*********************************************************************
  * @fn      calcFcs
  *
@@ -89,6 +89,9 @@ extern "C"
 
 #define RPC_UART_HDR_LEN           (RPC_UART_SOF_LEN + RPC_HDR_LEN)
 
+// AREQ filter size per subsystem (1 bit for each cmd1 value)
+#define RPC_AREQ_FILTER_LEN        (256 / 8)
+
 /***********************************************************************************
  * TYPEDEFS
  */
@@ -149,10 +152,20 @@ void rpcClose(void);
 int32_t rpcProcess(void);
 uint8_t rpcSendFrame(uint8_t cmd0, uint8_t cmd1, uint8_t * payload,
         uint8_t payload_len);
+uint8_t rpcSendFrameSrsp(uint8_t cmd0, uint8_t cmd1, uint8_t * payload,
+        uint8_t payload_len, uint8_t *srsp);
 void rpcForceRun(void);
 int32_t rpcInitMq(void);
 int32_t rpcGetMqClientMsg(void);
 int32_t rpcWaitMqClientMsg(uint32_t timeout);
+int32_t rpcDrainMqClientMsg(uint32_t timeout, uint32_t maxMsgs);
+void rpcSetSrspRetries(uint8_t retries);
+void rpcAreqFilterEnable(uint8_t enable);
+void rpcAreqFilterCb(uint8_t subSys, uint8_t cmd1, uint8_t hasCb);
+void rpcAreqFilterSet(uint8_t subSys, uint8_t cmd1, uint8_t accept);
+uint8_t rpcAreqFilterCheck(uint8_t cmd0, uint8_t cmd1);
+void rpcInlineDispatch(uint8_t enable);
+uint8_t rpcInlineDispatchEnabled(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,291 @@
+/*
+ * rpcDispatch.c
+ *
+ * This module contains the parallel callback dispatcher for the ZigBee
+ * Network Processor (ZNP) Host Interface.
+ * 
+ * Decoded AREQs are fanned out to a pool of worker queues, sharded by
+ * an ordering key (by default the source network address), so a slow
+ * callback for one device does not stall the traffic of the others.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <semaphore.h>
+
+#include "queue.h"
+#include "rpc.h"
+#include "rpcDispatch.h"
+#include "mtParser.h"
+#include "mtAf.h"
+#include "mtZdo.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// number of workers, 0 means dispatching is disabled and all frames are
+// processed on the thread reading the RPC queue
+static uint8_t dispatchNumWorkers = 0;
+
+// function used to calculate the ordering key of a frame
+static rpcDispatchKeyCb_t dispatchKeyCb = NULL;
+
+// one FIFO per worker, frames with the same key always go to the same one
+static llq_t dispatchLlq[RPC_DISPATCH_MAX_WORKERS];
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      rpcDispatchInit
+ *
+ * @brief   enable parallel dispatching of AREQs. Must be called before
+ *          the RPC thread is started. The application creates one
+ *          thread per worker, each looping on rpcDispatchProcess().
+ *
+ * @param   numWorkers - number of worker queues (1 - RPC_DISPATCH_MAX_WORKERS)
+ * @param   keyCb - ordering key function, NULL for rpcDispatchDefaultKey
+ *
+ * @return  status
+ */
+int32_t rpcDispatchInit(uint8_t numWorkers, rpcDispatchKeyCb_t keyCb)
+{
+	uint8_t workerIdx;
+
+	if ((numWorkers == 0) || (numWorkers > RPC_DISPATCH_MAX_WORKERS))
+	{
+		dbg_print(PRINT_LEVEL_ERROR,
+		        "rpcDispatchInit: invalid number of workers %d\n", numWorkers);
+		return -1;
+	}
+
+	for (workerIdx = 0; workerIdx < numWorkers; workerIdx++)
+	{
+		llq_open(&dispatchLlq[workerIdx]);
+	}
+
+	if (keyCb != NULL)
+	{
+		dispatchKeyCb = keyCb;
+	}
+	else
+	{
+		dispatchKeyCb = rpcDispatchDefaultKey;
+	}
+
+	dispatchNumWorkers = numWorkers;
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      rpcDispatchEnabled
+ *
+ * @brief   check if parallel dispatching is enabled
+ *
+ * @param   -
+ *
+ * @return  1 if enabled, 0 otherwise
+ */
+uint8_t rpcDispatchEnabled(void)
+{
+	return (dispatchNumWorkers > 0);
+}
+
+/*********************************************************************
+ * @fn      rpcDispatchFrame
+ *
+ * @brief   route an incoming frame to the worker owning its key. SRSPs
+ *          are always processed by the calling thread, as the SREQ
+ *          function waiting for them reads the result straight after.
+ *
+ * @param   rpcBuff - frame starting from cmd0
+ * @param   rpcLen - length of frame
+ *
+ * @return  -
+ */
+void rpcDispatchFrame(uint8_t *rpcBuff, uint8_t rpcLen)
+{
+	uint32_t key;
+	uint8_t workerIdx;
+
+	if ((dispatchNumWorkers == 0)
+	        || ((rpcBuff[0] & MT_RPC_CMD_TYPE_MASK) == MT_RPC_CMD_SRSP))
+	{
+		mtProcess(rpcBuff, rpcLen);
+		return;
+	}
+
+	key = dispatchKeyCb(rpcBuff, rpcLen);
+
+	// fold the key so that neighbouring addresses spread over the workers
+	key ^= (key >> 16);
+	key ^= (key >> 8);
+	workerIdx = (uint8_t)(key % dispatchNumWorkers);
+
+	dbg_print(PRINT_LEVEL_VERBOSE,
+	        "rpcDispatchFrame: CMD0:%x, CMD1:%x to worker %d\n", rpcBuff[0],
+	        rpcBuff[1], workerIdx);
+
+	llq_add(&dispatchLlq[workerIdx], (char *) rpcBuff, rpcLen, 0);
+}
+
+/*********************************************************************
+ * @fn      rpcDispatchProcess
+ *
+ * @brief   wait (blocking function) for a frame on a worker queue and
+ *          process it. Called in a loop from the worker thread.
+ *
+ * @param   workerIdx - index of the worker
+ *
+ * @return  status
+ */
+int32_t rpcDispatchProcess(uint8_t workerIdx)
+{
+	uint8_t rpcFrame[RPC_MAX_LEN + 1];
+	int32_t rpcLen;
+
+	if (workerIdx >= dispatchNumWorkers)
+	{
+		dbg_print(PRINT_LEVEL_ERROR,
+		        "rpcDispatchProcess: invalid worker %d\n", workerIdx);
+		return -1;
+	}
+
+	rpcLen = llq_receive(&dispatchLlq[workerIdx], (char *) rpcFrame,
+	        RPC_MAX_LEN + 1);
+
+	if (rpcLen <= 0)
+	{
+		return -1;
+	}
+
+	dbg_print(PRINT_LEVEL_VERBOSE,
+	        "rpcDispatchProcess: worker %d processing MT[%d]\n", workerIdx,
+	        rpcLen);
+
+	mtProcess(rpcFrame, rpcLen);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      rpcDispatchDefaultKey
+ *
+ * @brief   default ordering key: the network address of the device the
+ *          frame originates from. Frames not related to a device (state
+ *          changes, confirms, ...) all use key 0 and so stay in order
+ *          with respect to each other.
+ *
+ * @param   rpcBuff - frame starting from cmd0
+ * @param   rpcLen - length of frame
+ *
+ * @return  key
+ */
+uint32_t rpcDispatchDefaultKey(uint8_t *rpcBuff, uint8_t rpcLen)
+{
+	uint8_t subSys = rpcBuff[0] & MT_RPC_SUBSYSTEM_MASK;
+
+	if (subSys == MT_RPC_SYS_AF)
+	{
+		switch (rpcBuff[1])
+		{
+		case MT_AF_INCOMING_MSG:
+			// GroupId, ClusterId, SrcAddr
+			if (rpcLen >= 8)
+			{
+				return BUILD_UINT16(rpcBuff[6], rpcBuff[7]);
+			}
+			break;
+		case MT_AF_INCOMING_MSG_EXT:
+			// GroupId, ClusterId, SrcAddrMode, SrcAddr (2 or 8 bytes)
+			if (rpcLen >= 15)
+			{
+				return BUILD_UINT32(rpcBuff[7], rpcBuff[8], rpcBuff[9],
+				        rpcBuff[10])
+				        ^ BUILD_UINT32(rpcBuff[11], rpcBuff[12], rpcBuff[13],
+				                rpcBuff[14]);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	else if (subSys == MT_RPC_SYS_ZDO)
+	{
+		switch (rpcBuff[1])
+		{
+		case MT_ZDO_NWK_ADDR_RSP:
+		case MT_ZDO_IEEE_ADDR_RSP:
+			// Status, IEEEAddr, NwkAddr
+			if (rpcLen >= 13)
+			{
+				return BUILD_UINT16(rpcBuff[11], rpcBuff[12]);
+			}
+			break;
+		case MT_ZDO_END_DEVICE_ANNCE_IND:
+			// SrcAddr, NwkAddr
+			if (rpcLen >= 6)
+			{
+				return BUILD_UINT16(rpcBuff[4], rpcBuff[5]);
+			}
+			break;
+		case MT_ZDO_STATE_CHANGE_IND:
+		case MT_ZDO_MATCH_DESC_RSP_SENT:
+		case MT_ZDO_SRC_RTG_IND:
+		case MT_ZDO_BEACON_NOTIFY_IND:
+		case MT_ZDO_JOIN_CNF:
+		case MT_ZDO_NWK_DISCOVERY_CNF:
+		case MT_ZDO_CONCENTRATOR_IND_CB:
+			break;
+		default:
+			// ZDO responses and LEAVE_IND start with SrcAddr
+			if (rpcLen >= 4)
+			{
+				return BUILD_UINT16(rpcBuff[2], rpcBuff[3]);
+			}
+			break;
+		}
+	}
+
+	return 0;
+}
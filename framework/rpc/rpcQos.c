@@ -0,0 +1,647 @@
+/*
+ * rpcQos.c
+ *
+ * This module contains the class based scheduling of incoming frames for
+ * the ZigBee Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <semaphore.h>
+
+#include "queue.h"
+#include "rpc.h"
+#include "rpcQos.h"
+#include "mtParser.h"
+#include "mtAf.h"
+#include "mtZdo.h"
+#include "mtSapi.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	llq_t llq;
+	uint8_t weight;              // frames served per scheduling round
+	uint8_t credit;              // frames left in the current round
+	uint32_t maxDepth;           // 0 for no limit
+	rpcQosDropPolicy_t policy;
+	rpcQosStats_t stats;
+} rpcQosQueue_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static rpcQosQueue_t qosQueue[RPC_QOS_CLASS_MAX];
+
+// default weights, control frames are rare but must not wait behind data
+static const uint8_t qosDefaultWeight[RPC_QOS_CLASS_MAX] =
+	{ 4, 2, 1 };
+
+// protects the class queues' depth, credits and statistics
+static sem_t qosAccessSem;
+
+// number of frames queued over all classes
+static uint32_t qosTotal = 0;
+
+// consumers sleeping in rpcQosReceive(). A producer only posts the wake
+// semaphore if one of them is sleeping and none was woken up yet, so a
+// burst of frames costs a single wakeup; the woken consumer wakes the
+// next one if frames are left.
+static uint32_t qosSleepers = 0;
+static uint8_t qosWakePending = 0;
+static sem_t qosWakeSem;
+
+// set by rpcQosWakeup() to make a sleeping consumer return without a frame
+static uint8_t qosKick = 0;
+
+// number of wakeups and of frames handed to consumers
+static uint32_t qosWakeCnt = 0;
+static uint32_t qosFrameCnt = 0;
+
+// class currently being served
+static uint8_t qosCursor = 0;
+
+// function used to classify incoming frames
+static rpcQosClassCb_t qosClassCb = rpcQosDefaultClass;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS DECLARATION
+ */
+
+static uint8_t qosSchedule(void);
+static int32_t qosWait(const struct timespec *timeout);
+static int32_t qosTake(uint8_t *rpcBuff, int32_t maxLen, uint8_t *wake);
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      rpcQosInit
+ *
+ * @brief   create the class queues with the default configuration, all
+ *          classes unlimited with weights 4:2:1
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+void rpcQosInit(void)
+{
+	uint8_t cls;
+
+	for (cls = 0; cls < RPC_QOS_CLASS_MAX; cls++)
+	{
+		llq_open(&qosQueue[cls].llq);
+		qosQueue[cls].weight = qosDefaultWeight[cls];
+		qosQueue[cls].credit = qosDefaultWeight[cls];
+		qosQueue[cls].maxDepth = 0;
+		qosQueue[cls].policy = RPC_QOS_DROP_NEWEST;
+		memset(&qosQueue[cls].stats, 0, sizeof(rpcQosStats_t));
+	}
+
+	sem_init(&qosAccessSem, 0, 1);
+	sem_init(&qosWakeSem, 0, 0);
+}
+
+/*********************************************************************
+ * @fn      rpcQosSetClassifier
+ *
+ * @brief   replace the function used to classify incoming frames
+ *
+ * @param   classCb - classifier, NULL for rpcQosDefaultClass
+ *
+ * @return  -
+ */
+void rpcQosSetClassifier(rpcQosClassCb_t classCb)
+{
+	if (classCb != NULL)
+	{
+		qosClassCb = classCb;
+	}
+	else
+	{
+		qosClassCb = rpcQosDefaultClass;
+	}
+}
+
+/*********************************************************************
+ * @fn      rpcQosConfig
+ *
+ * @brief   configure the scheduling of a class
+ *
+ * @param   cls - class to configure
+ * @param   weight - frames served per round when other classes are busy
+ * @param   maxDepth - maximum number of queued frames, 0 for no limit
+ * @param   policy - frame to discard when the class is full
+ *
+ * @return  status
+ */
+int32_t rpcQosConfig(rpcQosClass_t cls, uint8_t weight, uint32_t maxDepth,
+        rpcQosDropPolicy_t policy)
+{
+	if ((cls >= RPC_QOS_CLASS_MAX) || (weight == 0))
+	{
+		dbg_print(PRINT_LEVEL_ERROR, "rpcQosConfig: invalid class %d/weight %d\n",
+		        cls, weight);
+		return -1;
+	}
+
+	sem_wait(&qosAccessSem);
+
+	qosQueue[cls].weight = weight;
+	qosQueue[cls].credit = weight;
+	qosQueue[cls].maxDepth = maxDepth;
+	qosQueue[cls].policy = policy;
+
+	sem_post(&qosAccessSem);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      rpcQosAdd
+ *
+ * @brief   queue an incoming frame in its class
+ *
+ * @param   rpcBuff - frame (cmd0, cmd1, payload)
+ * @param   rpcLen - length of the frame
+ *
+ * @return  0 if queued, -1 if dropped
+ */
+int32_t rpcQosAdd(uint8_t *rpcBuff, uint8_t rpcLen)
+{
+	uint8_t dropFrame[RPC_MAX_LEN + 1];
+	rpcQosClass_t cls;
+	rpcQosQueue_t *queue;
+	uint8_t wake = 0;
+
+	cls = qosClassCb(rpcBuff, rpcLen);
+	if (cls >= RPC_QOS_CLASS_MAX)
+	{
+		cls = RPC_QOS_CLASS_DATA;
+	}
+	queue = &qosQueue[cls];
+
+	sem_wait(&qosAccessSem);
+
+	if ((queue->maxDepth != 0)
+	        && (queue->stats.depth >= queue->maxDepth))
+	{
+		queue->stats.dropped++;
+
+		if (queue->policy == RPC_QOS_DROP_NEWEST)
+		{
+			sem_post(&qosAccessSem);
+
+			dbg_print(PRINT_LEVEL_VERBOSE,
+			        "rpcQosAdd: class %d full, dropped %02X:%02X\n", cls,
+			        rpcBuff[0], rpcBuff[1]);
+			return -1;
+		}
+
+		// replace the oldest frame, the number of queued frames is unchanged
+		llq_tryreceive(&queue->llq, (char *) dropFrame, RPC_MAX_LEN + 1);
+		llq_add(&queue->llq, (char *) rpcBuff, rpcLen, 0);
+		queue->stats.queued++;
+
+		sem_post(&qosAccessSem);
+
+		dbg_print(PRINT_LEVEL_VERBOSE,
+		        "rpcQosAdd: class %d full, dropped oldest %02X:%02X\n", cls,
+		        dropFrame[0], dropFrame[1]);
+		return 0;
+	}
+
+	llq_add(&queue->llq, (char *) rpcBuff, rpcLen, 0);
+
+	queue->stats.queued++;
+	queue->stats.depth++;
+	if (queue->stats.depth > queue->stats.maxDepth)
+	{
+		queue->stats.maxDepth = queue->stats.depth;
+	}
+	qosTotal++;
+
+	// wake up the application thread, unless it is awake already
+	if ((qosSleepers > 0) && !qosWakePending)
+	{
+		qosWakePending = 1;
+		wake = 1;
+	}
+
+	sem_post(&qosAccessSem);
+
+	if (wake)
+	{
+		sem_post(&qosWakeSem);
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      rpcQosReceive
+ *
+ * @brief   wait for a frame and take it from the class selected by the
+ *          weighted round robin scheduler
+ *
+ * @param   rpcBuff - buffer for the frame
+ * @param   maxLen - size of the buffer
+ * @param   timeout - absolute timeout, NULL to wait forever
+ *
+ * @return  length of the frame, -1 on timeout or rpcQosWakeup()
+ */
+int32_t rpcQosReceive(uint8_t *rpcBuff, int32_t maxLen,
+        const struct timespec *timeout)
+{
+	int32_t rpcLen = -1;
+	uint8_t wake = 0;
+
+	sem_wait(&qosAccessSem);
+
+	if (qosWait(timeout) == 0)
+	{
+		rpcLen = qosTake(rpcBuff, maxLen, &wake);
+	}
+
+	sem_post(&qosAccessSem);
+
+	if (wake)
+	{
+		sem_post(&qosWakeSem);
+	}
+
+	return rpcLen;
+}
+
+/*********************************************************************
+ * @fn      rpcQosTryReceive
+ *
+ * @brief   take a frame if one is queued, without blocking
+ *
+ * @param   rpcBuff - buffer for the frame
+ * @param   maxLen - size of the buffer
+ *
+ * @return  length of the frame, -1 if nothing is queued
+ */
+int32_t rpcQosTryReceive(uint8_t *rpcBuff, int32_t maxLen)
+{
+	int32_t rpcLen = -1;
+	uint8_t wake = 0;
+
+	sem_wait(&qosAccessSem);
+
+	if (qosTotal > 0)
+	{
+		rpcLen = qosTake(rpcBuff, maxLen, &wake);
+	}
+
+	sem_post(&qosAccessSem);
+
+	if (wake)
+	{
+		sem_post(&qosWakeSem);
+	}
+
+	return rpcLen;
+}
+
+/*********************************************************************
+ * @fn      rpcQosWakeup
+ *
+ * @brief   make a consumer sleeping in rpcQosReceive() return -1 without
+ *          a frame, so it can recalculate its timeout
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+void rpcQosWakeup(void)
+{
+	uint8_t wake = 0;
+
+	sem_wait(&qosAccessSem);
+
+	if ((qosSleepers > 0) && !qosWakePending)
+	{
+		qosKick = 1;
+		qosWakePending = 1;
+		wake = 1;
+	}
+
+	sem_post(&qosAccessSem);
+
+	if (wake)
+	{
+		sem_post(&qosWakeSem);
+	}
+}
+
+/*********************************************************************
+ * @fn      rpcQosGetWakeStats
+ *
+ * @brief   get the number of consumer wakeups and of frames received,
+ *          their ratio is the average batch size per wakeup
+ *
+ * @param   wakeups - filled in with the number of wakeups
+ * @param   frames - filled in with the number of frames received
+ *
+ * @return  -
+ */
+void rpcQosGetWakeStats(uint32_t *wakeups, uint32_t *frames)
+{
+	sem_wait(&qosAccessSem);
+	*wakeups = qosWakeCnt;
+	*frames = qosFrameCnt;
+	sem_post(&qosAccessSem);
+}
+
+/*********************************************************************
+ * @fn      rpcQosGetStats
+ *
+ * @brief   get the statistics of a class
+ *
+ * @param   cls - class
+ * @param   stats - filled in with the statistics
+ *
+ * @return  status
+ */
+int32_t rpcQosGetStats(rpcQosClass_t cls, rpcQosStats_t *stats)
+{
+	if ((cls >= RPC_QOS_CLASS_MAX) || (stats == NULL))
+	{
+		return -1;
+	}
+
+	sem_wait(&qosAccessSem);
+	memcpy(stats, &qosQueue[cls].stats, sizeof(rpcQosStats_t));
+	sem_post(&qosAccessSem);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      rpcQosResetStats
+ *
+ * @brief   clear the counters of all classes and the wakeup counters,
+ *          the depth is kept
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+void rpcQosResetStats(void)
+{
+	uint8_t cls;
+
+	sem_wait(&qosAccessSem);
+
+	for (cls = 0; cls < RPC_QOS_CLASS_MAX; cls++)
+	{
+		qosQueue[cls].stats.queued = 0;
+		qosQueue[cls].stats.dequeued = 0;
+		qosQueue[cls].stats.dropped = 0;
+		qosQueue[cls].stats.maxDepth = qosQueue[cls].stats.depth;
+	}
+	qosWakeCnt = 0;
+	qosFrameCnt = 0;
+
+	sem_post(&qosAccessSem);
+}
+
+/*********************************************************************
+ * @fn      rpcQosDefaultClass
+ *
+ * @brief   default classifier. SYS indications and network state events
+ *          are control, confirms and ZDO responses are confirms, and the
+ *          rest (incoming data, routes, beacons) is data.
+ *
+ * @param   rpcBuff - frame (cmd0, cmd1, payload)
+ * @param   rpcLen - length of the frame
+ *
+ * @return  class of the frame
+ */
+rpcQosClass_t rpcQosDefaultClass(uint8_t *rpcBuff, uint8_t rpcLen)
+{
+	uint8_t subSys = rpcBuff[0] & MT_RPC_SUBSYSTEM_MASK;
+
+	(void) rpcLen;
+
+	switch (subSys)
+	{
+	case MT_RPC_SYS_SYS:
+		return RPC_QOS_CLASS_CONTROL;
+
+	case MT_RPC_SYS_AF:
+		if ((rpcBuff[1] == MT_AF_DATA_CONFIRM)
+		        || (rpcBuff[1] == MT_AF_REFLECT_ERROR))
+		{
+			return RPC_QOS_CLASS_CONFIRM;
+		}
+		break;
+
+	case MT_RPC_SYS_ZDO:
+		switch (rpcBuff[1])
+		{
+		case MT_ZDO_STATE_CHANGE_IND:
+		case MT_ZDO_END_DEVICE_ANNCE_IND:
+		case MT_ZDO_LEAVE_IND:
+		case MT_ZDO_JOIN_CNF:
+		case MT_ZDO_NWK_DISCOVERY_CNF:
+		case MT_ZDO_STATUS_ERROR_RSP:
+		case MT_ZDO_CONCENTRATOR_IND_CB:
+			return RPC_QOS_CLASS_CONTROL;
+		case MT_ZDO_MATCH_DESC_RSP_SENT:
+			return RPC_QOS_CLASS_CONFIRM;
+		default:
+			// ZDO responses
+			if ((rpcBuff[1] >= MT_ZDO_AREQ_TO_HOST)
+			        && (rpcBuff[1] < MT_ZDO_STATE_CHANGE_IND))
+			{
+				return RPC_QOS_CLASS_CONFIRM;
+			}
+			break;
+		}
+		break;
+
+	case MT_RPC_SYS_SAPI:
+		if (rpcBuff[1] == MT_SAPI_START_CNF)
+		{
+			return RPC_QOS_CLASS_CONTROL;
+		}
+		else if (rpcBuff[1] != MT_SAPI_RECEIVE_DATA_IND)
+		{
+			return RPC_QOS_CLASS_CONFIRM;
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	return RPC_QOS_CLASS_DATA;
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      qosSchedule
+ *
+ * @brief   weighted round robin, each class with frames queued is served
+ *          up to its weight before moving on to the next one. Must be
+ *          called with qosAccessSem held and at least one frame queued.
+ *
+ * @param   -
+ *
+ * @return  class to serve
+ */
+static uint8_t qosSchedule(void)
+{
+	uint8_t tries;
+	rpcQosQueue_t *queue;
+
+	for (tries = 0; tries < (2 * RPC_QOS_CLASS_MAX); tries++)
+	{
+		queue = &qosQueue[qosCursor];
+		if ((queue->stats.depth > 0) && (queue->credit > 0))
+		{
+			queue->credit--;
+			return qosCursor;
+		}
+
+		// class empty or out of credit, refill it for its next turn
+		queue->credit = queue->weight;
+		qosCursor = (qosCursor + 1) % RPC_QOS_CLASS_MAX;
+	}
+
+	return RPC_QOS_CLASS_CONTROL;
+}
+
+/*********************************************************************
+ * @fn      qosWait
+ *
+ * @brief   sleep until a frame is queued. Must be called with
+ *          qosAccessSem held, which is released while sleeping.
+ *
+ * @param   timeout - absolute timeout, NULL to wait forever
+ *
+ * @return  0 if a frame is queued, -1 on timeout or rpcQosWakeup()
+ */
+static int32_t qosWait(const struct timespec *timeout)
+{
+	int ret;
+
+	while (qosTotal == 0)
+	{
+		qosSleepers++;
+		sem_post(&qosAccessSem);
+
+		if (timeout != NULL)
+		{
+			ret = sem_timedwait(&qosWakeSem, timeout);
+		}
+		else
+		{
+			ret = sem_wait(&qosWakeSem);
+		}
+
+		sem_wait(&qosAccessSem);
+		qosSleepers--;
+
+		if (ret == 0)
+		{
+			qosWakeCnt++;
+			qosWakePending = 0;
+
+			if (qosKick)
+			{
+				qosKick = 0;
+				if (qosTotal == 0)
+				{
+					return -1;
+				}
+			}
+		}
+		else if (qosTotal == 0)
+		{
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      qosTake
+ *
+ * @brief   take the next frame. Must be called with qosAccessSem held
+ *          and at least one frame queued.
+ *
+ * @param   rpcBuff - buffer for the frame
+ * @param   maxLen - size of the buffer
+ * @param   wake - set if another sleeping consumer must be woken up
+ *
+ * @return  length of the frame
+ */
+static int32_t qosTake(uint8_t *rpcBuff, int32_t maxLen, uint8_t *wake)
+{
+	uint8_t cls = qosSchedule();
+
+	qosQueue[cls].stats.depth--;
+	qosQueue[cls].stats.dequeued++;
+	qosTotal--;
+	qosFrameCnt++;
+
+	// pass the remaining frames on to another consumer
+	if ((qosTotal > 0) && (qosSleepers > 0) && !qosWakePending)
+	{
+		qosWakePending = 1;
+		*wake = 1;
+	}
+
+	return llq_tryreceive(&qosQueue[cls].llq, (char *) rpcBuff, maxLen);
+}
@@ -0,0 +1,108 @@
+/*
+ * rpcQos.h
+ *
+ * This module contains the class based scheduling of incoming frames for
+ * the ZigBee Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef RPCQOS_H
+#define RPCQOS_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+#include <time.h>
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// classes of incoming frames, in order of default weight
+typedef enum
+{
+	RPC_QOS_CLASS_CONTROL, // SYS indications, network state changes
+	RPC_QOS_CLASS_CONFIRM, // AF data confirms, ZDO responses, SAPI confirms
+	RPC_QOS_CLASS_DATA,    // incoming data and everything else
+	RPC_QOS_CLASS_MAX
+} rpcQosClass_t;
+
+// what to do with a frame arriving at a class that is full
+typedef enum
+{
+	RPC_QOS_DROP_NEWEST, // discard the arriving frame
+	RPC_QOS_DROP_OLDEST  // discard the oldest queued frame of the class
+} rpcQosDropPolicy_t;
+
+typedef struct
+{
+	uint32_t queued;    // frames added to the class
+	uint32_t dequeued;  // frames handed to the application
+	uint32_t dropped;   // frames discarded because the class was full
+	uint32_t depth;     // frames currently queued
+	uint32_t maxDepth;  // highest depth seen
+} rpcQosStats_t;
+
+// returns the class of an incoming MT frame (cmd0, cmd1, payload)
+typedef rpcQosClass_t (*rpcQosClassCb_t)(uint8_t *rpcBuff, uint8_t rpcLen);
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+void rpcQosInit(void);
+void rpcQosSetClassifier(rpcQosClassCb_t classCb);
+int32_t rpcQosConfig(rpcQosClass_t cls, uint8_t weight, uint32_t maxDepth,
+        rpcQosDropPolicy_t policy);
+int32_t rpcQosAdd(uint8_t *rpcBuff, uint8_t rpcLen);
+int32_t rpcQosReceive(uint8_t *rpcBuff, int32_t maxLen,
+        const struct timespec *timeout);
+int32_t rpcQosTryReceive(uint8_t *rpcBuff, int32_t maxLen);
+void rpcQosWakeup(void);
+void rpcQosGetWakeStats(uint32_t *wakeups, uint32_t *frames);
+int32_t rpcQosGetStats(rpcQosClass_t cls, rpcQosStats_t *stats);
+void rpcQosResetStats(void);
+rpcQosClass_t rpcQosDefaultClass(uint8_t *rpcBuff, uint8_t rpcLen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RPCQOS_H */
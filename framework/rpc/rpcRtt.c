@@ -0,0 +1,349 @@
+/*
+ * rpcRtt.c
+ *
+ * This module contains the SRSP round trip time estimator of the ZigBee
+ * Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rpc.h"
+#include "rpcRtt.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// cmd1 of the slow SREQs, see rpcRttSlow
+#define RPC_RTT_SYS_OSAL_NV_ITEM_INIT    (0x07)
+#define RPC_RTT_SYS_OSAL_NV_WRITE        (0x09)
+#define RPC_RTT_SYS_OSAL_NV_DELETE       (0x12)
+#define RPC_RTT_ZDO_STARTUP_FROM_APP     (0x40)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint8_t used;
+	uint8_t subSys;
+	uint8_t cmd1;
+	uint8_t backoff;    // timeout doublings since the last sample
+	int32_t srtt8;      // smoothed round trip time in 1/8 ms
+	int32_t rttvar4;    // round trip time variation in 1/4 ms
+	uint32_t samples;
+	uint32_t timeouts;
+} rpcRttEntry_t;
+
+typedef struct
+{
+	uint8_t subSys;
+	uint8_t cmd1;
+} rpcRttSlow_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// estimators, open addressed on (subsystem, cmd1). They are only
+// updated by rpcSendFrame() with the RPC semaphore held.
+static rpcRttEntry_t rttTable[RPC_RTT_ENTRIES];
+
+// SREQs whose timeout is at least RPC_RTT_SLOW_TIMEOUT_MS
+static const rpcRttSlow_t rttSlow[] =
+{
+	{ MT_RPC_SYS_SYS, RPC_RTT_SYS_OSAL_NV_ITEM_INIT },
+	{ MT_RPC_SYS_SYS, RPC_RTT_SYS_OSAL_NV_WRITE },
+	{ MT_RPC_SYS_SYS, RPC_RTT_SYS_OSAL_NV_DELETE },
+	{ MT_RPC_SYS_ZDO, RPC_RTT_ZDO_STARTUP_FROM_APP },
+};
+
+/*********************************************************************
+ * LOCAL FUNCTIONS DECLARATION
+ */
+
+static rpcRttEntry_t *rttFind(uint8_t cmd0, uint8_t cmd1, uint8_t create);
+static uint32_t rttCalcTimeout(rpcRttEntry_t *entry, uint32_t minTimeout);
+static uint32_t rttMinTimeout(uint8_t cmd0, uint8_t cmd1);
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      rpcRttTimeout
+ *
+ * @brief   get the SRSP timeout of an SREQ, srtt + 4 * rttvar as in
+ *          TCP's retransmission timer (RFC 6298), RPC_RTT_INIT_TIMEOUT_MS
+ *          until the first sample
+ *
+ * @param   cmd0 - cmd0 of the SREQ
+ * @param   cmd1 - cmd1 of the SREQ
+ *
+ * @return  timeout in ms
+ */
+uint32_t rpcRttTimeout(uint8_t cmd0, uint8_t cmd1)
+{
+	return rttCalcTimeout(rttFind(cmd0, cmd1, 0), rttMinTimeout(cmd0, cmd1));
+}
+
+/*********************************************************************
+ * @fn      rpcRttSample
+ *
+ * @brief   update the estimator with a measured round trip time. Only
+ *          SREQs answered on their first transmission must be sampled,
+ *          a retried one can not tell which transmission was answered.
+ *
+ * @param   cmd0 - cmd0 of the SREQ
+ * @param   cmd1 - cmd1 of the SREQ
+ * @param   rtt - time from sending the SREQ to receiving the SRSP in ms
+ *
+ * @return  -
+ */
+void rpcRttSample(uint8_t cmd0, uint8_t cmd1, uint32_t rtt)
+{
+	rpcRttEntry_t *entry = rttFind(cmd0, cmd1, 1);
+	int32_t err;
+
+	if (entry == NULL)
+	{
+		return;
+	}
+
+	if (entry->samples == 0)
+	{
+		entry->srtt8 = (int32_t) rtt * 8;
+		entry->rttvar4 = (int32_t) rtt * 2;
+	}
+	else
+	{
+		// srtt += (rtt - srtt) / 8, rttvar += (|rtt - srtt| - rttvar) / 4
+		err = ((int32_t) rtt * 8) - entry->srtt8;
+		entry->srtt8 += err / 8;
+		if (err < 0)
+		{
+			err = -err;
+		}
+		entry->rttvar4 += ((err / 2) - entry->rttvar4) / 4;
+	}
+
+	entry->samples++;
+	entry->backoff = 0;
+}
+
+/*********************************************************************
+ * @fn      rpcRttBackoff
+ *
+ * @brief   record an SRSP timeout, the timeout of the SREQ is doubled
+ *          until the next sample
+ *
+ * @param   cmd0 - cmd0 of the SREQ
+ * @param   cmd1 - cmd1 of the SREQ
+ *
+ * @return  -
+ */
+void rpcRttBackoff(uint8_t cmd0, uint8_t cmd1)
+{
+	rpcRttEntry_t *entry = rttFind(cmd0, cmd1, 1);
+
+	if (entry != NULL)
+	{
+		entry->timeouts++;
+		if (rttCalcTimeout(entry, rttMinTimeout(cmd0, cmd1))
+		        < RPC_RTT_MAX_TIMEOUT_MS)
+		{
+			entry->backoff++;
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      rpcRttGetStats
+ *
+ * @brief   get the estimator state of an SREQ
+ *
+ * @param   cmd0 - cmd0 of the SREQ
+ * @param   cmd1 - cmd1 of the SREQ
+ * @param   stats - filled in with the estimator state
+ *
+ * @return  status, -1 if the SREQ was never sent
+ */
+int32_t rpcRttGetStats(uint8_t cmd0, uint8_t cmd1, rpcRttStats_t *stats)
+{
+	rpcRttEntry_t *entry = rttFind(cmd0, cmd1, 0);
+
+	if (entry == NULL)
+	{
+		return -1;
+	}
+
+	stats->srtt = entry->srtt8 / 8;
+	stats->rttvar = entry->rttvar4 / 4;
+	stats->timeout = rttCalcTimeout(entry, rttMinTimeout(cmd0, cmd1));
+	stats->samples = entry->samples;
+	stats->timeouts = entry->timeouts;
+
+	return 0;
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      rttFind
+ *
+ * @brief   find the estimator of an SREQ
+ *
+ * @param   cmd0 - cmd0 of the SREQ
+ * @param   cmd1 - cmd1 of the SREQ
+ * @param   create - 1 to allocate an entry if there is none, the first
+ *          probed one is reused when the table is full
+ *
+ * @return  entry, NULL if not found
+ */
+static rpcRttEntry_t *rttFind(uint8_t cmd0, uint8_t cmd1, uint8_t create)
+{
+	uint8_t subSys = cmd0 & MT_RPC_SUBSYSTEM_MASK;
+	uint32_t start, idx, probe;
+
+	start = ((subSys * 31) + cmd1) % RPC_RTT_ENTRIES;
+
+	for (probe = 0; probe < RPC_RTT_ENTRIES; probe++)
+	{
+		idx = (start + probe) % RPC_RTT_ENTRIES;
+
+		if (!rttTable[idx].used)
+		{
+			break;
+		}
+
+		if ((rttTable[idx].subSys == subSys) && (rttTable[idx].cmd1 == cmd1))
+		{
+			return &rttTable[idx];
+		}
+	}
+
+	if (!create)
+	{
+		return NULL;
+	}
+
+	if (probe == RPC_RTT_ENTRIES)
+	{
+		idx = start;
+	}
+
+	memset(&rttTable[idx], 0, sizeof(rpcRttEntry_t));
+	rttTable[idx].used = 1;
+	rttTable[idx].subSys = subSys;
+	rttTable[idx].cmd1 = cmd1;
+
+	return &rttTable[idx];
+}
+
+/*********************************************************************
+ * @fn      rttCalcTimeout
+ *
+ * @brief   calculate the timeout of an estimator
+ *
+ * @param   entry - estimator, NULL if the SREQ has not been sent yet
+ * @param   minTimeout - lowest timeout of the SREQ in ms
+ *
+ * @return  timeout in ms
+ */
+static uint32_t rttCalcTimeout(rpcRttEntry_t *entry, uint32_t minTimeout)
+{
+	uint32_t timeout;
+
+	if ((entry == NULL) || (entry->samples == 0))
+	{
+		timeout = RPC_RTT_INIT_TIMEOUT_MS;
+	}
+	else
+	{
+		timeout = (entry->srtt8 / 8) + entry->rttvar4;
+	}
+	if (timeout < minTimeout)
+	{
+		timeout = minTimeout;
+	}
+
+	if (entry == NULL)
+	{
+		return timeout;
+	}
+
+	timeout <<= entry->backoff;
+	if (timeout > RPC_RTT_MAX_TIMEOUT_MS)
+	{
+		timeout = RPC_RTT_MAX_TIMEOUT_MS;
+	}
+
+	return timeout;
+}
+
+/*********************************************************************
+ * @fn      rttMinTimeout
+ *
+ * @brief   get the lowest SRSP timeout of an SREQ
+ *
+ * @param   cmd0 - cmd0 of the SREQ
+ * @param   cmd1 - cmd1 of the SREQ
+ *
+ * @return  timeout in ms
+ */
+static uint32_t rttMinTimeout(uint8_t cmd0, uint8_t cmd1)
+{
+	uint8_t subSys = cmd0 & MT_RPC_SUBSYSTEM_MASK;
+	uint32_t idx;
+
+	for (idx = 0; idx < (sizeof(rttSlow) / sizeof(rttSlow[0])); idx++)
+	{
+		if ((rttSlow[idx].subSys == subSys) && (rttSlow[idx].cmd1 == cmd1))
+		{
+			return RPC_RTT_SLOW_TIMEOUT_MS;
+		}
+	}
+
+	return RPC_RTT_MIN_TIMEOUT_MS;
+}
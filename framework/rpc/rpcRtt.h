@@ -0,0 +1,97 @@
+/*
+ * rpcRtt.h
+ *
+ * This module contains the SRSP round trip time estimator of the ZigBee
+ * Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef RPCRTT_H
+#define RPCRTT_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// number of (subsystem, cmd1) pairs tracked
+#define RPC_RTT_ENTRIES            (64)
+
+// SRSP timeout bounds
+#define RPC_RTT_MIN_TIMEOUT_MS     (200)
+#define RPC_RTT_MAX_TIMEOUT_MS     (8000)
+
+// SRSP timeout before the first sample, the former fixed timeout
+#define RPC_RTT_INIT_TIMEOUT_MS    (2000)
+
+// minimum SRSP timeout of the slow SREQs (NV writes during a flash
+// compaction, ZDO startup), which must not time out on a short estimate
+#define RPC_RTT_SLOW_TIMEOUT_MS    (2000)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint32_t srtt;      // smoothed round trip time in ms
+	uint32_t rttvar;    // round trip time variation in ms
+	uint32_t timeout;   // current SRSP timeout in ms
+	uint32_t samples;   // number of round trip times measured
+	uint32_t timeouts;  // number of SRSP timeouts
+} rpcRttStats_t;
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+uint32_t rpcRttTimeout(uint8_t cmd0, uint8_t cmd1);
+void rpcRttSample(uint8_t cmd0, uint8_t cmd1, uint32_t rtt);
+void rpcRttBackoff(uint8_t cmd0, uint8_t cmd1);
+int32_t rpcRttGetStats(uint8_t cmd0, uint8_t cmd1, rpcRttStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RPCRTT_H */
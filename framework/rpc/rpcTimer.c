@@ -0,0 +1,425 @@
+/*
+ * rpcTimer.c
+ *
+ * This module contains the monotonic clock and the timer wheel used for
+ * timeouts by the ZigBee Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <semaphore.h>
+#include <time.h>
+
+#include "rpcTimer.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// one list of timers per slot, a timer is in the slot of the first tick
+// at or after its expiry
+static rpcTimer_t *timerWheel[RPC_TIMER_WHEEL_SLOTS];
+
+// last tick processed by rpcTimerProcess()
+static uint64_t timerTick = 0;
+
+// earliest due time reported by rpcTimerProcess(), used to decide if a
+// new timer needs to wake up the thread running the timers
+static uint64_t timerNextDue = RPC_TIMER_NEVER;
+
+// number of running timers
+static uint32_t timerCount = 0;
+
+// called when a timer is started that is due before the thread running
+// the timers wakes up
+static void (*timerKickCb)(void) = NULL;
+
+// protects the wheel
+static sem_t timerSem;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS DECLARATION
+ */
+
+static void timerInsert(rpcTimer_t *timer);
+static void timerUnlink(rpcTimer_t *timer);
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      rpcTimerNow
+ *
+ * @brief   read the monotonic clock, which is not affected by changes
+ *          of the wall clock
+ *
+ * @param   -
+ *
+ * @return  time in ms
+ */
+uint64_t rpcTimerNow(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return ((uint64_t) now.tv_sec * 1000) + (now.tv_nsec / 1000000);
+}
+
+/*********************************************************************
+ * @fn      rpcTimerAbsTime
+ *
+ * @brief   convert a monotonic deadline to the absolute wall clock time
+ *          expected by sem_timedwait(). A wall clock step during the wait
+ *          would shorten or stretch it, so the time returned is at most
+ *          RPC_TIMER_ABS_SLICE_MS away; the caller waits again until
+ *          rpcTimerNow() reaches the deadline.
+ *
+ * @param   deadline - monotonic time in ms, see rpcTimerNow()
+ * @param   absTime - filled in with the absolute time
+ *
+ * @return  -
+ */
+void rpcTimerAbsTime(uint64_t deadline, struct timespec *absTime)
+{
+	uint64_t now = rpcTimerNow();
+	uint64_t delay = (deadline > now) ? (deadline - now) : 0;
+
+	if (delay > RPC_TIMER_ABS_SLICE_MS)
+	{
+		delay = RPC_TIMER_ABS_SLICE_MS;
+	}
+
+	clock_gettime(CLOCK_REALTIME, absTime);
+
+	absTime->tv_sec += (delay / 1000);
+	absTime->tv_nsec += (long) (delay % 1000) * 1000000L;
+	if (absTime->tv_nsec >= 1000000000L)
+	{
+		absTime->tv_sec++;
+		absTime->tv_nsec -= 1000000000L;
+	}
+}
+
+/*********************************************************************
+ * @fn      rpcTimerInit
+ *
+ * @brief   initialise the timer wheel
+ *
+ * @param   kickCb - called when a timer is started that is due before
+ *          the thread running rpcTimerProcess() wakes up, may be NULL
+ *
+ * @return  -
+ */
+void rpcTimerInit(void (*kickCb)(void))
+{
+	memset(timerWheel, 0, sizeof(timerWheel));
+	timerTick = rpcTimerNow() / RPC_TIMER_TICK_MS;
+	timerNextDue = RPC_TIMER_NEVER;
+	timerCount = 0;
+	timerKickCb = kickCb;
+
+	sem_init(&timerSem, 0, 1);
+}
+
+/*********************************************************************
+ * @fn      rpcTimerStart
+ *
+ * @brief   start (or restart) a timer. The callback runs on the thread
+ *          calling rpcTimerProcess(), normally the one processing the
+ *          incoming messages, and may restart or stop the timer.
+ *
+ * @param   timer - timer, must stay valid while it is running
+ * @param   timeout - time to the first expiry in ms
+ * @param   period - time between expiries in ms, 0 for a one shot timer
+ * @param   cb - function called on expiry
+ * @param   arg - argument passed to cb
+ *
+ * @return  -
+ */
+void rpcTimerStart(rpcTimer_t *timer, uint32_t timeout, uint32_t period,
+        rpcTimerCb_t cb, void *arg)
+{
+	uint8_t kick = 0;
+
+	sem_wait(&timerSem);
+
+	if (timer->active)
+	{
+		timerUnlink(timer);
+	}
+	else
+	{
+		timerCount++;
+	}
+
+	timer->expiry = rpcTimerNow() + timeout;
+	timer->period = period;
+	timer->cb = cb;
+	timer->arg = arg;
+	timer->active = 1;
+	timerInsert(timer);
+
+	if (timer->expiry < timerNextDue)
+	{
+		timerNextDue = timer->expiry;
+		kick = 1;
+	}
+
+	sem_post(&timerSem);
+
+	if (kick && (timerKickCb != NULL))
+	{
+		timerKickCb();
+	}
+}
+
+/*********************************************************************
+ * @fn      rpcTimerStop
+ *
+ * @brief   stop a timer, does nothing if it is not running
+ *
+ * @param   timer - timer
+ *
+ * @return  -
+ */
+void rpcTimerStop(rpcTimer_t *timer)
+{
+	sem_wait(&timerSem);
+
+	if (timer->active)
+	{
+		timerUnlink(timer);
+		timer->active = 0;
+		timerCount--;
+	}
+
+	sem_post(&timerSem);
+}
+
+/*********************************************************************
+ * @fn      rpcTimerActive
+ *
+ * @brief   check if a timer is running
+ *
+ * @param   timer - timer
+ *
+ * @return  1 if running, 0 otherwise
+ */
+uint8_t rpcTimerActive(rpcTimer_t *timer)
+{
+	return timer->active;
+}
+
+/*********************************************************************
+ * @fn      rpcTimerProcess
+ *
+ * @brief   run the callbacks of the expired timers
+ *
+ * @param   -
+ *
+ * @return  ms until the next timer is due, RPC_TIMER_FOREVER if none
+ */
+uint32_t rpcTimerProcess(void)
+{
+	uint64_t now, nowTick, due;
+	uint32_t tickCnt;
+	rpcTimer_t *timer;
+	rpcTimerCb_t cb;
+	void *arg;
+
+	now = rpcTimerNow();
+	nowTick = now / RPC_TIMER_TICK_MS;
+
+	while (1)
+	{
+		sem_wait(&timerSem);
+
+		// a whole revolution covers every slot
+		if ((timerTick < nowTick)
+		        && ((nowTick - timerTick) > RPC_TIMER_WHEEL_SLOTS))
+		{
+			timerTick = nowTick - RPC_TIMER_WHEEL_SLOTS;
+		}
+
+		// find the next expired timer, one at a time as the callbacks
+		// may start and stop timers
+		timer = NULL;
+		while ((timerTick < nowTick) && (timer == NULL))
+		{
+			timer = timerWheel[(timerTick + 1) % RPC_TIMER_WHEEL_SLOTS];
+			while ((timer != NULL)
+			        && (timer->expiry > (nowTick * RPC_TIMER_TICK_MS)))
+			{
+				timer = timer->next;
+			}
+
+			if (timer == NULL)
+			{
+				timerTick++;
+			}
+		}
+
+		if (timer == NULL)
+		{
+			break;
+		}
+
+		timerUnlink(timer);
+		cb = timer->cb;
+		arg = timer->arg;
+
+		if (timer->period != 0)
+		{
+			timer->expiry += timer->period;
+			if (timer->expiry <= now)
+			{
+				// we are late, do not try to catch up
+				timer->expiry = now + timer->period;
+			}
+			timerInsert(timer);
+		}
+		else
+		{
+			timer->active = 0;
+			timerCount--;
+		}
+
+		sem_post(&timerSem);
+
+		cb(arg);
+	}
+
+	// find when the next timer is due
+	timerNextDue = RPC_TIMER_NEVER;
+	if (timerCount > 0)
+	{
+		for (tickCnt = 1; tickCnt <= RPC_TIMER_WHEEL_SLOTS; tickCnt++)
+		{
+			due = (timerTick + tickCnt) * RPC_TIMER_TICK_MS;
+			timer = timerWheel[(timerTick + tickCnt) % RPC_TIMER_WHEEL_SLOTS];
+			while ((timer != NULL) && (timer->expiry > due))
+			{
+				timer = timer->next;
+			}
+
+			if (timer != NULL)
+			{
+				timerNextDue = due;
+				break;
+			}
+		}
+
+		if (timerNextDue == RPC_TIMER_NEVER)
+		{
+			// only timers more than a revolution away
+			timerNextDue = (timerTick + RPC_TIMER_WHEEL_SLOTS)
+			        * RPC_TIMER_TICK_MS;
+		}
+	}
+
+	due = timerNextDue;
+
+	sem_post(&timerSem);
+
+	if (due == RPC_TIMER_NEVER)
+	{
+		return RPC_TIMER_FOREVER;
+	}
+
+	return (due > now) ? (uint32_t) (due - now) : 0;
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      timerInsert
+ *
+ * @brief   link a timer into the slot of its expiry. Must be called with
+ *          timerSem held.
+ *
+ * @param   timer - timer
+ *
+ * @return  -
+ */
+static void timerInsert(rpcTimer_t *timer)
+{
+	uint64_t tick;
+
+	// first tick at or after the expiry, but never one already processed
+	tick = (timer->expiry + RPC_TIMER_TICK_MS - 1) / RPC_TIMER_TICK_MS;
+	if (tick <= timerTick)
+	{
+		tick = timerTick + 1;
+	}
+
+	timer->slot = (uint16_t) (tick % RPC_TIMER_WHEEL_SLOTS);
+	timer->next = timerWheel[timer->slot];
+	timerWheel[timer->slot] = timer;
+}
+
+/*********************************************************************
+ * @fn      timerUnlink
+ *
+ * @brief   remove a timer from its slot. Must be called with timerSem
+ *          held.
+ *
+ * @param   timer - timer
+ *
+ * @return  -
+ */
+static void timerUnlink(rpcTimer_t *timer)
+{
+	rpcTimer_t **link;
+
+	for (link = &timerWheel[timer->slot]; *link != NULL;
+	        link = &(*link)->next)
+	{
+		if (*link == timer)
+		{
+			*link = timer->next;
+			timer->next = NULL;
+			return;
+		}
+	}
+}
@@ -0,0 +1,110 @@
+/*
+ * rpcTimer.h
+ *
+ * This module contains the monotonic clock and the timer wheel used for
+ * timeouts by the ZigBee Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef RPCTIMER_H
+#define RPCTIMER_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+#include <time.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// resolution of the timer wheel in ms
+#define RPC_TIMER_TICK_MS        (10)
+
+// number of slots of the wheel, timers further away than one revolution
+// stay in their slot for the following revolutions
+#define RPC_TIMER_WHEEL_SLOTS    (256)
+
+// returned by rpcTimerProcess() when no timer is running
+#define RPC_TIMER_FOREVER        (0xFFFFFFFF)
+
+// deadline that never expires
+#define RPC_TIMER_NEVER          (0xFFFFFFFFFFFFFFFFULL)
+
+// longest wait returned by rpcTimerAbsTime() in ms, which bounds the error
+// a step of the wall clock can cause
+#define RPC_TIMER_ABS_SLICE_MS   (1000)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef void (*rpcTimerCb_t)(void *arg);
+
+// timer, owned by the caller and linked into the wheel while running
+typedef struct rpcTimer
+{
+	struct rpcTimer *next;
+	uint64_t expiry;    // monotonic time in ms
+	uint32_t period;    // ms, 0 for a one shot timer
+	rpcTimerCb_t cb;
+	void *arg;
+	uint16_t slot;     // slot of the wheel while running
+	uint8_t active;
+} rpcTimer_t;
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+uint64_t rpcTimerNow(void);
+void rpcTimerAbsTime(uint64_t deadline, struct timespec *absTime);
+void rpcTimerInit(void (*kickCb)(void));
+void rpcTimerStart(rpcTimer_t *timer, uint32_t timeout, uint32_t period,
+        rpcTimerCb_t cb, void *arg);
+void rpcTimerStop(rpcTimer_t *timer);
+uint8_t rpcTimerActive(rpcTimer_t *timer);
+uint32_t rpcTimerProcess(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RPCTIMER_H */
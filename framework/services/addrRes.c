@@ -0,0 +1,815 @@
+/*
+ * addrRes.c
+ *
+ * This module contains the address resolver of the ZigBee Network
+ * Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include <semaphore.h>
+
+#include "addrRes.h"
+#include "mtZdo.h"
+#include "rpc.h"
+#include "rpcTimer.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// addrResQuery_t type
+#define ADDR_RES_QUERY_NWK         (0)  // ZDO_NWK_ADDR_REQ, key is extAddr
+#define ADDR_RES_QUERY_IEEE        (1)  // ZDO_IEEE_ADDR_REQ, key is nwkAddr
+
+// ReqType of the requests, the device alone
+#define ADDR_RES_REQ_SINGLE        (0)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint8_t used;
+	uint16_t nwkAddr;
+	uint64_t extAddr;
+	uint64_t learnt;       // rpcTimerNow() of the last update
+} addrResEntry_t;
+
+typedef struct
+{
+	uint8_t used;
+	uint8_t type;          // ADDR_RES_QUERY_xxx
+	uint16_t nwkAddr;
+	uint64_t extAddr;
+	uint16_t gen;          // incremented for each query
+	rpcTimer_t timer;      // response timeout
+} addrResQuery_t;
+
+typedef struct
+{
+	uint8_t used;
+	uint8_t query;         // index in resQueries
+	addrResCb_t cb;
+	void *arg;
+} addrResWaiter_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static addrResEntry_t resEntries[ADDR_RES_MAX_ENTRIES];
+static addrResQuery_t resQueries[ADDR_RES_MAX_QUERIES];
+static addrResWaiter_t resWaiters[ADDR_RES_MAX_WAITERS];
+static addrResStats_t resStats;
+
+static uint32_t resTtl = ADDR_RES_DEFAULT_TTL;
+static uint32_t resTimeout = ADDR_RES_DEFAULT_TIMEOUT;
+
+// protects all of the above
+static sem_t resSem;
+// serialises the requests
+static sem_t resSendSem;
+
+static uint8_t resInitDone = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS DECLARATION
+ */
+
+static uint8_t resNwkAddrRspCb(NwkAddrRspFormat_t *msg);
+static uint8_t resIeeeAddrRspCb(IeeeAddrRspFormat_t *msg);
+static uint8_t resEndDeviceAnnceIndCb(EndDeviceAnnceIndFormat_t *msg);
+static uint8_t resLeaveIndCb(LeaveIndFormat_t *msg);
+static void resTimeoutCb(void *arg);
+static int32_t resGet(uint8_t type, uint16_t nwkAddr, uint64_t extAddr,
+        uint16_t *nwkOut, uint64_t *extOut, addrResCb_t cb, void *arg);
+static void resAnswer(uint8_t type, uint16_t nwkAddr, uint64_t extAddr,
+        uint8_t status);
+static uint8_t resTake(addrResQuery_t *query, uint8_t status,
+        addrResWaiter_t *done, uint8_t cnt);
+static void resDone(addrResWaiter_t *done, uint8_t cnt, uint8_t status,
+        uint16_t nwkAddr, uint64_t extAddr);
+static addrResQuery_t *resFindQuery(uint8_t type, uint16_t nwkAddr,
+        uint64_t extAddr);
+static addrResEntry_t *resFindNwk(uint16_t nwkAddr);
+static addrResEntry_t *resFindExt(uint64_t extAddr);
+static void resLearn(uint16_t nwkAddr, uint64_t extAddr);
+
+static mtZdoCb_t resZdoCbs =
+	{ .pfnZdoNwkAddrRsp = resNwkAddrRspCb,
+	        .pfnZdoIeeeAddrRsp = resIeeeAddrRspCb,
+	        .pfnZdoEndDeviceAnnceInd = resEndDeviceAnnceIndCb,
+	        .pfnZdoLeaveInd = resLeaveIndCb, };
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      addrResInit
+ *
+ * @brief   initialise the address resolver, must be called once after
+ *          rpcInitMq()
+ *
+ * @param   -
+ *
+ * @return  status, -1 if its observer could not be registered
+ */
+int32_t addrResInit(void)
+{
+	memset(resEntries, 0, sizeof(resEntries));
+	memset(resQueries, 0, sizeof(resQueries));
+	memset(resWaiters, 0, sizeof(resWaiters));
+	memset(&resStats, 0, sizeof(resStats));
+
+	sem_init(&resSem, 0, 1);
+	sem_init(&resSendSem, 0, 1);
+
+	if (!resInitDone)
+	{
+		if (zdoRegisterObserver(&resZdoCbs) != 0)
+		{
+			dbg_print(PRINT_LEVEL_WARNING,
+			        "addrResInit: no free observer entry\n");
+			return -1;
+		}
+		resInitDone = 1;
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      addrResConfig
+ *
+ * @brief   set how long addresses are cached and waited for
+ *
+ * @param   ttl - time an address is answered from the cache in ms
+ * @param   timeout - time to wait for a response in ms
+ *
+ * @return  -
+ */
+void addrResConfig(uint32_t ttl, uint32_t timeout)
+{
+	sem_wait(&resSem);
+
+	resTtl = ttl;
+	resTimeout = timeout;
+
+	sem_post(&resSem);
+}
+
+/*********************************************************************
+ * @fn      addrResGetNwk
+ *
+ * @brief   resolve an IEEE address to a short address. A cached address
+ *          is returned at once. Otherwise a ZDO_NWK_ADDR_REQ is sent,
+ *          unless one is already in flight for the same device, and cb
+ *          is called with the answer.
+ *
+ * @param   extAddr - IEEE address
+ * @param   nwkAddr - filled in with the short address if cached
+ * @param   cb - called once if ADDR_RES_PENDING is returned, possibly
+ *          before addrResGetNwk() returns if the request fails
+ * @param   arg - passed to cb
+ *
+ * @return  ADDR_RES_CACHED, ADDR_RES_PENDING or -1 if no more lookups
+ *          can wait
+ */
+int32_t addrResGetNwk(uint64_t extAddr, uint16_t *nwkAddr, addrResCb_t cb,
+        void *arg)
+{
+	return resGet(ADDR_RES_QUERY_NWK, 0, extAddr, nwkAddr, NULL, cb, arg);
+}
+
+/*********************************************************************
+ * @fn      addrResGetIeee
+ *
+ * @brief   resolve a short address to an IEEE address, as
+ *          addrResGetNwk() with a ZDO_IEEE_ADDR_REQ
+ *
+ * @param   nwkAddr - short address
+ * @param   extAddr - filled in with the IEEE address if cached
+ * @param   cb - called once if ADDR_RES_PENDING is returned
+ * @param   arg - passed to cb
+ *
+ * @return  ADDR_RES_CACHED, ADDR_RES_PENDING or -1 if no more lookups
+ *          can wait
+ */
+int32_t addrResGetIeee(uint16_t nwkAddr, uint64_t *extAddr, addrResCb_t cb,
+        void *arg)
+{
+	return resGet(ADDR_RES_QUERY_IEEE, nwkAddr, 0, NULL, extAddr, cb, arg);
+}
+
+/*********************************************************************
+ * @fn      addrResInvalidate
+ *
+ * @brief   forget the cached addresses of a device, for example when a
+ *          message to it failed
+ *
+ * @param   nwkAddr - short address
+ *
+ * @return  -
+ */
+void addrResInvalidate(uint16_t nwkAddr)
+{
+	addrResEntry_t *entry;
+
+	if (!resInitDone)
+	{
+		return;
+	}
+
+	sem_wait(&resSem);
+
+	entry = resFindNwk(nwkAddr);
+	if (entry)
+	{
+		entry->used = 0;
+		resStats.entries--;
+	}
+
+	sem_post(&resSem);
+}
+
+/*********************************************************************
+ * @fn      addrResGetStats
+ *
+ * @brief   get the address resolver counters
+ *
+ * @param   stats - filled in with the counters
+ *
+ * @return  -
+ */
+void addrResGetStats(addrResStats_t *stats)
+{
+	sem_wait(&resSem);
+
+	memcpy(stats, &resStats, sizeof(addrResStats_t));
+
+	sem_post(&resSem);
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      resNwkAddrRspCb
+ *
+ * @brief   MT_ZDO_NWK_ADDR_RSP observer. A failed response carries the
+ *          IEEE address of the request.
+ *
+ * @param   msg - response
+ *
+ * @return  0, the application still gets the response
+ */
+static uint8_t resNwkAddrRspCb(NwkAddrRspFormat_t *msg)
+{
+	resAnswer(ADDR_RES_QUERY_NWK, msg->NwkAddr, msg->IEEEAddr,
+	        (msg->Status == MT_RPC_SUCCESS) ?
+	                ADDR_RES_SUCCESS : ADDR_RES_FAILED);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      resIeeeAddrRspCb
+ *
+ * @brief   MT_ZDO_IEEE_ADDR_RSP observer. A failed response carries the
+ *          short address of the request.
+ *
+ * @param   msg - response
+ *
+ * @return  0, the application still gets the response
+ */
+static uint8_t resIeeeAddrRspCb(IeeeAddrRspFormat_t *msg)
+{
+	resAnswer(ADDR_RES_QUERY_IEEE, msg->NwkAddr, msg->IEEEAddr,
+	        (msg->Status == MT_RPC_SUCCESS) ?
+	                ADDR_RES_SUCCESS : ADDR_RES_FAILED);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      resEndDeviceAnnceIndCb
+ *
+ * @brief   MT_ZDO_END_DEVICE_ANNCE_IND observer, the addresses are
+ *          cached and answer the queries in flight for the device
+ *
+ * @param   msg - announcement
+ *
+ * @return  0, the application still gets the indication
+ */
+static uint8_t resEndDeviceAnnceIndCb(EndDeviceAnnceIndFormat_t *msg)
+{
+	sem_wait(&resSem);
+	resStats.refreshes++;
+	sem_post(&resSem);
+
+	resAnswer(ADDR_RES_QUERY_NWK, msg->NwkAddr, msg->IEEEAddr,
+	        ADDR_RES_SUCCESS);
+	resAnswer(ADDR_RES_QUERY_IEEE, msg->NwkAddr, msg->IEEEAddr,
+	        ADDR_RES_SUCCESS);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      resLeaveIndCb
+ *
+ * @brief   MT_ZDO_LEAVE_IND observer, the addresses of a device leaving
+ *          are forgotten
+ *
+ * @param   msg - leave indication
+ *
+ * @return  0, the application still gets the indication
+ */
+static uint8_t resLeaveIndCb(LeaveIndFormat_t *msg)
+{
+	addrResEntry_t *entry;
+
+	sem_wait(&resSem);
+
+	entry = resFindExt(msg->ExtAddr);
+	if (entry)
+	{
+		entry->used = 0;
+		resStats.entries--;
+	}
+
+	sem_post(&resSem);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      resTimeoutCb
+ *
+ * @brief   a query was not answered in time
+ *
+ * @param   arg - the query index in the high and its generation in the low
+ *                16 bits
+ *
+ * @return  -
+ */
+static void resTimeoutCb(void *arg)
+{
+	addrResQuery_t *query = &resQueries[(uintptr_t) arg >> 16];
+	uint16_t gen = (uint16_t) (uintptr_t) arg;
+	addrResWaiter_t done[ADDR_RES_MAX_WAITERS];
+	uint16_t nwkAddr;
+	uint64_t extAddr;
+	uint8_t cnt = 0;
+
+	sem_wait(&resSem);
+
+	nwkAddr = query->nwkAddr;
+	extAddr = query->extAddr;
+	// the query may have been answered, and its slot reused, while the
+	// timer callback was being called
+	if (query->used && (query->gen == gen))
+	{
+		cnt = resTake(query, ADDR_RES_TIMEOUT, done, cnt);
+	}
+
+	sem_post(&resSem);
+
+	if (cnt)
+	{
+		dbg_print(PRINT_LEVEL_INFO, "addrRes: no response for %04X %016llX\n",
+		        nwkAddr, (unsigned long long) extAddr);
+	}
+
+	resDone(done, cnt, ADDR_RES_TIMEOUT, nwkAddr, extAddr);
+}
+
+/*********************************************************************
+ * @fn      resGet
+ *
+ * @brief   look up the cache, or join or start a query
+ *
+ * @param   type - ADDR_RES_QUERY_xxx
+ * @param   nwkAddr - key of an ADDR_RES_QUERY_IEEE
+ * @param   extAddr - key of an ADDR_RES_QUERY_NWK
+ * @param   nwkOut - filled in with the cached short address, may be NULL
+ * @param   extOut - filled in with the cached IEEE address, may be NULL
+ * @param   cb - called with the answer of the query
+ * @param   arg - passed to cb
+ *
+ * @return  ADDR_RES_CACHED, ADDR_RES_PENDING or -1
+ */
+static int32_t resGet(uint8_t type, uint16_t nwkAddr, uint64_t extAddr,
+        uint16_t *nwkOut, uint64_t *extOut, addrResCb_t cb, void *arg)
+{
+	addrResWaiter_t done[ADDR_RES_MAX_WAITERS];
+	addrResEntry_t *entry;
+	addrResQuery_t *query;
+	addrResWaiter_t *waiter = NULL;
+	uint16_t gen;
+	uint8_t status, idx, cnt = 0;
+
+	if (!resInitDone)
+	{
+		return -1;
+	}
+
+	sem_wait(&resSem);
+
+	if (type == ADDR_RES_QUERY_NWK)
+	{
+		entry = resFindExt(extAddr);
+	}
+	else
+	{
+		entry = resFindNwk(nwkAddr);
+	}
+	if (entry && ((rpcTimerNow() - entry->learnt) < resTtl))
+	{
+		if (nwkOut)
+		{
+			*nwkOut = entry->nwkAddr;
+		}
+		if (extOut)
+		{
+			*extOut = entry->extAddr;
+		}
+		resStats.hits++;
+		sem_post(&resSem);
+		return ADDR_RES_CACHED;
+	}
+
+	for (idx = 0; idx < ADDR_RES_MAX_WAITERS; idx++)
+	{
+		if (!resWaiters[idx].used)
+		{
+			waiter = &resWaiters[idx];
+			break;
+		}
+	}
+
+	query = resFindQuery(type, nwkAddr, extAddr);
+	if (query && waiter)
+	{
+		waiter->used = 1;
+		waiter->query = query - resQueries;
+		waiter->cb = cb;
+		waiter->arg = arg;
+		resStats.misses++;
+		resStats.coalesced++;
+		sem_post(&resSem);
+		return ADDR_RES_PENDING;
+	}
+
+	for (idx = 0; (idx < ADDR_RES_MAX_QUERIES) && !query; idx++)
+	{
+		if (!resQueries[idx].used)
+		{
+			query = &resQueries[idx];
+		}
+	}
+	if ((query == NULL) || (waiter == NULL) || query->used)
+	{
+		sem_post(&resSem);
+		return -1;
+	}
+
+	query->used = 1;
+	query->type = type;
+	query->nwkAddr = nwkAddr;
+	query->extAddr = extAddr;
+	gen = ++query->gen;
+	rpcTimerStart(&query->timer, resTimeout, 0, resTimeoutCb,
+	        (void *) (((uintptr_t) (query - resQueries) << 16) | gen));
+
+	waiter->used = 1;
+	waiter->query = query - resQueries;
+	waiter->cb = cb;
+	waiter->arg = arg;
+
+	resStats.misses++;
+	resStats.requests++;
+
+	sem_post(&resSem);
+
+	sem_wait(&resSendSem);
+	if (type == ADDR_RES_QUERY_NWK)
+	{
+		NwkAddrReqFormat_t req;
+
+		for (idx = 0; idx < 8; idx++)
+		{
+			req.IEEEAddress[idx] = (uint8_t) (extAddr >> (8 * idx));
+		}
+		req.ReqType = ADDR_RES_REQ_SINGLE;
+		req.StartIndex = 0;
+		status = zdoNwkAddrReq(&req);
+	}
+	else
+	{
+		IeeeAddrReqFormat_t req;
+
+		req.ShortAddr = nwkAddr;
+		req.ReqType = ADDR_RES_REQ_SINGLE;
+		req.StartIndex = 0;
+		status = zdoIeeeAddrReq(&req);
+	}
+	sem_post(&resSendSem);
+
+	if (status != MT_RPC_SUCCESS)
+	{
+		dbg_print(PRINT_LEVEL_WARNING, "addrRes: request failed %02X\n",
+		        status);
+
+		sem_wait(&resSem);
+		if (query->used && (query->gen == gen))
+		{
+			cnt = resTake(query, ADDR_RES_FAILED, done, cnt);
+		}
+		sem_post(&resSem);
+
+		resDone(done, cnt, ADDR_RES_FAILED, nwkAddr, extAddr);
+	}
+
+	return ADDR_RES_PENDING;
+}
+
+/*********************************************************************
+ * @fn      resAnswer
+ *
+ * @brief   cache the addresses of a device and answer its query in
+ *          flight
+ *
+ * @param   type - ADDR_RES_QUERY_xxx answered
+ * @param   nwkAddr - short address
+ * @param   extAddr - IEEE address
+ * @param   status - ADDR_RES_SUCCESS or ADDR_RES_FAILED, a failed
+ *          answer holds only the key of the query
+ *
+ * @return  -
+ */
+static void resAnswer(uint8_t type, uint16_t nwkAddr, uint64_t extAddr,
+        uint8_t status)
+{
+	addrResWaiter_t done[ADDR_RES_MAX_WAITERS];
+	addrResQuery_t *query;
+	uint8_t cnt = 0;
+
+	sem_wait(&resSem);
+
+	if (status == ADDR_RES_SUCCESS)
+	{
+		resLearn(nwkAddr, extAddr);
+	}
+
+	query = resFindQuery(type, nwkAddr, extAddr);
+	if (query)
+	{
+		cnt = resTake(query, status, done, cnt);
+	}
+
+	sem_post(&resSem);
+
+	resDone(done, cnt, status, nwkAddr, extAddr);
+}
+
+/*********************************************************************
+ * @fn      resTake
+ *
+ * @brief   end a query and take its waiters, called with resSem held
+ *
+ * @param   query - the query
+ * @param   status - ADDR_RES_xxx of the answer
+ * @param   done - the waiters are added to it
+ * @param   cnt - waiters already in done
+ *
+ * @return  waiters in done
+ */
+static uint8_t resTake(addrResQuery_t *query, uint8_t status,
+        addrResWaiter_t *done, uint8_t cnt)
+{
+	uint8_t idx;
+
+	rpcTimerStop(&query->timer);
+	query->used = 0;
+
+	for (idx = 0; idx < ADDR_RES_MAX_WAITERS; idx++)
+	{
+		if (resWaiters[idx].used
+		        && (resWaiters[idx].query == (query - resQueries)))
+		{
+			memcpy(&done[cnt++], &resWaiters[idx], sizeof(addrResWaiter_t));
+			resWaiters[idx].used = 0;
+		}
+	}
+
+	if (status == ADDR_RES_TIMEOUT)
+	{
+		resStats.timeouts++;
+	}
+	else if (status == ADDR_RES_FAILED)
+	{
+		resStats.failures++;
+	}
+
+	return cnt;
+}
+
+/*********************************************************************
+ * @fn      resDone
+ *
+ * @brief   call the waiters of a query
+ *
+ * @param   done - waiters
+ * @param   cnt - number of waiters
+ * @param   status - ADDR_RES_xxx
+ * @param   nwkAddr - short address
+ * @param   extAddr - IEEE address
+ *
+ * @return  -
+ */
+static void resDone(addrResWaiter_t *done, uint8_t cnt, uint8_t status,
+        uint16_t nwkAddr, uint64_t extAddr)
+{
+	uint8_t idx;
+
+	for (idx = 0; idx < cnt; idx++)
+	{
+		if (done[idx].cb)
+		{
+			done[idx].cb(status, nwkAddr, extAddr, done[idx].arg);
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      resFindQuery
+ *
+ * @brief   find a query in flight, called with resSem held
+ *
+ * @param   type - ADDR_RES_QUERY_xxx
+ * @param   nwkAddr - key of an ADDR_RES_QUERY_IEEE
+ * @param   extAddr - key of an ADDR_RES_QUERY_NWK
+ *
+ * @return  the query, NULL if there is none
+ */
+static addrResQuery_t *resFindQuery(uint8_t type, uint16_t nwkAddr,
+        uint64_t extAddr)
+{
+	uint8_t idx;
+
+	for (idx = 0; idx < ADDR_RES_MAX_QUERIES; idx++)
+	{
+		addrResQuery_t *query = &resQueries[idx];
+
+		if (query->used && (query->type == type)
+		        && (((type == ADDR_RES_QUERY_NWK)
+		                && (query->extAddr == extAddr))
+		                || ((type == ADDR_RES_QUERY_IEEE)
+		                        && (query->nwkAddr == nwkAddr))))
+		{
+			return query;
+		}
+	}
+
+	return NULL;
+}
+
+/*********************************************************************
+ * @fn      resFindNwk
+ *
+ * @brief   find a cache entry by short address, called with resSem held
+ *
+ * @param   nwkAddr - short address
+ *
+ * @return  the entry, NULL if there is none
+ */
+static addrResEntry_t *resFindNwk(uint16_t nwkAddr)
+{
+	uint16_t idx;
+
+	for (idx = 0; idx < ADDR_RES_MAX_ENTRIES; idx++)
+	{
+		if (resEntries[idx].used && (resEntries[idx].nwkAddr == nwkAddr))
+		{
+			return &resEntries[idx];
+		}
+	}
+
+	return NULL;
+}
+
+/*********************************************************************
+ * @fn      resFindExt
+ *
+ * @brief   find a cache entry by IEEE address, called with resSem held
+ *
+ * @param   extAddr - IEEE address
+ *
+ * @return  the entry, NULL if there is none
+ */
+static addrResEntry_t *resFindExt(uint64_t extAddr)
+{
+	uint16_t idx;
+
+	for (idx = 0; idx < ADDR_RES_MAX_ENTRIES; idx++)
+	{
+		if (resEntries[idx].used && (resEntries[idx].extAddr == extAddr))
+		{
+			return &resEntries[idx];
+		}
+	}
+
+	return NULL;
+}
+
+/*********************************************************************
+ * @fn      resLearn
+ *
+ * @brief   cache the addresses of a device, called with resSem held. A
+ *          short address now used by another device is forgotten.
+ *
+ * @param   nwkAddr - short address
+ * @param   extAddr - IEEE address
+ *
+ * @return  -
+ */
+static void resLearn(uint16_t nwkAddr, uint64_t extAddr)
+{
+	addrResEntry_t *entry, *stale;
+	uint16_t idx;
+
+	entry = resFindExt(extAddr);
+	stale = resFindNwk(nwkAddr);
+	if (stale && (stale != entry))
+	{
+		stale->used = 0;
+		resStats.entries--;
+	}
+
+	if (entry == NULL)
+	{
+		// a free entry, or else the least recently learnt
+		entry = &resEntries[0];
+		for (idx = 0; idx < ADDR_RES_MAX_ENTRIES; idx++)
+		{
+			if (!resEntries[idx].used)
+			{
+				entry = &resEntries[idx];
+				break;
+			}
+			if (resEntries[idx].learnt < entry->learnt)
+			{
+				entry = &resEntries[idx];
+			}
+		}
+		if (!entry->used)
+		{
+			entry->used = 1;
+			resStats.entries++;
+		}
+		entry->extAddr = extAddr;
+	}
+
+	entry->nwkAddr = nwkAddr;
+	entry->learnt = rpcTimerNow();
+}
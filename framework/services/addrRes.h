@@ -0,0 +1,116 @@
+/*
+ * addrRes.h
+ *
+ * This module contains the address resolver of the ZigBee Network
+ * Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef ADDRRES_H
+#define ADDRRES_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// address pairs cached, the least recently learnt is replaced
+#define ADDR_RES_MAX_ENTRIES          (256)
+
+// ZDO_NWK_ADDR_REQs and ZDO_IEEE_ADDR_REQs in flight at the same time
+#define ADDR_RES_MAX_QUERIES          (8)
+
+// callers waiting for the queries in flight, all queries together
+#define ADDR_RES_MAX_WAITERS          (32)
+
+// defaults of addrResConfig(), in ms
+#define ADDR_RES_DEFAULT_TTL          (300000)
+#define ADDR_RES_DEFAULT_TIMEOUT      (5000)
+
+// return of addrResGetNwk() and addrResGetIeee()
+#define ADDR_RES_CACHED               (0)
+#define ADDR_RES_PENDING              (1)
+
+// status of addrResCb_t
+#define ADDR_RES_SUCCESS              (0)
+#define ADDR_RES_FAILED               (1)  // request or response failed
+#define ADDR_RES_TIMEOUT              (2)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint16_t entries;
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t coalesced;    // lookups joining a query in flight
+	uint32_t requests;     // requests sent over the air
+	uint32_t refreshes;    // entries learnt from announcements
+	uint32_t timeouts;
+	uint32_t failures;
+} addrResStats_t;
+
+// nwkAddr and extAddr are both valid if status is ADDR_RES_SUCCESS
+typedef void (*addrResCb_t)(uint8_t status, uint16_t nwkAddr,
+        uint64_t extAddr, void *arg);
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+int32_t addrResInit(void);
+void addrResConfig(uint32_t ttl, uint32_t timeout);
+int32_t addrResGetNwk(uint64_t extAddr, uint16_t *nwkAddr, addrResCb_t cb,
+        void *arg);
+int32_t addrResGetIeee(uint16_t nwkAddr, uint64_t *extAddr, addrResCb_t cb,
+        void *arg);
+void addrResInvalidate(uint16_t nwkAddr);
+void addrResGetStats(addrResStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADDRRES_H */
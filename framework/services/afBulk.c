@@ -0,0 +1,447 @@
+/*
+ * afBulk.c
+ *
+ * This module contains the large payload AF send of the ZigBee
+ * Network Processor (ZNP) Host Interface. Payloads longer than an
+ * AF_DATA_REQUEST_EXT frame are staged in the ZNP with AF_DATA_STORE
+ * and sent by a final zero length store.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <semaphore.h>
+
+#include "afBulk.h"
+#include "mtAf.h"
+#include "rpc.h"
+#include "rpcTimer.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint8_t used;
+	uint8_t endpoint;
+	uint16_t gen;          // incremented when the entry is freed
+	uint64_t sent;         // time the payload was sent
+	afBulkResult_t result;
+	afBulkDoneCb_t cb;
+	void *arg;
+	rpcTimer_t timer;      // confirm timeout
+} afBulkPending_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// sends waiting for their confirm
+static afBulkPending_t bulkPending[AF_BULK_MAX_PENDING];
+
+// protects bulkPending
+static sem_t bulkSem;
+// the ZNP stages one payload at a time
+static sem_t bulkStageSem;
+
+static uint8_t bulkInitDone = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS DECLARATION
+ */
+
+static uint8_t bulkDataConfirmCb(DataConfirmFormat_t *msg);
+static void bulkTimeoutCb(void *arg);
+static void bulkComplete(afBulkPending_t *entry, uint16_t gen, uint8_t status);
+static uint8_t bulkStage(DataRequestExtFormat_t *req, const uint8_t *data,
+        afBulkReadCb_t reader, void *readArg, uint16_t *chunks);
+
+static mtAfCb_t bulkAfCbs =
+	{ bulkDataConfirmCb,		//MT_AF_DATA_CONFIRM
+	        NULL,			//MT_AF_INCOMING_MSG
+	        NULL,			//MT_AF_INCOMING_MSG_EXT
+	        NULL,			//MT_AF_DATA_RETRIEVE
+	        NULL,			//MT_AF_REFLECT_ERROR
+	    };
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      afBulkInit
+ *
+ * @brief   initialise the large payload send, must be called once
+ *          after rpcInitMq()
+ *
+ * @param   -
+ *
+ * @return  status, -1 if its observer could not be registered
+ */
+int32_t afBulkInit(void)
+{
+	memset(bulkPending, 0, sizeof(bulkPending));
+
+	sem_init(&bulkSem, 0, 1);
+	sem_init(&bulkStageSem, 0, 1);
+
+	if (!bulkInitDone)
+	{
+		if (afRegisterObserver(&bulkAfCbs) != 0)
+		{
+			dbg_print(PRINT_LEVEL_WARNING,
+			        "afBulkInit: no free observer entry\n");
+			return -1;
+		}
+		bulkInitDone = 1;
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      afBulkSend
+ *
+ * @brief   send a payload of up to 64k bytes. A payload that does not
+ *          fit in one AF_DATA_REQUEST_EXT is copied into the ZNP with
+ *          back to back AF_DATA_STOREs of the maximum size, straight
+ *          from data or from the reader, and then sent. The call
+ *          returns once the payload is in the ZNP, cb is called once
+ *          with the status of the MT_AF_DATA_CONFIRM or of the step
+ *          that failed, possibly before afBulkSend() returns.
+ *
+ *          The ZNP stages one payload at a time, large payloads must
+ *          not be sent with afDataRequestExt() at the same time.
+ *
+ * @param   req - request header, req->Len is the payload length and
+ *          req->Data is not used
+ * @param   data - payload, NULL to get it from reader
+ * @param   reader - called for each chunk if data is NULL
+ * @param   readArg - passed to reader
+ * @param   cb - completion callback, may be NULL
+ * @param   arg - passed to cb
+ *
+ * @return  status, -1 if too many sends are waiting for a confirm
+ */
+int32_t afBulkSend(DataRequestExtFormat_t *req, const uint8_t *data,
+        afBulkReadCb_t reader, void *readArg, afBulkDoneCb_t cb, void *arg)
+{
+	afBulkPending_t *entry = NULL;
+	uint64_t start;
+	uint16_t chunks = 0;
+	uint16_t gen;
+	uint8_t status;
+	uint8_t idx;
+
+	if ((data == NULL) && (reader == NULL))
+	{
+		return -1;
+	}
+
+	sem_wait(&bulkSem);
+
+	for (idx = 0; idx < AF_BULK_MAX_PENDING; idx++)
+	{
+		if (!bulkPending[idx].used)
+		{
+			entry = &bulkPending[idx];
+			break;
+		}
+	}
+
+	if (entry == NULL)
+	{
+		sem_post(&bulkSem);
+		dbg_print(PRINT_LEVEL_WARNING, "afBulkSend: no free entry\n");
+		return -1;
+	}
+
+	// the confirm may be processed before the SRSP of the last store
+	entry->used = 1;
+	entry->endpoint = req->SrcEndpoint;
+	entry->cb = cb;
+	entry->arg = arg;
+	memset(&entry->result, 0, sizeof(afBulkResult_t));
+	entry->result.transId = req->TransId;
+	entry->result.len = req->Len;
+	entry->sent = RPC_TIMER_NEVER;
+	gen = entry->gen;
+
+	sem_post(&bulkSem);
+
+	start = rpcTimerNow();
+
+	sem_wait(&bulkStageSem);
+	status = bulkStage(req, data, reader, readArg, &chunks);
+	sem_post(&bulkStageSem);
+
+	sem_wait(&bulkSem);
+	if (entry->gen == gen)
+	{
+		entry->result.chunks = chunks;
+		entry->result.stageTime = (uint32_t) (rpcTimerNow() - start);
+		if (status == afStatus_SUCCESS)
+		{
+			entry->sent = rpcTimerNow();
+			rpcTimerStart(&entry->timer, AF_BULK_CONFIRM_TIMEOUT_MS, 0,
+			        bulkTimeoutCb, entry);
+		}
+	}
+	sem_post(&bulkSem);
+
+	if (status != afStatus_SUCCESS)
+	{
+		bulkComplete(entry, gen, status);
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      bulkStage
+ *
+ * @brief   copy the payload into the ZNP and send it
+ *
+ * @param   req - request header
+ * @param   data - payload, NULL to get it from reader
+ * @param   reader - payload reader
+ * @param   readArg - passed to reader
+ * @param   chunks - number of AF_DATA_STOREs sent
+ *
+ * @return  afStatus_xxx or AF_BULK_STATUS_xxx
+ */
+static uint8_t bulkStage(DataRequestExtFormat_t *req, const uint8_t *data,
+        afBulkReadCb_t reader, void *readArg, uint16_t *chunks)
+{
+	DataRequestExtFormat_t ext;
+	DataStoreFormat_t store;
+	uint16_t offset, len;
+	uint8_t status;
+
+	memcpy(&ext, req, sizeof(DataRequestExtFormat_t));
+
+	if (ext.Len <= MT_AF_DATA_EXT_MAX_LEN)
+	{
+		// fits in a single frame
+		if (data != NULL)
+		{
+			memcpy(ext.Data, data, ext.Len);
+		}
+		else if (reader(0, ext.Data, ext.Len, readArg) != ext.Len)
+		{
+			return AF_BULK_STATUS_READ_ERROR;
+		}
+
+		if (afDataRequestExtRsp(&ext, &status) != MT_RPC_SUCCESS)
+		{
+			return AF_BULK_STATUS_NO_SRSP;
+		}
+		return status;
+	}
+
+	// the ZNP allocates the payload buffer for the request
+	if (afDataRequestExtRsp(&ext, &status) != MT_RPC_SUCCESS)
+	{
+		return AF_BULK_STATUS_NO_SRSP;
+	}
+	if (status != afStatus_SUCCESS)
+	{
+		return status;
+	}
+
+	for (offset = 0; offset < ext.Len; offset += len)
+	{
+		len = ext.Len - offset;
+		if (len > MT_AF_DATA_STORE_MAX_LEN)
+		{
+			len = MT_AF_DATA_STORE_MAX_LEN;
+		}
+
+		store.Index = offset;
+		store.Length = (uint8_t) len;
+		if (data != NULL)
+		{
+			memcpy(store.Data, data + offset, len);
+		}
+		else if (reader(offset, store.Data, len, readArg) != len)
+		{
+			return AF_BULK_STATUS_READ_ERROR;
+		}
+
+		if (afDataStoreRsp(&store, &status) != MT_RPC_SUCCESS)
+		{
+			return AF_BULK_STATUS_NO_SRSP;
+		}
+		if (status != afStatus_SUCCESS)
+		{
+			return status;
+		}
+		(*chunks)++;
+	}
+
+	// a zero length store sends the staged request
+	store.Index = 0;
+	store.Length = 0;
+	if (afDataStoreRsp(&store, &status) != MT_RPC_SUCCESS)
+	{
+		return AF_BULK_STATUS_NO_SRSP;
+	}
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      bulkDataConfirmCb
+ *
+ * @brief   MT_AF_DATA_CONFIRM observer, completes the matching send
+ *
+ * @param   msg - confirm
+ *
+ * @return  0
+ */
+static uint8_t bulkDataConfirmCb(DataConfirmFormat_t *msg)
+{
+	afBulkPending_t *entry = NULL;
+	uint16_t gen = 0;
+	uint8_t idx;
+
+	sem_wait(&bulkSem);
+
+	for (idx = 0; idx < AF_BULK_MAX_PENDING; idx++)
+	{
+		if (bulkPending[idx].used && (bulkPending[idx].endpoint == msg->Endpoint)
+		        && (bulkPending[idx].result.transId == msg->TransId))
+		{
+			entry = &bulkPending[idx];
+			gen = entry->gen;
+			break;
+		}
+	}
+
+	sem_post(&bulkSem);
+
+	if (entry != NULL)
+	{
+		bulkComplete(entry, gen, msg->Status);
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      bulkTimeoutCb
+ *
+ * @brief   confirm timeout of a send
+ *
+ * @param   arg - entry
+ *
+ * @return  -
+ */
+static void bulkTimeoutCb(void *arg)
+{
+	afBulkPending_t *entry = (afBulkPending_t *) arg;
+	uint8_t expired;
+	uint16_t gen;
+
+	sem_wait(&bulkSem);
+
+	expired = entry->used && (entry->sent != RPC_TIMER_NEVER)
+	        && (rpcTimerNow() >= (entry->sent + AF_BULK_CONFIRM_TIMEOUT_MS));
+	gen = entry->gen;
+
+	sem_post(&bulkSem);
+
+	if (expired)
+	{
+		bulkComplete(entry, gen, AF_BULK_STATUS_TIMEOUT);
+	}
+}
+
+/*********************************************************************
+ * @fn      bulkComplete
+ *
+ * @brief   complete a send and call its callback
+ *
+ * @param   entry - entry of the send
+ * @param   gen - generation of the entry when the send was looked up,
+ *          nothing is done if it has been completed since
+ * @param   status - completion status
+ *
+ * @return  -
+ */
+static void bulkComplete(afBulkPending_t *entry, uint16_t gen, uint8_t status)
+{
+	afBulkResult_t result;
+	afBulkDoneCb_t cb;
+	void *arg;
+
+	sem_wait(&bulkSem);
+
+	if (!entry->used || (entry->gen != gen))
+	{
+		sem_post(&bulkSem);
+		return;
+	}
+
+	rpcTimerStop(&entry->timer);
+
+	memcpy(&result, &entry->result, sizeof(afBulkResult_t));
+	result.status = status;
+	if (entry->sent != RPC_TIMER_NEVER)
+	{
+		result.latency = (uint32_t) (rpcTimerNow() - entry->sent);
+	}
+	cb = entry->cb;
+	arg = entry->arg;
+
+	entry->used = 0;
+	entry->gen++;
+
+	sem_post(&bulkSem);
+
+	if (cb != NULL)
+	{
+		cb(&result, arg);
+	}
+}
@@ -0,0 +1,105 @@
+/*
+ * afBulk.h
+ *
+ * This module contains the large payload AF send of the ZigBee
+ * Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef AFBULK_H
+#define AFBULK_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+#include "mtAf.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// number of sends that can wait for their MT_AF_DATA_CONFIRM
+#define AF_BULK_MAX_PENDING        (4)
+
+// time to wait for MT_AF_DATA_CONFIRM
+#define AF_BULK_CONFIRM_TIMEOUT_MS (10000)
+
+// completion status of sends that did not get a confirm, any other
+// value is the status of the MT_AF_DATA_CONFIRM or of an SRSP
+#define AF_BULK_STATUS_READ_ERROR  (0xFD)
+#define AF_BULK_STATUS_NO_SRSP     (0xFE)
+#define AF_BULK_STATUS_TIMEOUT     (0xFF)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint8_t status;       // afStatus_xxx or AF_BULK_STATUS_xxx
+	uint8_t transId;
+	uint16_t len;         // payload length
+	uint16_t chunks;      // AF_DATA_STOREs sent
+	uint32_t stageTime;   // ms to copy the payload into the ZNP
+	uint32_t latency;     // ms from the send to the confirm
+} afBulkResult_t;
+
+// copy up to len bytes of the payload starting at offset into buf
+// and return the number of bytes copied
+typedef uint16_t (*afBulkReadCb_t)(uint16_t offset, uint8_t *buf,
+        uint16_t len, void *arg);
+
+// called once for every send accepted by afBulkSend()
+typedef void (*afBulkDoneCb_t)(afBulkResult_t *result, void *arg);
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+int32_t afBulkInit(void);
+int32_t afBulkSend(DataRequestExtFormat_t *req, const uint8_t *data,
+        afBulkReadCb_t reader, void *readArg, afBulkDoneCb_t cb, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFBULK_H */
@@ -0,0 +1,315 @@
+/*
+ * afDedup.c
+ *
+ * This module contains the suppression of duplicate incoming AF
+ * messages of the ZigBee Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include <semaphore.h>
+
+#include "afDedup.h"
+#include "mtAf.h"
+#include "rpcTimer.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint64_t srcAddr;
+	uint16_t clusterId;
+	uint8_t srcAddrMode;
+	uint8_t srcEndpoint;
+	uint8_t seqNum;
+	uint8_t used;
+	uint32_t time;       // low 32 bits of rpcTimerNow() when last seen
+} afDedupEntry_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static afDedupEntry_t dedupEntries[AF_DEDUP_MAX_ENTRIES];
+static uint32_t dedupWindow = AF_DEDUP_DEFAULT_WINDOW;
+static afDedupStats_t dedupStats;
+
+// protects dedupEntries, dedupWindow and dedupStats
+static sem_t dedupSem;
+
+static uint8_t dedupInitDone = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS DECLARATION
+ */
+
+static uint8_t dedupIncomingMsgCb(IncomingMsgFormat_t *msg);
+static uint8_t dedupIncomingMsgExtCb(IncomingMsgExtFormat_t *msg);
+static uint8_t dedupCheck(uint8_t srcAddrMode, uint64_t srcAddr,
+        uint8_t srcEndpoint, uint16_t clusterId, uint8_t seqNum);
+
+static mtAfCb_t dedupAfCbs =
+	{ NULL,			//MT_AF_DATA_CONFIRM
+	        dedupIncomingMsgCb,	//MT_AF_INCOMING_MSG
+	        dedupIncomingMsgExtCb,	//MT_AF_INCOMING_MSG_EXT
+	        NULL,			//MT_AF_DATA_RETRIEVE
+	        NULL,			//MT_AF_REFLECT_ERROR
+	    };
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      afDedupInit
+ *
+ * @brief   initialise the duplicate suppression, must be called once
+ *          after rpcInitMq(). A message with the same source, source
+ *          endpoint, cluster and sequence number as one received
+ *          within the window is then not passed to the application.
+ *
+ * @param   -
+ *
+ * @return  status, -1 if its observer could not be registered
+ */
+int32_t afDedupInit(void)
+{
+	memset(dedupEntries, 0, sizeof(dedupEntries));
+	memset(&dedupStats, 0, sizeof(dedupStats));
+	dedupWindow = AF_DEDUP_DEFAULT_WINDOW;
+
+	sem_init(&dedupSem, 0, 1);
+
+	if (!dedupInitDone)
+	{
+		if (afRegisterObserver(&dedupAfCbs) != 0)
+		{
+			dbg_print(PRINT_LEVEL_WARNING,
+			        "afDedupInit: no free observer entry\n");
+			return -1;
+		}
+		dedupInitDone = 1;
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      afDedupConfig
+ *
+ * @brief   set how long a message is remembered for
+ *
+ * @param   window - time in ms, 0 disables the suppression
+ *
+ * @return  -
+ */
+void afDedupConfig(uint32_t window)
+{
+	sem_wait(&dedupSem);
+
+	dedupWindow = window;
+	if (window == 0)
+	{
+		memset(dedupEntries, 0, sizeof(dedupEntries));
+	}
+
+	sem_post(&dedupSem);
+}
+
+/*********************************************************************
+ * @fn      afDedupGetStats
+ *
+ * @brief   get the duplicate suppression counters
+ *
+ * @param   stats - filled in with the counters
+ *
+ * @return  -
+ */
+void afDedupGetStats(afDedupStats_t *stats)
+{
+	sem_wait(&dedupSem);
+
+	memcpy(stats, &dedupStats, sizeof(afDedupStats_t));
+
+	sem_post(&dedupSem);
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      dedupIncomingMsgCb
+ *
+ * @brief   MT_AF_INCOMING_MSG observer
+ *
+ * @param   msg - incoming message
+ *
+ * @return  1 if the message is a duplicate
+ */
+static uint8_t dedupIncomingMsgCb(IncomingMsgFormat_t *msg)
+{
+	return dedupCheck(Addr16Bit, msg->SrcAddr, msg->SrcEndpoint,
+	        msg->ClusterId, msg->TransSeqNum);
+}
+
+/*********************************************************************
+ * @fn      dedupIncomingMsgExtCb
+ *
+ * @brief   MT_AF_INCOMING_MSG_EXT observer
+ *
+ * @param   msg - incoming message
+ *
+ * @return  1 if the message is a duplicate
+ */
+static uint8_t dedupIncomingMsgExtCb(IncomingMsgExtFormat_t *msg)
+{
+	// the payload of a large message is held by the ZNP until it is
+	// retrieved, it has to reach the reassembly even if it is a duplicate
+	if (msg->Len > MT_AF_INCOMING_EXT_MAX_LEN)
+	{
+		return 0;
+	}
+
+	return dedupCheck(msg->SrcAddrMode, msg->SrcAddr, msg->SrcEndpoint,
+	        msg->ClusterId, msg->TransSeqNum);
+}
+
+/*********************************************************************
+ * @fn      dedupCheck
+ *
+ * @brief   look a message up and remember it. Only AF_DEDUP_MAX_PROBE
+ *          slots from the hash are searched, an expired slot is reused
+ *          and if there is none the oldest message of them is forgotten.
+ *
+ * @param   srcAddrMode - afAddrMode_t of srcAddr
+ * @param   srcAddr - source address
+ * @param   srcEndpoint - source endpoint
+ * @param   clusterId - cluster
+ * @param   seqNum - transaction sequence number
+ *
+ * @return  1 if the message was seen within the window
+ */
+static uint8_t dedupCheck(uint8_t srcAddrMode, uint64_t srcAddr,
+        uint8_t srcEndpoint, uint16_t clusterId, uint8_t seqNum)
+{
+	afDedupEntry_t *entry, *slot = NULL;
+	uint32_t now, hash, age, oldest = 0;
+	uint8_t probe, dup = 0;
+
+	sem_wait(&dedupSem);
+
+	if (dedupWindow == 0)
+	{
+		sem_post(&dedupSem);
+		return 0;
+	}
+
+	now = (uint32_t) rpcTimerNow();
+	dedupStats.checked++;
+
+	hash = (uint32_t) srcAddr ^ (uint32_t) (srcAddr >> 32);
+	hash = (hash * 31 + srcEndpoint) * 31 + clusterId;
+	hash = (hash * 31 + seqNum) * 2654435761u;
+	hash ^= hash >> 16;
+
+	for (probe = 0; probe < AF_DEDUP_MAX_PROBE; probe++)
+	{
+		entry = &dedupEntries[(hash + probe) & (AF_DEDUP_MAX_ENTRIES - 1)];
+		age = now - entry->time;
+
+		if (!entry->used || (age >= dedupWindow))
+		{
+			if ((slot == NULL) || slot->used)
+			{
+				slot = entry;
+				oldest = 0xFFFFFFFF;
+			}
+			continue;
+		}
+
+		if ((entry->srcAddr == srcAddr) && (entry->srcAddrMode == srcAddrMode)
+		        && (entry->srcEndpoint == srcEndpoint)
+		        && (entry->clusterId == clusterId)
+		        && (entry->seqNum == seqNum))
+		{
+			dup = 1;
+			slot = entry;
+			break;
+		}
+
+		if ((oldest != 0xFFFFFFFF) && (age >= oldest))
+		{
+			slot = entry;
+			oldest = age;
+		}
+	}
+
+	if (dup)
+	{
+		dedupStats.dropped++;
+	}
+	else
+	{
+		if (oldest != 0xFFFFFFFF)
+		{
+			dedupStats.evicted++;
+		}
+
+		slot->srcAddr = srcAddr;
+		slot->srcAddrMode = srcAddrMode;
+		slot->srcEndpoint = srcEndpoint;
+		slot->clusterId = clusterId;
+		slot->seqNum = seqNum;
+		slot->used = 1;
+	}
+	slot->time = now;
+
+	sem_post(&dedupSem);
+
+	if (dup)
+	{
+		dbg_print(PRINT_LEVEL_VERBOSE,
+		        "dedupCheck: duplicate from 0x%llX ep %d cluster 0x%04X seq %d\n",
+		        (unsigned long long) srcAddr, srcEndpoint, clusterId, seqNum);
+	}
+
+	return dup;
+}
@@ -0,0 +1,837 @@
+/*
+ * afFanout.c
+ *
+ * This module contains the multi-destination AF send of the ZigBee
+ * Network Processor (ZNP) Host Interface. A destination set is covered
+ * with a broadcast, with groupcasts to the groups it contains and with
+ * unicasts for the rest, all sent through the AF transmit engine, and
+ * the results are reported once for the whole set.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <semaphore.h>
+
+#include "afFanout.h"
+#include "afTx.h"
+#include "mtAf.h"
+#include "rpcTimer.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// delay before trying again when the transmit engine is full
+#define AF_FANOUT_RETRY_MS         (50)
+
+#define AF_FANOUT_NO_PART          (0xFFFF)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint8_t used;
+	uint16_t groupId;
+	uint16_t memberCnt;
+	uint16_t members[AF_FANOUT_MAX_MEMBERS];
+} afFanoutGroup_t;
+
+typedef struct afFanoutOp afFanoutOp_t;
+
+// one send of a fan-out
+typedef struct
+{
+	afFanoutOp_t *op;
+	uint8_t route;         // AF_FANOUT_xxx
+	uint16_t addr;         // network address, group ID or broadcast
+	uint16_t dest;         // destination index of a unicast
+} afFanoutPart_t;
+
+struct afFanoutOp
+{
+	DataRequestFormat_t req;
+	afFanoutDoneCb_t cb;
+	void *arg;
+	uint64_t start;
+	uint16_t count;
+	uint16_t partCnt;
+	uint16_t next;         // next part to send
+	uint16_t inFlight;     // parts sent and not completed
+	uint16_t doneCnt;      // parts completed
+	uint8_t feeding;       // a thread is sending the parts
+	uint8_t feedAgain;     // parts completed while it was
+	uint16_t *partOf;      // part covering each destination
+	afFanoutDest_t *dests;
+	afFanoutPart_t *parts;
+	rpcTimer_t timer;      // retries when the transmit engine is full
+};
+
+// destination address and its index, sorted for the group lookups
+typedef struct
+{
+	uint16_t addr;
+	uint16_t idx;
+} afFanoutSorted_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static afFanoutGroup_t fanoutGroups[AF_FANOUT_MAX_GROUPS];
+static uint16_t fanoutBcastMin = AF_FANOUT_BCAST_MIN;
+
+// protects the groups and the fan-outs in progress
+static sem_t fanoutSem;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS DECLARATION
+ */
+
+static void fanoutPlan(afFanoutOp_t *op, uint16_t *dsts, uint8_t flags,
+        afFanoutSorted_t *sorted, uint16_t sortedCnt);
+static int32_t fanoutFindSorted(afFanoutSorted_t *sorted, uint16_t count,
+        uint16_t addr);
+static int fanoutCompare(const void *a, const void *b);
+static afFanoutGroup_t *fanoutFindGroup(uint16_t groupId);
+static void fanoutFeed(afFanoutOp_t *op);
+static void fanoutRetryCb(void *arg);
+static void fanoutPartCb(afTxResult_t *result, void *arg);
+static void fanoutFinish(afFanoutOp_t *op);
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      afFanoutInit
+ *
+ * @brief   initialise the fan-out, afTxInit() must have been called
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+void afFanoutInit(void)
+{
+	memset(fanoutGroups, 0, sizeof(fanoutGroups));
+	fanoutBcastMin = AF_FANOUT_BCAST_MIN;
+
+	sem_init(&fanoutSem, 0, 1);
+}
+
+/*********************************************************************
+ * @fn      afFanoutGroupAdd
+ *
+ * @brief   record that a device is a member of a group. The host copy
+ *          must follow the group tables of the devices, a groupcast is
+ *          only used when all the members are meant to get it.
+ *
+ * @param   groupId - group ID
+ * @param   addr - network address of the device
+ *
+ * @return  status, -1 if the group table or the group is full
+ */
+int32_t afFanoutGroupAdd(uint16_t groupId, uint16_t addr)
+{
+	afFanoutGroup_t *group;
+	uint16_t idx;
+
+	sem_wait(&fanoutSem);
+
+	group = fanoutFindGroup(groupId);
+	if (group == NULL)
+	{
+		for (idx = 0; idx < AF_FANOUT_MAX_GROUPS; idx++)
+		{
+			if (!fanoutGroups[idx].used)
+			{
+				group = &fanoutGroups[idx];
+				group->used = 1;
+				group->groupId = groupId;
+				group->memberCnt = 0;
+				break;
+			}
+		}
+	}
+
+	if (group == NULL)
+	{
+		sem_post(&fanoutSem);
+		return -1;
+	}
+
+	for (idx = 0; idx < group->memberCnt; idx++)
+	{
+		if (group->members[idx] == addr)
+		{
+			sem_post(&fanoutSem);
+			return 0;
+		}
+	}
+
+	if (group->memberCnt >= AF_FANOUT_MAX_MEMBERS)
+	{
+		sem_post(&fanoutSem);
+		return -1;
+	}
+
+	group->members[group->memberCnt++] = addr;
+
+	sem_post(&fanoutSem);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      afFanoutGroupRemove
+ *
+ * @brief   record that a device left a group
+ *
+ * @param   groupId - group ID
+ * @param   addr - network address of the device
+ *
+ * @return  status, -1 if it was not a member
+ */
+int32_t afFanoutGroupRemove(uint16_t groupId, uint16_t addr)
+{
+	afFanoutGroup_t *group;
+	uint16_t idx;
+
+	sem_wait(&fanoutSem);
+
+	group = fanoutFindGroup(groupId);
+	if (group != NULL)
+	{
+		for (idx = 0; idx < group->memberCnt; idx++)
+		{
+			if (group->members[idx] == addr)
+			{
+				group->members[idx] = group->members[--group->memberCnt];
+				if (group->memberCnt == 0)
+				{
+					group->used = 0;
+				}
+
+				sem_post(&fanoutSem);
+				return 0;
+			}
+		}
+	}
+
+	sem_post(&fanoutSem);
+
+	return -1;
+}
+
+/*********************************************************************
+ * @fn      afFanoutGroupDelete
+ *
+ * @brief   forget a group
+ *
+ * @param   groupId - group ID
+ *
+ * @return  -
+ */
+void afFanoutGroupDelete(uint16_t groupId)
+{
+	afFanoutGroup_t *group;
+
+	sem_wait(&fanoutSem);
+
+	group = fanoutFindGroup(groupId);
+	if (group != NULL)
+	{
+		group->used = 0;
+	}
+
+	sem_post(&fanoutSem);
+}
+
+/*********************************************************************
+ * @fn      afFanoutSetBroadcastMin
+ *
+ * @brief   set the number of destinations from which a broadcast is
+ *          used when AF_FANOUT_ALLOW_EXTRA is set
+ *
+ * @param   count - number of destinations, 0 to never broadcast
+ *
+ * @return  -
+ */
+void afFanoutSetBroadcastMin(uint16_t count)
+{
+	fanoutBcastMin = count;
+}
+
+/*********************************************************************
+ * @fn      afFanoutSend
+ *
+ * @brief   send the same request to a set of destinations. Unless
+ *          every destination must acknowledge (AF_FANOUT_ACKED), the
+ *          set is covered with the fewest sends: one broadcast for a
+ *          large set if other devices may get the message, otherwise
+ *          a groupcast for each known group whose members are all in
+ *          the set, and unicasts for the rest. The sends go through
+ *          the AF transmit engine, cb is called once all of them have
+ *          completed. A destination given more than once gets the
+ *          message once.
+ *
+ * @param   req - request, req->DstAddr is not used and AF_ACK_REQUEST
+ *          only applies to the unicasts
+ * @param   dsts - network addresses of the destinations
+ * @param   count - number of destinations
+ * @param   flags - AF_FANOUT_xxx
+ * @param   cb - completion callback, may be NULL
+ * @param   arg - passed to cb
+ *
+ * @return  number of sends, -1 on error
+ */
+int32_t afFanoutSend(DataRequestFormat_t *req, uint16_t *dsts,
+        uint16_t count, uint8_t flags, afFanoutDoneCb_t cb, void *arg)
+{
+	afFanoutOp_t *op;
+	afFanoutSorted_t *sorted;
+	uint8_t *mem;
+	uint16_t idx, partCnt, sortedCnt;
+
+	if ((dsts == NULL) || (count == 0))
+	{
+		return -1;
+	}
+
+	// the op, then the per destination tables and the parts
+	mem = malloc(sizeof(afFanoutOp_t)
+	        + (count * (sizeof(uint16_t) + sizeof(afFanoutDest_t)
+	                + sizeof(afFanoutPart_t))));
+	sorted = malloc(count * sizeof(afFanoutSorted_t));
+	if ((mem == NULL) || (sorted == NULL))
+	{
+		dbg_print(PRINT_LEVEL_WARNING, "afFanoutSend: out of memory\n");
+		free(mem);
+		free(sorted);
+		return -1;
+	}
+
+	op = (afFanoutOp_t *) mem;
+	memset(op, 0, sizeof(afFanoutOp_t));
+	op->parts = (afFanoutPart_t *) (mem + sizeof(afFanoutOp_t));
+	op->dests = (afFanoutDest_t *) (op->parts + count);
+	op->partOf = (uint16_t *) (op->dests + count);
+
+	memcpy(&op->req, req, sizeof(DataRequestFormat_t));
+	if (flags & AF_FANOUT_ACKED)
+	{
+		op->req.Options |= AF_ACK_REQUEST;
+	}
+	op->cb = cb;
+	op->arg = arg;
+	op->start = rpcTimerNow();
+	op->count = count;
+
+	for (idx = 0; idx < count; idx++)
+	{
+		op->partOf[idx] = AF_FANOUT_NO_PART;
+		op->dests[idx].status = afStatus_FAILED;
+		sorted[idx].addr = dsts[idx];
+		sorted[idx].idx = idx;
+	}
+	qsort(sorted, count, sizeof(afFanoutSorted_t), fanoutCompare);
+
+	// keep the first of the destinations given more than once
+	sortedCnt = 1;
+	for (idx = 1; idx < count; idx++)
+	{
+		if (sorted[idx].addr != sorted[sortedCnt - 1].addr)
+		{
+			sorted[sortedCnt++] = sorted[idx];
+		}
+		else if (sorted[idx].idx < sorted[sortedCnt - 1].idx)
+		{
+			sorted[sortedCnt - 1].idx = sorted[idx].idx;
+		}
+	}
+
+	sem_wait(&fanoutSem);
+	fanoutPlan(op, dsts, flags, sorted, sortedCnt);
+	sem_post(&fanoutSem);
+
+	free(sorted);
+
+	// op may be freed as soon as it is fed
+	partCnt = op->partCnt;
+
+	dbg_print(PRINT_LEVEL_INFO, "afFanoutSend: %d destinations in %d sends\n",
+	        count, partCnt);
+
+	fanoutFeed(op);
+
+	return partCnt;
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      fanoutPlan
+ *
+ * @brief   split the destinations into parts, called with fanoutSem
+ *          held. A destination given more than once shares the part of
+ *          its first occurrence.
+ *
+ * @param   op - fan-out
+ * @param   dsts - network addresses of the destinations
+ * @param   flags - AF_FANOUT_xxx
+ * @param   sorted - distinct destinations sorted by address, each with
+ *          the index of its first occurrence
+ * @param   sortedCnt - number of distinct destinations
+ *
+ * @return  -
+ */
+static void fanoutPlan(afFanoutOp_t *op, uint16_t *dsts, uint8_t flags,
+        afFanoutSorted_t *sorted, uint16_t sortedCnt)
+{
+	afFanoutGroup_t *group, *best;
+	afFanoutPart_t *part;
+	uint16_t idx, first, member, inSet, bestInSet;
+	int32_t pos;
+
+	if (!(flags & AF_FANOUT_ACKED) && (flags & AF_FANOUT_ALLOW_EXTRA)
+	        && (fanoutBcastMin != 0) && (sortedCnt >= fanoutBcastMin))
+	{
+		part = &op->parts[op->partCnt];
+		part->op = op;
+		part->route = AF_FANOUT_BROADCAST;
+		part->addr = AF_FANOUT_BCAST_ADDR;
+		for (idx = 0; idx < op->count; idx++)
+		{
+			op->partOf[idx] = op->partCnt;
+			op->dests[idx].route = AF_FANOUT_BROADCAST;
+		}
+		op->partCnt++;
+		return;
+	}
+
+	// greedily take the group covering the most destinations. A group
+	// with a member outside the set is only used if extra devices may
+	// get the message, and a member never gets it twice.
+	while (!(flags & AF_FANOUT_ACKED))
+	{
+		best = NULL;
+		bestInSet = 0;
+
+		for (idx = 0; idx < AF_FANOUT_MAX_GROUPS; idx++)
+		{
+			group = &fanoutGroups[idx];
+			if (!group->used)
+			{
+				continue;
+			}
+
+			inSet = 0;
+			for (member = 0; member < group->memberCnt; member++)
+			{
+				pos = fanoutFindSorted(sorted, sortedCnt,
+				        group->members[member]);
+				if (pos == -1)
+				{
+					if (!(flags & AF_FANOUT_ALLOW_EXTRA))
+					{
+						break;
+					}
+				}
+				else if (op->partOf[sorted[pos].idx] != AF_FANOUT_NO_PART)
+				{
+					break;
+				}
+				else
+				{
+					inSet++;
+				}
+			}
+
+			if ((member == group->memberCnt) && (inSet >= AF_FANOUT_GROUP_MIN)
+			        && (inSet > bestInSet))
+			{
+				best = group;
+				bestInSet = inSet;
+			}
+		}
+
+		if (best == NULL)
+		{
+			break;
+		}
+
+		part = &op->parts[op->partCnt];
+		part->op = op;
+		part->route = AF_FANOUT_GROUPCAST;
+		part->addr = best->groupId;
+		for (member = 0; member < best->memberCnt; member++)
+		{
+			pos = fanoutFindSorted(sorted, sortedCnt, best->members[member]);
+			if (pos != -1)
+			{
+				op->partOf[sorted[pos].idx] = op->partCnt;
+				op->dests[sorted[pos].idx].route = AF_FANOUT_GROUPCAST;
+			}
+		}
+		op->partCnt++;
+	}
+
+	for (idx = 0; idx < op->count; idx++)
+	{
+		if (op->partOf[idx] != AF_FANOUT_NO_PART)
+		{
+			continue;
+		}
+
+		// the first occurrence comes before, its part is already set
+		first = sorted[fanoutFindSorted(sorted, sortedCnt, dsts[idx])].idx;
+		if (first != idx)
+		{
+			op->partOf[idx] = op->partOf[first];
+			op->dests[idx].route = op->dests[first].route;
+		}
+		else
+		{
+			part = &op->parts[op->partCnt];
+			part->op = op;
+			part->route = AF_FANOUT_UNICAST;
+			part->addr = dsts[idx];
+			part->dest = idx;
+			op->partOf[idx] = op->partCnt;
+			op->dests[idx].route = AF_FANOUT_UNICAST;
+			op->partCnt++;
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      fanoutFindSorted
+ *
+ * @brief   binary search of an address in the sorted destinations
+ *
+ * @param   sorted - destinations sorted by address
+ * @param   count - number of destinations
+ * @param   addr - network address
+ *
+ * @return  position in sorted, -1 if not found
+ */
+static int32_t fanoutFindSorted(afFanoutSorted_t *sorted, uint16_t count,
+        uint16_t addr)
+{
+	int32_t low = 0, high = (int32_t) count - 1, mid;
+
+	while (low <= high)
+	{
+		mid = (low + high) / 2;
+		if (sorted[mid].addr == addr)
+		{
+			return mid;
+		}
+		else if (sorted[mid].addr < addr)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid - 1;
+		}
+	}
+
+	return -1;
+}
+
+/*********************************************************************
+ * @fn      fanoutCompare
+ *
+ * @brief   qsort() comparison of two sorted destinations
+ */
+static int fanoutCompare(const void *a, const void *b)
+{
+	return (int) ((const afFanoutSorted_t *) a)->addr
+	        - (int) ((const afFanoutSorted_t *) b)->addr;
+}
+
+/*********************************************************************
+ * @fn      fanoutFindGroup
+ *
+ * @brief   find a group, called with fanoutSem held
+ *
+ * @param   groupId - group ID
+ *
+ * @return  group, NULL if not known
+ */
+static afFanoutGroup_t *fanoutFindGroup(uint16_t groupId)
+{
+	uint16_t idx;
+
+	for (idx = 0; idx < AF_FANOUT_MAX_GROUPS; idx++)
+	{
+		if (fanoutGroups[idx].used && (fanoutGroups[idx].groupId == groupId))
+		{
+			return &fanoutGroups[idx];
+		}
+	}
+
+	return NULL;
+}
+
+/*********************************************************************
+ * @fn      fanoutFeed
+ *
+ * @brief   hand the parts of a fan-out to the transmit engine until it
+ *          is full. One thread feeds a fan-out at a time, the others
+ *          leave it a note to continue.
+ *
+ * @param   op - fan-out
+ *
+ * @return  -
+ */
+static void fanoutFeed(afFanoutOp_t *op)
+{
+	DataRequestFormat_t req;
+	afFanoutPart_t *part;
+	int32_t transId;
+	uint8_t finished;
+
+	sem_wait(&fanoutSem);
+	if (op->feeding)
+	{
+		op->feedAgain = 1;
+		sem_post(&fanoutSem);
+		return;
+	}
+	op->feeding = 1;
+
+	while (1)
+	{
+		op->feedAgain = 0;
+		if (op->next >= op->partCnt)
+		{
+			break;
+		}
+
+		part = &op->parts[op->next++];
+		op->inFlight++;
+		memcpy(&req, &op->req, sizeof(DataRequestFormat_t));
+		req.DstAddr = part->addr;
+		if (part->route != AF_FANOUT_UNICAST)
+		{
+			// the devices do not acknowledge group and broadcast sends
+			req.Options &= ~AF_ACK_REQUEST;
+		}
+
+		sem_post(&fanoutSem);
+
+		if (part->route == AF_FANOUT_GROUPCAST)
+		{
+			transId = afTxSendGroup(&req, fanoutPartCb, part);
+		}
+		else
+		{
+			transId = afTxSend(&req, fanoutPartCb, part);
+		}
+
+		sem_wait(&fanoutSem);
+
+		if (transId == -1)
+		{
+			// no room in the transmit engine, our completions will
+			// call us again or the timer if we have none
+			op->next--;
+			op->inFlight--;
+			if (!op->feedAgain)
+			{
+				if (op->inFlight == 0)
+				{
+					rpcTimerStart(&op->timer, AF_FANOUT_RETRY_MS, 0,
+					        fanoutRetryCb, op);
+				}
+				break;
+			}
+		}
+	}
+
+	op->feeding = 0;
+	finished = (op->doneCnt == op->partCnt);
+
+	sem_post(&fanoutSem);
+
+	if (finished)
+	{
+		fanoutFinish(op);
+	}
+}
+
+/*********************************************************************
+ * @fn      fanoutRetryCb
+ *
+ * @brief   try again to send the parts of a fan-out
+ *
+ * @param   arg - fan-out
+ *
+ * @return  -
+ */
+static void fanoutRetryCb(void *arg)
+{
+	fanoutFeed((afFanoutOp_t *) arg);
+}
+
+/*********************************************************************
+ * @fn      fanoutPartCb
+ *
+ * @brief   completion of a part, records its status for the
+ *          destinations it covers
+ *
+ * @param   result - result of the send
+ * @param   arg - part
+ *
+ * @return  -
+ */
+static void fanoutPartCb(afTxResult_t *result, void *arg)
+{
+	afFanoutPart_t *part = (afFanoutPart_t *) arg;
+	afFanoutOp_t *op = part->op;
+	uint16_t partIdx = (uint16_t) (part - op->parts);
+	uint16_t idx;
+	uint8_t finished, feed;
+
+	sem_wait(&fanoutSem);
+
+	if (part->route == AF_FANOUT_UNICAST)
+	{
+		op->dests[part->dest].status = result->status;
+	}
+	else
+	{
+		for (idx = 0; idx < op->count; idx++)
+		{
+			if (op->partOf[idx] == partIdx)
+			{
+				op->dests[idx].status = result->status;
+			}
+		}
+	}
+
+	op->inFlight--;
+	op->doneCnt++;
+	finished = (op->doneCnt == op->partCnt) && !op->feeding;
+	feed = !finished && (op->next < op->partCnt);
+
+	sem_post(&fanoutSem);
+
+	if (finished)
+	{
+		fanoutFinish(op);
+	}
+	else if (feed)
+	{
+		fanoutFeed(op);
+	}
+}
+
+/*********************************************************************
+ * @fn      fanoutFinish
+ *
+ * @brief   report the result of a fan-out and free it
+ *
+ * @param   op - fan-out
+ *
+ * @return  -
+ */
+static void fanoutFinish(afFanoutOp_t *op)
+{
+	afFanoutResult_t result;
+	uint16_t idx;
+
+	memset(&result, 0, sizeof(afFanoutResult_t));
+	result.count = op->count;
+	result.dests = op->dests;
+	result.latency = (uint32_t) (rpcTimerNow() - op->start);
+
+	for (idx = 0; idx < op->partCnt; idx++)
+	{
+		switch (op->parts[idx].route)
+		{
+		case AF_FANOUT_UNICAST:
+			result.unicasts++;
+			break;
+		case AF_FANOUT_GROUPCAST:
+			result.groupcasts++;
+			break;
+		default:
+			result.broadcasts++;
+			break;
+		}
+	}
+
+	for (idx = 0; idx < op->count; idx++)
+	{
+		// a destination given more than once shares the unicast status
+		if (op->dests[idx].route == AF_FANOUT_UNICAST)
+		{
+			op->dests[idx].status =
+			        op->dests[op->parts[op->partOf[idx]].dest].status;
+		}
+
+		if (op->dests[idx].status != afStatus_SUCCESS)
+		{
+			result.failed++;
+		}
+		else if (op->dests[idx].route == AF_FANOUT_UNICAST)
+		{
+			result.delivered++;
+		}
+		else
+		{
+			result.covered++;
+		}
+	}
+
+	if (op->cb != NULL)
+	{
+		op->cb(&result, op->arg);
+	}
+
+	free(op);
+}
@@ -0,0 +1,127 @@
+/*
+ * afFanout.h
+ *
+ * This module contains the multi-destination AF send of the ZigBee
+ * Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef AFFANOUT_H
+#define AFFANOUT_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+#include "mtAf.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// host copy of the group membership of the devices
+#define AF_FANOUT_MAX_GROUPS       (16)
+#define AF_FANOUT_MAX_MEMBERS      (64)
+
+// default number of destinations from which a broadcast is used, when
+// the flags allow other devices to get the message
+#define AF_FANOUT_BCAST_MIN        (32)
+
+// smallest number of destinations worth a groupcast
+#define AF_FANOUT_GROUP_MIN        (2)
+
+// broadcast address used, all devices including sleeping ones
+#define AF_FANOUT_BCAST_ADDR       (0xFFFF)
+
+// afFanoutSend() flags
+#define AF_FANOUT_ACKED            (0x01)  // every destination acknowledges,
+                                           // unicasts with APS ack only
+#define AF_FANOUT_ALLOW_EXTRA      (0x02)  // devices outside the set may
+                                           // get the message
+
+// route of a destination
+#define AF_FANOUT_UNICAST          (0)
+#define AF_FANOUT_GROUPCAST        (1)
+#define AF_FANOUT_BROADCAST        (2)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint8_t route;        // AF_FANOUT_xxx
+	uint8_t status;       // status of the send that covered it
+} afFanoutDest_t;
+
+typedef struct
+{
+	uint16_t count;       // destinations
+	uint16_t delivered;   // unicasts confirmed
+	uint16_t covered;     // destinations of confirmed group or broadcast
+	                      // sends, the devices do not acknowledge these
+	uint16_t failed;
+	uint16_t unicasts;
+	uint8_t groupcasts;
+	uint8_t broadcasts;
+	uint32_t latency;     // ms from afFanoutSend() to the last confirm
+	afFanoutDest_t *dests; // one per destination, in the order given
+} afFanoutResult_t;
+
+// called once for every send accepted by afFanoutSend()
+typedef void (*afFanoutDoneCb_t)(afFanoutResult_t *result, void *arg);
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+void afFanoutInit(void);
+int32_t afFanoutGroupAdd(uint16_t groupId, uint16_t addr);
+int32_t afFanoutGroupRemove(uint16_t groupId, uint16_t addr);
+void afFanoutGroupDelete(uint16_t groupId);
+void afFanoutSetBroadcastMin(uint16_t count);
+int32_t afFanoutSend(DataRequestFormat_t *req, uint16_t *dsts,
+        uint16_t count, uint8_t flags, afFanoutDoneCb_t cb, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFFANOUT_H */
@@ -0,0 +1,364 @@
+/*
+ * afReasm.c
+ *
+ * This module contains the reassembly of large incoming AF messages of
+ * the ZigBee Network Processor (ZNP) Host Interface. Messages too long
+ * for an MT_AF_INCOMING_MSG_EXT frame are kept in the ZNP, their payload
+ * is read with AF_DATA_RETRIEVE into a preallocated buffer, a few chunks
+ * at a time from the timer wheel so other frames are processed between
+ * them, and released with a zero length retrieve.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <semaphore.h>
+
+#include "afReasm.h"
+#include "mtAf.h"
+#include "rpc.h"
+#include "rpcTimer.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint8_t used;
+	uint16_t offset;       // payload bytes retrieved
+	IncomingMsgExtFormat_t hdr;
+	rpcTimer_t timer;      // runs the next step
+	uint8_t data[AF_REASM_MAX_LEN];
+} afReasmMsg_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static afReasmMsg_t reasmMsgs[AF_REASM_MAX_MSGS];
+static afReasmMsgCb_t reasmCb = NULL;
+static afReasmStats_t reasmStats;
+
+// protects reasmMsgs and reasmStats
+static sem_t reasmSem;
+// serialises the AF_DATA_RETRIEVEs
+static sem_t reasmRetrieveSem;
+
+static uint8_t reasmInitDone = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS DECLARATION
+ */
+
+static uint8_t reasmIncomingMsgExtCb(IncomingMsgExtFormat_t *msg);
+static void reasmStep(void *arg);
+static uint8_t reasmRetrieve(uint32_t timeStamp, uint16_t index,
+        uint8_t length, uint8_t *data);
+
+static mtAfCb_t reasmAfCbs =
+	{ NULL,			//MT_AF_DATA_CONFIRM
+	        NULL,			//MT_AF_INCOMING_MSG
+	        reasmIncomingMsgExtCb,	//MT_AF_INCOMING_MSG_EXT
+	        NULL,			//MT_AF_DATA_RETRIEVE
+	        NULL,			//MT_AF_REFLECT_ERROR
+	    };
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      afReasmInit
+ *
+ * @brief   initialise the reassembly, must be called once after
+ *          rpcInitMq(). Large messages are then consumed and delivered
+ *          to cb instead of the MT_AF_INCOMING_MSG_EXT callback.
+ *
+ * @param   cb - callback for the reassembled messages
+ *
+ * @return  status, -1 if its observer could not be registered
+ */
+int32_t afReasmInit(afReasmMsgCb_t cb)
+{
+	memset(reasmMsgs, 0, sizeof(reasmMsgs));
+	memset(&reasmStats, 0, sizeof(reasmStats));
+	reasmCb = cb;
+
+	sem_init(&reasmSem, 0, 1);
+	sem_init(&reasmRetrieveSem, 0, 1);
+
+	if (!reasmInitDone)
+	{
+		if (afRegisterObserver(&reasmAfCbs) != 0)
+		{
+			dbg_print(PRINT_LEVEL_WARNING,
+			        "afReasmInit: no free observer entry\n");
+			return -1;
+		}
+		reasmInitDone = 1;
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      afReasmGetStats
+ *
+ * @brief   get the reassembly counters
+ *
+ * @param   stats - filled in with the counters
+ *
+ * @return  -
+ */
+void afReasmGetStats(afReasmStats_t *stats)
+{
+	uint8_t idx;
+
+	sem_wait(&reasmSem);
+
+	memcpy(stats, &reasmStats, sizeof(afReasmStats_t));
+	stats->active = 0;
+	for (idx = 0; idx < AF_REASM_MAX_MSGS; idx++)
+	{
+		if (reasmMsgs[idx].used)
+		{
+			stats->active++;
+		}
+	}
+
+	sem_post(&reasmSem);
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      reasmIncomingMsgExtCb
+ *
+ * @brief   MT_AF_INCOMING_MSG_EXT observer, starts the reassembly of
+ *          messages whose payload was not in the frame
+ *
+ * @param   msg - message header
+ *
+ * @return  1 if the message was consumed
+ */
+static uint8_t reasmIncomingMsgExtCb(IncomingMsgExtFormat_t *msg)
+{
+	afReasmMsg_t *reasm = NULL;
+	uint8_t idx;
+
+	if (msg->Len <= MT_AF_INCOMING_EXT_MAX_LEN)
+	{
+		return 0;
+	}
+
+	sem_wait(&reasmSem);
+
+	if (msg->Len <= AF_REASM_MAX_LEN)
+	{
+		for (idx = 0; idx < AF_REASM_MAX_MSGS; idx++)
+		{
+			if (!reasmMsgs[idx].used)
+			{
+				reasm = &reasmMsgs[idx];
+				reasm->used = 1;
+				break;
+			}
+		}
+	}
+
+	if (reasm == NULL)
+	{
+		reasmStats.dropped++;
+	}
+
+	sem_post(&reasmSem);
+
+	if (reasm == NULL)
+	{
+		dbg_print(PRINT_LEVEL_WARNING,
+		        "afReasm: dropping %d bytes message from %llx\n", msg->Len,
+		        (long long unsigned int) msg->SrcAddr);
+		// free the message in the ZNP
+		reasmRetrieve(msg->TimeStamp, 0, 0, NULL);
+		return 1;
+	}
+
+	memcpy(&reasm->hdr, msg, sizeof(IncomingMsgExtFormat_t));
+	reasm->offset = 0;
+
+	// the retrieves run from the timer wheel, the frames queued behind
+	// this one go first
+	rpcTimerStart(&reasm->timer, 0, 0, reasmStep, reasm);
+
+	return 1;
+}
+
+/*********************************************************************
+ * @fn      reasmStep
+ *
+ * @brief   retrieve the next chunks of a message, deliver it once
+ *          complete
+ *
+ * @param   arg - message
+ *
+ * @return  -
+ */
+static void reasmStep(void *arg)
+{
+	afReasmMsg_t *reasm = (afReasmMsg_t *) arg;
+	uint8_t chunk, status = afStatus_SUCCESS;
+	uint16_t len;
+
+	for (chunk = 0;
+	        (chunk < AF_REASM_CHUNKS_PER_STEP) && (reasm->offset < reasm->hdr.Len);
+	        chunk++)
+	{
+		len = reasm->hdr.Len - reasm->offset;
+		if (len > MT_AF_DATA_RETRIEVE_MAX_LEN)
+		{
+			len = MT_AF_DATA_RETRIEVE_MAX_LEN;
+		}
+
+		status = reasmRetrieve(reasm->hdr.TimeStamp, reasm->offset,
+		        (uint8_t) len, &reasm->data[reasm->offset]);
+		if (status != afStatus_SUCCESS)
+		{
+			break;
+		}
+
+		reasm->offset += len;
+	}
+
+	sem_wait(&reasmSem);
+	reasmStats.chunks += chunk;
+	sem_post(&reasmSem);
+
+	if ((status == afStatus_SUCCESS) && (reasm->offset < reasm->hdr.Len))
+	{
+		rpcTimerStart(&reasm->timer, 0, 0, reasmStep, reasm);
+		return;
+	}
+
+	// free the message in the ZNP
+	reasmRetrieve(reasm->hdr.TimeStamp, 0, 0, NULL);
+
+	if (status == afStatus_SUCCESS)
+	{
+		if (reasmCb != NULL)
+		{
+			reasmCb(&reasm->hdr, reasm->data, reasm->hdr.Len);
+		}
+	}
+	else
+	{
+		dbg_print(PRINT_LEVEL_WARNING,
+		        "afReasm: retrieve failed with %x at %d of %d\n", status,
+		        reasm->offset, reasm->hdr.Len);
+	}
+
+	sem_wait(&reasmSem);
+	if (status == afStatus_SUCCESS)
+	{
+		reasmStats.messages++;
+		reasmStats.bytes += reasm->hdr.Len;
+	}
+	else
+	{
+		reasmStats.failed++;
+	}
+	reasm->used = 0;
+	sem_post(&reasmSem);
+}
+
+/*********************************************************************
+ * @fn      reasmRetrieve
+ *
+ * @brief   retrieve a chunk of a message kept in the ZNP
+ *
+ * @param   timeStamp - TimeStamp of the message
+ * @param   index - offset of the chunk
+ * @param   length - length of the chunk, 0 to free the message
+ * @param   data - buffer for the chunk
+ *
+ * @return  afStatus_xxx, afStatus_FAILED if there was no SRSP or it
+ *          was short
+ */
+static uint8_t reasmRetrieve(uint32_t timeStamp, uint16_t index,
+        uint8_t length, uint8_t *data)
+{
+	DataRetrieveFormat_t req;
+	DataRetrieveSrspFormat_t rsp;
+	uint8_t status;
+
+	req.TimeStamp[0] = (uint8_t) (timeStamp & 0xFF);
+	req.TimeStamp[1] = (uint8_t) ((timeStamp >> 8) & 0xFF);
+	req.TimeStamp[2] = (uint8_t) ((timeStamp >> 16) & 0xFF);
+	req.TimeStamp[3] = (uint8_t) ((timeStamp >> 24) & 0xFF);
+	req.Index = index;
+	req.Length = length;
+
+	sem_wait(&reasmRetrieveSem);
+
+	if (afDataRetrieveRsp(&req, &rsp) != MT_RPC_SUCCESS)
+	{
+		status = afStatus_FAILED;
+	}
+	else
+	{
+		status = rsp.Status;
+		if ((status == afStatus_SUCCESS) && (length > 0))
+		{
+			if (rsp.Length != length)
+			{
+				status = afStatus_FAILED;
+			}
+			else
+			{
+				memcpy(data, rsp.Data, length);
+			}
+		}
+	}
+
+	sem_post(&reasmRetrieveSem);
+
+	return status;
+}
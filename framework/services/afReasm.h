@@ -0,0 +1,98 @@
+/*
+ * afReasm.h
+ *
+ * This module contains the reassembly of large incoming AF messages of
+ * the ZigBee Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef AFREASM_H
+#define AFREASM_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+#include "mtAf.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// messages reassembled at the same time
+#define AF_REASM_MAX_MSGS          (2)
+
+// size of the reassembly buffers, longer messages are dropped
+#define AF_REASM_MAX_LEN           (2048)
+
+// AF_DATA_RETRIEVEs done before other frames get a turn
+#define AF_REASM_CHUNKS_PER_STEP   (4)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// called with the header of the MT_AF_INCOMING_MSG_EXT and the whole
+// payload, msg->Data is not used
+typedef void (*afReasmMsgCb_t)(IncomingMsgExtFormat_t *msg, uint8_t *data,
+        uint16_t len);
+
+typedef struct
+{
+	uint32_t messages;    // messages delivered
+	uint32_t bytes;       // payload bytes delivered
+	uint32_t chunks;      // AF_DATA_RETRIEVEs done
+	uint32_t dropped;     // messages too long or without a free buffer
+	uint32_t failed;      // messages lost to an AF_DATA_RETRIEVE error
+	uint8_t active;       // messages being reassembled
+} afReasmStats_t;
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+int32_t afReasmInit(afReasmMsgCb_t cb);
+void afReasmGetStats(afReasmStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFREASM_H */
@@ -0,0 +1,336 @@
+/*
+ * afSrcRtg.c
+ *
+ * This module contains the source route cache of the ZigBee Network
+ * Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include <semaphore.h>
+
+#include "afSrcRtg.h"
+#include "mtZdo.h"
+#include "rpcTimer.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint8_t used;
+	uint8_t relayCount;
+	uint16_t dstAddr;
+	uint64_t time;         // time the route record was received
+	uint16_t relayList[AF_SRC_RTG_MAX_RELAYS];
+} afSrcRtgRoute_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static afSrcRtgRoute_t srcRtgRoutes[AF_SRC_RTG_MAX_ROUTES];
+static uint32_t srcRtgMaxAge = AF_SRC_RTG_DEFAULT_MAX_AGE;
+static afSrcRtgStats_t srcRtgStats;
+
+// protects srcRtgRoutes, srcRtgMaxAge and srcRtgStats
+static sem_t srcRtgSem;
+
+static uint8_t srcRtgInitDone = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS DECLARATION
+ */
+
+static uint8_t srcRtgIndCb(SrcRtgIndFormat_t *msg);
+static afSrcRtgRoute_t *srcRtgFind(uint16_t dstAddr);
+
+static mtZdoCb_t srcRtgZdoCbs =
+	{ .pfnZdoSrcRtgInd = srcRtgIndCb, };
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      afSrcRtgInit
+ *
+ * @brief   initialise the source route cache, must be called once
+ *          after rpcInitMq(). The route records the ZNP reports with
+ *          ZDO_SRC_RTG_IND are then kept per destination.
+ *
+ * @param   -
+ *
+ * @return  status, -1 if its observer could not be registered
+ */
+int32_t afSrcRtgInit(void)
+{
+	memset(srcRtgRoutes, 0, sizeof(srcRtgRoutes));
+	memset(&srcRtgStats, 0, sizeof(srcRtgStats));
+	srcRtgMaxAge = AF_SRC_RTG_DEFAULT_MAX_AGE;
+
+	sem_init(&srcRtgSem, 0, 1);
+
+	if (!srcRtgInitDone)
+	{
+		if (zdoRegisterObserver(&srcRtgZdoCbs) != 0)
+		{
+			dbg_print(PRINT_LEVEL_WARNING,
+			        "afSrcRtgInit: no free observer entry\n");
+			return -1;
+		}
+		srcRtgInitDone = 1;
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      afSrcRtgConfig
+ *
+ * @brief   set how long a route is used after its route record. It
+ *          should be shorter than the interval of the many-to-one
+ *          route requests of the concentrator.
+ *
+ * @param   maxAge - age in ms, 0 stops the use of cached routes
+ *
+ * @return  -
+ */
+void afSrcRtgConfig(uint32_t maxAge)
+{
+	sem_wait(&srcRtgSem);
+
+	srcRtgMaxAge = maxAge;
+
+	sem_post(&srcRtgSem);
+}
+
+/*********************************************************************
+ * @fn      afSrcRtgLookup
+ *
+ * @brief   get a fresh route to a destination, there is none unless
+ *          afSrcRtgInit() was called
+ *
+ * @param   dstAddr - short address of the destination
+ * @param   relayList - filled in with the relays in the order of the
+ *          route record, must hold AF_SRC_RTG_MAX_RELAYS addresses
+ *
+ * @return  number of relays, -1 if no fresh route is known
+ */
+int32_t afSrcRtgLookup(uint16_t dstAddr, uint16_t *relayList)
+{
+	afSrcRtgRoute_t *route;
+	int32_t relayCount = -1;
+
+	if (!srcRtgInitDone)
+	{
+		return -1;
+	}
+
+	sem_wait(&srcRtgSem);
+
+	route = srcRtgFind(dstAddr);
+	if ((route != NULL) && (srcRtgMaxAge != 0)
+	        && ((rpcTimerNow() - route->time) < srcRtgMaxAge))
+	{
+		memcpy(relayList, route->relayList,
+		        route->relayCount * sizeof(uint16_t));
+		relayCount = route->relayCount;
+		srcRtgStats.hits++;
+	}
+	else
+	{
+		srcRtgStats.misses++;
+	}
+
+	sem_post(&srcRtgSem);
+
+	return relayCount;
+}
+
+/*********************************************************************
+ * @fn      afSrcRtgInvalidate
+ *
+ * @brief   forget the route to a destination after a delivery failure,
+ *          the next send falls back to route discovery
+ *
+ * @param   dstAddr - short address of the destination
+ *
+ * @return  -
+ */
+void afSrcRtgInvalidate(uint16_t dstAddr)
+{
+	afSrcRtgRoute_t *route;
+
+	if (!srcRtgInitDone)
+	{
+		return;
+	}
+
+	sem_wait(&srcRtgSem);
+
+	route = srcRtgFind(dstAddr);
+	if (route != NULL)
+	{
+		route->used = 0;
+		srcRtgStats.invalidated++;
+	}
+
+	sem_post(&srcRtgSem);
+
+	if (route != NULL)
+	{
+		dbg_print(PRINT_LEVEL_INFO, "afSrcRtg: route to 0x%04X dropped\n",
+		        dstAddr);
+	}
+}
+
+/*********************************************************************
+ * @fn      afSrcRtgGetStats
+ *
+ * @brief   get the source route cache counters
+ *
+ * @param   stats - filled in with the counters
+ *
+ * @return  -
+ */
+void afSrcRtgGetStats(afSrcRtgStats_t *stats)
+{
+	uint8_t idx;
+
+	sem_wait(&srcRtgSem);
+
+	memcpy(stats, &srcRtgStats, sizeof(afSrcRtgStats_t));
+	stats->routes = 0;
+	for (idx = 0; idx < AF_SRC_RTG_MAX_ROUTES; idx++)
+	{
+		if (srcRtgRoutes[idx].used)
+		{
+			stats->routes++;
+		}
+	}
+
+	sem_post(&srcRtgSem);
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      srcRtgIndCb
+ *
+ * @brief   MT_ZDO_SRC_RTG_IND observer, caches the route record. The
+ *          least recently recorded route makes room for a new
+ *          destination.
+ *
+ * @param   msg - route record
+ *
+ * @return  0, the application still gets the indication
+ */
+static uint8_t srcRtgIndCb(SrcRtgIndFormat_t *msg)
+{
+	afSrcRtgRoute_t *route;
+	uint8_t idx;
+
+	if (msg->RelayCount > AF_SRC_RTG_MAX_RELAYS)
+	{
+		return 0;
+	}
+
+	sem_wait(&srcRtgSem);
+
+	srcRtgStats.records++;
+
+	route = srcRtgFind(msg->DstAddr);
+	if (route == NULL)
+	{
+		for (idx = 0; idx < AF_SRC_RTG_MAX_ROUTES; idx++)
+		{
+			if (!srcRtgRoutes[idx].used)
+			{
+				route = &srcRtgRoutes[idx];
+				break;
+			}
+			if ((route == NULL) || (srcRtgRoutes[idx].time < route->time))
+			{
+				route = &srcRtgRoutes[idx];
+			}
+		}
+		if (route->used)
+		{
+			srcRtgStats.evicted++;
+		}
+	}
+
+	route->used = 1;
+	route->dstAddr = msg->DstAddr;
+	route->relayCount = msg->RelayCount;
+	memcpy(route->relayList, msg->RelayList,
+	        msg->RelayCount * sizeof(uint16_t));
+	route->time = rpcTimerNow();
+
+	sem_post(&srcRtgSem);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      srcRtgFind
+ *
+ * @brief   find the route to a destination, called with srcRtgSem held
+ *
+ * @param   dstAddr - short address of the destination
+ *
+ * @return  route, NULL if none is cached
+ */
+static afSrcRtgRoute_t *srcRtgFind(uint16_t dstAddr)
+{
+	uint8_t idx;
+
+	for (idx = 0; idx < AF_SRC_RTG_MAX_ROUTES; idx++)
+	{
+		if (srcRtgRoutes[idx].used && (srcRtgRoutes[idx].dstAddr == dstAddr))
+		{
+			return &srcRtgRoutes[idx];
+		}
+	}
+
+	return NULL;
+}
@@ -0,0 +1,94 @@
+/*
+ * afSrcRtg.h
+ *
+ * This module contains the source route cache of the ZigBee Network
+ * Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef AFSRCRTG_H
+#define AFSRCRTG_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// destinations with a route in the cache
+#define AF_SRC_RTG_MAX_ROUTES      (64)
+
+// routes with more relays are not cached
+#define AF_SRC_RTG_MAX_RELAYS      (16)
+
+// default age in ms after which a route is no longer used
+#define AF_SRC_RTG_DEFAULT_MAX_AGE (60000)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint32_t records;     // route records received
+	uint32_t hits;        // lookups that found a fresh route
+	uint32_t misses;      // lookups without a fresh route
+	uint32_t invalidated; // routes dropped after a delivery failure
+	uint32_t evicted;     // routes replaced to make room
+	uint8_t routes;       // routes in the cache
+} afSrcRtgStats_t;
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+int32_t afSrcRtgInit(void);
+void afSrcRtgConfig(uint32_t maxAge);
+int32_t afSrcRtgLookup(uint16_t dstAddr, uint16_t *relayList);
+void afSrcRtgInvalidate(uint16_t dstAddr);
+void afSrcRtgGetStats(afSrcRtgStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFSRCRTG_H */
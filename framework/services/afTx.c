@@ -0,0 +1,1364 @@
+/*
+ * afTx.c
+ *
+ * This module contains the windowed AF transmit engine of the ZigBee
+ * Network Processor (ZNP) Host Interface. It allocates the TransIDs,
+ * tracks the sends until their MT_AF_DATA_CONFIRM, limits the number
+ * of outstanding sends globally and per destination, retries failed
+ * sends and stops sending to unreachable destinations.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <semaphore.h>
+
+#include "afTx.h"
+#include "afSrcRtg.h"
+#include "mtAf.h"
+#include "rpc.h"
+#include "rpcTimer.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * MACROS
+ */
+
+// windows are kept in 1/16 to grow by a fraction per confirm
+#define AF_TX_WND(w) ((w) >> 4)
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// ZigBee and MAC status codes worth a retry
+#define AF_TX_APS_NO_ACK                (0xB7)
+#define AF_TX_MAC_CHANNEL_ACCESS_FAIL   (0xE1)
+#define AF_TX_MAC_NO_ACK                (0xE9)
+#define AF_TX_MAC_TRANSACTION_EXPIRED   (0xF0)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef enum
+{
+	AF_TX_FREE, AF_TX_QUEUED, AF_TX_IN_FLIGHT, AF_TX_BACKOFF
+} afTxState_t;
+
+typedef struct
+{
+	uint8_t state;
+	uint8_t dest;          // index in txDests
+	uint8_t attempts;      // AF_DATA_REQUESTs sent
+	uint8_t group;         // req.DstAddr is a group ID
+	uint8_t srcRtg;        // the last attempt was source routed
+	uint16_t gen;          // incremented when the entry is freed
+	uint32_t seq;          // queue order
+	uint64_t queued;       // time afTxSend() accepted the send
+	uint64_t first;        // time of the first AF_DATA_REQUEST
+	uint64_t sent;         // time of the last AF_DATA_REQUEST
+	uint64_t retry;        // time of the next retry
+	uint32_t sendNo;       // number of sends before this one
+	afTxDoneCb_t cb;
+	void *arg;
+	rpcTimer_t timer;      // confirm timeout or retry delay
+	DataRequestFormat_t req;
+} afTxEntry_t;
+
+typedef struct
+{
+	uint8_t used;
+	uint8_t inFlight;
+	uint8_t queued;        // entries queued or waiting for a retry
+	uint8_t failures;      // consecutive failures
+	uint8_t breaker;       // AF_TX_BREAKER_xxx
+	uint8_t group;         // addr is a group ID
+	uint8_t shared;        // sends without a destination of their own
+	uint16_t addr;
+	uint16_t window;       // in 1/16
+	uint32_t cutNo;        // sends before this one do not cut the window
+	uint64_t openUntil;    // end of the cooldown of an open breaker
+	uint64_t lastUse;
+} afTxDest_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static afTxEntry_t txEntries[AF_TX_MAX_ENTRIES];
+// the last one is shared by the sends that found no free destination,
+// they are only limited by the global window
+static afTxDest_t txDests[AF_TX_MAX_DESTS + 1];
+
+static uint16_t txWindow;    // global window in 1/16
+static uint32_t txSendNo;
+static uint32_t txCutNo;
+static uint8_t txInFlight;
+static uint8_t txQueued;
+static uint8_t txBackoff;
+static uint32_t txSeq;
+static uint8_t txTransId;
+
+static uint8_t txMaxWindow = AF_TX_MAX_WINDOW;
+static uint8_t txMaxDestWindow = AF_TX_MAX_DEST_WINDOW;
+static uint32_t txConfirmTimeout = AF_TX_CONFIRM_TIMEOUT_MS;
+static afTxRetryPolicy_t txPolicy =
+	{ 0, AF_TX_RETRY_BASE_MS, AF_TX_RETRY_MAX_MS, 0,
+	        AF_TX_BREAKER_COOLDOWN_MS };
+static afTxBreakerCb_t txBreakerCb = NULL;
+
+static afTxStats_t txStats;
+
+// protects the tables above
+static sem_t txSem;
+// serialises the AF_DATA_REQUESTs
+static sem_t txSendSem;
+
+static uint8_t txInitDone = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS DECLARATION
+ */
+
+static uint8_t txDataConfirmCb(DataConfirmFormat_t *msg);
+static void txTimeoutCb(void *arg);
+static void txRetryCb(void *arg);
+static void txPump(void);
+static void txComplete(afTxEntry_t *entry, uint16_t gen, uint8_t status);
+static void txFailDest(uint8_t dest);
+static void txRelease(afTxEntry_t *entry, uint8_t status,
+        afTxResult_t *result);
+static void txFeedback(afTxEntry_t *entry, afTxDest_t *dest, uint8_t status);
+static uint8_t txBreaker(afTxDest_t *dest, uint8_t status);
+static uint8_t txDestWindow(afTxDest_t *dest, uint64_t now);
+static uint8_t txRetryable(uint8_t status);
+static uint32_t txRetryDelay(uint8_t attempts);
+static int32_t txQueue(DataRequestFormat_t *req, uint8_t group,
+        afTxDoneCb_t cb, void *arg);
+static uint8_t txRequest(DataRequestFormat_t *req, uint8_t group,
+        uint16_t *relayList, int32_t relayCount, uint8_t *status);
+static uint8_t txFindDest(uint16_t addr, uint8_t group);
+static uint8_t txTransIdUsed(uint8_t endpoint, uint8_t transId);
+
+static mtAfCb_t txAfCbs =
+	{ txDataConfirmCb,		//MT_AF_DATA_CONFIRM
+	        NULL,			//MT_AF_INCOMING_MSG
+	        NULL,			//MT_AF_INCOMING_MSG_EXT
+	        NULL,			//MT_AF_DATA_RETRIEVE
+	        NULL,			//MT_AF_REFLECT_ERROR
+	    };
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      afTxInit
+ *
+ * @brief   initialise the transmit engine, must be called once after
+ *          rpcInitMq()
+ *
+ * @param   -
+ *
+ * @return  status, -1 if its observer could not be registered
+ */
+int32_t afTxInit(void)
+{
+	memset(txEntries, 0, sizeof(txEntries));
+	memset(txDests, 0, sizeof(txDests));
+	txDests[AF_TX_MAX_DESTS].shared = 1;
+	txDests[AF_TX_MAX_DESTS].window = 1 << 4;
+	memset(&txStats, 0, sizeof(txStats));
+
+	txWindow = (txMaxWindow > 1) ? ((txMaxWindow / 2) << 4) : (1 << 4);
+	txSendNo = 0;
+	txCutNo = 0;
+	txInFlight = 0;
+	txQueued = 0;
+	txBackoff = 0;
+	txSeq = 0;
+	txTransId = 0;
+
+	sem_init(&txSem, 0, 1);
+	sem_init(&txSendSem, 0, 1);
+
+	if (!txInitDone)
+	{
+		if (afRegisterObserver(&txAfCbs) != 0)
+		{
+			dbg_print(PRINT_LEVEL_WARNING,
+			        "afTxInit: no free observer entry\n");
+			return -1;
+		}
+		txInitDone = 1;
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      afTxConfig
+ *
+ * @brief   set the window limits and the confirm timeout, afTxInit()
+ *          must have been called
+ *
+ * @param   maxWindow - maximum number of sends waiting for a confirm
+ * @param   maxDestWindow - maximum per destination
+ * @param   confirmTimeout - time to wait for a confirm in ms
+ *
+ * @return  -
+ */
+void afTxConfig(uint8_t maxWindow, uint8_t maxDestWindow,
+        uint32_t confirmTimeout)
+{
+	uint8_t idx;
+
+	if (maxWindow == 0)
+	{
+		maxWindow = 1;
+	}
+	if (maxDestWindow == 0)
+	{
+		maxDestWindow = 1;
+	}
+
+	sem_wait(&txSem);
+
+	txMaxWindow = maxWindow;
+	txMaxDestWindow = maxDestWindow;
+	txConfirmTimeout = confirmTimeout;
+
+	if (AF_TX_WND(txWindow) > txMaxWindow)
+	{
+		txWindow = txMaxWindow << 4;
+	}
+	for (idx = 0; idx < AF_TX_MAX_DESTS; idx++)
+	{
+		if (AF_TX_WND(txDests[idx].window) > txMaxDestWindow)
+		{
+			txDests[idx].window = txMaxDestWindow << 4;
+		}
+	}
+
+	sem_post(&txSem);
+
+	txPump();
+}
+
+/*********************************************************************
+ * @fn      afTxSetRetryPolicy
+ *
+ * @brief   set the retry policy. Sends failing with a routing, MAC or
+ *          APS acknowledgement error, or with afStatus_MEM_FAIL, are
+ *          sent again after a delay doubling from baseDelay up to
+ *          maxDelay, randomised to half to the full delay. After
+ *          breakerThreshold consecutive delivery failures the breaker
+ *          of the destination opens: its sends fail with
+ *          AF_TX_STATUS_BREAKER_OPEN until, after breakerCooldown, a
+ *          single send succeeds again. afTxInit() must have been
+ *          called.
+ *
+ * @param   policy - retry policy, copied
+ *
+ * @return  -
+ */
+void afTxSetRetryPolicy(afTxRetryPolicy_t *policy)
+{
+	sem_wait(&txSem);
+
+	memcpy(&txPolicy, policy, sizeof(afTxRetryPolicy_t));
+	if (txPolicy.baseDelay == 0)
+	{
+		txPolicy.baseDelay = 1;
+	}
+	if (txPolicy.maxDelay < txPolicy.baseDelay)
+	{
+		txPolicy.maxDelay = txPolicy.baseDelay;
+	}
+
+	sem_post(&txSem);
+}
+
+/*********************************************************************
+ * @fn      afTxSetBreakerCb
+ *
+ * @brief   register a callback for the breaker state changes
+ *
+ * @param   cb - callback, NULL to unregister
+ *
+ * @return  -
+ */
+void afTxSetBreakerCb(afTxBreakerCb_t cb)
+{
+	txBreakerCb = cb;
+}
+
+/*********************************************************************
+ * @fn      afTxSend
+ *
+ * @brief   queue an AF_DATA_REQUEST. It is sent when the global and
+ *          the destination window allow it, req->TransID is replaced
+ *          by one allocated by the engine. cb is called with the
+ *          status of the MT_AF_DATA_CONFIRM, possibly before afTxSend()
+ *          returns.
+ *
+ * @param   req - request, copied
+ * @param   cb - completion callback, may be NULL
+ * @param   arg - passed to cb
+ *
+ * @return  TransID of the send, -1 if there is no free entry or
+ *          afTxInit() was not called
+ */
+int32_t afTxSend(DataRequestFormat_t *req, afTxDoneCb_t cb, void *arg)
+{
+	return txQueue(req, 0, cb, arg);
+}
+
+/*********************************************************************
+ * @fn      afTxSendGroup
+ *
+ * @brief   queue a groupcast, sent as an AF_DATA_REQUEST_EXT with group
+ *          addressing, see afTxSend(). Each group has its own window.
+ *
+ * @param   req - request, req->DstAddr is the group ID
+ * @param   cb - completion callback, may be NULL
+ * @param   arg - passed to cb
+ *
+ * @return  TransID of the send, -1 if there is no free entry
+ */
+int32_t afTxSendGroup(DataRequestFormat_t *req, afTxDoneCb_t cb, void *arg)
+{
+	return txQueue(req, 1, cb, arg);
+}
+
+/*********************************************************************
+ * @fn      afTxGetDestStats
+ *
+ * @brief   get the window and breaker state of a destination
+ *
+ * @param   dstAddr - network address of the destination
+ * @param   stats - filled in with the destination state
+ *
+ * @return  status, -1 if the destination is not known or afTxInit()
+ *          was not called
+ */
+int32_t afTxGetDestStats(uint16_t dstAddr, afTxDestStats_t *stats)
+{
+	int32_t status = -1;
+	uint64_t now = rpcTimerNow();
+	afTxDest_t *dest;
+	uint8_t idx;
+
+	if (!txInitDone)
+	{
+		return -1;
+	}
+
+	sem_wait(&txSem);
+
+	for (idx = 0; idx < AF_TX_MAX_DESTS; idx++)
+	{
+		dest = &txDests[idx];
+		if (dest->used && !dest->group && (dest->addr == dstAddr))
+		{
+			stats->window = AF_TX_WND(dest->window);
+			stats->inFlight = dest->inFlight;
+			stats->queued = dest->queued;
+			stats->failures = dest->failures;
+			stats->breaker = dest->breaker;
+			stats->openTime =
+			        ((dest->breaker == AF_TX_BREAKER_OPEN)
+			                && (dest->openUntil > now)) ?
+			                (uint32_t) (dest->openUntil - now) : 0;
+			status = 0;
+			break;
+		}
+	}
+
+	sem_post(&txSem);
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      afTxGetStats
+ *
+ * @brief   get the transmit engine counters
+ *
+ * @param   stats - filled in with the counters, zeroed if afTxInit()
+ *          was not called
+ *
+ * @return  status, -1 if afTxInit() was not called
+ */
+int32_t afTxGetStats(afTxStats_t *stats)
+{
+	uint8_t idx;
+
+	if (!txInitDone)
+	{
+		memset(stats, 0, sizeof(afTxStats_t));
+		return -1;
+	}
+
+	sem_wait(&txSem);
+
+	memcpy(stats, &txStats, sizeof(afTxStats_t));
+	stats->window = AF_TX_WND(txWindow);
+	stats->inFlight = txInFlight;
+	stats->queued = txQueued;
+	stats->backoff = txBackoff;
+	stats->openBreakers = 0;
+	for (idx = 0; idx < AF_TX_MAX_DESTS; idx++)
+	{
+		if (txDests[idx].used && (txDests[idx].breaker != AF_TX_BREAKER_CLOSED))
+		{
+			stats->openBreakers++;
+		}
+	}
+
+	sem_post(&txSem);
+
+	return 0;
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      txQueue
+ *
+ * @brief   queue a send
+ *
+ * @param   req - request, copied
+ * @param   group - 1 if req->DstAddr is a group ID
+ * @param   cb - completion callback, may be NULL
+ * @param   arg - passed to cb
+ *
+ * @return  TransID of the send, -1 if there is no free entry
+ */
+static int32_t txQueue(DataRequestFormat_t *req, uint8_t group,
+        afTxDoneCb_t cb, void *arg)
+{
+	afTxEntry_t *entry = NULL;
+	afTxResult_t result;
+	uint8_t dest;
+	uint8_t idx;
+	uint8_t transId;
+	uint8_t open;
+
+	if (!txInitDone)
+	{
+		return -1;
+	}
+
+	sem_wait(&txSem);
+
+	for (idx = 0; idx < AF_TX_MAX_ENTRIES; idx++)
+	{
+		if (txEntries[idx].state == AF_TX_FREE)
+		{
+			entry = &txEntries[idx];
+			break;
+		}
+	}
+
+	if (entry == NULL)
+	{
+		sem_post(&txSem);
+		dbg_print(PRINT_LEVEL_WARNING, "afTx: no free entry\n");
+		return -1;
+	}
+
+	dest = txFindDest(req->DstAddr, group);
+
+	// there are fewer entries than TransIDs, one is always free
+	do
+	{
+		transId = txTransId++;
+	} while (txTransIdUsed(req->SrcEndpoint, transId));
+
+	memcpy(&entry->req, req, sizeof(DataRequestFormat_t));
+	entry->req.TransID = transId;
+	entry->state = AF_TX_QUEUED;
+	entry->dest = dest;
+	entry->attempts = 0;
+	entry->group = group;
+	entry->seq = txSeq++;
+	entry->queued = rpcTimerNow();
+	entry->cb = cb;
+	entry->arg = arg;
+
+	txDests[dest].queued++;
+	txDests[dest].lastUse = entry->queued;
+	txQueued++;
+
+	open = (txDests[dest].breaker == AF_TX_BREAKER_OPEN)
+	        && (entry->queued < txDests[dest].openUntil);
+	if (open)
+	{
+		txStats.rejected++;
+		txRelease(entry, AF_TX_STATUS_BREAKER_OPEN, &result);
+	}
+
+	sem_post(&txSem);
+
+	if (open)
+	{
+		if (cb != NULL)
+		{
+			cb(&result, arg);
+		}
+	}
+	else
+	{
+		txPump();
+	}
+
+	return transId;
+}
+
+/*********************************************************************
+ * @fn      txDataConfirmCb
+ *
+ * @brief   MT_AF_DATA_CONFIRM observer, completes the matching send.
+ *          Confirms of TransIDs not sent by the engine are ignored.
+ *
+ * @param   msg - confirm
+ *
+ * @return  0
+ */
+static uint8_t txDataConfirmCb(DataConfirmFormat_t *msg)
+{
+	afTxEntry_t *entry = NULL;
+	uint16_t gen = 0;
+	uint8_t idx;
+
+	sem_wait(&txSem);
+
+	for (idx = 0; idx < AF_TX_MAX_ENTRIES; idx++)
+	{
+		if ((txEntries[idx].state == AF_TX_IN_FLIGHT)
+		        && (txEntries[idx].req.SrcEndpoint == msg->Endpoint)
+		        && (txEntries[idx].req.TransID == msg->TransId))
+		{
+			entry = &txEntries[idx];
+			gen = entry->gen;
+			break;
+		}
+	}
+
+	sem_post(&txSem);
+
+	if (entry != NULL)
+	{
+		txComplete(entry, gen, msg->Status);
+		txPump();
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      txTimeoutCb
+ *
+ * @brief   confirm timeout of a send
+ *
+ * @param   arg - entry
+ *
+ * @return  -
+ */
+static void txTimeoutCb(void *arg)
+{
+	afTxEntry_t *entry = (afTxEntry_t *) arg;
+	uint8_t expired;
+	uint8_t transId;
+	uint16_t gen;
+
+	sem_wait(&txSem);
+
+	// the entry may have been completed and reused while the timer
+	// callback was being called
+	expired = (entry->state == AF_TX_IN_FLIGHT)
+	        && (rpcTimerNow() >= (entry->sent + txConfirmTimeout));
+	transId = entry->req.TransID;
+	gen = entry->gen;
+
+	sem_post(&txSem);
+
+	if (expired)
+	{
+		dbg_print(PRINT_LEVEL_INFO, "afTx: no confirm for TransID %d\n",
+		        transId);
+		txComplete(entry, gen, AF_TX_STATUS_TIMEOUT);
+		txPump();
+	}
+}
+
+/*********************************************************************
+ * @fn      txRetryCb
+ *
+ * @brief   end of the retry delay of a send, it is queued again unless
+ *          the breaker of its destination opened meanwhile
+ *
+ * @param   arg - entry
+ *
+ * @return  -
+ */
+static void txRetryCb(void *arg)
+{
+	afTxEntry_t *entry = (afTxEntry_t *) arg;
+	afTxDest_t *dest;
+	int32_t failDest = -1;
+
+	sem_wait(&txSem);
+
+	if ((entry->state != AF_TX_BACKOFF) || (rpcTimerNow() < entry->retry))
+	{
+		sem_post(&txSem);
+		return;
+	}
+
+	dest = &txDests[entry->dest];
+	if (dest->breaker == AF_TX_BREAKER_OPEN)
+	{
+		failDest = entry->dest;
+	}
+	else
+	{
+		entry->state = AF_TX_QUEUED;
+		txBackoff--;
+		txQueued++;
+	}
+
+	sem_post(&txSem);
+
+	if (failDest != -1)
+	{
+		txFailDest((uint8_t) failDest);
+	}
+	else
+	{
+		txPump();
+	}
+}
+
+/*********************************************************************
+ * @fn      txPump
+ *
+ * @brief   send the queued requests the windows allow, oldest first
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+static void txPump(void)
+{
+	DataRequestFormat_t req;
+	uint16_t relayList[AF_SRC_RTG_MAX_RELAYS];
+	int32_t relayCount;
+	afTxEntry_t *entry;
+	afTxDest_t *dest;
+	uint64_t now;
+	uint8_t idx;
+	uint16_t gen;
+	int32_t rpcStatus;
+	uint8_t status;
+	uint8_t probe;
+	uint8_t group;
+
+	while (1)
+	{
+		sem_wait(&txSem);
+
+		now = rpcTimerNow();
+		entry = NULL;
+		probe = 0;
+		if (txInFlight < AF_TX_WND(txWindow))
+		{
+			for (idx = 0; idx < AF_TX_MAX_ENTRIES; idx++)
+			{
+				dest = &txDests[txEntries[idx].dest];
+				if ((txEntries[idx].state == AF_TX_QUEUED)
+				        && (dest->inFlight < txDestWindow(dest, now))
+				        && ((entry == NULL)
+				                || ((int32_t) (txEntries[idx].seq - entry->seq)
+				                        < 0)))
+				{
+					entry = &txEntries[idx];
+				}
+			}
+		}
+
+		if (entry == NULL)
+		{
+			sem_post(&txSem);
+			break;
+		}
+
+		dest = &txDests[entry->dest];
+		if (dest->breaker == AF_TX_BREAKER_OPEN)
+		{
+			// the cooldown is over, let this send probe the destination
+			dest->breaker = AF_TX_BREAKER_HALF_OPEN;
+			probe = 1;
+		}
+		dest->queued--;
+		dest->inFlight++;
+		txQueued--;
+		txInFlight++;
+
+		// the confirm may complete and free the entry before
+		// afDataRequest() returns, send a copy
+		entry->state = AF_TX_IN_FLIGHT;
+		entry->sent = now;
+		if (entry->attempts == 0)
+		{
+			entry->first = now;
+		}
+		else
+		{
+			txStats.retries++;
+		}
+		entry->attempts++;
+		entry->sendNo = txSendNo++;
+		gen = entry->gen;
+		memcpy(&req, &entry->req, sizeof(DataRequestFormat_t));
+		group = entry->group;
+		relayCount = group ? -1 : afSrcRtgLookup(req.DstAddr, relayList);
+		entry->srcRtg = (relayCount > 0);
+		rpcTimerStart(&entry->timer, txConfirmTimeout, 0, txTimeoutCb, entry);
+
+		sem_post(&txSem);
+
+		if (probe && (txBreakerCb != NULL))
+		{
+			txBreakerCb(req.DstAddr, AF_TX_BREAKER_HALF_OPEN);
+		}
+
+		sem_wait(&txSendSem);
+		rpcStatus = txRequest(&req, group, relayList, relayCount, &status);
+		sem_post(&txSendSem);
+
+		sem_wait(&txSem);
+		txStats.sent++;
+		sem_post(&txSem);
+
+		if (rpcStatus != MT_RPC_SUCCESS)
+		{
+			txComplete(entry, gen, AF_TX_STATUS_NO_SRSP);
+		}
+		else if (status != afStatus_SUCCESS)
+		{
+			txComplete(entry, gen, status);
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      txRequest
+ *
+ * @brief   send the AF_DATA_REQUEST of a send, a groupcast needs the
+ *          extended request for its addressing mode and a unicast with
+ *          a cached route is source routed to skip route discovery
+ *
+ * @param   req - request
+ * @param   group - 1 if req->DstAddr is a group ID
+ * @param   relayList - relays of the cached route
+ * @param   relayCount - number of relays, -1 or 0 to route normally
+ * @param   status - set to the status of the SRSP
+ *
+ * @return  status of rpcSendFrame()
+ */
+static uint8_t txRequest(DataRequestFormat_t *req, uint8_t group,
+        uint16_t *relayList, int32_t relayCount, uint8_t *status)
+{
+	DataRequestExtFormat_t ext;
+	DataRequestSrcRtgFormat_t srcRtg;
+
+	if (!group && (relayCount > 0))
+	{
+		srcRtg.DstAddr = req->DstAddr;
+		srcRtg.DstEndpoint = req->DstEndpoint;
+		srcRtg.SrcEndpoint = req->SrcEndpoint;
+		srcRtg.ClusterID = req->ClusterID;
+		srcRtg.TransID = req->TransID;
+		srcRtg.Options = req->Options;
+		srcRtg.Radius = req->Radius;
+		srcRtg.RelayCount = (uint8_t) relayCount;
+		memcpy(srcRtg.RelayList, relayList, relayCount * sizeof(uint16_t));
+		srcRtg.Len = req->Len;
+		memcpy(srcRtg.Data, req->Data, req->Len);
+
+		return afDataRequestSrcRtgRsp(&srcRtg, status);
+	}
+
+	if (!group)
+	{
+		return afDataRequestRsp(req, status);
+	}
+
+	memset(&ext, 0, sizeof(DataRequestExtFormat_t));
+	ext.DstAddrMode = AddrGroup;
+	ext.DstAddr[0] = (uint8_t) (req->DstAddr & 0xFF);
+	ext.DstAddr[1] = (uint8_t) ((req->DstAddr >> 8) & 0xFF);
+	ext.DstEndpoint = req->DstEndpoint;
+	ext.SrcEndpoint = req->SrcEndpoint;
+	ext.ClusterId = req->ClusterID;
+	ext.TransId = req->TransID;
+	ext.Options = req->Options;
+	ext.Radius = req->Radius;
+	ext.Len = req->Len;
+	memcpy(ext.Data, req->Data, req->Len);
+
+	return afDataRequestExtRsp(&ext, status);
+}
+
+/*********************************************************************
+ * @fn      txComplete
+ *
+ * @brief   complete an attempt of a send. The send is retried if the
+ *          policy allows it, otherwise its callback is called.
+ *
+ * @param   entry - entry of the send
+ * @param   gen - generation of the entry when the send was looked up,
+ *          nothing is done if it has been completed since
+ * @param   status - completion status of the attempt
+ *
+ * @return  -
+ */
+static void txComplete(afTxEntry_t *entry, uint16_t gen, uint8_t status)
+{
+	afTxResult_t result;
+	afTxDest_t *dest;
+	afTxDoneCb_t cb;
+	void *arg;
+	uint32_t delay;
+	uint16_t dstAddr;
+	uint8_t destIdx;
+	uint8_t breaker;
+	uint8_t routeFailed;
+
+	sem_wait(&txSem);
+
+	if ((entry->state != AF_TX_IN_FLIGHT) || (entry->gen != gen))
+	{
+		sem_post(&txSem);
+		return;
+	}
+
+	rpcTimerStop(&entry->timer);
+
+	destIdx = entry->dest;
+	dest = &txDests[destIdx];
+	dstAddr = entry->req.DstAddr;
+	// the source route did not deliver, a retry discovers a new one
+	routeFailed = entry->srcRtg && (status != afStatus_SUCCESS)
+	        && (status != afStatus_MEM_FAIL)
+	        && (status != AF_TX_STATUS_NO_SRSP);
+	txFeedback(entry, dest, status);
+	breaker = txBreaker(dest, status);
+
+	if (txRetryable(status) && (entry->attempts <= txPolicy.maxRetries)
+	        && (dest->breaker == AF_TX_BREAKER_CLOSED))
+	{
+		dest->inFlight--;
+		dest->queued++;
+		txInFlight--;
+		txBackoff++;
+
+		delay = txRetryDelay(entry->attempts);
+		entry->state = AF_TX_BACKOFF;
+		entry->retry = rpcTimerNow() + delay;
+		rpcTimerStart(&entry->timer, delay, 0, txRetryCb, entry);
+
+		sem_post(&txSem);
+
+		dbg_print(PRINT_LEVEL_VERBOSE,
+		        "afTx: TransID %d failed with %x, retry in %d ms\n",
+		        entry->req.TransID, status, delay);
+	}
+	else
+	{
+		cb = entry->cb;
+		arg = entry->arg;
+		txRelease(entry, status, &result);
+
+		sem_post(&txSem);
+
+		if (cb != NULL)
+		{
+			cb(&result, arg);
+		}
+	}
+
+	if (routeFailed)
+	{
+		afSrcRtgInvalidate(dstAddr);
+	}
+	if (breaker == AF_TX_BREAKER_OPEN)
+	{
+		// nothing else is sent to the destination for a while
+		txFailDest(destIdx);
+	}
+	if ((breaker != 0xFF) && (txBreakerCb != NULL))
+	{
+		txBreakerCb(dstAddr, breaker);
+	}
+}
+
+/*********************************************************************
+ * @fn      txFailDest
+ *
+ * @brief   complete the sends queued or waiting for a retry to a
+ *          destination with an open breaker
+ *
+ * @param   dest - index in txDests
+ *
+ * @return  -
+ */
+static void txFailDest(uint8_t dest)
+{
+	afTxResult_t result;
+	afTxEntry_t *entry;
+	afTxDoneCb_t cb;
+	void *arg;
+	uint8_t idx;
+
+	while (1)
+	{
+		sem_wait(&txSem);
+
+		entry = NULL;
+		if (txDests[dest].breaker == AF_TX_BREAKER_OPEN)
+		{
+			for (idx = 0; idx < AF_TX_MAX_ENTRIES; idx++)
+			{
+				if ((txEntries[idx].dest == dest)
+				        && ((txEntries[idx].state == AF_TX_QUEUED)
+				                || (txEntries[idx].state == AF_TX_BACKOFF)))
+				{
+					entry = &txEntries[idx];
+					break;
+				}
+			}
+		}
+
+		if (entry == NULL)
+		{
+			sem_post(&txSem);
+			break;
+		}
+
+		cb = entry->cb;
+		arg = entry->arg;
+		txStats.rejected++;
+		txRelease(entry, AF_TX_STATUS_BREAKER_OPEN, &result);
+
+		sem_post(&txSem);
+
+		if (cb != NULL)
+		{
+			cb(&result, arg);
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      txRelease
+ *
+ * @brief   free an entry and fill in the result of its send, called
+ *          with txSem held
+ *
+ * @param   entry - entry of the send
+ * @param   status - completion status
+ * @param   result - filled in with the result
+ *
+ * @return  -
+ */
+static void txRelease(afTxEntry_t *entry, uint8_t status,
+        afTxResult_t *result)
+{
+	afTxDest_t *dest = &txDests[entry->dest];
+	uint64_t now = rpcTimerNow();
+
+	result->status = status;
+	result->transId = entry->req.TransID;
+	result->dstAddr = entry->req.DstAddr;
+	result->attempts = entry->attempts;
+	if (entry->attempts > 0)
+	{
+		result->queueTime = (uint32_t) (entry->first - entry->queued);
+		result->latency = (uint32_t) (now - entry->sent);
+	}
+	else
+	{
+		result->queueTime = (uint32_t) (now - entry->queued);
+		result->latency = 0;
+	}
+
+	switch (entry->state)
+	{
+	case AF_TX_QUEUED:
+		dest->queued--;
+		txQueued--;
+		break;
+	case AF_TX_BACKOFF:
+		dest->queued--;
+		txBackoff--;
+		break;
+	case AF_TX_IN_FLIGHT:
+		dest->inFlight--;
+		txInFlight--;
+		break;
+	default:
+		break;
+	}
+
+	rpcTimerStop(&entry->timer);
+	dest->lastUse = now;
+	entry->state = AF_TX_FREE;
+	entry->gen++;
+}
+
+/*********************************************************************
+ * @fn      txFeedback
+ *
+ * @brief   size the windows from the completion status. Confirms grow
+ *          the windows by one per window of successful sends. The ZNP
+ *          running out of buffers, or not answering, halves the global
+ *          window and any other error the destination window, at most
+ *          once per window of sends.
+ *
+ * @param   entry - completed send
+ * @param   dest - destination of the send
+ * @param   status - completion status
+ *
+ * @return  -
+ */
+static void txFeedback(afTxEntry_t *entry, afTxDest_t *dest, uint8_t status)
+{
+	switch (status)
+	{
+	case afStatus_SUCCESS:
+		txStats.confirmed++;
+		if (AF_TX_WND(txWindow) < txMaxWindow)
+		{
+			txWindow += 256 / txWindow;
+		}
+		if (AF_TX_WND(dest->window) < txMaxDestWindow)
+		{
+			dest->window += 256 / dest->window;
+		}
+		break;
+
+	case afStatus_MEM_FAIL:
+	case AF_TX_STATUS_NO_SRSP:
+	case AF_TX_STATUS_TIMEOUT:
+		txStats.failed++;
+		if (status == afStatus_MEM_FAIL)
+		{
+			txStats.memFails++;
+		}
+		else if (status == AF_TX_STATUS_TIMEOUT)
+		{
+			txStats.timeouts++;
+		}
+		if ((int32_t) (entry->sendNo - txCutNo) >= 0)
+		{
+			txWindow = (txWindow > (2 << 4)) ? (txWindow / 2) : (1 << 4);
+			txCutNo = txSendNo;
+		}
+		break;
+
+	default:
+		txStats.failed++;
+		if ((int32_t) (entry->sendNo - dest->cutNo) >= 0)
+		{
+			dest->window =
+			        (dest->window > (2 << 4)) ? (dest->window / 2) : (1 << 4);
+			dest->cutNo = txSendNo;
+		}
+		break;
+	}
+}
+
+/*********************************************************************
+ * @fn      txBreaker
+ *
+ * @brief   update the breaker of a destination from a completion
+ *          status. Only delivery failures count, the ZNP running out
+ *          of buffers says nothing about the destination.
+ *
+ * @param   dest - destination of the send
+ * @param   status - completion status
+ *
+ * @return  new breaker state, 0xFF if unchanged
+ */
+static uint8_t txBreaker(afTxDest_t *dest, uint8_t status)
+{
+	// the shared destination stands for many, it is never opened
+	if (dest->shared)
+	{
+		return 0xFF;
+	}
+
+	switch (status)
+	{
+	case afStatus_SUCCESS:
+		dest->failures = 0;
+		if (dest->breaker != AF_TX_BREAKER_CLOSED)
+		{
+			dest->breaker = AF_TX_BREAKER_CLOSED;
+			return AF_TX_BREAKER_CLOSED;
+		}
+		break;
+
+	case afStatus_MEM_FAIL:
+	case AF_TX_STATUS_NO_SRSP:
+	case AF_TX_STATUS_TIMEOUT:
+		break;
+
+	default:
+		if (dest->failures < 0xFF)
+		{
+			dest->failures++;
+		}
+		if ((txPolicy.breakerThreshold != 0)
+		        && ((dest->breaker == AF_TX_BREAKER_HALF_OPEN)
+		                || ((dest->breaker == AF_TX_BREAKER_CLOSED)
+		                        && (dest->failures
+		                                >= txPolicy.breakerThreshold))))
+		{
+			dest->breaker = AF_TX_BREAKER_OPEN;
+			dest->openUntil = rpcTimerNow() + txPolicy.breakerCooldown;
+			txStats.breakerTrips++;
+			dbg_print(PRINT_LEVEL_INFO, "afTx: breaker of %04x open\n",
+			        dest->addr);
+			return AF_TX_BREAKER_OPEN;
+		}
+		break;
+	}
+
+	return 0xFF;
+}
+
+/*********************************************************************
+ * @fn      txDestWindow
+ *
+ * @brief   get the number of sends a destination may have in flight
+ *
+ * @param   dest - destination
+ * @param   now - current time
+ *
+ * @return  window
+ */
+static uint8_t txDestWindow(afTxDest_t *dest, uint64_t now)
+{
+	if (dest->shared)
+	{
+		return 0xFF;
+	}
+
+	switch (dest->breaker)
+	{
+	case AF_TX_BREAKER_OPEN:
+		return (now >= dest->openUntil) ? 1 : 0;
+	case AF_TX_BREAKER_HALF_OPEN:
+		return 1;
+	default:
+		return AF_TX_WND(dest->window);
+	}
+}
+
+/*********************************************************************
+ * @fn      txRetryable
+ *
+ * @brief   check if a send failing with a status is retried
+ *
+ * @param   status - completion status
+ *
+ * @return  1 if retried
+ */
+static uint8_t txRetryable(uint8_t status)
+{
+	switch (status)
+	{
+	case afStatus_MEM_FAIL:
+	case afStatus_NO_ROUTE:
+	case AF_TX_APS_NO_ACK:
+	case AF_TX_MAC_CHANNEL_ACCESS_FAIL:
+	case AF_TX_MAC_NO_ACK:
+	case AF_TX_MAC_TRANSACTION_EXPIRED:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/*********************************************************************
+ * @fn      txRetryDelay
+ *
+ * @brief   get the delay before a retry, the capped exponential delay
+ *          randomised to spread the retries of concurrent sends
+ *
+ * @param   attempts - sends done so far
+ *
+ * @return  delay in ms
+ */
+static uint32_t txRetryDelay(uint8_t attempts)
+{
+	uint32_t delay = txPolicy.baseDelay;
+
+	while ((--attempts > 0) && (delay < txPolicy.maxDelay))
+	{
+		delay *= 2;
+	}
+	if (delay > txPolicy.maxDelay)
+	{
+		delay = txPolicy.maxDelay;
+	}
+
+	return (delay / 2) + (rand() % ((delay / 2) + 1));
+}
+
+/*********************************************************************
+ * @fn      txFindDest
+ *
+ * @brief   find the window of a destination, called with txSem held. A
+ *          new destination reuses an idle one, first one that never
+ *          failed then one whose failures or breaker are over, the
+ *          least recently used of them. Destinations with an open
+ *          breaker are kept until their cooldown is over.
+ *
+ * @param   addr - network address or group ID
+ * @param   group - 1 if addr is a group ID
+ *
+ * @return  index in txDests, AF_TX_MAX_DESTS for the shared destination
+ *          if none can be reused
+ */
+static uint8_t txFindDest(uint16_t addr, uint8_t group)
+{
+	afTxDest_t *dest;
+	uint64_t now = rpcTimerNow();
+	uint8_t idle = AF_TX_MAX_DESTS;
+	uint8_t idleRank = 0xFF;
+	uint8_t rank;
+	uint8_t idx;
+
+	for (idx = 0; idx < AF_TX_MAX_DESTS; idx++)
+	{
+		dest = &txDests[idx];
+		if (dest->used && (dest->addr == addr) && (dest->group == group))
+		{
+			return idx;
+		}
+
+		// rank the reusable destinations by the history they lose
+		if (!dest->used)
+		{
+			rank = 0;
+		}
+		else if ((dest->inFlight != 0) || (dest->queued != 0)
+		        || ((dest->breaker == AF_TX_BREAKER_OPEN)
+		                && (now < dest->openUntil)))
+		{
+			continue;
+		}
+		else if ((dest->failures == 0)
+		        && (dest->breaker == AF_TX_BREAKER_CLOSED))
+		{
+			rank = 1;
+		}
+		else
+		{
+			rank = 2;
+		}
+
+		if ((rank < idleRank)
+		        || ((rank == idleRank) && (rank != 0)
+		                && (dest->lastUse < txDests[idle].lastUse)))
+		{
+			idle = idx;
+			idleRank = rank;
+		}
+	}
+
+	if (idle == AF_TX_MAX_DESTS)
+	{
+		dbg_print(PRINT_LEVEL_INFO,
+		        "afTx: no free destination, %04x not throttled\n", addr);
+		return AF_TX_MAX_DESTS;
+	}
+
+	memset(&txDests[idle], 0, sizeof(afTxDest_t));
+	txDests[idle].used = 1;
+	txDests[idle].addr = addr;
+	txDests[idle].group = group;
+	txDests[idle].window = 1 << 4;
+
+	return idle;
+}
+
+/*********************************************************************
+ * @fn      txTransIdUsed
+ *
+ * @brief   check if a TransID is used by a queued or outstanding send
+ *
+ * @param   endpoint - source endpoint
+ * @param   transId - TransID
+ *
+ * @return  1 if used
+ */
+static uint8_t txTransIdUsed(uint8_t endpoint, uint8_t transId)
+{
+	uint8_t idx;
+
+	for (idx = 0; idx < AF_TX_MAX_ENTRIES; idx++)
+	{
+		if ((txEntries[idx].state != AF_TX_FREE)
+		        && (txEntries[idx].req.SrcEndpoint == endpoint)
+		        && (txEntries[idx].req.TransID == transId))
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
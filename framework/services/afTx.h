@@ -0,0 +1,169 @@
+/*
+ * afTx.h
+ *
+ * This module contains the windowed AF transmit engine of the ZigBee
+ * Network Processor (ZNP) Host Interface, with retransmission and
+ * per-destination circuit breakers.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef AFTX_H
+#define AFTX_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+#include "mtAf.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// number of sends that can be queued or waiting for their confirm
+#define AF_TX_MAX_ENTRIES          (32)
+
+// number of destinations with their own window and breaker, many more
+// than AF_TX_MAX_ENTRIES so that the destinations with an open breaker
+// do not keep a new one out
+#define AF_TX_MAX_DESTS            (128)
+
+// default window limits, the windows grow by one for each window of
+// successful confirms and are halved when the ZNP or the destination
+// is overrun
+#define AF_TX_MAX_WINDOW           (8)
+#define AF_TX_MAX_DEST_WINDOW      (4)
+
+// default time to wait for MT_AF_DATA_CONFIRM
+#define AF_TX_CONFIRM_TIMEOUT_MS   (10000)
+
+// default retry policy, retries are off until afTxSetRetryPolicy()
+#define AF_TX_RETRY_BASE_MS        (100)
+#define AF_TX_RETRY_MAX_MS         (2000)
+#define AF_TX_BREAKER_COOLDOWN_MS  (30000)
+
+// completion status of sends that did not get a confirm, any other
+// value is the status of the MT_AF_DATA_CONFIRM or of the SRSP
+#define AF_TX_STATUS_BREAKER_OPEN  (0xFD)
+#define AF_TX_STATUS_NO_SRSP       (0xFE)
+#define AF_TX_STATUS_TIMEOUT       (0xFF)
+
+// circuit breaker states of a destination
+#define AF_TX_BREAKER_CLOSED       (0)  // sending normally
+#define AF_TX_BREAKER_OPEN         (1)  // sends fail without being sent
+#define AF_TX_BREAKER_HALF_OPEN    (2)  // one send probes the destination
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint8_t status;       // afStatus_xxx or AF_TX_STATUS_xxx
+	uint8_t transId;
+	uint16_t dstAddr;     // network address or group ID
+	uint8_t attempts;     // AF_DATA_REQUESTs sent, 0 if none
+	uint32_t queueTime;   // ms spent waiting for the first send
+	uint32_t latency;     // ms from the last AF_DATA_REQUEST to the confirm
+} afTxResult_t;
+
+// called once for every send accepted by afTxSend()
+typedef void (*afTxDoneCb_t)(afTxResult_t *result, void *arg);
+
+// called when the circuit breaker of a destination changes state
+typedef void (*afTxBreakerCb_t)(uint16_t dstAddr, uint8_t state);
+
+typedef struct
+{
+	uint8_t maxRetries;        // retries after the first send, 0 for none
+	uint32_t baseDelay;        // ms before the first retry
+	uint32_t maxDelay;         // cap of the doubling retry delay
+	uint8_t breakerThreshold;  // consecutive failures opening the
+	                           // breaker, 0 to disable the breakers
+	uint32_t breakerCooldown;  // ms before an open breaker lets a probe
+	                           // through
+} afTxRetryPolicy_t;
+
+typedef struct
+{
+	uint8_t window;
+	uint8_t inFlight;
+	uint8_t queued;       // waiting for the window or a retry
+	uint8_t failures;     // consecutive failures
+	uint8_t breaker;      // AF_TX_BREAKER_xxx
+	uint32_t openTime;    // ms until an open breaker lets a probe through
+} afTxDestStats_t;
+
+typedef struct
+{
+	uint32_t sent;        // AF_DATA_REQUESTs sent to the ZNP
+	uint32_t confirmed;   // sends completed with afStatus_SUCCESS
+	uint32_t failed;      // sends completed with an error status
+	uint32_t timeouts;    // sends completed with AF_TX_STATUS_TIMEOUT
+	uint32_t memFails;    // sends rejected with afStatus_MEM_FAIL
+	uint32_t retries;     // AF_DATA_REQUESTs sent again after a failure
+	uint32_t rejected;    // sends failed by an open breaker
+	uint32_t breakerTrips; // breakers opened
+	uint8_t window;       // current global window
+	uint8_t inFlight;     // sends waiting for their confirm
+	uint8_t queued;       // sends waiting for the window
+	uint8_t backoff;      // sends waiting to be retried
+	uint8_t openBreakers; // destinations with an open breaker
+} afTxStats_t;
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+int32_t afTxInit(void);
+void afTxConfig(uint8_t maxWindow, uint8_t maxDestWindow,
+        uint32_t confirmTimeout);
+void afTxSetRetryPolicy(afTxRetryPolicy_t *policy);
+void afTxSetBreakerCb(afTxBreakerCb_t cb);
+int32_t afTxSend(DataRequestFormat_t *req, afTxDoneCb_t cb, void *arg);
+int32_t afTxSendGroup(DataRequestFormat_t *req, afTxDoneCb_t cb, void *arg);
+int32_t afTxGetDestStats(uint16_t dstAddr, afTxDestStats_t *stats);
+int32_t afTxGetStats(afTxStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFTX_H */
@@ -0,0 +1,1162 @@
+/*
+ * devIntv.c
+ *
+ * This module contains the device interview engine of the ZigBee
+ * Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include <stdio.h>
+#include <semaphore.h>
+
+#include "devIntv.h"
+#include "mtZdo.h"
+#include "rpc.h"
+#include "rpcTimer.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// devIntvSlot_t stage, the requests of an interview in order
+#define DEV_INTV_STAGE_NODE_DESC      (0)
+#define DEV_INTV_STAGE_POWER_DESC     (1)
+#define DEV_INTV_STAGE_ACTIVE_EP      (2)
+#define DEV_INTV_STAGE_SIMPLE_DESC    (3)
+
+// header of the cache file, followed by devIntvDevice_t records. A
+// device interviewed again is appended, the last record wins.
+#define DEV_INTV_FILE_MAGIC           (0x5649445A)
+#define DEV_INTV_FILE_VERSION         (2)
+
+#define DEV_INTV_PATH_LEN             (256)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t recordLen;    // sizeof(devIntvDevice_t) of the writer
+} devIntvFileHdr_t;
+
+typedef struct
+{
+	uint16_t nwkAddr;
+	uint64_t extAddr;
+	devIntvCb_t cb;
+	void *arg;
+} devIntvQueued_t;
+
+typedef struct
+{
+	uint8_t used;
+	uint8_t send;          // a request is due
+	uint8_t stage;         // DEV_INTV_STAGE_xxx
+	uint8_t ep;            // index of the endpoint being described
+	uint8_t attempts;      // requests sent for this stage
+	uint16_t gen;          // incremented for each request
+	uint64_t sent;         // time of the request
+	devIntvCb_t cb;
+	void *arg;
+	rpcTimer_t timer;      // response timeout
+	devIntvDevice_t dev;   // descriptors received so far
+} devIntvSlot_t;
+
+// an interview over, reported outside intvSem
+typedef struct
+{
+	uint8_t status;
+	devIntvCb_t cb;
+	void *arg;
+	devIntvDevice_t dev;
+} devIntvDone_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static devIntvDevice_t intvCache[DEV_INTV_MAX_DEVICES];
+static uint8_t intvCacheUsed[DEV_INTV_MAX_DEVICES];
+static devIntvQueued_t intvQueue[DEV_INTV_MAX_QUEUED];
+static uint16_t intvQueueHead;
+static uint16_t intvQueueCnt;
+static devIntvSlot_t intvSlots[DEV_INTV_MAX_INFLIGHT];
+static devIntvStats_t intvStats;
+
+static uint8_t intvInFlight = DEV_INTV_DEFAULT_INFLIGHT;
+static uint32_t intvTimeout = DEV_INTV_DEFAULT_TIMEOUT;
+static uint8_t intvMaxRetries = DEV_INTV_DEFAULT_RETRIES;
+
+// cache file, empty if the cache is not persisted
+static char intvPath[DEV_INTV_PATH_LEN];
+
+// protects all of the above
+static sem_t intvSem;
+// serialises the requests
+static sem_t intvSendSem;
+// serialises the writes of the cache file
+static sem_t intvFileSem;
+
+static uint8_t intvInitDone = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS DECLARATION
+ */
+
+static uint8_t intvNodeDescRspCb(NodeDescRspFormat_t *msg);
+static uint8_t intvPowerDescRspCb(PowerDescRspFormat_t *msg);
+static uint8_t intvActiveEpRspCb(ActiveEpRspFormat_t *msg);
+static uint8_t intvSimpleDescRspCb(SimpleDescRspFormat_t *msg);
+static void intvTimeoutCb(void *arg);
+static void intvPump(void);
+static devIntvSlot_t *intvFindSlot(uint8_t stage, uint16_t nwkAddr);
+static uint8_t intvAdvance(devIntvSlot_t *slot, devIntvDone_t *done);
+static uint8_t intvFail(devIntvSlot_t *slot, devIntvDone_t *done);
+static void intvFinish(devIntvDone_t *done);
+static int32_t intvFind(uint64_t extAddr);
+static int32_t intvStore(devIntvDevice_t *dev);
+static void intvLoad(void);
+static void intvAppend(devIntvDevice_t *dev);
+static void intvRewrite(void);
+
+static mtZdoCb_t intvZdoCbs =
+	{ .pfnZdoNodeDescRsp = intvNodeDescRspCb,
+	        .pfnZdoPowerDescRsp = intvPowerDescRspCb,
+	        .pfnZdoActiveEpRsp = intvActiveEpRspCb,
+	        .pfnZdoSimpleDescRsp = intvSimpleDescRspCb, };
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      devIntvInit
+ *
+ * @brief   initialise the interview engine, must be called once after
+ *          rpcInitMq(). The devices interviewed before are read from
+ *          the cache file.
+ *
+ * @param   path - cache file, created if it does not exist, NULL if
+ *          the cache is not persisted
+ *
+ * @return  status, -1 if its observer could not be registered
+ */
+int32_t devIntvInit(const char *path)
+{
+	memset(intvCacheUsed, 0, sizeof(intvCacheUsed));
+	memset(intvSlots, 0, sizeof(intvSlots));
+	memset(&intvStats, 0, sizeof(intvStats));
+	intvQueueHead = 0;
+	intvQueueCnt = 0;
+
+	intvPath[0] = '\0';
+	if (path != NULL)
+	{
+		strncpy(intvPath, path, DEV_INTV_PATH_LEN - 1);
+		intvPath[DEV_INTV_PATH_LEN - 1] = '\0';
+	}
+
+	sem_init(&intvSem, 0, 1);
+	sem_init(&intvSendSem, 0, 1);
+	sem_init(&intvFileSem, 0, 1);
+
+	intvLoad();
+
+	if (!intvInitDone)
+	{
+		if (zdoRegisterObserver(&intvZdoCbs) != 0)
+		{
+			dbg_print(PRINT_LEVEL_WARNING,
+			        "devIntvInit: no free observer entry\n");
+			return -1;
+		}
+		intvInitDone = 1;
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      devIntvConfig
+ *
+ * @brief   set the concurrency and the retries of the interviews
+ *
+ * @param   inFlight - devices interviewed at the same time, at most
+ *          DEV_INTV_MAX_INFLIGHT
+ * @param   timeout - time to wait for a response in ms
+ * @param   maxRetries - requests repeated before the interview fails
+ *
+ * @return  -
+ */
+void devIntvConfig(uint8_t inFlight, uint32_t timeout, uint8_t maxRetries)
+{
+	if (inFlight == 0)
+	{
+		inFlight = 1;
+	}
+	if (inFlight > DEV_INTV_MAX_INFLIGHT)
+	{
+		inFlight = DEV_INTV_MAX_INFLIGHT;
+	}
+
+	sem_wait(&intvSem);
+
+	intvInFlight = inFlight;
+	intvTimeout = timeout;
+	intvMaxRetries = maxRetries;
+
+	sem_post(&intvSem);
+
+	intvPump();
+}
+
+/*********************************************************************
+ * @fn      devIntvStart
+ *
+ * @brief   interview a device: its node, power and active endpoint
+ *          descriptors and the simple descriptor of each endpoint. A
+ *          device in the cache, even interviewed partially, is not
+ *          interviewed again until devIntvInvalidate() is called.
+ *
+ * @param   nwkAddr - short address of the device
+ * @param   extAddr - IEEE address of the device, key of the cache
+ * @param   cb - called once the interview is over if DEV_INTV_PENDING
+ *          is returned
+ * @param   arg - passed to cb
+ *
+ * @return  DEV_INTV_CACHED, the descriptors can be read with
+ *          devIntvGet(), DEV_INTV_PENDING, or -1 if the device is
+ *          already being interviewed or the queue is full
+ */
+int32_t devIntvStart(uint16_t nwkAddr, uint64_t extAddr, devIntvCb_t cb,
+        void *arg)
+{
+	devIntvQueued_t *queued;
+	uint16_t idx;
+
+	if (!intvInitDone)
+	{
+		return -1;
+	}
+
+	sem_wait(&intvSem);
+
+	if (intvFind(extAddr) >= 0)
+	{
+		intvStats.cached++;
+		sem_post(&intvSem);
+		return DEV_INTV_CACHED;
+	}
+
+	for (idx = 0; idx < DEV_INTV_MAX_INFLIGHT; idx++)
+	{
+		if (intvSlots[idx].used && (intvSlots[idx].dev.extAddr == extAddr))
+		{
+			sem_post(&intvSem);
+			return -1;
+		}
+	}
+	for (idx = 0; idx < intvQueueCnt; idx++)
+	{
+		if (intvQueue[(intvQueueHead + idx) % DEV_INTV_MAX_QUEUED].extAddr
+		        == extAddr)
+		{
+			sem_post(&intvSem);
+			return -1;
+		}
+	}
+
+	if (intvQueueCnt == DEV_INTV_MAX_QUEUED)
+	{
+		intvStats.dropped++;
+		sem_post(&intvSem);
+		return -1;
+	}
+
+	queued = &intvQueue[(intvQueueHead + intvQueueCnt++) % DEV_INTV_MAX_QUEUED];
+	queued->nwkAddr = nwkAddr;
+	queued->extAddr = extAddr;
+	queued->cb = cb;
+	queued->arg = arg;
+
+	sem_post(&intvSem);
+
+	intvPump();
+
+	return DEV_INTV_PENDING;
+}
+
+/*********************************************************************
+ * @fn      devIntvGet
+ *
+ * @brief   get the descriptors of a device from the cache. The device
+ *          was interviewed partially if dev->numEndpoints is lower than
+ *          dev->activeEndpoints.
+ *
+ * @param   extAddr - IEEE address of the device
+ * @param   dev - filled in with the descriptors
+ *
+ * @return  status, -1 if the device is not in the cache
+ */
+int32_t devIntvGet(uint64_t extAddr, devIntvDevice_t *dev)
+{
+	int32_t idx;
+
+	sem_wait(&intvSem);
+
+	idx = intvFind(extAddr);
+	if (idx >= 0)
+	{
+		memcpy(dev, &intvCache[idx], sizeof(devIntvDevice_t));
+	}
+
+	sem_post(&intvSem);
+
+	return (idx >= 0) ? 0 : -1;
+}
+
+/*********************************************************************
+ * @fn      devIntvInvalidate
+ *
+ * @brief   remove a device from the cache, and from the cache file, so
+ *          that devIntvStart() interviews it again
+ *
+ * @param   extAddr - IEEE address of the device
+ *
+ * @return  status, -1 if the device is not in the cache
+ */
+int32_t devIntvInvalidate(uint64_t extAddr)
+{
+	int32_t idx;
+
+	sem_wait(&intvSem);
+
+	idx = intvFind(extAddr);
+	if (idx >= 0)
+	{
+		intvCacheUsed[idx] = 0;
+		intvStats.devices--;
+	}
+
+	sem_post(&intvSem);
+
+	if (idx < 0)
+	{
+		return -1;
+	}
+
+	if (intvPath[0] != '\0')
+	{
+		intvRewrite();
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      devIntvGetStats
+ *
+ * @brief   get the interview engine counters
+ *
+ * @param   stats - filled in with the counters
+ *
+ * @return  -
+ */
+void devIntvGetStats(devIntvStats_t *stats)
+{
+	sem_wait(&intvSem);
+
+	memcpy(stats, &intvStats, sizeof(devIntvStats_t));
+
+	sem_post(&intvSem);
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      intvNodeDescRspCb
+ *
+ * @brief   MT_ZDO_NODE_DESC_RSP observer
+ *
+ * @param   msg - response
+ *
+ * @return  1 if the response belongs to an interview
+ */
+static uint8_t intvNodeDescRspCb(NodeDescRspFormat_t *msg)
+{
+	devIntvSlot_t *slot;
+	devIntvDone_t done;
+	uint8_t finished;
+
+	sem_wait(&intvSem);
+
+	slot = intvFindSlot(DEV_INTV_STAGE_NODE_DESC, msg->NwkAddr);
+	if (slot == NULL)
+	{
+		sem_post(&intvSem);
+		return 0;
+	}
+
+	rpcTimerStop(&slot->timer);
+
+	if (msg->Status == MT_RPC_SUCCESS)
+	{
+		memcpy(&slot->dev.nodeDesc, msg, sizeof(NodeDescRspFormat_t));
+		finished = intvAdvance(slot, &done);
+	}
+	else
+	{
+		finished = intvFail(slot, &done);
+	}
+
+	sem_post(&intvSem);
+
+	if (finished)
+	{
+		intvFinish(&done);
+	}
+	intvPump();
+
+	return 1;
+}
+
+/*********************************************************************
+ * @fn      intvPowerDescRspCb
+ *
+ * @brief   MT_ZDO_POWER_DESC_RSP observer
+ *
+ * @param   msg - response
+ *
+ * @return  1 if the response belongs to an interview
+ */
+static uint8_t intvPowerDescRspCb(PowerDescRspFormat_t *msg)
+{
+	devIntvSlot_t *slot;
+	devIntvDone_t done;
+	uint8_t finished;
+
+	sem_wait(&intvSem);
+
+	slot = intvFindSlot(DEV_INTV_STAGE_POWER_DESC, msg->NwkAddr);
+	if (slot == NULL)
+	{
+		sem_post(&intvSem);
+		return 0;
+	}
+
+	rpcTimerStop(&slot->timer);
+
+	if (msg->Status == MT_RPC_SUCCESS)
+	{
+		memcpy(&slot->dev.powerDesc, msg, sizeof(PowerDescRspFormat_t));
+		finished = intvAdvance(slot, &done);
+	}
+	else
+	{
+		finished = intvFail(slot, &done);
+	}
+
+	sem_post(&intvSem);
+
+	if (finished)
+	{
+		intvFinish(&done);
+	}
+	intvPump();
+
+	return 1;
+}
+
+/*********************************************************************
+ * @fn      intvActiveEpRspCb
+ *
+ * @brief   MT_ZDO_ACTIVE_EP_RSP observer
+ *
+ * @param   msg - response
+ *
+ * @return  1 if the response belongs to an interview
+ */
+static uint8_t intvActiveEpRspCb(ActiveEpRspFormat_t *msg)
+{
+	devIntvSlot_t *slot;
+	devIntvDone_t done;
+	uint8_t finished, idx;
+
+	sem_wait(&intvSem);
+
+	slot = intvFindSlot(DEV_INTV_STAGE_ACTIVE_EP, msg->NwkAddr);
+	if (slot == NULL)
+	{
+		sem_post(&intvSem);
+		return 0;
+	}
+
+	rpcTimerStop(&slot->timer);
+
+	if (msg->Status == MT_RPC_SUCCESS)
+	{
+		slot->dev.activeEndpoints = msg->ActiveEPCount;
+		slot->dev.numEndpoints = msg->ActiveEPCount;
+		if (slot->dev.numEndpoints > DEV_INTV_MAX_ENDPOINTS)
+		{
+			dbg_print(PRINT_LEVEL_WARNING,
+			        "devIntv: 0x%04X has %d endpoints, %d recorded\n",
+			        msg->NwkAddr, msg->ActiveEPCount, DEV_INTV_MAX_ENDPOINTS);
+			slot->dev.numEndpoints = DEV_INTV_MAX_ENDPOINTS;
+		}
+		// the simple descriptor requests take the endpoints from here
+		for (idx = 0; idx < slot->dev.numEndpoints; idx++)
+		{
+			slot->dev.endpoints[idx].Endpoint = msg->ActiveEPList[idx];
+		}
+		finished = intvAdvance(slot, &done);
+	}
+	else
+	{
+		finished = intvFail(slot, &done);
+	}
+
+	sem_post(&intvSem);
+
+	if (finished)
+	{
+		intvFinish(&done);
+	}
+	intvPump();
+
+	return 1;
+}
+
+/*********************************************************************
+ * @fn      intvSimpleDescRspCb
+ *
+ * @brief   MT_ZDO_SIMPLE_DESC_RSP observer
+ *
+ * @param   msg - response
+ *
+ * @return  1 if the response belongs to an interview
+ */
+static uint8_t intvSimpleDescRspCb(SimpleDescRspFormat_t *msg)
+{
+	devIntvSlot_t *slot;
+	devIntvDone_t done;
+	uint8_t finished;
+
+	sem_wait(&intvSem);
+
+	slot = intvFindSlot(DEV_INTV_STAGE_SIMPLE_DESC, msg->NwkAddr);
+	if ((slot == NULL) || ((msg->Status == MT_RPC_SUCCESS)
+	        && (msg->Endpoint != slot->dev.endpoints[slot->ep].Endpoint)))
+	{
+		sem_post(&intvSem);
+		return 0;
+	}
+
+	rpcTimerStop(&slot->timer);
+
+	if (msg->Status == MT_RPC_SUCCESS)
+	{
+		memcpy(&slot->dev.endpoints[slot->ep], msg,
+		        sizeof(SimpleDescRspFormat_t));
+		finished = intvAdvance(slot, &done);
+	}
+	else
+	{
+		finished = intvFail(slot, &done);
+	}
+
+	sem_post(&intvSem);
+
+	if (finished)
+	{
+		intvFinish(&done);
+	}
+	intvPump();
+
+	return 1;
+}
+
+/*********************************************************************
+ * @fn      intvTimeoutCb
+ *
+ * @brief   response timeout of a request
+ *
+ * @param   arg - slot
+ *
+ * @return  -
+ */
+static void intvTimeoutCb(void *arg)
+{
+	devIntvSlot_t *slot = (devIntvSlot_t *) arg;
+	devIntvDone_t done;
+	uint8_t expired, finished = 0;
+
+	sem_wait(&intvSem);
+
+	// the response may have arrived while the timer callback was being
+	// called
+	expired = slot->used && !slot->send
+	        && (rpcTimerNow() >= (slot->sent + intvTimeout));
+	if (expired)
+	{
+		dbg_print(PRINT_LEVEL_INFO,
+		        "devIntv: no response from 0x%04X at stage %d\n",
+		        slot->dev.nwkAddr, slot->stage);
+		finished = intvFail(slot, &done);
+	}
+
+	sem_post(&intvSem);
+
+	if (finished)
+	{
+		intvFinish(&done);
+	}
+	if (expired)
+	{
+		intvPump();
+	}
+}
+
+/*********************************************************************
+ * @fn      intvPump
+ *
+ * @brief   send the requests that are due and start interviewing queued
+ *          devices while slots are free
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+static void intvPump(void)
+{
+	devIntvSlot_t *slot;
+	devIntvQueued_t *queued;
+	devIntvDone_t done;
+	uint16_t nwkAddr, gen;
+	uint8_t idx, stage, endpoint, status, finished;
+
+	while (1)
+	{
+		sem_wait(&intvSem);
+
+		slot = NULL;
+		for (idx = 0; idx < DEV_INTV_MAX_INFLIGHT; idx++)
+		{
+			if (intvSlots[idx].used && intvSlots[idx].send)
+			{
+				slot = &intvSlots[idx];
+				break;
+			}
+		}
+
+		for (idx = 0; (idx < intvInFlight) && (slot == NULL)
+		        && (intvQueueCnt > 0); idx++)
+		{
+			if (!intvSlots[idx].used)
+			{
+				queued = &intvQueue[intvQueueHead];
+				intvQueueHead = (intvQueueHead + 1) % DEV_INTV_MAX_QUEUED;
+				intvQueueCnt--;
+
+				slot = &intvSlots[idx];
+				memset(&slot->dev, 0, sizeof(devIntvDevice_t));
+				slot->dev.extAddr = queued->extAddr;
+				slot->dev.nwkAddr = queued->nwkAddr;
+				slot->cb = queued->cb;
+				slot->arg = queued->arg;
+				slot->stage = DEV_INTV_STAGE_NODE_DESC;
+				slot->ep = 0;
+				slot->attempts = 0;
+				slot->send = 1;
+				slot->used = 1;
+			}
+		}
+
+		if (slot == NULL)
+		{
+			sem_post(&intvSem);
+			break;
+		}
+
+		slot->send = 0;
+		slot->attempts++;
+		slot->gen++;
+		slot->sent = rpcTimerNow();
+		gen = slot->gen;
+		stage = slot->stage;
+		nwkAddr = slot->dev.nwkAddr;
+		endpoint = slot->dev.endpoints[slot->ep].Endpoint;
+		intvStats.requests++;
+		if (slot->attempts > 1)
+		{
+			intvStats.retries++;
+		}
+		rpcTimerStart(&slot->timer, intvTimeout, 0, intvTimeoutCb, slot);
+
+		sem_post(&intvSem);
+
+		sem_wait(&intvSendSem);
+		switch (stage)
+		{
+		case DEV_INTV_STAGE_NODE_DESC:
+		{
+			NodeDescReqFormat_t req;
+			req.DstAddr = nwkAddr;
+			req.NwkAddrOfInterest = nwkAddr;
+			status = zdoNodeDescReq(&req);
+			break;
+		}
+		case DEV_INTV_STAGE_POWER_DESC:
+		{
+			PowerDescReqFormat_t req;
+			req.DstAddr = nwkAddr;
+			req.NwkAddrOfInterest = nwkAddr;
+			status = zdoPowerDescReq(&req);
+			break;
+		}
+		case DEV_INTV_STAGE_ACTIVE_EP:
+		{
+			ActiveEpReqFormat_t req;
+			req.DstAddr = nwkAddr;
+			req.NwkAddrOfInterest = nwkAddr;
+			status = zdoActiveEpReq(&req);
+			break;
+		}
+		default:
+		{
+			SimpleDescReqFormat_t req;
+			req.DstAddr = nwkAddr;
+			req.NwkAddrOfInterest = nwkAddr;
+			req.Endpoint = endpoint;
+			status = zdoSimpleDescReq(&req);
+			break;
+		}
+		}
+		sem_post(&intvSendSem);
+
+		if (status != MT_RPC_SUCCESS)
+		{
+			finished = 0;
+
+			sem_wait(&intvSem);
+			if (slot->used && !slot->send && (slot->gen == gen))
+			{
+				rpcTimerStop(&slot->timer);
+				finished = intvFail(slot, &done);
+			}
+			sem_post(&intvSem);
+
+			if (finished)
+			{
+				intvFinish(&done);
+			}
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      intvFindSlot
+ *
+ * @brief   find the interview waiting for a response, called with
+ *          intvSem held
+ *
+ * @param   stage - DEV_INTV_STAGE_xxx of the response
+ * @param   nwkAddr - NwkAddrOfInterest of the response
+ *
+ * @return  the slot, NULL if the response is not for an interview
+ */
+static devIntvSlot_t *intvFindSlot(uint8_t stage, uint16_t nwkAddr)
+{
+	uint8_t idx;
+
+	for (idx = 0; idx < DEV_INTV_MAX_INFLIGHT; idx++)
+	{
+		if (intvSlots[idx].used && !intvSlots[idx].send
+		        && (intvSlots[idx].stage == stage)
+		        && (intvSlots[idx].dev.nwkAddr == nwkAddr))
+		{
+			return &intvSlots[idx];
+		}
+	}
+
+	return NULL;
+}
+
+/*********************************************************************
+ * @fn      intvAdvance
+ *
+ * @brief   move an interview to its next request, or end it once every
+ *          endpoint is described, called with intvSem held
+ *
+ * @param   slot - the interview
+ * @param   done - filled in if the interview is over
+ *
+ * @return  1 if the interview is over
+ */
+static uint8_t intvAdvance(devIntvSlot_t *slot, devIntvDone_t *done)
+{
+	if (slot->stage == DEV_INTV_STAGE_SIMPLE_DESC)
+	{
+		slot->ep++;
+	}
+	else
+	{
+		slot->stage++;
+	}
+
+	if ((slot->stage < DEV_INTV_STAGE_SIMPLE_DESC)
+	        || (slot->ep < slot->dev.numEndpoints))
+	{
+		slot->attempts = 0;
+		slot->send = 1;
+		return 0;
+	}
+
+	slot->used = 0;
+	intvStats.interviews++;
+	if (intvStore(&slot->dev) < 0)
+	{
+		intvStats.dropped++;
+	}
+
+	if (slot->dev.numEndpoints < slot->dev.activeEndpoints)
+	{
+		intvStats.partial++;
+		done->status = DEV_INTV_PARTIAL;
+	}
+	else
+	{
+		done->status = DEV_INTV_SUCCESS;
+	}
+	done->cb = slot->cb;
+	done->arg = slot->arg;
+	memcpy(&done->dev, &slot->dev, sizeof(devIntvDevice_t));
+
+	return 1;
+}
+
+/*********************************************************************
+ * @fn      intvFail
+ *
+ * @brief   repeat a request that failed or give the interview up,
+ *          called with intvSem held
+ *
+ * @param   slot - the interview
+ * @param   done - filled in if the interview is given up
+ *
+ * @return  1 if the interview is given up
+ */
+static uint8_t intvFail(devIntvSlot_t *slot, devIntvDone_t *done)
+{
+	if (slot->attempts <= intvMaxRetries)
+	{
+		slot->send = 1;
+		return 0;
+	}
+
+	slot->used = 0;
+	intvStats.failed++;
+
+	done->status = DEV_INTV_FAILED;
+	done->cb = slot->cb;
+	done->arg = slot->arg;
+	memcpy(&done->dev, &slot->dev, sizeof(devIntvDevice_t));
+
+	return 1;
+}
+
+/*********************************************************************
+ * @fn      intvFinish
+ *
+ * @brief   persist the descriptors of an interview and report it
+ *
+ * @param   done - the interview
+ *
+ * @return  -
+ */
+static void intvFinish(devIntvDone_t *done)
+{
+	if (done->status != DEV_INTV_FAILED)
+	{
+		dbg_print(PRINT_LEVEL_INFO,
+		        "devIntv: 0x%04X interviewed, %d of %d endpoints\n",
+		        done->dev.nwkAddr, done->dev.numEndpoints,
+		        done->dev.activeEndpoints);
+		intvAppend(&done->dev);
+	}
+	else
+	{
+		dbg_print(PRINT_LEVEL_WARNING, "devIntv: 0x%04X interview failed\n",
+		        done->dev.nwkAddr);
+	}
+
+	if (done->cb != NULL)
+	{
+		done->cb(done->status, done->dev.extAddr,
+		        (done->status != DEV_INTV_FAILED) ? &done->dev : NULL,
+		        done->arg);
+	}
+}
+
+/*********************************************************************
+ * @fn      intvFind
+ *
+ * @brief   find a device in the cache, called with intvSem held
+ *
+ * @param   extAddr - IEEE address
+ *
+ * @return  index in intvCache, -1 if the device is not cached
+ */
+static int32_t intvFind(uint64_t extAddr)
+{
+	uint16_t idx;
+
+	for (idx = 0; idx < DEV_INTV_MAX_DEVICES; idx++)
+	{
+		if (intvCacheUsed[idx] && (intvCache[idx].extAddr == extAddr))
+		{
+			return idx;
+		}
+	}
+
+	return -1;
+}
+
+/*********************************************************************
+ * @fn      intvStore
+ *
+ * @brief   add or replace a device in the cache, called with intvSem
+ *          held
+ *
+ * @param   dev - descriptors of the device
+ *
+ * @return  index in intvCache, -1 if the cache is full
+ */
+static int32_t intvStore(devIntvDevice_t *dev)
+{
+	int32_t idx = intvFind(dev->extAddr);
+
+	if (idx < 0)
+	{
+		for (idx = 0; idx < DEV_INTV_MAX_DEVICES; idx++)
+		{
+			if (!intvCacheUsed[idx])
+			{
+				break;
+			}
+		}
+		if (idx == DEV_INTV_MAX_DEVICES)
+		{
+			return -1;
+		}
+		intvCacheUsed[idx] = 1;
+		intvStats.devices++;
+	}
+
+	memcpy(&intvCache[idx], dev, sizeof(devIntvDevice_t));
+
+	return idx;
+}
+
+/*********************************************************************
+ * @fn      intvLoad
+ *
+ * @brief   read the cache file. A file written by another version is
+ *          ignored, one holding devices interviewed more than once is
+ *          compacted.
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+static void intvLoad(void)
+{
+	devIntvFileHdr_t hdr;
+	devIntvDevice_t dev;
+	uint32_t records = 0;
+	FILE *file;
+
+	if (intvPath[0] == '\0')
+	{
+		return;
+	}
+
+	file = fopen(intvPath, "rb");
+	if (file == NULL)
+	{
+		return;
+	}
+
+	if ((fread(&hdr, sizeof(hdr), 1, file) != 1)
+	        || (hdr.magic != DEV_INTV_FILE_MAGIC)
+	        || (hdr.version != DEV_INTV_FILE_VERSION)
+	        || (hdr.recordLen != sizeof(devIntvDevice_t)))
+	{
+		dbg_print(PRINT_LEVEL_WARNING, "devIntv: %s is not a cache file\n",
+		        intvPath);
+		fclose(file);
+		return;
+	}
+
+	while (fread(&dev, sizeof(dev), 1, file) == 1)
+	{
+		records++;
+		if (intvStore(&dev) < 0)
+		{
+			intvStats.dropped++;
+		}
+	}
+	fclose(file);
+
+	intvStats.loaded = intvStats.devices;
+
+	dbg_print(PRINT_LEVEL_INFO, "devIntv: %d devices read from %s\n",
+	        intvStats.devices, intvPath);
+
+	if (records > intvStats.devices)
+	{
+		intvRewrite();
+	}
+}
+
+/*********************************************************************
+ * @fn      intvAppend
+ *
+ * @brief   append the descriptors of a device to the cache file
+ *
+ * @param   dev - descriptors of the device
+ *
+ * @return  -
+ */
+static void intvAppend(devIntvDevice_t *dev)
+{
+	devIntvFileHdr_t hdr;
+	FILE *file;
+
+	if (intvPath[0] == '\0')
+	{
+		return;
+	}
+
+	sem_wait(&intvFileSem);
+
+	file = fopen(intvPath, "ab");
+	if (file != NULL)
+	{
+		if (ftell(file) == 0)
+		{
+			hdr.magic = DEV_INTV_FILE_MAGIC;
+			hdr.version = DEV_INTV_FILE_VERSION;
+			hdr.recordLen = sizeof(devIntvDevice_t);
+			fwrite(&hdr, sizeof(hdr), 1, file);
+		}
+		if (fwrite(dev, sizeof(devIntvDevice_t), 1, file) != 1)
+		{
+			dbg_print(PRINT_LEVEL_WARNING, "devIntv: could not write %s\n",
+			        intvPath);
+		}
+		fclose(file);
+	}
+	else
+	{
+		dbg_print(PRINT_LEVEL_WARNING, "devIntv: could not open %s\n",
+		        intvPath);
+	}
+
+	sem_post(&intvFileSem);
+}
+
+/*********************************************************************
+ * @fn      intvRewrite
+ *
+ * @brief   write the cache file again with one record per device, to a
+ *          temporary file renamed over the old one
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+static void intvRewrite(void)
+{
+	char tmpPath[DEV_INTV_PATH_LEN + 4];
+	devIntvFileHdr_t hdr;
+	FILE *file;
+	uint16_t idx;
+	uint8_t ok;
+
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", intvPath);
+
+	sem_wait(&intvFileSem);
+
+	file = fopen(tmpPath, "wb");
+	if (file != NULL)
+	{
+		hdr.magic = DEV_INTV_FILE_MAGIC;
+		hdr.version = DEV_INTV_FILE_VERSION;
+		hdr.recordLen = sizeof(devIntvDevice_t);
+		ok = (fwrite(&hdr, sizeof(hdr), 1, file) == 1);
+
+		sem_wait(&intvSem);
+		for (idx = 0; (idx < DEV_INTV_MAX_DEVICES) && ok; idx++)
+		{
+			if (intvCacheUsed[idx])
+			{
+				ok = (fwrite(&intvCache[idx], sizeof(devIntvDevice_t), 1,
+				        file) == 1);
+			}
+		}
+		sem_post(&intvSem);
+
+		if ((fclose(file) == 0) && ok)
+		{
+			rename(tmpPath, intvPath);
+		}
+		else
+		{
+			remove(tmpPath);
+		}
+	}
+
+	sem_post(&intvFileSem);
+}
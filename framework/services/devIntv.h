@@ -0,0 +1,135 @@
+/*
+ * devIntv.h
+ *
+ * This module contains the device interview engine of the ZigBee
+ * Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef DEVINTV_H
+#define DEVINTV_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+#include "mtZdo.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// devices kept in the descriptor cache
+#define DEV_INTV_MAX_DEVICES          (256)
+
+// endpoints described per device, the interview of a device with more
+// is DEV_INTV_PARTIAL
+#define DEV_INTV_MAX_ENDPOINTS        (8)
+
+// devices waiting for an interview
+#define DEV_INTV_MAX_QUEUED           (256)
+
+// devices interviewed at the same time, each with one request in flight
+#define DEV_INTV_MAX_INFLIGHT         (16)
+
+// defaults of devIntvConfig()
+#define DEV_INTV_DEFAULT_INFLIGHT     (4)
+#define DEV_INTV_DEFAULT_TIMEOUT      (5000)
+#define DEV_INTV_DEFAULT_RETRIES      (2)
+
+// return of devIntvStart()
+#define DEV_INTV_CACHED               (0)
+#define DEV_INTV_PENDING              (1)
+
+// status of devIntvCb_t
+#define DEV_INTV_SUCCESS              (0)
+#define DEV_INTV_FAILED               (1)
+#define DEV_INTV_PARTIAL              (2)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// the descriptors as received, written as is to the cache file
+typedef struct
+{
+	uint64_t extAddr;
+	uint16_t nwkAddr;      // at the time of the interview
+	NodeDescRspFormat_t nodeDesc;
+	PowerDescRspFormat_t powerDesc;
+	uint8_t activeEndpoints; // reported by the device
+	uint8_t numEndpoints;  // described, fewer than activeEndpoints if partial
+	SimpleDescRspFormat_t endpoints[DEV_INTV_MAX_ENDPOINTS];
+} devIntvDevice_t;
+
+typedef struct
+{
+	uint16_t devices;      // in the cache
+	uint16_t loaded;       // read from the cache file
+	uint32_t cached;       // interviews answered from the cache
+	uint32_t interviews;   // completed
+	uint32_t partial;      // completed with endpoints not described
+	uint32_t failed;
+	uint32_t requests;
+	uint32_t retries;
+	uint32_t dropped;      // interviews not queued or not cached
+} devIntvStats_t;
+
+// dev is NULL if status is DEV_INTV_FAILED
+typedef void (*devIntvCb_t)(uint8_t status, uint64_t extAddr,
+        devIntvDevice_t *dev, void *arg);
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+int32_t devIntvInit(const char *path);
+void devIntvConfig(uint8_t inFlight, uint32_t timeout, uint8_t maxRetries);
+int32_t devIntvStart(uint16_t nwkAddr, uint64_t extAddr, devIntvCb_t cb,
+        void *arg);
+int32_t devIntvGet(uint64_t extAddr, devIntvDevice_t *dev);
+int32_t devIntvInvalidate(uint64_t extAddr);
+void devIntvGetStats(devIntvStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEVINTV_H */
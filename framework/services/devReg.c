@@ -0,0 +1,700 @@
+/*
+ * devReg.c
+ *
+ * This module contains the device registry of the ZigBee Network
+ * Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include <semaphore.h>
+
+#include "devReg.h"
+#include "hashIdx.h"
+#include "mtZdo.h"
+#include "mtAf.h"
+#include "mtSys.h"
+#include "rpc.h"
+#include "rpcTimer.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define DEV_REG_NONE               HASH_IDX_NONE
+
+// Capabilities of ZDO_END_DEVICE_ANNCE_IND
+#define DEV_REG_CAP_ROUTER         (0x02)
+
+// events a single update can cause
+#define DEV_REG_MAX_EVENTS         (3)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint8_t event;
+	uint16_t idx;
+	uint16_t oldNwkAddr;
+	devRegDevice_t dev;
+} devRegEvent_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static devRegDevice_t regDevices[DEV_REG_MAX_DEVICES];
+static uint8_t regUsed[DEV_REG_MAX_DEVICES];
+static hashIdxSlot_t regNwkSlots[DEV_REG_HASH_SIZE];
+static hashIdxSlot_t regExtSlots[DEV_REG_HASH_SIZE];
+static hashIdx_t regNwkHash;
+static hashIdx_t regExtHash;
+static devRegStats_t regStats;
+static devRegCb_t regCb = NULL;
+
+// protects all of the above
+static sem_t regSem;
+
+static uint8_t regInitDone = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS DECLARATION
+ */
+
+static uint8_t regEndDeviceAnnceIndCb(EndDeviceAnnceIndFormat_t *msg);
+static uint8_t regNwkAddrRspCb(NwkAddrRspFormat_t *msg);
+static uint8_t regIeeeAddrRspCb(IeeeAddrRspFormat_t *msg);
+static uint8_t regLeaveIndCb(LeaveIndFormat_t *msg);
+static uint8_t regIncomingMsgCb(IncomingMsgFormat_t *msg);
+static uint8_t regIncomingMsgExtCb(IncomingMsgExtFormat_t *msg);
+static int32_t regLearn(uint16_t nwkAddr, uint64_t extAddr, uint8_t devType,
+        uint8_t lqi, uint8_t seen);
+static uint8_t regRemove(uint16_t idx, devRegEvent_t *events, uint8_t cnt);
+static uint8_t regEvent(uint8_t event, uint16_t idx, uint16_t oldNwkAddr,
+        devRegEvent_t *events, uint8_t cnt);
+static void regEmit(devRegEvent_t *events, uint8_t cnt);
+static uint16_t regNwkFind(uint16_t nwkAddr);
+static uint16_t regExtFind(uint64_t extAddr);
+
+static mtZdoCb_t regZdoCbs =
+	{ .pfnZdoNwkAddrRsp = regNwkAddrRspCb,
+	        .pfnZdoIeeeAddrRsp = regIeeeAddrRspCb,
+	        .pfnZdoEndDeviceAnnceInd = regEndDeviceAnnceIndCb,
+	        .pfnZdoLeaveInd = regLeaveIndCb, };
+
+static mtAfCb_t regAfCbs =
+	{ NULL,			//MT_AF_DATA_CONFIRM
+	        regIncomingMsgCb,	//MT_AF_INCOMING_MSG
+	        regIncomingMsgExtCb,	//MT_AF_INCOMING_MSG_EXT
+	        NULL,			//MT_AF_DATA_RETRIEVE
+	        NULL,			//MT_AF_REFLECT_ERROR
+	    };
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      devRegInit
+ *
+ * @brief   initialise the device registry, must be called once after
+ *          rpcInitMq(). Devices are then registered from announcements,
+ *          address responses and incoming messages, before the
+ *          application callbacks are called.
+ *
+ * @param   cb - called when a device is added, removed or changes its
+ *          short address, may be NULL
+ *
+ * @return  status, -1 if its observers could not be registered
+ */
+int32_t devRegInit(devRegCb_t cb)
+{
+	memset(regUsed, 0, sizeof(regUsed));
+	hashIdxInit(&regNwkHash, regNwkSlots, DEV_REG_HASH_SIZE);
+	hashIdxInit(&regExtHash, regExtSlots, DEV_REG_HASH_SIZE);
+	memset(&regStats, 0, sizeof(regStats));
+	regCb = cb;
+
+	sem_init(&regSem, 0, 1);
+
+	if (!regInitDone)
+	{
+		if ((zdoRegisterObserver(&regZdoCbs) != 0)
+		        || (afRegisterObserver(&regAfCbs) != 0))
+		{
+			dbg_print(PRINT_LEVEL_WARNING,
+			        "devRegInit: no free observer entry\n");
+			return -1;
+		}
+		regInitDone = 1;
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      devRegAdd
+ *
+ * @brief   register a device or complete its addresses. A device known
+ *          by its IEEE address takes over a new short address.
+ *
+ * @param   nwkAddr - short address, DEV_REG_NWK_UNKNOWN if not known
+ * @param   extAddr - IEEE address, 0 if not known
+ *
+ * @return  index of the device, -1 if the registry is full
+ */
+int32_t devRegAdd(uint16_t nwkAddr, uint64_t extAddr)
+{
+	return regLearn(nwkAddr, extAddr, DEV_REG_TYPE_UNKNOWN, 0, 0);
+}
+
+/*********************************************************************
+ * @fn      devRegFindNwk
+ *
+ * @brief   find a device by its short address
+ *
+ * @param   nwkAddr - short address
+ *
+ * @return  index of the device, -1 if it is not registered
+ */
+int32_t devRegFindNwk(uint16_t nwkAddr)
+{
+	uint16_t idx;
+
+	sem_wait(&regSem);
+
+	regStats.lookups++;
+	idx = regNwkFind(nwkAddr);
+
+	sem_post(&regSem);
+
+	return (idx == DEV_REG_NONE) ? -1 : idx;
+}
+
+/*********************************************************************
+ * @fn      devRegFindExt
+ *
+ * @brief   find a device by its IEEE address
+ *
+ * @param   extAddr - IEEE address
+ *
+ * @return  index of the device, -1 if it is not registered
+ */
+int32_t devRegFindExt(uint64_t extAddr)
+{
+	uint16_t idx;
+
+	sem_wait(&regSem);
+
+	regStats.lookups++;
+	idx = regExtFind(extAddr);
+
+	sem_post(&regSem);
+
+	return (idx == DEV_REG_NONE) ? -1 : idx;
+}
+
+/*********************************************************************
+ * @fn      devRegGet
+ *
+ * @brief   get a registered device
+ *
+ * @param   idx - index of the device
+ * @param   dev - filled in with the device
+ *
+ * @return  status, -1 if no device is registered at idx
+ */
+int32_t devRegGet(uint16_t idx, devRegDevice_t *dev)
+{
+	int32_t status = -1;
+
+	sem_wait(&regSem);
+
+	if ((idx < DEV_REG_MAX_DEVICES) && regUsed[idx])
+	{
+		memcpy(dev, &regDevices[idx], sizeof(devRegDevice_t));
+		status = 0;
+	}
+
+	sem_post(&regSem);
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      devRegRemove
+ *
+ * @brief   remove a device, its index may then be given to another one
+ *
+ * @param   idx - index of the device
+ *
+ * @return  status, -1 if no device is registered at idx
+ */
+int32_t devRegRemove(uint16_t idx)
+{
+	devRegEvent_t events[DEV_REG_MAX_EVENTS];
+	uint8_t cnt = 0;
+
+	sem_wait(&regSem);
+
+	if ((idx < DEV_REG_MAX_DEVICES) && regUsed[idx])
+	{
+		cnt = regRemove(idx, events, cnt);
+	}
+
+	sem_post(&regSem);
+
+	regEmit(events, cnt);
+
+	return cnt ? 0 : -1;
+}
+
+/*********************************************************************
+ * @fn      devRegGetStats
+ *
+ * @brief   get the device registry counters
+ *
+ * @param   stats - filled in with the counters
+ *
+ * @return  -
+ */
+void devRegGetStats(devRegStats_t *stats)
+{
+	sem_wait(&regSem);
+
+	regStats.probes = regNwkHash.probes + regExtHash.probes;
+	memcpy(stats, &regStats, sizeof(devRegStats_t));
+
+	sem_post(&regSem);
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      regEndDeviceAnnceIndCb
+ *
+ * @brief   MT_ZDO_END_DEVICE_ANNCE_IND observer
+ *
+ * @param   msg - announcement
+ *
+ * @return  0, the application still gets the indication
+ */
+static uint8_t regEndDeviceAnnceIndCb(EndDeviceAnnceIndFormat_t *msg)
+{
+	regLearn(msg->NwkAddr, msg->IEEEAddr,
+	        (msg->Capabilities & DEV_REG_CAP_ROUTER) ?
+	                DEVICETYPE_ROUTER : DEVICETYPE_ENDDEVICE, 0, 0);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      regNwkAddrRspCb
+ *
+ * @brief   MT_ZDO_NWK_ADDR_RSP observer
+ *
+ * @param   msg - response
+ *
+ * @return  0, the application still gets the response
+ */
+static uint8_t regNwkAddrRspCb(NwkAddrRspFormat_t *msg)
+{
+	if (msg->Status == MT_RPC_SUCCESS)
+	{
+		regLearn(msg->NwkAddr, msg->IEEEAddr, DEV_REG_TYPE_UNKNOWN, 0, 0);
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      regIeeeAddrRspCb
+ *
+ * @brief   MT_ZDO_IEEE_ADDR_RSP observer
+ *
+ * @param   msg - response
+ *
+ * @return  0, the application still gets the response
+ */
+static uint8_t regIeeeAddrRspCb(IeeeAddrRspFormat_t *msg)
+{
+	if (msg->Status == MT_RPC_SUCCESS)
+	{
+		regLearn(msg->NwkAddr, msg->IEEEAddr, DEV_REG_TYPE_UNKNOWN, 0, 0);
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      regLeaveIndCb
+ *
+ * @brief   MT_ZDO_LEAVE_IND observer, a device leaving for good is
+ *          removed
+ *
+ * @param   msg - leave indication
+ *
+ * @return  0, the application still gets the indication
+ */
+static uint8_t regLeaveIndCb(LeaveIndFormat_t *msg)
+{
+	devRegEvent_t events[DEV_REG_MAX_EVENTS];
+	uint16_t idx;
+	uint8_t cnt = 0;
+
+	if (msg->Rejoin)
+	{
+		return 0;
+	}
+
+	sem_wait(&regSem);
+
+	idx = regExtFind(msg->ExtAddr);
+	if (idx == DEV_REG_NONE)
+	{
+		idx = regNwkFind(msg->SrcAddr);
+	}
+	if (idx != DEV_REG_NONE)
+	{
+		cnt = regRemove(idx, events, cnt);
+	}
+
+	sem_post(&regSem);
+
+	regEmit(events, cnt);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      regIncomingMsgCb
+ *
+ * @brief   MT_AF_INCOMING_MSG observer
+ *
+ * @param   msg - incoming message
+ *
+ * @return  0, the application still gets the message
+ */
+static uint8_t regIncomingMsgCb(IncomingMsgFormat_t *msg)
+{
+	regLearn(msg->SrcAddr, 0, DEV_REG_TYPE_UNKNOWN, msg->LinkQuality, 1);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      regIncomingMsgExtCb
+ *
+ * @brief   MT_AF_INCOMING_MSG_EXT observer
+ *
+ * @param   msg - incoming message
+ *
+ * @return  0, the application still gets the message
+ */
+static uint8_t regIncomingMsgExtCb(IncomingMsgExtFormat_t *msg)
+{
+	if (msg->SrcAddrMode == Addr16Bit)
+	{
+		regLearn((uint16_t) msg->SrcAddr, 0, DEV_REG_TYPE_UNKNOWN,
+		        msg->LinkQuality, 1);
+	}
+	else if (msg->SrcAddrMode == Addr64Bit)
+	{
+		regLearn(DEV_REG_NWK_UNKNOWN, msg->SrcAddr, DEV_REG_TYPE_UNKNOWN,
+		        msg->LinkQuality, 1);
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      regLearn
+ *
+ * @brief   register what is known of a device. The IEEE address is the
+ *          identity: a known device with a new short address keeps its
+ *          index, and a stale device holding that short address or a
+ *          different device with the same short address is removed.
+ *
+ * @param   nwkAddr - short address, DEV_REG_NWK_UNKNOWN if not known
+ * @param   extAddr - IEEE address, 0 if not known
+ * @param   devType - device type, DEV_REG_TYPE_UNKNOWN if not known
+ * @param   lqi - link quality of a message from the device
+ * @param   seen - 1 if lqi is of a message from the device
+ *
+ * @return  index of the device, -1 if it could not be registered
+ */
+static int32_t regLearn(uint16_t nwkAddr, uint64_t extAddr, uint8_t devType,
+        uint8_t lqi, uint8_t seen)
+{
+	devRegEvent_t events[DEV_REG_MAX_EVENTS];
+	devRegDevice_t *dev;
+	uint16_t idx, nwkIdx = DEV_REG_NONE, extIdx = DEV_REG_NONE;
+	uint16_t oldNwkAddr;
+	uint8_t cnt = 0;
+
+	if ((nwkAddr == DEV_REG_NWK_UNKNOWN) && (extAddr == 0))
+	{
+		return -1;
+	}
+
+	sem_wait(&regSem);
+
+	regStats.lookups++;
+	if (nwkAddr != DEV_REG_NWK_UNKNOWN)
+	{
+		nwkIdx = regNwkFind(nwkAddr);
+	}
+	if (extAddr != 0)
+	{
+		extIdx = regExtFind(extAddr);
+	}
+
+	if ((nwkIdx != DEV_REG_NONE) && (extAddr != 0) && (nwkIdx != extIdx)
+	        && (regDevices[nwkIdx].extAddr != 0))
+	{
+		// the short address belongs to another device now
+		cnt = regRemove(nwkIdx, events, cnt);
+		nwkIdx = DEV_REG_NONE;
+	}
+
+	if ((extIdx != DEV_REG_NONE) && (nwkIdx != DEV_REG_NONE)
+	        && (nwkIdx != extIdx))
+	{
+		// the device was also registered by its short address alone
+		cnt = regRemove(nwkIdx, events, cnt);
+		nwkIdx = DEV_REG_NONE;
+	}
+
+	idx = (extIdx != DEV_REG_NONE) ? extIdx : nwkIdx;
+	if (idx == DEV_REG_NONE)
+	{
+		for (idx = 0; idx < DEV_REG_MAX_DEVICES; idx++)
+		{
+			if (!regUsed[idx])
+			{
+				break;
+			}
+		}
+		if (idx == DEV_REG_MAX_DEVICES)
+		{
+			regStats.dropped++;
+			sem_post(&regSem);
+			regEmit(events, cnt);
+			return -1;
+		}
+
+		regUsed[idx] = 1;
+		regStats.devices++;
+		dev = &regDevices[idx];
+		memset(dev, 0, sizeof(devRegDevice_t));
+		dev->nwkAddr = nwkAddr;
+		dev->extAddr = extAddr;
+		dev->devType = DEV_REG_TYPE_UNKNOWN;
+		if (nwkAddr != DEV_REG_NWK_UNKNOWN)
+		{
+			hashIdxInsert(&regNwkHash, hashIdxTag16(nwkAddr), idx);
+		}
+		if (extAddr != 0)
+		{
+			hashIdxInsert(&regExtHash, hashIdxTag64(extAddr), idx);
+		}
+		cnt = regEvent(DEV_REG_ADDED, idx, DEV_REG_NWK_UNKNOWN, events, cnt);
+	}
+	else
+	{
+		dev = &regDevices[idx];
+		if ((extAddr != 0) && (dev->extAddr == 0))
+		{
+			dev->extAddr = extAddr;
+			hashIdxInsert(&regExtHash, hashIdxTag64(extAddr), idx);
+		}
+		if ((nwkAddr != DEV_REG_NWK_UNKNOWN) && (dev->nwkAddr != nwkAddr))
+		{
+			oldNwkAddr = dev->nwkAddr;
+			if (oldNwkAddr != DEV_REG_NWK_UNKNOWN)
+			{
+				hashIdxDelete(&regNwkHash, hashIdxTag16(oldNwkAddr), idx);
+			}
+			dev->nwkAddr = nwkAddr;
+			hashIdxInsert(&regNwkHash, hashIdxTag16(nwkAddr), idx);
+			regStats.nwkChanges++;
+			cnt = regEvent(DEV_REG_NWK_CHANGED, idx, oldNwkAddr, events, cnt);
+		}
+	}
+
+	if (devType != DEV_REG_TYPE_UNKNOWN)
+	{
+		dev->devType = devType;
+	}
+	if (seen)
+	{
+		dev->lqi = lqi;
+		dev->lastSeen = (uint32_t) (rpcTimerNow() / 1000);
+	}
+
+	sem_post(&regSem);
+
+	regEmit(events, cnt);
+
+	return idx;
+}
+
+/*********************************************************************
+ * @fn      regRemove
+ *
+ * @brief   remove a device, called with regSem held
+ *
+ * @param   idx - index of the device
+ * @param   events - the event is added to them
+ * @param   cnt - events already in events
+ *
+ * @return  events in events
+ */
+static uint8_t regRemove(uint16_t idx, devRegEvent_t *events, uint8_t cnt)
+{
+	devRegDevice_t *dev = &regDevices[idx];
+
+	cnt = regEvent(DEV_REG_REMOVED, idx, DEV_REG_NWK_UNKNOWN, events, cnt);
+
+	if (dev->nwkAddr != DEV_REG_NWK_UNKNOWN)
+	{
+		hashIdxDelete(&regNwkHash, hashIdxTag16(dev->nwkAddr), idx);
+	}
+	if (dev->extAddr != 0)
+	{
+		hashIdxDelete(&regExtHash, hashIdxTag64(dev->extAddr), idx);
+	}
+	regUsed[idx] = 0;
+	regStats.devices--;
+
+	return cnt;
+}
+
+/*********************************************************************
+ * @fn      regEvent
+ *
+ * @brief   record an event for the callback, called with regSem held
+ *
+ * @param   event - DEV_REG_xxx
+ * @param   idx - index of the device
+ * @param   oldNwkAddr - previous short address
+ * @param   events - the event is added to them
+ * @param   cnt - events already in events
+ *
+ * @return  events in events
+ */
+static uint8_t regEvent(uint8_t event, uint16_t idx, uint16_t oldNwkAddr,
+        devRegEvent_t *events, uint8_t cnt)
+{
+	if ((regCb == NULL) || (cnt >= DEV_REG_MAX_EVENTS))
+	{
+		return cnt;
+	}
+
+	events[cnt].event = event;
+	events[cnt].idx = idx;
+	events[cnt].oldNwkAddr = oldNwkAddr;
+	memcpy(&events[cnt].dev, &regDevices[idx], sizeof(devRegDevice_t));
+
+	return cnt + 1;
+}
+
+/*********************************************************************
+ * @fn      regEmit
+ *
+ * @brief   pass recorded events to the callback
+ *
+ * @param   events - events
+ * @param   cnt - number of events
+ *
+ * @return  -
+ */
+static void regEmit(devRegEvent_t *events, uint8_t cnt)
+{
+	uint8_t idx;
+
+	for (idx = 0; (idx < cnt) && (regCb != NULL); idx++)
+	{
+		regCb(events[idx].event, events[idx].idx, &events[idx].dev,
+		        events[idx].oldNwkAddr);
+	}
+}
+
+/*********************************************************************
+ * @fn      regNwkFind
+ *
+ * @brief   find a device by its short address, called with regSem held
+ *
+ * @param   nwkAddr - short address
+ *
+ * @return  index of the device, DEV_REG_NONE if it is not registered
+ */
+static uint16_t regNwkFind(uint16_t nwkAddr)
+{
+	uint16_t slot;
+
+	// a short address has its own tag, the device need not be compared
+	return hashIdxFirst(&regNwkHash, hashIdxTag16(nwkAddr), &slot);
+}
+
+/*********************************************************************
+ * @fn      regExtFind
+ *
+ * @brief   find a device by its IEEE address, called with regSem held
+ *
+ * @param   extAddr - IEEE address
+ *
+ * @return  index of the device, DEV_REG_NONE if it is not registered
+ */
+static uint16_t regExtFind(uint64_t extAddr)
+{
+	uint16_t tag = hashIdxTag64(extAddr);
+	uint16_t idx, slot;
+
+	idx = hashIdxFirst(&regExtHash, tag, &slot);
+	while ((idx != DEV_REG_NONE) && (regDevices[idx].extAddr != extAddr))
+	{
+		idx = hashIdxNext(&regExtHash, tag, &slot);
+	}
+
+	return idx;
+}
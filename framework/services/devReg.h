@@ -0,0 +1,118 @@
+/*
+ * devReg.h
+ *
+ * This module contains the device registry of the ZigBee Network
+ * Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef DEVREG_H
+#define DEVREG_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// devices in the registry, indexes go from 0 to DEV_REG_MAX_DEVICES - 1
+#define DEV_REG_MAX_DEVICES        (1024)
+
+// slots of each address index, a power of 2 at least twice
+// DEV_REG_MAX_DEVICES to keep the probes short
+#define DEV_REG_HASH_SIZE          (2048)
+
+// nwkAddr of a device only known by its IEEE address
+#define DEV_REG_NWK_UNKNOWN        (0xFFFE)
+
+#define DEV_REG_TYPE_UNKNOWN       (0xFF)
+
+// devRegCb_t event
+#define DEV_REG_ADDED              (0)
+#define DEV_REG_NWK_CHANGED        (1)
+#define DEV_REG_REMOVED            (2)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// 16 bytes, four devices per cache line
+typedef struct
+{
+	uint64_t extAddr;      // 0 if not known yet
+	uint16_t nwkAddr;      // DEV_REG_NWK_UNKNOWN if not known
+	uint8_t devType;       // DEVICETYPE_xxx or DEV_REG_TYPE_UNKNOWN
+	uint8_t lqi;           // link quality of the last message received
+	uint32_t lastSeen;     // rpcTimerNow() in s of the last message
+} devRegDevice_t;
+
+typedef struct
+{
+	uint16_t devices;
+	uint32_t lookups;
+	uint32_t probes;       // slots looked at by the lookups
+	uint32_t nwkChanges;
+	uint32_t dropped;      // devices not registered, registry full
+} devRegStats_t;
+
+// called for each device added, removed or given a new short address.
+// oldNwkAddr is the previous short address for DEV_REG_NWK_CHANGED.
+typedef void (*devRegCb_t)(uint8_t event, uint16_t idx,
+        devRegDevice_t *dev, uint16_t oldNwkAddr);
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+int32_t devRegInit(devRegCb_t cb);
+int32_t devRegAdd(uint16_t nwkAddr, uint64_t extAddr);
+int32_t devRegFindNwk(uint16_t nwkAddr);
+int32_t devRegFindExt(uint64_t extAddr);
+int32_t devRegGet(uint16_t idx, devRegDevice_t *dev);
+int32_t devRegRemove(uint16_t idx);
+void devRegGetStats(devRegStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEVREG_H */
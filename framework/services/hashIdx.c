@@ -0,0 +1,257 @@
+/*
+ * hashIdx.c
+ *
+ * This module contains the open addressing index of the ZigBee Network
+ * Processor (ZNP) Host Interface services.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+
+#include "hashIdx.h"
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      hashIdxInit
+ *
+ * @brief   initialise an empty index. It is not protected, the caller
+ *          serialises the calls.
+ *
+ * @param   hash - index
+ * @param   slots - slots of the index, more than the entries indexed
+ * @param   size - number of slots, a power of 2
+ *
+ * @return  -
+ */
+void hashIdxInit(hashIdx_t *hash, hashIdxSlot_t *slots, uint16_t size)
+{
+	hash->slots = slots;
+	hash->mask = size - 1;
+	hash->shift = 16;
+	while (size > 1)
+	{
+		hash->shift--;
+		size >>= 1;
+	}
+
+	hashIdxClear(hash);
+}
+
+/*********************************************************************
+ * @fn      hashIdxClear
+ *
+ * @brief   remove all the entries of an index
+ *
+ * @param   hash - index
+ *
+ * @return  -
+ */
+void hashIdxClear(hashIdx_t *hash)
+{
+	memset(hash->slots, 0xFF,
+	        ((uint32_t) hash->mask + 1) * sizeof(hashIdxSlot_t));
+	hash->probes = 0;
+}
+
+/*********************************************************************
+ * @fn      hashIdxInsert
+ *
+ * @brief   index an entry
+ *
+ * @param   hash - index
+ * @param   tag - hash of the key of the entry
+ * @param   idx - entry, not indexed yet
+ *
+ * @return  -
+ */
+void hashIdxInsert(hashIdx_t *hash, uint16_t tag, uint16_t idx)
+{
+	uint16_t slot = tag >> hash->shift;
+
+	while (hash->slots[slot].idx != HASH_IDX_NONE)
+	{
+		slot = (slot + 1) & hash->mask;
+	}
+
+	hash->slots[slot].tag = tag;
+	hash->slots[slot].idx = idx;
+}
+
+/*********************************************************************
+ * @fn      hashIdxDelete
+ *
+ * @brief   remove an entry from an index. The following slots are
+ *          shifted back so that no probe sequence is broken.
+ *
+ * @param   hash - index
+ * @param   tag - hash of the key the entry was indexed with
+ * @param   idx - entry
+ *
+ * @return  -
+ */
+void hashIdxDelete(hashIdx_t *hash, uint16_t tag, uint16_t idx)
+{
+	uint16_t hole, slot, home;
+
+	hole = tag >> hash->shift;
+	while (hash->slots[hole].idx != idx)
+	{
+		if (hash->slots[hole].idx == HASH_IDX_NONE)
+		{
+			return;
+		}
+		hole = (hole + 1) & hash->mask;
+	}
+
+	slot = hole;
+	while (1)
+	{
+		slot = (slot + 1) & hash->mask;
+		if (hash->slots[slot].idx == HASH_IDX_NONE)
+		{
+			break;
+		}
+
+		// move the entry back unless its home is between the hole
+		// and its slot
+		home = hash->slots[slot].tag >> hash->shift;
+		if (((slot - home) & hash->mask) >= ((slot - hole) & hash->mask))
+		{
+			hash->slots[hole] = hash->slots[slot];
+			hole = slot;
+		}
+	}
+
+	hash->slots[hole].idx = HASH_IDX_NONE;
+}
+
+/*********************************************************************
+ * @fn      hashIdxFirst
+ *
+ * @brief   find the first entry indexed with a tag. Different keys may
+ *          share a tag, the caller compares the key of the entry and
+ *          calls hashIdxNext() for the next one.
+ *
+ * @param   hash - index
+ * @param   tag - hash of the key
+ * @param   slot - set to the slot of the entry for hashIdxNext()
+ *
+ * @return  entry, HASH_IDX_NONE if none
+ */
+uint16_t hashIdxFirst(hashIdx_t *hash, uint16_t tag, uint16_t *slot)
+{
+	*slot = ((tag >> hash->shift) - 1) & hash->mask;
+
+	return hashIdxNext(hash, tag, slot);
+}
+
+/*********************************************************************
+ * @fn      hashIdxNext
+ *
+ * @brief   find the next entry indexed with a tag
+ *
+ * @param   hash - index
+ * @param   tag - hash of the key
+ * @param   slot - slot of the previous entry, set to the slot of the
+ *          entry found
+ *
+ * @return  entry, HASH_IDX_NONE if none
+ */
+uint16_t hashIdxNext(hashIdx_t *hash, uint16_t tag, uint16_t *slot)
+{
+	uint16_t pos = (*slot + 1) & hash->mask;
+
+	while (hash->slots[pos].idx != HASH_IDX_NONE)
+	{
+		hash->probes++;
+		if (hash->slots[pos].tag == tag)
+		{
+			*slot = pos;
+			return hash->slots[pos].idx;
+		}
+		pos = (pos + 1) & hash->mask;
+	}
+
+	return HASH_IDX_NONE;
+}
+
+/*********************************************************************
+ * @fn      hashIdxTag16
+ *
+ * @brief   tag of a 16 bit key such as a short address. Each key has its
+ *          own tag, an entry found needs no comparison.
+ *
+ * @param   key - key
+ *
+ * @return  tag
+ */
+uint16_t hashIdxTag16(uint16_t key)
+{
+	// odd multiplier, a bijection on 16 bits
+	return (uint16_t) (key * 40503u);
+}
+
+/*********************************************************************
+ * @fn      hashIdxTag32
+ *
+ * @brief   tag of a 32 bit key such as a pair of short addresses
+ *
+ * @param   key - key
+ *
+ * @return  tag
+ */
+uint16_t hashIdxTag32(uint32_t key)
+{
+	return (uint16_t) ((key * 2654435761u) >> 16);
+}
+
+/*********************************************************************
+ * @fn      hashIdxTag64
+ *
+ * @brief   tag of a 64 bit key such as an IEEE address
+ *
+ * @param   key - key
+ *
+ * @return  tag
+ */
+uint16_t hashIdxTag64(uint64_t key)
+{
+	return hashIdxTag32((uint32_t) key ^ (uint32_t) (key >> 32));
+}
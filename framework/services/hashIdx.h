@@ -0,0 +1,98 @@
+/*
+ * hashIdx.h
+ *
+ * This module contains the open addressing index of the ZigBee Network
+ * Processor (ZNP) Host Interface services.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef HASHIDX_H
+#define HASHIDX_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// empty slot, and index returned when no entry has the tag
+#define HASH_IDX_NONE              (0xFFFF)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// the tag is a 16 bit hash of the key, kept in the slot so that a lookup
+// only touches the entries of the caller whose tag matches
+typedef struct
+{
+	uint16_t tag;
+	uint16_t idx;          // entry of the caller, HASH_IDX_NONE if empty
+} hashIdxSlot_t;
+
+typedef struct
+{
+	hashIdxSlot_t *slots;
+	uint16_t mask;         // slots - 1
+	uint8_t shift;         // the home slot of a tag is tag >> shift
+	uint32_t probes;       // slots looked at by the lookups
+} hashIdx_t;
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+void hashIdxInit(hashIdx_t *hash, hashIdxSlot_t *slots, uint16_t size);
+void hashIdxClear(hashIdx_t *hash);
+void hashIdxInsert(hashIdx_t *hash, uint16_t tag, uint16_t idx);
+void hashIdxDelete(hashIdx_t *hash, uint16_t tag, uint16_t idx);
+uint16_t hashIdxFirst(hashIdx_t *hash, uint16_t tag, uint16_t *slot);
+uint16_t hashIdxNext(hashIdx_t *hash, uint16_t tag, uint16_t *slot);
+uint16_t hashIdxTag16(uint16_t key);
+uint16_t hashIdxTag32(uint32_t key);
+uint16_t hashIdxTag64(uint64_t key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HASHIDX_H */
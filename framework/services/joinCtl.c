@@ -0,0 +1,575 @@
+/*
+ * joinCtl.c
+ *
+ * This module contains the permit join admission control of the ZigBee
+ * Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include <semaphore.h>
+
+#include "joinCtl.h"
+#include "mtZdo.h"
+#include "mtAf.h"
+#include "rpc.h"
+#include "rpcQos.h"
+#include "rpcTimer.h"
+#include "afTx.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// ZDO_MGMT_PERMIT_JOIN_REQ to every router
+#define JOIN_CTL_DST_ROUTERS          (0xFFFC)
+
+// longest Duration, 0xFF would leave permit join on
+#define JOIN_CTL_MAX_DURATION         (254)
+
+// one bucket per second for joinsPerMinute
+#define JOIN_CTL_BUCKETS              (60)
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static joinCtlConfig_t ctlConfig =
+	{ JOIN_CTL_DEFAULT_WINDOW, JOIN_CTL_DEFAULT_GAP,
+	        JOIN_CTL_DEFAULT_MIN_BUDGET, JOIN_CTL_DEFAULT_MAX_BUDGET,
+	        JOIN_CTL_DEFAULT_MAX_DEPTH, JOIN_CTL_DEFAULT_MAX_PENDING,
+	        JOIN_CTL_DEFAULT_MAX_FAIL };
+static joinCtlStats_t ctlStats;
+
+// end of the admission, 0 if it lasts until joinCtlStop()
+static uint64_t ctlEnd;
+// end of the open window, or earliest opening of the next one
+static uint64_t ctlWindowEnd;
+static uint64_t ctlNextOpen;
+// the last window closed on its budget rather than on the load
+static uint8_t ctlFilled;
+
+// AF_DATA_CONFIRMs since the last tick
+static uint32_t ctlConfirms;
+static uint32_t ctlFailures;
+
+static uint16_t ctlBuckets[JOIN_CTL_BUCKETS];
+static uint64_t ctlBucketTime[JOIN_CTL_BUCKETS];
+
+static rpcTimer_t ctlTimer;
+
+// protects all of the above
+static sem_t ctlSem;
+// serialises the ZDO_MGMT_PERMIT_JOIN_REQs
+static sem_t ctlSendSem;
+
+static uint8_t ctlInitDone = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS DECLARATION
+ */
+
+static uint8_t ctlEndDeviceAnnceIndCb(EndDeviceAnnceIndFormat_t *msg);
+static uint8_t ctlDataConfirmCb(DataConfirmFormat_t *msg);
+static void ctlTickCb(void *arg);
+static void ctlOpen(uint64_t now);
+static void ctlClose(uint64_t now, uint8_t state);
+static void ctlThrottle(void);
+static void ctlApply(void);
+
+static mtZdoCb_t ctlZdoCbs =
+	{ .pfnZdoEndDeviceAnnceInd = ctlEndDeviceAnnceIndCb, };
+
+static mtAfCb_t ctlAfCbs =
+	{ ctlDataConfirmCb,	//MT_AF_DATA_CONFIRM
+	        NULL,			//MT_AF_INCOMING_MSG
+	        NULL,			//MT_AF_INCOMING_MSG_EXT
+	        NULL,			//MT_AF_DATA_RETRIEVE
+	        NULL,			//MT_AF_REFLECT_ERROR
+	    };
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      joinCtlInit
+ *
+ * @brief   initialise the admission control, must be called once after
+ *          rpcInitMq()
+ *
+ * @param   -
+ *
+ * @return  status, -1 if its observers could not be registered
+ */
+int32_t joinCtlInit(void)
+{
+	memset(&ctlStats, 0, sizeof(ctlStats));
+	memset(ctlBucketTime, 0, sizeof(ctlBucketTime));
+	ctlStats.state = JOIN_CTL_STOPPED;
+	ctlStats.budget = ctlConfig.minBudget;
+
+	sem_init(&ctlSem, 0, 1);
+	sem_init(&ctlSendSem, 0, 1);
+
+	if (!ctlInitDone)
+	{
+		if ((zdoRegisterObserver(&ctlZdoCbs) != 0)
+		        || (afRegisterObserver(&ctlAfCbs) != 0))
+		{
+			dbg_print(PRINT_LEVEL_WARNING,
+			        "joinCtlInit: no free observer entry\n");
+			return -1;
+		}
+		ctlInitDone = 1;
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      joinCtlConfig
+ *
+ * @brief   set the windows, the budget bounds and the load limits
+ *
+ * @param   config - configuration, copied
+ *
+ * @return  -
+ */
+void joinCtlConfig(joinCtlConfig_t *config)
+{
+	sem_wait(&ctlSem);
+
+	memcpy(&ctlConfig, config, sizeof(joinCtlConfig_t));
+	if (ctlConfig.window == 0)
+	{
+		ctlConfig.window = 1;
+	}
+	if (ctlConfig.window > JOIN_CTL_MAX_DURATION)
+	{
+		ctlConfig.window = JOIN_CTL_MAX_DURATION;
+	}
+	if (ctlConfig.minBudget == 0)
+	{
+		ctlConfig.minBudget = 1;
+	}
+	if (ctlConfig.maxBudget < ctlConfig.minBudget)
+	{
+		ctlConfig.maxBudget = ctlConfig.minBudget;
+	}
+	if (ctlStats.budget < ctlConfig.minBudget)
+	{
+		ctlStats.budget = ctlConfig.minBudget;
+	}
+	if (ctlStats.budget > ctlConfig.maxBudget)
+	{
+		ctlStats.budget = ctlConfig.maxBudget;
+	}
+
+	sem_post(&ctlSem);
+}
+
+/*********************************************************************
+ * @fn      joinCtlStart
+ *
+ * @brief   admit joins in windows: permit join is opened for the
+ *          window time, closed once the budget of the window is used
+ *          up or the load is too high, and opened again after the gap
+ *          if the load allows it. The budget halves when the load
+ *          closes a window and grows while windows fill up.
+ *
+ * @param   duration - s joins are admitted for, 0 until joinCtlStop()
+ *
+ * @return  status, -1 if not initialised
+ */
+int32_t joinCtlStart(uint16_t duration)
+{
+	uint64_t now = rpcTimerNow();
+
+	if (!ctlInitDone)
+	{
+		return -1;
+	}
+
+	sem_wait(&ctlSem);
+
+	ctlEnd = duration ? (now + (uint64_t) duration * 1000) : 0;
+	ctlConfirms = 0;
+	ctlFailures = 0;
+	ctlFilled = 0;
+	ctlOpen(now);
+	rpcTimerStart(&ctlTimer, JOIN_CTL_TICK, JOIN_CTL_TICK, ctlTickCb, NULL);
+
+	sem_post(&ctlSem);
+
+	dbg_print(PRINT_LEVEL_INFO, "joinCtl: admitting joins for %d s\n",
+	        duration);
+
+	ctlApply();
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      joinCtlStop
+ *
+ * @brief   close permit join and stop admitting joins
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+void joinCtlStop(void)
+{
+	if (!ctlInitDone)
+	{
+		return;
+	}
+
+	sem_wait(&ctlSem);
+
+	rpcTimerStop(&ctlTimer);
+	ctlStats.state = JOIN_CTL_STOPPED;
+
+	sem_post(&ctlSem);
+
+	ctlApply();
+}
+
+/*********************************************************************
+ * @fn      joinCtlGetStats
+ *
+ * @brief   get the state and the counters of the admission control
+ *
+ * @param   stats - filled in with the state and the counters
+ *
+ * @return  -
+ */
+void joinCtlGetStats(joinCtlStats_t *stats)
+{
+	uint64_t second = rpcTimerNow() / 1000;
+	uint8_t idx;
+
+	sem_wait(&ctlSem);
+
+	ctlStats.joinsPerMinute = 0;
+	for (idx = 0; idx < JOIN_CTL_BUCKETS; idx++)
+	{
+		if ((ctlBucketTime[idx] + JOIN_CTL_BUCKETS) > second)
+		{
+			ctlStats.joinsPerMinute += ctlBuckets[idx];
+		}
+	}
+	memcpy(stats, &ctlStats, sizeof(joinCtlStats_t));
+
+	sem_post(&ctlSem);
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      ctlEndDeviceAnnceIndCb
+ *
+ * @brief   MT_ZDO_END_DEVICE_ANNCE_IND observer, counts the joins and
+ *          closes permit join as soon as the budget is used up
+ *
+ * @param   msg - announcement
+ *
+ * @return  0, the application still gets the indication
+ */
+static uint8_t ctlEndDeviceAnnceIndCb(EndDeviceAnnceIndFormat_t *msg)
+{
+	uint64_t now = rpcTimerNow();
+	uint64_t second = now / 1000;
+	uint8_t bucket = second % JOIN_CTL_BUCKETS;
+	uint8_t closed = 0;
+
+	sem_wait(&ctlSem);
+
+	if (ctlBucketTime[bucket] != second)
+	{
+		ctlBucketTime[bucket] = second;
+		ctlBuckets[bucket] = 0;
+	}
+	ctlBuckets[bucket]++;
+	ctlStats.joins++;
+
+	if (ctlStats.state == JOIN_CTL_OPEN)
+	{
+		ctlStats.windowJoins++;
+		if (ctlStats.windowJoins >= ctlStats.budget)
+		{
+			ctlFilled = 1;
+			ctlClose(now, JOIN_CTL_CLOSED);
+			closed = 1;
+		}
+	}
+
+	sem_post(&ctlSem);
+
+	if (closed)
+	{
+		ctlApply();
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      ctlDataConfirmCb
+ *
+ * @brief   MT_AF_DATA_CONFIRM observer, counts the failures
+ *
+ * @param   msg - confirm
+ *
+ * @return  0, the application still gets the confirm
+ */
+static uint8_t ctlDataConfirmCb(DataConfirmFormat_t *msg)
+{
+	sem_wait(&ctlSem);
+
+	ctlConfirms++;
+	if (msg->Status != afStatus_SUCCESS)
+	{
+		ctlFailures++;
+	}
+
+	sem_post(&ctlSem);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      ctlTickCb
+ *
+ * @brief   sample the load and open, close or pause permit join
+ *
+ * @param   arg - unused
+ *
+ * @return  -
+ */
+static void ctlTickCb(void *arg)
+{
+	rpcQosStats_t qosStats;
+	afTxStats_t txStats;
+	uint64_t now = rpcTimerNow();
+	uint32_t depth = 0;
+	uint8_t cls, overloaded, rate, apply = 0;
+	uint8_t txUsed;
+
+	// outside ctlSem, these take their own locks
+	for (cls = 0; cls < RPC_QOS_CLASS_MAX; cls++)
+	{
+		if (rpcQosGetStats((rpcQosClass_t) cls, &qosStats) == 0)
+		{
+			depth += qosStats.depth;
+		}
+	}
+	// without afTx there are no sends to wait for
+	txUsed = (afTxGetStats(&txStats) == 0);
+
+	sem_wait(&ctlSem);
+
+	// failure rate smoothed over about four ticks
+	rate = ctlConfirms ? (uint8_t) ((ctlFailures * 100) / ctlConfirms) : 0;
+	ctlStats.failRate = (uint8_t) (((uint32_t) ctlStats.failRate * 3 + rate)
+	        / 4);
+	ctlConfirms = 0;
+	ctlFailures = 0;
+
+	ctlStats.depth = depth;
+	ctlStats.pending = txUsed ? (txStats.inFlight + txStats.queued) : 0;
+	overloaded = (depth > ctlConfig.maxDepth)
+	        || (ctlStats.pending > ctlConfig.maxPending)
+	        || (ctlStats.failRate > ctlConfig.maxFailRate);
+
+	if ((ctlEnd != 0) && (now >= ctlEnd))
+	{
+		rpcTimerStop(&ctlTimer);
+		ctlStats.state = JOIN_CTL_STOPPED;
+		apply = 1;
+	}
+	else if (ctlStats.state == JOIN_CTL_OPEN)
+	{
+		if (overloaded)
+		{
+			ctlThrottle();
+			ctlClose(now, JOIN_CTL_PAUSED);
+			apply = 1;
+		}
+		else if (now >= ctlWindowEnd)
+		{
+			// permit join has expired on the routers, no request needed
+			ctlFilled = 0;
+			ctlClose(now, JOIN_CTL_CLOSED);
+		}
+	}
+	else if (overloaded)
+	{
+		if (ctlStats.state == JOIN_CTL_CLOSED)
+		{
+			// the joins of the last window are likely the cause
+			ctlThrottle();
+			ctlStats.state = JOIN_CTL_PAUSED;
+		}
+	}
+	else if ((ctlStats.state == JOIN_CTL_PAUSED) || (now >= ctlNextOpen))
+	{
+		ctlOpen(now);
+		apply = 1;
+	}
+
+	sem_post(&ctlSem);
+
+	if (apply)
+	{
+		ctlApply();
+	}
+}
+
+/*********************************************************************
+ * @fn      ctlOpen
+ *
+ * @brief   open a window, called with ctlSem held. The budget grows if
+ *          the previous window was filled.
+ *
+ * @param   now - rpcTimerNow()
+ *
+ * @return  -
+ */
+static void ctlOpen(uint64_t now)
+{
+	if (ctlFilled)
+	{
+		ctlStats.budget += ctlStats.budget / 4 + 1;
+		if (ctlStats.budget > ctlConfig.maxBudget)
+		{
+			ctlStats.budget = ctlConfig.maxBudget;
+		}
+		ctlFilled = 0;
+	}
+
+	ctlStats.state = JOIN_CTL_OPEN;
+	ctlStats.windowJoins = 0;
+	ctlStats.windows++;
+	ctlWindowEnd = now + (uint64_t) ctlConfig.window * 1000;
+}
+
+/*********************************************************************
+ * @fn      ctlClose
+ *
+ * @brief   close the window, called with ctlSem held
+ *
+ * @param   now - rpcTimerNow()
+ * @param   state - JOIN_CTL_CLOSED or JOIN_CTL_PAUSED
+ *
+ * @return  -
+ */
+static void ctlClose(uint64_t now, uint8_t state)
+{
+	ctlStats.state = state;
+	ctlNextOpen = now + (uint64_t) ctlConfig.gap * 1000;
+
+	dbg_print(PRINT_LEVEL_INFO, "joinCtl: window closed, %d joins, budget %d\n",
+	        ctlStats.windowJoins, ctlStats.budget);
+}
+
+/*********************************************************************
+ * @fn      ctlThrottle
+ *
+ * @brief   halve the budget as the load is too high, called with ctlSem
+ *          held
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+static void ctlThrottle(void)
+{
+	ctlStats.budget /= 2;
+	if (ctlStats.budget < ctlConfig.minBudget)
+	{
+		ctlStats.budget = ctlConfig.minBudget;
+	}
+	ctlStats.pauses++;
+	ctlFilled = 0;
+}
+
+/*********************************************************************
+ * @fn      ctlApply
+ *
+ * @brief   send the permit join state to the routers. The state is read
+ *          with ctlSendSem held so that the last request sent is the
+ *          current state.
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+static void ctlApply(void)
+{
+	MgmtPermitJoinReqFormat_t req;
+	uint64_t now;
+	uint8_t status;
+
+	sem_wait(&ctlSendSem);
+
+	sem_wait(&ctlSem);
+	now = rpcTimerNow();
+	req.Duration = 0;
+	if ((ctlStats.state == JOIN_CTL_OPEN) && (ctlWindowEnd > now))
+	{
+		req.Duration = (uint8_t) ((ctlWindowEnd - now + 999) / 1000);
+	}
+	sem_post(&ctlSem);
+
+	req.AddrMode = Addr16Bit;
+	req.DstAddr = JOIN_CTL_DST_ROUTERS;
+	req.TCSignificance = 0;
+	status = zdoMgmtPermitJoinReq(&req);
+
+	sem_post(&ctlSendSem);
+
+	if (status != MT_RPC_SUCCESS)
+	{
+		dbg_print(PRINT_LEVEL_WARNING, "joinCtl: permit join failed %02X\n",
+		        status);
+	}
+}
@@ -0,0 +1,121 @@
+/*
+ * joinCtl.h
+ *
+ * This module contains the permit join admission control of the ZigBee
+ * Network Processor (ZNP) Host Interface. The load includes the sends
+ * of afTx once afTxInit() has been called, until then the pending limit
+ * is not used.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef JOINCTL_H
+#define JOINCTL_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// the load is sampled and the window state checked at this period, ms
+#define JOIN_CTL_TICK                 (1000)
+
+// joinCtlStats_t state
+#define JOIN_CTL_STOPPED              (0)
+#define JOIN_CTL_OPEN                 (1)  // permit join on
+#define JOIN_CTL_CLOSED               (2)  // between windows
+#define JOIN_CTL_PAUSED               (3)  // closed until the load drops
+
+// defaults of joinCtlConfig_t
+#define JOIN_CTL_DEFAULT_WINDOW       (10)
+#define JOIN_CTL_DEFAULT_GAP          (5)
+#define JOIN_CTL_DEFAULT_MIN_BUDGET   (2)
+#define JOIN_CTL_DEFAULT_MAX_BUDGET   (30)
+#define JOIN_CTL_DEFAULT_MAX_DEPTH    (64)
+#define JOIN_CTL_DEFAULT_MAX_PENDING  (16)
+#define JOIN_CTL_DEFAULT_MAX_FAIL     (20)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint8_t window;        // s permit join is opened for, 1 to 254
+	uint8_t gap;           // s between two windows
+	uint16_t minBudget;    // joins admitted per window, adapted between
+	uint16_t maxBudget;    // these two
+	uint32_t maxDepth;     // incoming frames queued
+	uint16_t maxPending;   // AF sends waiting for their confirm or the
+	                       // window of afTx, if afTx is used
+	uint8_t maxFailRate;   // AF_DATA_CONFIRM failures in percent
+} joinCtlConfig_t;
+
+typedef struct
+{
+	uint8_t state;         // JOIN_CTL_xxx
+	uint16_t budget;       // joins admitted in the current window
+	uint16_t windowJoins;  // joins in the current window
+	uint16_t joinsPerMinute;  // over the last 60 s
+	uint32_t joins;
+	uint32_t windows;      // windows opened
+	uint32_t pauses;       // windows closed or delayed by the load
+	uint32_t depth;        // last load sample
+	uint16_t pending;
+	uint8_t failRate;
+} joinCtlStats_t;
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+int32_t joinCtlInit(void);
+void joinCtlConfig(joinCtlConfig_t *config);
+int32_t joinCtlStart(uint16_t duration);
+void joinCtlStop(void);
+void joinCtlGetStats(joinCtlStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JOINCTL_H */
@@ -0,0 +1,680 @@
+/*
+ * lqiHist.c
+ *
+ * This module contains the link quality history of the ZigBee Network
+ * Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include <semaphore.h>
+
+#include "lqiHist.h"
+#include "rpc.h"
+#include "mtZdo.h"
+#include "mtAf.h"
+#include "rpcTimer.h"
+#include "hashIdx.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define LQI_HIST_HASH_SIZE            (512)
+
+#define LQI_HIST_BUCKETS \
+	(LQI_HIST_MINUTE_BUCKETS + LQI_HIST_HOUR_BUCKETS + LQI_HIST_DAY_BUCKETS)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint16_t from;
+	uint16_t to;
+	uint64_t lastSeen;     // rpcTimerNow() of the last sample
+	// per tier, the period of the newest bucket and the sum and count
+	// of its samples
+	uint32_t head[LQI_HIST_TIERS];
+	uint64_t sum[LQI_HIST_TIERS];
+	uint32_t cnt[LQI_HIST_TIERS];
+	lqiHistBucket_t buckets[LQI_HIST_BUCKETS];
+} lqiHistEntry_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static const uint32_t histPeriod[LQI_HIST_TIERS] =
+	{ 60000, 3600000, 86400000 };
+static const uint8_t histSize[LQI_HIST_TIERS] =
+	{ LQI_HIST_MINUTE_BUCKETS, LQI_HIST_HOUR_BUCKETS, LQI_HIST_DAY_BUCKETS };
+static const uint8_t histOffset[LQI_HIST_TIERS] =
+	{ 0, LQI_HIST_MINUTE_BUCKETS, LQI_HIST_MINUTE_BUCKETS
+	        + LQI_HIST_HOUR_BUCKETS };
+
+static lqiHistEntry_t histLinks[LQI_HIST_MAX_LINKS];
+// open addressing by link
+static hashIdxSlot_t histSlots[LQI_HIST_HASH_SIZE];
+static hashIdx_t histHash;
+static lqiHistStats_t histStats;
+
+// protects all of the above
+static sem_t histSem;
+
+static uint8_t histInitDone = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS DECLARATION
+ */
+
+static uint8_t histIncomingMsgCb(IncomingMsgFormat_t *msg);
+static uint8_t histIncomingMsgExtCb(IncomingMsgExtFormat_t *msg);
+static uint8_t histMgmtLqiRspCb(MgmtLqiRspFormat_t *msg);
+static void histAdd(uint16_t from, uint16_t to, uint8_t lqi, uint64_t now);
+static lqiHistEntry_t *histFind(uint16_t from, uint16_t to);
+static lqiHistEntry_t *histNew(uint16_t from, uint16_t to, uint64_t now);
+static uint16_t histTag(uint16_t from, uint16_t to);
+static lqiHistBucket_t *histBucket(lqiHistEntry_t *entry, uint8_t tier,
+        uint32_t period);
+static void histSummary(lqiHistEntry_t *entry, uint8_t tier, uint8_t window,
+        uint32_t now, lqiHistLink_t *link);
+
+static mtZdoCb_t histZdoCbs =
+	{ .pfnZdoMgmtLqiRsp = histMgmtLqiRspCb, };
+
+static mtAfCb_t histAfCbs =
+	{ NULL,			//MT_AF_DATA_CONFIRM
+	        histIncomingMsgCb,	//MT_AF_INCOMING_MSG
+	        histIncomingMsgExtCb,	//MT_AF_INCOMING_MSG_EXT
+	        NULL,			//MT_AF_DATA_RETRIEVE
+	        NULL,			//MT_AF_REFLECT_ERROR
+	    };
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      lqiHistInit
+ *
+ * @brief   initialise the link quality history, must be called once
+ *          after rpcInitMq(). Incoming AF messages and
+ *          ZDO_MGMT_LQI_RSPs are then recorded.
+ *
+ * @param   -
+ *
+ * @return  status, -1 if its observers could not be registered
+ */
+int32_t lqiHistInit(void)
+{
+	hashIdxInit(&histHash, histSlots, LQI_HIST_HASH_SIZE);
+	memset(&histStats, 0, sizeof(histStats));
+
+	sem_init(&histSem, 0, 1);
+
+	if (!histInitDone)
+	{
+		if ((zdoRegisterObserver(&histZdoCbs) != 0)
+		        || (afRegisterObserver(&histAfCbs) != 0))
+		{
+			dbg_print(PRINT_LEVEL_WARNING,
+			        "lqiHistInit: no free observer entry\n");
+			return -1;
+		}
+		histInitDone = 1;
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      lqiHistAdd
+ *
+ * @brief   record a sample measured by other means
+ *
+ * @param   from - transmitter
+ * @param   to - receiver
+ * @param   lqi - link quality
+ *
+ * @return  -
+ */
+void lqiHistAdd(uint16_t from, uint16_t to, uint8_t lqi)
+{
+	uint64_t now = rpcTimerNow();
+
+	sem_wait(&histSem);
+
+	histAdd(from, to, lqi, now);
+
+	sem_post(&histSem);
+}
+
+/*********************************************************************
+ * @fn      lqiHistGetSeries
+ *
+ * @brief   get the buckets of a link up to the current period, oldest
+ *          first
+ *
+ * @param   from - transmitter
+ * @param   to - receiver
+ * @param   tier - LQI_HIST_xxx
+ * @param   buckets - filled in with the buckets
+ * @param   maxBuckets - size of buckets
+ *
+ * @return  number of buckets filled in, -1 if the link is not recorded
+ */
+int32_t lqiHistGetSeries(uint16_t from, uint16_t to, uint8_t tier,
+        lqiHistBucket_t *buckets, uint8_t maxBuckets)
+{
+	lqiHistEntry_t *entry;
+	lqiHistBucket_t *bucket;
+	uint32_t period;
+	uint8_t count, idx;
+
+	if (tier >= LQI_HIST_TIERS)
+	{
+		return -1;
+	}
+
+	period = (uint32_t) (rpcTimerNow() / histPeriod[tier]);
+	count = (maxBuckets < histSize[tier]) ? maxBuckets : histSize[tier];
+
+	sem_wait(&histSem);
+
+	entry = histFind(from, to);
+	for (idx = 0; entry && (idx < count); idx++)
+	{
+		bucket = histBucket(entry, tier, period - (count - 1) + idx);
+		if (bucket)
+		{
+			memcpy(&buckets[idx], bucket, sizeof(lqiHistBucket_t));
+		}
+		else
+		{
+			memset(&buckets[idx], 0, sizeof(lqiHistBucket_t));
+		}
+	}
+
+	sem_post(&histSem);
+
+	return entry ? count : -1;
+}
+
+/*********************************************************************
+ * @fn      lqiHistGetLink
+ *
+ * @brief   summarise a link over the last buckets of a tier
+ *
+ * @param   from - transmitter
+ * @param   to - receiver
+ * @param   tier - LQI_HIST_xxx
+ * @param   window - buckets, the current one included
+ * @param   link - filled in with the summary
+ *
+ * @return  status, -1 if the link has no sample in the window
+ */
+int32_t lqiHistGetLink(uint16_t from, uint16_t to, uint8_t tier,
+        uint8_t window, lqiHistLink_t *link)
+{
+	lqiHistEntry_t *entry;
+	uint32_t period;
+
+	if (tier >= LQI_HIST_TIERS)
+	{
+		return -1;
+	}
+
+	period = (uint32_t) (rpcTimerNow() / histPeriod[tier]);
+
+	sem_wait(&histSem);
+
+	entry = histFind(from, to);
+	if (entry)
+	{
+		histSummary(entry, tier, window, period, link);
+	}
+
+	sem_post(&histSem);
+
+	return (entry && link->samples) ? 0 : -1;
+}
+
+/*********************************************************************
+ * @fn      lqiHistWorst
+ *
+ * @brief   get the links with the lowest average LQI over the last
+ *          buckets of a tier, worst first
+ *
+ * @param   tier - LQI_HIST_xxx
+ * @param   window - buckets, the current one included
+ * @param   links - filled in with the links
+ * @param   maxLinks - size of links
+ *
+ * @return  number of links filled in
+ */
+int32_t lqiHistWorst(uint8_t tier, uint8_t window, lqiHistLink_t *links,
+        uint16_t maxLinks)
+{
+	lqiHistLink_t link;
+	uint32_t period;
+	uint16_t idx, pos, count = 0;
+
+	if ((tier >= LQI_HIST_TIERS) || (maxLinks == 0))
+	{
+		return 0;
+	}
+
+	period = (uint32_t) (rpcTimerNow() / histPeriod[tier]);
+
+	sem_wait(&histSem);
+
+	for (idx = 0; idx < histStats.links; idx++)
+	{
+		histSummary(&histLinks[idx], tier, window, period, &link);
+		if (link.samples == 0)
+		{
+			continue;
+		}
+
+		// insertion into the sorted array, dropping the best if full
+		if ((count == maxLinks) && (link.avg >= links[count - 1].avg))
+		{
+			continue;
+		}
+		pos = (count < maxLinks) ? count++ : count - 1;
+		while ((pos > 0) && (links[pos - 1].avg > link.avg))
+		{
+			links[pos] = links[pos - 1];
+			pos--;
+		}
+		links[pos] = link;
+	}
+
+	sem_post(&histSem);
+
+	return count;
+}
+
+/*********************************************************************
+ * @fn      lqiHistGetStats
+ *
+ * @brief   get the link quality history counters
+ *
+ * @param   stats - filled in with the counters
+ *
+ * @return  -
+ */
+void lqiHistGetStats(lqiHistStats_t *stats)
+{
+	sem_wait(&histSem);
+
+	memcpy(stats, &histStats, sizeof(lqiHistStats_t));
+
+	sem_post(&histSem);
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      histIncomingMsgCb
+ *
+ * @brief   MT_AF_INCOMING_MSG observer
+ *
+ * @param   msg - incoming message
+ *
+ * @return  0, the application still gets the message
+ */
+static uint8_t histIncomingMsgCb(IncomingMsgFormat_t *msg)
+{
+	lqiHistAdd(msg->SrcAddr, LQI_HIST_LOCAL, msg->LinkQuality);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      histIncomingMsgExtCb
+ *
+ * @brief   MT_AF_INCOMING_MSG_EXT observer, messages from an IEEE
+ *          address are not recorded
+ *
+ * @param   msg - incoming message
+ *
+ * @return  0, the application still gets the message
+ */
+static uint8_t histIncomingMsgExtCb(IncomingMsgExtFormat_t *msg)
+{
+	if (msg->SrcAddrMode == Addr16Bit)
+	{
+		lqiHistAdd((uint16_t) msg->SrcAddr, LQI_HIST_LOCAL, msg->LinkQuality);
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      histMgmtLqiRspCb
+ *
+ * @brief   MT_ZDO_MGMT_LQI_RSP observer, each neighbor is a link to the
+ *          device answering
+ *
+ * @param   msg - response
+ *
+ * @return  0, the response is left to the others
+ */
+static uint8_t histMgmtLqiRspCb(MgmtLqiRspFormat_t *msg)
+{
+	uint64_t now = rpcTimerNow();
+	uint8_t idx;
+
+	if (msg->Status != MT_RPC_SUCCESS)
+	{
+		return 0;
+	}
+
+	sem_wait(&histSem);
+
+	for (idx = 0; idx < msg->NeighborLqiListCount; idx++)
+	{
+		// unused or invalid short address
+		if (msg->NeighborLqiList[idx].NetworkAddress < 0xFFF8)
+		{
+			histAdd(msg->NeighborLqiList[idx].NetworkAddress, msg->SrcAddr,
+			        msg->NeighborLqiList[idx].LQI, now);
+		}
+	}
+
+	sem_post(&histSem);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      histAdd
+ *
+ * @brief   add a sample to the current bucket of each tier, called with
+ *          histSem held
+ *
+ * @param   from - transmitter
+ * @param   to - receiver
+ * @param   lqi - link quality
+ * @param   now - rpcTimerNow()
+ *
+ * @return  -
+ */
+static void histAdd(uint16_t from, uint16_t to, uint8_t lqi, uint64_t now)
+{
+	lqiHistEntry_t *entry = histFind(from, to);
+	lqiHistBucket_t *bucket;
+	uint32_t period, skip;
+	uint8_t tier;
+
+	if (entry == NULL)
+	{
+		entry = histNew(from, to, now);
+		if (entry == NULL)
+		{
+			histStats.dropped++;
+			return;
+		}
+	}
+	histStats.samples++;
+	entry->lastSeen = now;
+
+	for (tier = 0; tier < LQI_HIST_TIERS; tier++)
+	{
+		period = (uint32_t) (now / histPeriod[tier]);
+		if ((period != entry->head[tier]) || (entry->cnt[tier] == 0))
+		{
+			// clear the buckets of the periods without samples
+			for (skip = entry->head[tier] + 1; (skip <= period)
+			        && (skip - entry->head[tier] <= histSize[tier]); skip++)
+			{
+				memset(&entry->buckets[histOffset[tier]
+				        + skip % histSize[tier]], 0, sizeof(lqiHistBucket_t));
+			}
+			entry->head[tier] = period;
+			entry->sum[tier] = 0;
+			entry->cnt[tier] = 0;
+		}
+
+		bucket = &entry->buckets[histOffset[tier] + period % histSize[tier]];
+		entry->sum[tier] += lqi;
+		entry->cnt[tier]++;
+		bucket->avg = (uint8_t) (entry->sum[tier] / entry->cnt[tier]);
+		if ((entry->cnt[tier] == 1) || (lqi < bucket->min))
+		{
+			bucket->min = lqi;
+		}
+		if ((entry->cnt[tier] == 1) || (lqi > bucket->max))
+		{
+			bucket->max = lqi;
+		}
+		bucket->count++;
+	}
+}
+
+/*********************************************************************
+ * @fn      histFind
+ *
+ * @brief   find a link, called with histSem held
+ *
+ * @param   from - transmitter
+ * @param   to - receiver
+ *
+ * @return  the link, NULL if not recorded
+ */
+static lqiHistEntry_t *histFind(uint16_t from, uint16_t to)
+{
+	lqiHistEntry_t *entry;
+	uint16_t tag = histTag(from, to);
+	uint16_t idx, slot;
+
+	idx = hashIdxFirst(&histHash, tag, &slot);
+	while (idx != HASH_IDX_NONE)
+	{
+		entry = &histLinks[idx];
+		if ((entry->from == from) && (entry->to == to))
+		{
+			return entry;
+		}
+		idx = hashIdxNext(&histHash, tag, &slot);
+	}
+
+	return NULL;
+}
+
+/*********************************************************************
+ * @fn      histNew
+ *
+ * @brief   record a new link, called with histSem held. When the table
+ *          is full the least recently sampled link is replaced if it
+ *          is idle, the scan only happens for a new link.
+ *
+ * @param   from - transmitter
+ * @param   to - receiver
+ * @param   now - rpcTimerNow()
+ *
+ * @return  the link, NULL if the table is full of active links
+ */
+static lqiHistEntry_t *histNew(uint16_t from, uint16_t to, uint64_t now)
+{
+	lqiHistEntry_t *entry;
+	uint16_t idx, slot;
+
+	if (histStats.links < LQI_HIST_MAX_LINKS)
+	{
+		idx = histStats.links++;
+	}
+	else
+	{
+		idx = 0;
+		for (slot = 1; slot < LQI_HIST_MAX_LINKS; slot++)
+		{
+			if (histLinks[slot].lastSeen < histLinks[idx].lastSeen)
+			{
+				idx = slot;
+			}
+		}
+		if (now - histLinks[idx].lastSeen < LQI_HIST_IDLE_TIMEOUT)
+		{
+			return NULL;
+		}
+		hashIdxDelete(&histHash,
+		        histTag(histLinks[idx].from, histLinks[idx].to), idx);
+		histStats.evicted++;
+	}
+
+	entry = &histLinks[idx];
+	memset(entry, 0, sizeof(lqiHistEntry_t));
+	entry->from = from;
+	entry->to = to;
+
+	hashIdxInsert(&histHash, histTag(from, to), idx);
+
+	return entry;
+}
+
+/*********************************************************************
+ * @fn      histTag
+ *
+ * @brief   tag of a link in histHash
+ *
+ * @param   from - transmitter
+ * @param   to - receiver
+ *
+ * @return  tag
+ */
+static uint16_t histTag(uint16_t from, uint16_t to)
+{
+	return hashIdxTag32(((uint32_t) from << 16) | to);
+}
+
+/*********************************************************************
+ * @fn      histBucket
+ *
+ * @brief   get the bucket of a period, called with histSem held
+ *
+ * @param   entry - the link
+ * @param   tier - LQI_HIST_xxx
+ * @param   period - time / period of the tier
+ *
+ * @return  the bucket, NULL if it holds no sample of the period
+ */
+static lqiHistBucket_t *histBucket(lqiHistEntry_t *entry, uint8_t tier,
+        uint32_t period)
+{
+	lqiHistBucket_t *bucket;
+
+	if ((entry->cnt[tier] == 0) || (period > entry->head[tier])
+	        || ((entry->head[tier] - period) >= histSize[tier]))
+	{
+		return NULL;
+	}
+
+	bucket = &entry->buckets[histOffset[tier] + period % histSize[tier]];
+
+	return bucket->count ? bucket : NULL;
+}
+
+/*********************************************************************
+ * @fn      histSummary
+ *
+ * @brief   summarise a link over the last buckets of a tier, called
+ *          with histSem held
+ *
+ * @param   entry - the link
+ * @param   tier - LQI_HIST_xxx
+ * @param   window - buckets, the current one included
+ * @param   now - current period of the tier
+ * @param   link - filled in with the summary, samples is 0 if the
+ *          window holds none
+ *
+ * @return  -
+ */
+static void histSummary(lqiHistEntry_t *entry, uint8_t tier, uint8_t window,
+        uint32_t now, lqiHistLink_t *link)
+{
+	lqiHistBucket_t *bucket;
+	// a day of samples at a high rate overflows 32 bits once weighted
+	uint64_t sum = 0, halfSum[2] = { 0, 0 };
+	uint32_t halfCnt[2] = { 0, 0 };
+	uint8_t idx, half;
+
+	if ((window == 0) || (window > histSize[tier]))
+	{
+		window = histSize[tier];
+	}
+
+	memset(link, 0, sizeof(lqiHistLink_t));
+	link->from = entry->from;
+	link->to = entry->to;
+	link->min = 0xFF;
+
+	for (idx = 0; idx < window; idx++)
+	{
+		bucket = histBucket(entry, tier, now - (window - 1) + idx);
+		if (bucket == NULL)
+		{
+			continue;
+		}
+
+		half = (idx >= (window / 2)) ? 1 : 0;
+		sum += (uint64_t) bucket->avg * bucket->count;
+		halfSum[half] += (uint64_t) bucket->avg * bucket->count;
+		halfCnt[half] += bucket->count;
+		link->samples += bucket->count;
+		if (bucket->min < link->min)
+		{
+			link->min = bucket->min;
+		}
+	}
+
+	if (link->samples)
+	{
+		link->avg = (uint8_t) (sum / link->samples);
+	}
+	if (halfCnt[0] && halfCnt[1])
+	{
+		link->trend = (int16_t) (halfSum[1] / halfCnt[1])
+		        - (int16_t) (halfSum[0] / halfCnt[0]);
+	}
+}
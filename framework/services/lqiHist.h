@@ -0,0 +1,127 @@
+/*
+ * lqiHist.h
+ *
+ * This module contains the link quality history of the ZigBee Network
+ * Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef LQIHIST_H
+#define LQIHIST_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// links recorded. When the table is full a new link replaces the least
+// recently sampled one if that had no sample for LQI_HIST_IDLE_TIMEOUT
+// ms, otherwise the samples of the new link are dropped.
+#define LQI_HIST_MAX_LINKS            (256)
+#define LQI_HIST_IDLE_TIMEOUT         (3600000)
+
+// tiers, each a ring of buckets of one period
+#define LQI_HIST_MINUTE               (0)  // 60 buckets of 1 min
+#define LQI_HIST_HOUR                 (1)  // 24 buckets of 1 h
+#define LQI_HIST_DAY                  (2)  // 30 buckets of 1 day
+#define LQI_HIST_TIERS                (3)
+
+#define LQI_HIST_MINUTE_BUCKETS       (60)
+#define LQI_HIST_HOUR_BUCKETS         (24)
+#define LQI_HIST_DAY_BUCKETS          (30)
+
+// receiver of the links fed from incoming AF messages, the LinkQuality
+// of a message is measured by the ZNP on its last hop
+#define LQI_HIST_LOCAL                (0x0000)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// samples of one period, count is 0 if there were none
+typedef struct
+{
+	uint8_t avg;
+	uint8_t min;
+	uint8_t max;
+	uint32_t count;
+} lqiHistBucket_t;
+
+typedef struct
+{
+	uint16_t from;         // transmitter
+	uint16_t to;           // receiver measuring the LQI
+	uint8_t avg;           // over the window asked for
+	uint8_t min;
+	int16_t trend;         // average of the newer half of the window
+	                       // minus that of the older half
+	uint32_t samples;
+} lqiHistLink_t;
+
+typedef struct
+{
+	uint16_t links;
+	uint32_t samples;
+	uint32_t dropped;      // samples of links not recorded, table full
+	uint32_t evicted;      // idle links replaced by new ones
+} lqiHistStats_t;
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+int32_t lqiHistInit(void);
+void lqiHistAdd(uint16_t from, uint16_t to, uint8_t lqi);
+int32_t lqiHistGetSeries(uint16_t from, uint16_t to, uint8_t tier,
+        lqiHistBucket_t *buckets, uint8_t maxBuckets);
+int32_t lqiHistGetLink(uint16_t from, uint16_t to, uint8_t tier,
+        uint8_t window, lqiHistLink_t *link);
+int32_t lqiHistWorst(uint8_t tier, uint8_t window, lqiHistLink_t *links,
+        uint16_t maxLinks);
+void lqiHistGetStats(lqiHistStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LQIHIST_H */
@@ -0,0 +1,658 @@
+/*
+ * netStart.c
+ *
+ * This module contains the network startup of the ZigBee Network
+ * Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include <semaphore.h>
+
+#include "netStart.h"
+#include "rpc.h"
+#include "rpcDispatch.h"
+#include "mtSys.h"
+#include "mtZdo.h"
+#include "mtSapi.h"
+#include "rpcTimer.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define NET_START_NO_TARGET           (0xFF)
+
+// with dispatch workers, longest time to wait for an observer after the
+// frames were handed over before reading the queue again, in ms
+#define NET_START_DISPATCH_SLICE      (10)
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// set by the observers, posted on netEvtSem
+static volatile uint8_t netState = DEV_HOLD;
+static volatile uint8_t netTarget = NET_START_NO_TARGET;
+static volatile uint8_t netUp = 0;
+static volatile uint8_t netResetInd = 0;
+static sem_t netEvtSem;
+
+// counters of the running startup, published to netStats when done
+static netStartStats_t netCur;
+static netStartStats_t netStats;
+
+// protects netStats
+static sem_t netSem;
+
+static uint8_t netInitDone = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS DECLARATION
+ */
+
+static uint8_t netStateChangeIndCb(uint8_t zdoState);
+static uint8_t netResetIndCb(ResetIndFormat_t *msg);
+static int32_t netResume(netStartCfg_t *cfg, uint32_t timeout);
+static int32_t netNew(netStartCfg_t *cfg, uint32_t timeout);
+static uint8_t netConfigMatch(netStartCfg_t *cfg);
+static int32_t netReset(uint64_t deadline);
+static int32_t netStartup(netStartCfg_t *cfg, uint8_t devType,
+        uint64_t deadline);
+static int32_t netWait(volatile uint8_t *flag, uint64_t deadline);
+static int32_t netNvRead(uint16_t id, uint8_t *value, uint8_t len);
+static int32_t netNvSet(uint16_t id, uint8_t *value, uint8_t len);
+
+static mtZdoCb_t netZdoCbs =
+	{ .pfnmtZdoStateChangeInd = netStateChangeIndCb, };
+
+static mtSysCb_t netSysCbs =
+	{ .pfnSysResetInd = netResetIndCb, };
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      netStartInit
+ *
+ * @brief   initialise the network startup, must be called once after
+ *          rpcInitMq()
+ *
+ * @param   -
+ *
+ * @return  status, -1 if its observers could not be registered
+ */
+int32_t netStartInit(void)
+{
+	memset(&netStats, 0, sizeof(netStats));
+
+	if (!netInitDone)
+	{
+		sem_init(&netSem, 0, 1);
+		sem_init(&netEvtSem, 0, 0);
+
+		if ((zdoRegisterObserver(&netZdoCbs) != 0)
+		        || (sysRegisterObserver(&netSysCbs) != 0))
+		{
+			dbg_print(PRINT_LEVEL_WARNING,
+			        "netStartInit: no free observer entry\n");
+			return -1;
+		}
+		netInitDone = 1;
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      netStart
+ *
+ * @brief   bring the network up. NV items already holding the value are
+ *          not written and the network in NV is resumed without a reset
+ *          when possible; a resume that does not come up falls back to
+ *          a reset. Blocks until the network is up, waiting on
+ *          MT_SYS_RESET_IND and MT_ZDO_STATE_CHANGE_IND. Without inline
+ *          dispatch the messages are processed on the calling thread
+ *          meanwhile.
+ *
+ * @param   cfg - startup configuration
+ *
+ * @return  status, -1 if the network did not come up
+ */
+int32_t netStart(netStartCfg_t *cfg)
+{
+	uint64_t start = rpcTimerNow();
+	uint32_t timeout = cfg->timeout ? cfg->timeout : NET_START_TIMEOUT;
+	uint8_t mode = cfg->mode;
+	int32_t status;
+
+	if (!netInitDone)
+	{
+		return -1;
+	}
+
+	memset(&netCur, 0, sizeof(netCur));
+
+	if (mode == NET_START_AUTO)
+	{
+		mode = netConfigMatch(cfg) ? NET_START_RESUME : NET_START_NEW;
+	}
+
+	if (mode == NET_START_NEW)
+	{
+		status = netNew(cfg, timeout);
+	}
+	else
+	{
+		status = netResume(cfg, timeout);
+	}
+
+	netCur.state = netState;
+	netCur.resumed = (netCur.resets == 0);
+	netCur.totalTime = (uint32_t) (rpcTimerNow() - start);
+
+	dbg_print(PRINT_LEVEL_INFO,
+	        "netStart: %s in %dms, %d resets, %d NV writes, %d skipped\n",
+	        (status == 0) ? "up" : "failed", netCur.totalTime, netCur.resets,
+	        netCur.nvWrites, netCur.nvSkipped);
+
+	sem_wait(&netSem);
+	memcpy(&netStats, &netCur, sizeof(netStartStats_t));
+	sem_post(&netSem);
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      netStartState
+ *
+ * @brief   get the last state reported by MT_ZDO_STATE_CHANGE_IND
+ *
+ * @param   -
+ *
+ * @return  devStates_t
+ */
+uint8_t netStartState(void)
+{
+	return netState;
+}
+
+/*********************************************************************
+ * @fn      netStartGetStats
+ *
+ * @brief   get the counters of the last netStart()
+ *
+ * @param   stats - filled in with the counters
+ *
+ * @return  -
+ */
+void netStartGetStats(netStartStats_t *stats)
+{
+	sem_wait(&netSem);
+
+	memcpy(stats, &netStats, sizeof(netStartStats_t));
+
+	sem_post(&netSem);
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      netStateChangeIndCb
+ *
+ * @brief   MT_ZDO_STATE_CHANGE_IND observer
+ *
+ * @param   zdoState - devStates_t
+ *
+ * @return  0, the application still gets the message
+ */
+static uint8_t netStateChangeIndCb(uint8_t zdoState)
+{
+	netState = zdoState;
+	if (zdoState == netTarget)
+	{
+		netUp = 1;
+		sem_post(&netEvtSem);
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      netResetIndCb
+ *
+ * @brief   MT_SYS_RESET_IND observer
+ *
+ * @param   msg - indication
+ *
+ * @return  0, the application still gets the message
+ */
+static uint8_t netResetIndCb(ResetIndFormat_t *msg)
+{
+	netState = DEV_HOLD;
+	netResetInd = 1;
+	sem_post(&netEvtSem);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      netResume
+ *
+ * @brief   start the network in NV, first without a reset
+ *
+ * @param   cfg - startup configuration
+ * @param   timeout - ms for each attempt
+ *
+ * @return  status
+ */
+static int32_t netResume(netStartCfg_t *cfg, uint32_t timeout)
+{
+	uint8_t value = 0;
+
+	// a later reset must not clear the network either
+	if (netNvSet(ZCD_NV_STARTUP_OPTION, &value, 1) != 0)
+	{
+		return -1;
+	}
+
+	if (netNvRead(ZCD_NV_LOGICAL_TYPE, &value, 1) != 0)
+	{
+		return -1;
+	}
+
+	if (netStartup(cfg, value, rpcTimerNow() + timeout) == 0)
+	{
+		return 0;
+	}
+
+	dbg_print(PRINT_LEVEL_WARNING,
+	        "netResume: network not resumed, resetting the ZNP\n");
+
+	if (netReset(rpcTimerNow() + timeout) != 0)
+	{
+		return -1;
+	}
+
+	return netStartup(cfg, value, rpcTimerNow() + timeout);
+}
+
+/*********************************************************************
+ * @fn      netNew
+ *
+ * @brief   clear the network and configuration and start a new network
+ *
+ * @param   cfg - startup configuration
+ * @param   timeout - ms for each step waiting on the ZNP
+ *
+ * @return  status
+ */
+static int32_t netNew(netStartCfg_t *cfg, uint32_t timeout)
+{
+	uint8_t value[4];
+	uint8_t devType = cfg->devType;
+
+	value[0] = ZCD_STARTOPT_CLEAR_STATE | ZCD_STARTOPT_CLEAR_CONFIG;
+	if ((netNvSet(ZCD_NV_STARTUP_OPTION, value, 1) != 0)
+	        || (netReset(rpcTimerNow() + timeout) != 0))
+	{
+		return -1;
+	}
+
+	// the reset restored the default configuration, write what differs
+	if (devType != NET_START_KEEP_TYPE)
+	{
+		if (netNvSet(ZCD_NV_LOGICAL_TYPE, &devType, 1) != 0)
+		{
+			return -1;
+		}
+	}
+	else if (netNvRead(ZCD_NV_LOGICAL_TYPE, &devType, 1) != 0)
+	{
+		return -1;
+	}
+
+	value[0] = LO_UINT16(cfg->panId);
+	value[1] = HI_UINT16(cfg->panId);
+	if (netNvSet(ZCD_NV_PANID, value, 2) != 0)
+	{
+		return -1;
+	}
+
+	value[0] = BREAK_UINT32(cfg->chanList, 0);
+	value[1] = BREAK_UINT32(cfg->chanList, 1);
+	value[2] = BREAK_UINT32(cfg->chanList, 2);
+	value[3] = BREAK_UINT32(cfg->chanList, 3);
+	if (netNvSet(ZCD_NV_CHANLIST, value, 4) != 0)
+	{
+		return -1;
+	}
+
+	if (netStartup(cfg, devType, rpcTimerNow() + timeout) != 0)
+	{
+		return -1;
+	}
+
+	// keep the network in case of a reset
+	value[0] = 0;
+	return netNvSet(ZCD_NV_STARTUP_OPTION, value, 1);
+}
+
+/*********************************************************************
+ * @fn      netConfigMatch
+ *
+ * @brief   check whether NV holds a network formed with the
+ *          configuration, a PAN ID of 0xFFFF matches any
+ *
+ * @param   cfg - startup configuration
+ *
+ * @return  1 if it does
+ */
+static uint8_t netConfigMatch(netStartCfg_t *cfg)
+{
+	OsalNvLengthFormat_t lenReq;
+	OsalNvLengthSrspFormat_t lenRsp;
+	uint8_t value[4];
+
+	// the next start must not clear the network, and the NIB is only in
+	// NV once a network was formed or joined
+	if ((netNvRead(ZCD_NV_STARTUP_OPTION, value, 1) != 0)
+	        || (value[0] & (ZCD_STARTOPT_CLEAR_STATE | ZCD_STARTOPT_CLEAR_CONFIG)))
+	{
+		return 0;
+	}
+
+	lenReq.Id = ZCD_NV_NIB;
+	if ((sysOsalNvLengthRsp(&lenReq, &lenRsp) != MT_RPC_SUCCESS)
+	        || (lenRsp.ItemLen == 0))
+	{
+		return 0;
+	}
+
+	if ((cfg->devType != NET_START_KEEP_TYPE)
+	        && ((netNvRead(ZCD_NV_LOGICAL_TYPE, value, 1) != 0)
+	                || (value[0] != cfg->devType)))
+	{
+		return 0;
+	}
+
+	if ((cfg->panId != 0xFFFF)
+	        && ((netNvRead(ZCD_NV_PANID, value, 2) != 0)
+	                || (value[0] != LO_UINT16(cfg->panId))
+	                || (value[1] != HI_UINT16(cfg->panId))))
+	{
+		return 0;
+	}
+
+	if ((netNvRead(ZCD_NV_CHANLIST, value, 4) != 0)
+	        || (value[0] != BREAK_UINT32(cfg->chanList, 0))
+	        || (value[1] != BREAK_UINT32(cfg->chanList, 1))
+	        || (value[2] != BREAK_UINT32(cfg->chanList, 2))
+	        || (value[3] != BREAK_UINT32(cfg->chanList, 3)))
+	{
+		return 0;
+	}
+
+	return 1;
+}
+
+/*********************************************************************
+ * @fn      netReset
+ *
+ * @brief   reset the ZNP and wait for MT_SYS_RESET_IND
+ *
+ * @param   deadline - rpcTimerNow() to give up at
+ *
+ * @return  status
+ */
+static int32_t netReset(uint64_t deadline)
+{
+	ResetReqFormat_t req;
+	uint64_t start = rpcTimerNow();
+
+	netResetInd = 0;
+	netCur.resets++;
+
+	req.Type = 1;
+	sysResetReq(&req);
+
+	if (netWait(&netResetInd, deadline) != 0)
+	{
+		dbg_print(PRINT_LEVEL_WARNING, "netReset: no MT_SYS_RESET_IND\n");
+		return -1;
+	}
+
+	netCur.resetTime += (uint32_t) (rpcTimerNow() - start);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      netStartup
+ *
+ * @brief   register the endpoints, start ZDO and wait for the state of
+ *          the device type. A ZNP already in that state, as when only
+ *          the host restarted, is not started again.
+ *
+ * @param   cfg - startup configuration
+ * @param   devType - DEVICETYPE_xxx
+ * @param   deadline - rpcTimerNow() to give up at
+ *
+ * @return  status
+ */
+static int32_t netStartup(netStartCfg_t *cfg, uint8_t devType,
+        uint64_t deadline)
+{
+	GetDeviceInfoFormat_t infoReq;
+	GetDeviceInfoSrspFormat_t infoRsp;
+	uint64_t start;
+	uint8_t status;
+
+	if (cfg->registerCb && (cfg->registerCb() != 0))
+	{
+		dbg_print(PRINT_LEVEL_INFO, "netStartup: endpoints not registered\n");
+	}
+
+	switch (devType)
+	{
+	case DEVICETYPE_COORDINATOR:
+		netTarget = DEV_ZB_COORD;
+		break;
+	case DEVICETYPE_ROUTER:
+		netTarget = DEV_ROUTER;
+		break;
+	default:
+		netTarget = DEV_END_DEVICE;
+		break;
+	}
+	netUp = 0;
+
+	infoReq.Param = ZB_INFO_DEV_STATE;
+	if ((zbGetDeviceInfoRsp(&infoReq, &infoRsp) == MT_RPC_SUCCESS)
+	        && (infoRsp.Value[0] == netTarget))
+	{
+		dbg_print(PRINT_LEVEL_INFO, "netStartup: the ZNP is already up\n");
+		netState = netTarget;
+		netTarget = NET_START_NO_TARGET;
+		netCur.restored = 1;
+		return 0;
+	}
+
+	start = rpcTimerNow();
+	status = zdoInit();
+	if ((status != NEW_NETWORK) && (status != RESTORED_NETWORK))
+	{
+		dbg_print(PRINT_LEVEL_WARNING, "netStartup: zdoInit failed [%d]\n",
+		        status);
+		netTarget = NET_START_NO_TARGET;
+		return -1;
+	}
+	netCur.restored = (status == RESTORED_NETWORK);
+
+	status = netWait(&netUp, deadline);
+	netTarget = NET_START_NO_TARGET;
+	if (status != 0)
+	{
+		return -1;
+	}
+
+	netCur.startupTime += (uint32_t) (rpcTimerNow() - start);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      netWait
+ *
+ * @brief   wait until an observer sets a flag. With inline dispatch the
+ *          observers post netEvtSem, otherwise the queued messages are
+ *          read here as they arrive. With dispatch workers the observers
+ *          run after the frames were handed over, so netEvtSem is waited
+ *          on after each read.
+ *
+ * @param   flag - set by the observer
+ * @param   deadline - rpcTimerNow() to give up at
+ *
+ * @return  status, -1 on timeout
+ */
+static int32_t netWait(volatile uint8_t *flag, uint64_t deadline)
+{
+	struct timespec to;
+	uint64_t now, slice;
+
+	while (!*flag)
+	{
+		now = rpcTimerNow();
+		if (now >= deadline)
+		{
+			return -1;
+		}
+
+		if (rpcInlineDispatchEnabled())
+		{
+			rpcTimerAbsTime(deadline, &to);
+			sem_timedwait(&netEvtSem, &to);
+		}
+		else if (rpcDispatchEnabled())
+		{
+			if (rpcDrainMqClientMsg((uint32_t) (deadline - now), 0) > 0)
+			{
+				slice = rpcTimerNow() + NET_START_DISPATCH_SLICE;
+				rpcTimerAbsTime((slice < deadline) ? slice : deadline, &to);
+				sem_timedwait(&netEvtSem, &to);
+			}
+		}
+		else
+		{
+			rpcDrainMqClientMsg((uint32_t) (deadline - now), 0);
+		}
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      netNvRead
+ *
+ * @brief   read the start of an NV item
+ *
+ * @param   id - NV item ID
+ * @param   value - filled in with the bytes
+ * @param   len - bytes to read
+ *
+ * @return  status
+ */
+static int32_t netNvRead(uint16_t id, uint8_t *value, uint8_t len)
+{
+	OsalNvReadFormat_t req;
+	OsalNvReadSrspFormat_t rsp;
+
+	req.Id = id;
+	req.Offset = 0;
+	netCur.nvReads++;
+	if ((sysOsalNvReadRsp(&req, &rsp) != MT_RPC_SUCCESS)
+	        || (rsp.Status != SUCCESS) || (rsp.Len < len))
+	{
+		dbg_print(PRINT_LEVEL_WARNING, "netNvRead: 0x%04X failed\n", id);
+		return -1;
+	}
+	memcpy(value, rsp.Value, len);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      netNvSet
+ *
+ * @brief   write an NV item unless it already holds the value
+ *
+ * @param   id - NV item ID
+ * @param   value - bytes to write
+ * @param   len - length of value
+ *
+ * @return  status
+ */
+static int32_t netNvSet(uint16_t id, uint8_t *value, uint8_t len)
+{
+	OsalNvWriteFormat_t req;
+	uint8_t status;
+
+	if ((netNvRead(id, req.Value, len) == 0)
+	        && (memcmp(req.Value, value, len) == 0))
+	{
+		netCur.nvSkipped++;
+		return 0;
+	}
+
+	req.Id = id;
+	req.Offset = 0;
+	req.Len = len;
+	memcpy(req.Value, value, len);
+	netCur.nvWrites++;
+	if ((sysOsalNvWriteRsp(&req, &status) != MT_RPC_SUCCESS)
+	        || (status != SUCCESS))
+	{
+		dbg_print(PRINT_LEVEL_WARNING, "netNvSet: 0x%04X failed\n", id);
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * netStart.h
+ *
+ * This module contains the network startup of the ZigBee Network
+ * Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef NETSTART_H
+#define NETSTART_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// netStartCfg_t.mode
+#define NET_START_RESUME              (0)  // the network in NV
+#define NET_START_NEW                 (1)  // form or join a new network
+#define NET_START_AUTO                (2)  // resume if NV holds a network
+                                           // with the config, new
+                                           // otherwise
+
+// netStartCfg_t.devType, keep the logical type in NV
+#define NET_START_KEEP_TYPE           (0xFF)
+
+#define NET_START_TIMEOUT             (30000)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// register the endpoints, called before the ZDO startup. A resumed ZNP
+// may still hold them, so an error is not fatal.
+typedef int32_t (*netStartRegisterCb_t)(void);
+
+typedef struct
+{
+	uint8_t mode;          // NET_START_xxx
+	uint8_t devType;       // DEVICETYPE_xxx, NEW and AUTO only
+	uint16_t panId;        // NEW and AUTO only
+	uint32_t chanList;     // NEW and AUTO only
+	uint32_t timeout;      // ms for each startup attempt, 0 for default
+	netStartRegisterCb_t registerCb;
+} netStartCfg_t;
+
+typedef struct
+{
+	uint8_t state;         // devStates_t
+	uint8_t resumed;       // 1 if the ZNP was not reset
+	uint8_t restored;      // 1 if the network was restored from NV or
+	                       // the ZNP was already up
+	uint8_t resets;
+	uint8_t nvReads;
+	uint8_t nvWrites;
+	uint8_t nvSkipped;     // writes skipped, NV already held the value
+	uint32_t resetTime;    // ms from the reset to MT_SYS_RESET_IND
+	uint32_t startupTime;  // ms from the ZDO startup to the network up
+	uint32_t totalTime;    // ms from netStart() to the network up
+} netStartStats_t;
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+int32_t netStartInit(void);
+int32_t netStart(netStartCfg_t *cfg);
+uint8_t netStartState(void);
+void netStartGetStats(netStartStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NETSTART_H */
@@ -0,0 +1,612 @@
+/*
+ * nvBulk.c
+ *
+ * This module contains the NV backup and restore of the ZigBee Network
+ * Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <semaphore.h>
+
+#include "nvBulk.h"
+#include "rpc.h"
+#include "mtSys.h"
+#include "rpcTimer.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define NV_BULK_FILE_MAGIC            (0x4B42564E)
+#define NV_BULK_FILE_VERSION          (1)
+
+// largest chunk of one SREQ
+#define NV_BULK_READ_MAX              (248)
+#define NV_BULK_WRITE_MAX             (246)
+#define NV_BULK_INIT_MAX              (245)
+
+// MT_SYS_OSAL_NV_ITEM_INIT, the item was created
+#define NV_BULK_ITEM_UNINIT           (0x09)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t count;
+} nvBulkFileHdr_t;
+
+// followed by len bytes of the item
+typedef struct
+{
+	uint16_t id;
+	uint16_t len;
+} nvBulkRecordHdr_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static nvBulkStats_t nvStats;
+
+// serialises the operations
+static sem_t nvSem;
+
+static uint8_t nvInitDone = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS DECLARATION
+ */
+
+static int32_t nvBackup(const char *path, const uint16_t *ids,
+        uint16_t first, uint16_t count);
+static int32_t nvRestoreItem(uint16_t id, uint8_t *data, uint16_t len);
+static int32_t nvLength(uint16_t id, uint16_t *len);
+static int32_t nvRead(uint16_t id, uint16_t offset, uint8_t *data,
+        uint16_t len);
+static int32_t nvWrite(uint16_t id, uint16_t offset, uint8_t *data,
+        uint16_t len);
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      nvBulkInit
+ *
+ * @brief   initialise the NV backup and restore, must be called once
+ *          after rpcOpen()
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+void nvBulkInit(void)
+{
+	memset(&nvStats, 0, sizeof(nvStats));
+
+	sem_init(&nvSem, 0, 1);
+
+	nvInitDone = 1;
+}
+
+/*********************************************************************
+ * @fn      nvBulkBackup
+ *
+ * @brief   save a list of NV items to a file, items not on the device
+ *          are left out. Blocks until done, the SRSPs of the reads are
+ *          also passed to the registered SYS callbacks.
+ *
+ * @param   path - file, replaced once complete
+ * @param   ids - NV item IDs
+ * @param   count - number of ids
+ *
+ * @return  number of items saved, -1 on error
+ */
+int32_t nvBulkBackup(const char *path, const uint16_t *ids, uint16_t count)
+{
+	if (!nvInitDone || (ids == NULL))
+	{
+		return -1;
+	}
+
+	return nvBackup(path, ids, 0, count);
+}
+
+/*********************************************************************
+ * @fn      nvBulkBackupRange
+ *
+ * @brief   save a range of NV items to a file, see nvBulkBackup()
+ *
+ * @param   path - file, replaced once complete
+ * @param   first - first NV item ID
+ * @param   last - last NV item ID, included
+ *
+ * @return  number of items saved, -1 on error
+ */
+int32_t nvBulkBackupRange(const char *path, uint16_t first, uint16_t last)
+{
+	if (!nvInitDone || (last < first) || (last - first >= 0xFFFF))
+	{
+		return -1;
+	}
+
+	return nvBackup(path, NULL, first, last - first + 1);
+}
+
+/*********************************************************************
+ * @fn      nvBulkRestore
+ *
+ * @brief   restore the NV items of a file. Each item is compared with
+ *          the device chunk by chunk and only the bytes that differ are
+ *          written. Missing items are created, items of another length
+ *          deleted and created again. Blocks until done.
+ *
+ * @param   path - file written by nvBulkBackup()
+ *
+ * @return  number of items created or updated, -1 on error
+ */
+int32_t nvBulkRestore(const char *path)
+{
+	nvBulkFileHdr_t hdr;
+	nvBulkRecordHdr_t rec;
+	uint8_t data[NV_BULK_ITEM_MAX];
+	uint64_t start = rpcTimerNow();
+	FILE *file;
+	uint16_t idx;
+	int32_t status = 0;
+
+	if (!nvInitDone)
+	{
+		return -1;
+	}
+
+	file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		dbg_print(PRINT_LEVEL_WARNING, "nvBulkRestore: can not open %s\n",
+		        path);
+		return -1;
+	}
+
+	if ((fread(&hdr, sizeof(hdr), 1, file) != 1)
+	        || (hdr.magic != NV_BULK_FILE_MAGIC)
+	        || (hdr.version != NV_BULK_FILE_VERSION))
+	{
+		dbg_print(PRINT_LEVEL_WARNING, "nvBulkRestore: %s is not a backup\n",
+		        path);
+		fclose(file);
+		return -1;
+	}
+
+	sem_wait(&nvSem);
+
+	memset(&nvStats, 0, sizeof(nvStats));
+	nvStats.items = hdr.count;
+
+	for (idx = 0; idx < hdr.count; idx++)
+	{
+		if ((fread(&rec, sizeof(rec), 1, file) != 1)
+		        || (rec.len > NV_BULK_ITEM_MAX)
+		        || (fread(data, 1, rec.len, file) != rec.len))
+		{
+			dbg_print(PRINT_LEVEL_WARNING, "nvBulkRestore: %s truncated\n",
+			        path);
+			nvStats.failed += hdr.count - idx;
+			status = -1;
+			break;
+		}
+
+		switch (nvRestoreItem(rec.id, data, rec.len))
+		{
+		case 0:
+			nvStats.unchanged++;
+			break;
+		case 1:
+			nvStats.written++;
+			break;
+		default:
+			dbg_print(PRINT_LEVEL_WARNING,
+			        "nvBulkRestore: item 0x%04X not restored\n", rec.id);
+			nvStats.failed++;
+			break;
+		}
+	}
+
+	nvStats.elapsed = (uint32_t) (rpcTimerNow() - start);
+	if (status == 0)
+	{
+		status = nvStats.written;
+	}
+
+	sem_post(&nvSem);
+
+	fclose(file);
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      nvBulkGetStats
+ *
+ * @brief   get the counters of the last backup or restore
+ *
+ * @param   stats - filled in with the counters
+ *
+ * @return  -
+ */
+void nvBulkGetStats(nvBulkStats_t *stats)
+{
+	sem_wait(&nvSem);
+
+	memcpy(stats, &nvStats, sizeof(nvBulkStats_t));
+
+	sem_post(&nvSem);
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      nvBackup
+ *
+ * @brief   save NV items to a temporary file renamed over path once
+ *          complete
+ *
+ * @param   path - file
+ * @param   ids - NV item IDs, NULL for the range from first
+ * @param   first - first NV item ID if ids is NULL
+ * @param   count - number of items
+ *
+ * @return  number of items saved, -1 on error
+ */
+static int32_t nvBackup(const char *path, const uint16_t *ids,
+        uint16_t first, uint16_t count)
+{
+	char tmpPath[NV_BULK_PATH_LEN + 4];
+	uint8_t data[NV_BULK_ITEM_MAX];
+	uint64_t start = rpcTimerNow();
+	nvBulkFileHdr_t hdr;
+	nvBulkRecordHdr_t rec;
+	FILE *file;
+	uint32_t idx;
+	uint8_t ok;
+
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+
+	file = fopen(tmpPath, "wb");
+	if (file == NULL)
+	{
+		dbg_print(PRINT_LEVEL_WARNING, "nvBulkBackup: can not create %s\n",
+		        tmpPath);
+		return -1;
+	}
+
+	hdr.magic = NV_BULK_FILE_MAGIC;
+	hdr.version = NV_BULK_FILE_VERSION;
+	hdr.count = 0;
+	ok = (fwrite(&hdr, sizeof(hdr), 1, file) == 1);
+
+	sem_wait(&nvSem);
+
+	memset(&nvStats, 0, sizeof(nvStats));
+	nvStats.items = count;
+
+	for (idx = 0; (idx < count) && ok; idx++)
+	{
+		rec.id = ids ? ids[idx] : (uint16_t) (first + idx);
+
+		// the length probe tells absent items apart and sizes the reads
+		if (nvLength(rec.id, &rec.len) != 0)
+		{
+			nvStats.failed++;
+			continue;
+		}
+		if (rec.len == 0)
+		{
+			nvStats.absent++;
+			continue;
+		}
+		if ((rec.len > NV_BULK_ITEM_MAX)
+		        || (nvRead(rec.id, 0, data, rec.len) != 0))
+		{
+			dbg_print(PRINT_LEVEL_WARNING,
+			        "nvBulkBackup: item 0x%04X (%d bytes) not saved\n", rec.id,
+			        rec.len);
+			nvStats.failed++;
+			continue;
+		}
+
+		ok = (fwrite(&rec, sizeof(rec), 1, file) == 1)
+		        && (fwrite(data, 1, rec.len, file) == rec.len);
+		hdr.count++;
+	}
+
+	nvStats.elapsed = (uint32_t) (rpcTimerNow() - start);
+
+	sem_post(&nvSem);
+
+	// the count is only known now
+	ok = ok && (fseek(file, 0, SEEK_SET) == 0)
+	        && (fwrite(&hdr, sizeof(hdr), 1, file) == 1);
+
+	if ((fclose(file) == 0) && ok && (rename(tmpPath, path) == 0))
+	{
+		return hdr.count;
+	}
+
+	dbg_print(PRINT_LEVEL_WARNING, "nvBulkBackup: can not write %s\n", path);
+	remove(tmpPath);
+
+	return -1;
+}
+
+/*********************************************************************
+ * @fn      nvRestoreItem
+ *
+ * @brief   bring an NV item of the device to the saved value, called
+ *          with nvSem held
+ *
+ * @param   id - NV item ID
+ * @param   data - saved value
+ * @param   len - length of data
+ *
+ * @return  0 unchanged, 1 created or updated, -1 on error
+ */
+static int32_t nvRestoreItem(uint16_t id, uint8_t *data, uint16_t len)
+{
+	OsalNvDeleteFormat_t del;
+	OsalNvItemInitFormat_t init;
+	uint8_t chunk[NV_BULK_READ_MAX];
+	uint16_t devLen, offset, size, diff, diffEnd;
+	int32_t changed = 0;
+	uint8_t status;
+
+	if (nvLength(id, &devLen) != 0)
+	{
+		return -1;
+	}
+
+	// the length of an item is fixed when it is created
+	if ((devLen != 0) && (devLen != len))
+	{
+		del.Id = id;
+		del.ItemLen = devLen;
+		nvStats.sreqs++;
+		if ((sysOsalNvDeleteRsp(&del, &status) != MT_RPC_SUCCESS)
+		        || (status != SUCCESS))
+		{
+			return -1;
+		}
+		devLen = 0;
+	}
+
+	if (devLen == 0)
+	{
+		init.Id = id;
+		init.ItemLen = len;
+		init.InitLen = (len < NV_BULK_INIT_MAX) ? len : NV_BULK_INIT_MAX;
+		memcpy(init.InitData, data, init.InitLen);
+		nvStats.sreqs++;
+		if ((sysOsalNvItemInitRsp(&init, &status) != MT_RPC_SUCCESS)
+		        || (status != NV_BULK_ITEM_UNINIT))
+		{
+			return -1;
+		}
+		nvStats.bytesWritten += init.InitLen;
+
+		// nothing to compare with, write the rest
+		if (nvWrite(id, init.InitLen, data + init.InitLen,
+		        len - init.InitLen) != 0)
+		{
+			return -1;
+		}
+
+		return 1;
+	}
+
+	for (offset = 0; offset < len; offset += size)
+	{
+		size = len - offset;
+		if (size > NV_BULK_READ_MAX)
+		{
+			size = NV_BULK_READ_MAX;
+		}
+		if (nvRead(id, offset, chunk, size) != 0)
+		{
+			return -1;
+		}
+
+		// write the span from the first to the last differing byte
+		for (diff = 0; (diff < size) && (chunk[diff] == data[offset + diff]);
+		        diff++)
+			;
+		if (diff == size)
+		{
+			continue;
+		}
+		for (diffEnd = size; chunk[diffEnd - 1] == data[offset + diffEnd - 1];
+		        diffEnd--)
+			;
+		if (nvWrite(id, offset + diff, data + offset + diff, diffEnd - diff)
+		        != 0)
+		{
+			return -1;
+		}
+		changed = 1;
+	}
+
+	return changed;
+}
+
+/*********************************************************************
+ * @fn      nvLength
+ *
+ * @brief   get the length of an NV item, called with nvSem held
+ *
+ * @param   id - NV item ID
+ * @param   len - filled in with the length, 0 if the item does not exist
+ *
+ * @return  status
+ */
+static int32_t nvLength(uint16_t id, uint16_t *len)
+{
+	OsalNvLengthFormat_t req;
+	OsalNvLengthSrspFormat_t rsp;
+
+	req.Id = id;
+	nvStats.sreqs++;
+	if (sysOsalNvLengthRsp(&req, &rsp) != MT_RPC_SUCCESS)
+	{
+		return -1;
+	}
+	*len = rsp.ItemLen;
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      nvRead
+ *
+ * @brief   read part of an NV item in as few SREQs as possible, called
+ *          with nvSem held
+ *
+ * @param   id - NV item ID
+ * @param   offset - first byte
+ * @param   data - filled in with the bytes
+ * @param   len - bytes to read
+ *
+ * @return  status
+ */
+static int32_t nvRead(uint16_t id, uint16_t offset, uint8_t *data,
+        uint16_t len)
+{
+	OsalNvReadFormat_t req;
+	OsalNvReadSrspFormat_t rsp;
+	uint16_t done = 0, size, skip;
+
+	while (done < len)
+	{
+		// beyond the 8 bit offset, read again from the last reachable
+		// byte and skip what is already read
+		skip = (offset + done > 0xFF) ? offset + done - 0xFF : 0;
+
+		req.Id = id;
+		req.Offset = (uint8_t) (offset + done - skip);
+		nvStats.sreqs++;
+		if ((sysOsalNvReadRsp(&req, &rsp) != MT_RPC_SUCCESS)
+		        || (rsp.Status != SUCCESS) || (rsp.Len <= skip))
+		{
+			return -1;
+		}
+
+		// the SRSP holds all it can of the rest of the item
+		size = rsp.Len - skip;
+		if (size > len - done)
+		{
+			size = len - done;
+		}
+		memcpy(data + done, &rsp.Value[skip], size);
+		done += size;
+		nvStats.bytesRead += size;
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      nvWrite
+ *
+ * @brief   write part of an NV item, called with nvSem held
+ *
+ * @param   id - NV item ID
+ * @param   offset - first byte
+ * @param   data - bytes to write
+ * @param   len - length of data
+ *
+ * @return  status
+ */
+static int32_t nvWrite(uint16_t id, uint16_t offset, uint8_t *data,
+        uint16_t len)
+{
+	OsalNvWriteFormat_t req;
+	uint16_t end = offset + len;
+	uint8_t status;
+
+	while (offset < end)
+	{
+		req.Len = (end - offset > NV_BULK_WRITE_MAX) ?
+		        NV_BULK_WRITE_MAX : end - offset;
+
+		// beyond the 8 bit offset, write the tail from the last reachable
+		// byte, data holds the bytes before offset too
+		if (offset > 0xFF)
+		{
+			if (end - 0xFF > NV_BULK_WRITE_MAX)
+			{
+				return -1;
+			}
+			data -= offset - 0xFF;
+			offset = 0xFF;
+			req.Len = end - offset;
+		}
+
+		req.Id = id;
+		req.Offset = (uint8_t) offset;
+		memcpy(req.Value, data, req.Len);
+		nvStats.sreqs++;
+		if ((sysOsalNvWriteRsp(&req, &status) != MT_RPC_SUCCESS)
+		        || (status != SUCCESS))
+		{
+			return -1;
+		}
+		nvStats.bytesWritten += req.Len;
+
+		offset += req.Len;
+		data += req.Len;
+	}
+
+	return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * nvBulk.h
+ *
+ * This module contains the NV backup and restore of the ZigBee Network
+ * Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef NVBULK_H
+#define NVBULK_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// MT_SYS_OSAL_NV_READ/WRITE take an 8 bit offset, longer items can not
+// be read or written entirely and are reported as failed
+#define NV_BULK_ITEM_MAX              (0xFF + 246)
+
+#define NV_BULK_PATH_LEN              (256)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// counters of the last backup or restore
+typedef struct
+{
+	uint16_t items;        // items in the list or file
+	uint16_t absent;       // backup: not on the device
+	uint16_t unchanged;    // restore: device already holds the backup
+	uint16_t written;      // restore: items created or updated
+	uint16_t failed;
+	uint32_t bytesRead;
+	uint32_t bytesWritten;
+	uint32_t sreqs;
+	uint32_t elapsed;      // ms
+} nvBulkStats_t;
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+void nvBulkInit(void);
+int32_t nvBulkBackup(const char *path, const uint16_t *ids, uint16_t count);
+int32_t nvBulkBackupRange(const char *path, uint16_t first, uint16_t last);
+int32_t nvBulkRestore(const char *path);
+void nvBulkGetStats(nvBulkStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NVBULK_H */
@@ -0,0 +1,659 @@
+/*
+ * nwkScan.c
+ *
+ * This module contains the network scan aggregator of the ZigBee
+ * Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include <semaphore.h>
+
+#include "nwkScan.h"
+#include "mtZdo.h"
+#include "rpc.h"
+#include "rpcTimer.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// channels of the 2.4 GHz band
+#define NWK_SCAN_CHANNELS             (0x07FFF800)
+
+// the ZNP scans each channel for (2^duration + 1) superframes of
+// 15.36 ms, rounded up here
+#define NWK_SCAN_SUPERFRAME           (16)
+
+// added to the scan time before a missing ZDO_NWK_DISCOVERY_CNF is
+// given up
+#define NWK_SCAN_SLACK                (2000)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// last beacon of a sender
+typedef struct
+{
+	uint16_t addr;
+	uint8_t net;           // index in scanNetworks
+	uint8_t permitJoin;
+	uint8_t routerCap;
+	uint8_t lqi;
+	uint8_t depth;
+} nwkScanSender_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static nwkScanNetwork_t scanNetworks[NWK_SCAN_MAX_NETWORKS];
+static uint8_t scanCount;
+static nwkScanSender_t scanSenders[NWK_SCAN_MAX_SENDERS];
+static uint8_t scanSenderCount;
+
+static uint8_t scanActive = 0;
+static uint32_t scanRemaining;   // channels not scanned yet
+static uint8_t scanDuration;
+static uint8_t scanSubsetSize;
+static uint8_t scanStopOnJoinable;
+static uint16_t scanGen;
+static nwkScanDoneCb_t scanCb = NULL;
+static void *scanArg = NULL;
+static rpcTimer_t scanTimer;
+
+// protects all of the above
+static sem_t scanSem;
+
+static uint8_t scanInitDone = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS DECLARATION
+ */
+
+static uint8_t scanBeaconNotifyIndCb(BeaconNotifyIndFormat_t *msg);
+static uint8_t scanNwkDiscoveryCnfCb(NwkDiscoveryCnfFormat_t *msg);
+static void scanTimeoutCb(void *arg);
+static void scanNext(void);
+static void scanFinish(uint8_t status);
+static void scanBeacon(BeaconListItemFormat_t *beacon);
+static void scanParent(uint8_t net);
+static uint8_t scanJoinable(void);
+
+static mtZdoCb_t scanZdoCbs =
+	{ .pfnZdoBeaconNotifyInd = scanBeaconNotifyIndCb,
+	        .pfnZdoNwkDiscoveryCnf = scanNwkDiscoveryCnfCb, };
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      nwkScanInit
+ *
+ * @brief   initialise the scan aggregator, must be called once after
+ *          rpcInitMq()
+ *
+ * @param   -
+ *
+ * @return  status, -1 if its observer could not be registered
+ */
+int32_t nwkScanInit(void)
+{
+	scanCount = 0;
+	scanSenderCount = 0;
+	scanActive = 0;
+
+	sem_init(&scanSem, 0, 1);
+
+	if (!scanInitDone)
+	{
+		if (zdoRegisterObserver(&scanZdoCbs) != 0)
+		{
+			dbg_print(PRINT_LEVEL_WARNING,
+			        "nwkScanInit: no free observer entry\n");
+			return -1;
+		}
+		scanInitDone = 1;
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      nwkScanStart
+ *
+ * @brief   scan for networks. The channels are scanned in subsets, one
+ *          ZDO_NWK_DISCOVERY_REQ each, sent as soon as the previous one
+ *          is confirmed. The beacons of all subsets are merged into one
+ *          table per PAN and channel, which is complete when cb is
+ *          called. The table of the previous scan is cleared.
+ *
+ * @param   channels - channel mask, bits 11 to 26
+ * @param   duration - scan duration exponent, 0 to 14
+ * @param   subsetSize - channels per request, 0 for all at once
+ * @param   stopOnJoinable - 1 to stop after the first subset where a
+ *          router allows joining
+ * @param   cb - called once the scan is over
+ * @param   arg - passed to cb
+ *
+ * @return  status, -1 if a scan is already running
+ */
+int32_t nwkScanStart(uint32_t channels, uint8_t duration, uint8_t subsetSize,
+        uint8_t stopOnJoinable, nwkScanDoneCb_t cb, void *arg)
+{
+	if (!scanInitDone)
+	{
+		return -1;
+	}
+
+	sem_wait(&scanSem);
+
+	if (scanActive)
+	{
+		sem_post(&scanSem);
+		return -1;
+	}
+
+	scanCount = 0;
+	scanSenderCount = 0;
+	scanRemaining = channels & NWK_SCAN_CHANNELS;
+	scanDuration = duration;
+	scanSubsetSize = subsetSize ? subsetSize : 32;
+	scanStopOnJoinable = stopOnJoinable;
+	scanCb = cb;
+	scanArg = arg;
+	scanActive = 1;
+
+	sem_post(&scanSem);
+
+	scanNext();
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      nwkScanGetNetworks
+ *
+ * @brief   get the networks found so far
+ *
+ * @param   networks - filled in with the networks
+ * @param   maxNetworks - size of networks
+ *
+ * @return  number of networks filled in
+ */
+int32_t nwkScanGetNetworks(nwkScanNetwork_t *networks, uint8_t maxNetworks)
+{
+	uint8_t count;
+
+	sem_wait(&scanSem);
+
+	count = (scanCount < maxNetworks) ? scanCount : maxNetworks;
+	memcpy(networks, scanNetworks, count * sizeof(nwkScanNetwork_t));
+
+	sem_post(&scanSem);
+
+	return count;
+}
+
+/*********************************************************************
+ * @fn      nwkScanBest
+ *
+ * @brief   pick the network to join: the one whose best parent has the
+ *          highest LQI, the lowest depth breaking ties
+ *
+ * @param   extPanId - extended PAN ID to join, 0 for any
+ * @param   network - filled in with the network
+ *
+ * @return  status, -1 if no router of such a network allows joining
+ */
+int32_t nwkScanBest(uint64_t extPanId, nwkScanNetwork_t *network)
+{
+	nwkScanNetwork_t *best = NULL, *net;
+	uint8_t idx;
+
+	sem_wait(&scanSem);
+
+	for (idx = 0; idx < scanCount; idx++)
+	{
+		net = &scanNetworks[idx];
+		if ((net->parent == NWK_SCAN_NO_PARENT)
+		        || ((extPanId != 0) && (net->extPanId != extPanId)))
+		{
+			continue;
+		}
+		if ((best == NULL) || (net->parentLqi > best->parentLqi)
+		        || ((net->parentLqi == best->parentLqi)
+		                && (net->parentDepth < best->parentDepth)))
+		{
+			best = net;
+		}
+	}
+	if (best)
+	{
+		memcpy(network, best, sizeof(nwkScanNetwork_t));
+	}
+
+	sem_post(&scanSem);
+
+	return best ? 0 : -1;
+}
+
+/*********************************************************************
+ * @fn      nwkScanJoin
+ *
+ * @brief   join a network found by the scan through its best parent
+ *
+ * @param   network - network, from nwkScanBest() or
+ *          nwkScanGetNetworks()
+ *
+ * @return  status of the ZDO_JOIN_REQ, the outcome comes with
+ *          MT_ZDO_JOIN_CNF
+ */
+uint8_t nwkScanJoin(nwkScanNetwork_t *network)
+{
+	JoinReqFormat_t req;
+	uint8_t idx;
+
+	if (network->parent == NWK_SCAN_NO_PARENT)
+	{
+		return MT_RPC_ERR_PARAMETER;
+	}
+
+	req.LogicalChannel = network->channel;
+	req.PanID = network->panId;
+	for (idx = 0; idx < 8; idx++)
+	{
+		req.ExtendedPanID[idx] = (uint8_t) (network->extPanId >> (8 * idx));
+	}
+	req.ChosenParent = network->parent;
+	req.ParentDepth = network->parentDepth;
+	req.StackProfile = network->stackProfile;
+
+	dbg_print(PRINT_LEVEL_INFO,
+	        "nwkScan: joining PAN 0x%04X on channel %d through 0x%04X\n",
+	        network->panId, network->channel, network->parent);
+
+	return zdoJoinReq(&req);
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      scanBeaconNotifyIndCb
+ *
+ * @brief   MT_ZDO_BEACON_NOTIFY_IND observer
+ *
+ * @param   msg - beacons
+ *
+ * @return  0, the application still gets the beacons
+ */
+static uint8_t scanBeaconNotifyIndCb(BeaconNotifyIndFormat_t *msg)
+{
+	uint8_t idx;
+
+	sem_wait(&scanSem);
+
+	if (scanActive)
+	{
+		for (idx = 0; idx < msg->BeaconCount; idx++)
+		{
+			scanBeacon(&msg->BeaconList[idx]);
+		}
+	}
+
+	sem_post(&scanSem);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      scanNwkDiscoveryCnfCb
+ *
+ * @brief   MT_ZDO_NWK_DISCOVERY_CNF observer, a subset is scanned
+ *
+ * @param   msg - confirm
+ *
+ * @return  0, the application still gets the confirm
+ */
+static uint8_t scanNwkDiscoveryCnfCb(NwkDiscoveryCnfFormat_t *msg)
+{
+	uint8_t active, stop;
+
+	sem_wait(&scanSem);
+
+	active = scanActive;
+	if (active)
+	{
+		rpcTimerStop(&scanTimer);
+	}
+	stop = (scanStopOnJoinable && scanJoinable()) || (scanRemaining == 0)
+	        || (msg->Status != MT_RPC_SUCCESS);
+
+	sem_post(&scanSem);
+
+	if (active)
+	{
+		if (stop)
+		{
+			scanFinish(msg->Status);
+		}
+		else
+		{
+			scanNext();
+		}
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      scanTimeoutCb
+ *
+ * @brief   no ZDO_NWK_DISCOVERY_CNF came for a subset
+ *
+ * @param   arg - generation of the request
+ *
+ * @return  -
+ */
+static void scanTimeoutCb(void *arg)
+{
+	uint8_t expired;
+
+	sem_wait(&scanSem);
+	expired = scanActive && (scanGen == (uint16_t) (uintptr_t) arg);
+	sem_post(&scanSem);
+
+	if (expired)
+	{
+		dbg_print(PRINT_LEVEL_WARNING, "nwkScan: no discovery confirm\n");
+		scanFinish(NWK_SCAN_TIMEOUT);
+	}
+}
+
+/*********************************************************************
+ * @fn      scanNext
+ *
+ * @brief   request the scan of the next channel subset
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+static void scanNext(void)
+{
+	NwkDiscoveryReqFormat_t req;
+	uint32_t subset = 0, timeout;
+	uint8_t channel, cnt = 0, status;
+
+	sem_wait(&scanSem);
+
+	for (channel = 11; (channel <= 26) && (cnt < scanSubsetSize); channel++)
+	{
+		if (scanRemaining & (1UL << channel))
+		{
+			subset |= (1UL << channel);
+			cnt++;
+		}
+	}
+	scanRemaining &= ~subset;
+
+	if (cnt == 0)
+	{
+		sem_post(&scanSem);
+		scanFinish(MT_RPC_SUCCESS);
+		return;
+	}
+
+	timeout = cnt * ((1UL << scanDuration) + 1) * NWK_SCAN_SUPERFRAME
+	        + NWK_SCAN_SLACK;
+	scanGen++;
+	rpcTimerStart(&scanTimer, timeout, 0, scanTimeoutCb,
+	        (void *) (uintptr_t) scanGen);
+
+	req.ScanChannels[0] = BREAK_UINT32(subset, 0);
+	req.ScanChannels[1] = BREAK_UINT32(subset, 1);
+	req.ScanChannels[2] = BREAK_UINT32(subset, 2);
+	req.ScanChannels[3] = BREAK_UINT32(subset, 3);
+	req.ScanDuration = scanDuration;
+
+	sem_post(&scanSem);
+
+	status = zdoNwkDiscoveryReq(&req);
+	if (status != MT_RPC_SUCCESS)
+	{
+		dbg_print(PRINT_LEVEL_WARNING, "nwkScan: discovery request failed %02X\n",
+		        status);
+		scanFinish(status);
+	}
+}
+
+/*********************************************************************
+ * @fn      scanFinish
+ *
+ * @brief   end the scan and report it
+ *
+ * @param   status - ZDO_NWK_DISCOVERY_CNF status or NWK_SCAN_TIMEOUT
+ *
+ * @return  -
+ */
+static void scanFinish(uint8_t status)
+{
+	nwkScanDoneCb_t cb;
+	void *arg;
+	uint8_t count;
+
+	sem_wait(&scanSem);
+
+	if (!scanActive)
+	{
+		sem_post(&scanSem);
+		return;
+	}
+	rpcTimerStop(&scanTimer);
+	scanActive = 0;
+	cb = scanCb;
+	arg = scanArg;
+	count = scanCount;
+
+	sem_post(&scanSem);
+
+	dbg_print(PRINT_LEVEL_INFO, "nwkScan: %d networks found\n", count);
+
+	if (cb != NULL)
+	{
+		cb(status, count, arg);
+	}
+}
+
+/*********************************************************************
+ * @fn      scanBeacon
+ *
+ * @brief   merge a beacon into the network table, called with scanSem
+ *          held. The last beacon of each sender is kept, so that a
+ *          sender that stops allowing joining gives way to the other
+ *          parents of its network.
+ *
+ * @param   beacon - the beacon
+ *
+ * @return  -
+ */
+static void scanBeacon(BeaconListItemFormat_t *beacon)
+{
+	nwkScanNetwork_t *net = NULL;
+	nwkScanSender_t *sender = NULL;
+	uint8_t idx;
+
+	for (idx = 0; idx < scanCount; idx++)
+	{
+		if ((scanNetworks[idx].extPanId == beacon->ExtendedPanId)
+		        && (scanNetworks[idx].panId == beacon->PanId)
+		        && (scanNetworks[idx].channel == beacon->LogicalChannel))
+		{
+			net = &scanNetworks[idx];
+			break;
+		}
+	}
+
+	if (net == NULL)
+	{
+		if (scanCount == NWK_SCAN_MAX_NETWORKS)
+		{
+			return;
+		}
+		net = &scanNetworks[scanCount++];
+		memset(net, 0, sizeof(nwkScanNetwork_t));
+		net->extPanId = beacon->ExtendedPanId;
+		net->panId = beacon->PanId;
+		net->channel = beacon->LogicalChannel;
+		net->minDepth = 0xFF;
+		net->parent = NWK_SCAN_NO_PARENT;
+	}
+
+	net->beacons++;
+	net->stackProfile = beacon->StackProf;
+	net->updateId = beacon->UpdateId;
+	if (beacon->Lqi > net->bestLqi)
+	{
+		net->bestLqi = beacon->Lqi;
+	}
+	if (beacon->Depth < net->minDepth)
+	{
+		net->minDepth = beacon->Depth;
+	}
+
+	for (idx = 0; idx < scanSenderCount; idx++)
+	{
+		if ((scanSenders[idx].addr == beacon->SrcAddr)
+		        && (&scanNetworks[scanSenders[idx].net] == net))
+		{
+			sender = &scanSenders[idx];
+			break;
+		}
+	}
+
+	if (sender == NULL)
+	{
+		if (scanSenderCount == NWK_SCAN_MAX_SENDERS)
+		{
+			return;
+		}
+		sender = &scanSenders[scanSenderCount++];
+		sender->addr = beacon->SrcAddr;
+		sender->net = (uint8_t) (net - scanNetworks);
+	}
+
+	sender->permitJoin = beacon->PermitJoining;
+	sender->routerCap = beacon->RouterCap;
+	sender->lqi = beacon->Lqi;
+	sender->depth = beacon->Depth;
+
+	scanParent(sender->net);
+}
+
+/*********************************************************************
+ * @fn      scanParent
+ *
+ * @brief   pick the parent of a network from the last beacon of its
+ *          senders, called with scanSem held. A sender allowing joining
+ *          with router capacity is a parent; the best one has the
+ *          highest LQI, then the lowest depth.
+ *
+ * @param   net - index in scanNetworks
+ *
+ * @return  -
+ */
+static void scanParent(uint8_t net)
+{
+	nwkScanNetwork_t *entry = &scanNetworks[net];
+	nwkScanSender_t *sender;
+	uint8_t idx;
+
+	entry->permitJoin = 0;
+	entry->parent = NWK_SCAN_NO_PARENT;
+	entry->parentLqi = 0;
+	entry->parentDepth = 0;
+
+	for (idx = 0; idx < scanSenderCount; idx++)
+	{
+		sender = &scanSenders[idx];
+		if ((sender->net != net) || !sender->permitJoin)
+		{
+			continue;
+		}
+
+		entry->permitJoin = 1;
+		if (sender->routerCap
+		        && ((entry->parent == NWK_SCAN_NO_PARENT)
+		                || (sender->lqi > entry->parentLqi)
+		                || ((sender->lqi == entry->parentLqi)
+		                        && (sender->depth < entry->parentDepth))))
+		{
+			entry->parent = sender->addr;
+			entry->parentLqi = sender->lqi;
+			entry->parentDepth = sender->depth;
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      scanJoinable
+ *
+ * @brief   check for a network with a parent, called with scanSem held
+ *
+ * @param   -
+ *
+ * @return  1 if a router of some network allows joining
+ */
+static uint8_t scanJoinable(void)
+{
+	uint8_t idx;
+
+	for (idx = 0; idx < scanCount; idx++)
+	{
+		if (scanNetworks[idx].parent != NWK_SCAN_NO_PARENT)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * nwkScan.h
+ *
+ * This module contains the network scan aggregator of the ZigBee
+ * Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef NWKSCAN_H
+#define NWKSCAN_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// networks recorded per scan, one per PAN and channel
+#define NWK_SCAN_MAX_NETWORKS         (32)
+
+// beacon senders remembered per scan to pick the parents, the beacons
+// of further senders only count in the network statistics
+#define NWK_SCAN_MAX_SENDERS          (128)
+
+// nwkScanNetwork_t parent when no beacon allowed joining
+#define NWK_SCAN_NO_PARENT            (0xFFFF)
+
+// status of nwkScanDoneCb_t besides the ZDO_NWK_DISCOVERY_CNF status
+#define NWK_SCAN_TIMEOUT              (0xFF)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint64_t extPanId;
+	uint16_t panId;
+	uint8_t channel;
+	uint8_t stackProfile;
+	uint8_t updateId;
+	uint8_t permitJoin;    // the last beacon of a sender allowed joining
+	uint8_t bestLqi;       // of all beacons
+	uint8_t minDepth;      // of all beacons
+	uint16_t beacons;      // received, repeats included
+	uint16_t parent;       // best router allowing joining
+	uint8_t parentLqi;
+	uint8_t parentDepth;
+} nwkScanNetwork_t;
+
+// called once the last channel subset is scanned or the scan stopped
+// on a network allowing joining
+typedef void (*nwkScanDoneCb_t)(uint8_t status, uint8_t networks,
+        void *arg);
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+int32_t nwkScanInit(void);
+int32_t nwkScanStart(uint32_t channels, uint8_t duration, uint8_t subsetSize,
+        uint8_t stopOnJoinable, nwkScanDoneCb_t cb, void *arg);
+int32_t nwkScanGetNetworks(nwkScanNetwork_t *networks, uint8_t maxNetworks);
+int32_t nwkScanBest(uint64_t extPanId, nwkScanNetwork_t *network);
+uint8_t nwkScanJoin(nwkScanNetwork_t *network);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NWKSCAN_H */
@@ -0,0 +1,958 @@
+/*
+ * tblFetch.c
+ *
+ * This module contains the paginated table fetcher of the ZigBee
+ * Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include <stdlib.h>
+#include <semaphore.h>
+
+#include "tblFetch.h"
+#include "mtZdo.h"
+#include "rpc.h"
+#include "rpcTimer.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define TBL_FETCH_NONE                (0xFFFF)
+
+// table indexes are 8 bit
+#define TBL_FETCH_MAX_ENTRIES         (256)
+
+#define TBL_FETCH_MAX_PAGES \
+	(TBL_FETCH_MAX_CONCURRENCY * TBL_FETCH_MAX_PIPELINE)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint8_t table;
+	uint16_t dstAddr;
+	tblFetchCb_t cb;
+	void *arg;
+} tblFetchQueued_t;
+
+typedef struct
+{
+	uint8_t used;
+	uint8_t table;         // TBL_FETCH_xxx
+	uint16_t dstAddr;
+	uint8_t known;         // entries and pageSize are known
+	uint16_t entries;      // table size reported by the device
+	uint8_t pageSize;      // items of the largest page received
+	uint8_t partial;       // pages were given up
+	uint8_t outstanding;   // pages in flight
+	uint8_t received[TBL_FETCH_MAX_ENTRIES / 8];
+	uint8_t skipped[TBL_FETCH_MAX_ENTRIES / 8];
+	uint8_t *items;        // item i at i * item size
+	tblFetchCb_t cb;
+	void *arg;
+} tblFetchJob_t;
+
+typedef struct
+{
+	uint8_t used;
+	uint8_t send;          // a request is due
+	uint8_t job;           // index in fetchJobs
+	uint8_t startIndex;
+	uint8_t attempts;
+	uint16_t gen;          // incremented for each request
+	uint64_t sent;         // time of the request
+	rpcTimer_t timer;      // response timeout
+} tblFetchPage_t;
+
+// a fetch over, reported outside fetchSem
+typedef struct
+{
+	uint8_t status;
+	uint8_t table;
+	uint16_t dstAddr;
+	uint8_t *items;
+	uint16_t count;
+	uint16_t entries;
+	tblFetchCb_t cb;
+	void *arg;
+} tblFetchDone_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static tblFetchJob_t fetchJobs[TBL_FETCH_MAX_CONCURRENCY];
+static tblFetchPage_t fetchPages[TBL_FETCH_MAX_PAGES];
+static tblFetchQueued_t fetchQueue[TBL_FETCH_MAX_QUEUED];
+static uint8_t fetchQueueHead;
+static uint8_t fetchQueueCnt;
+static tblFetchStats_t fetchStats;
+
+static uint8_t fetchConcurrency = TBL_FETCH_DEFAULT_CONCURRENCY;
+static uint8_t fetchPipeline = TBL_FETCH_DEFAULT_PIPELINE;
+static uint32_t fetchTimeout = TBL_FETCH_DEFAULT_TIMEOUT;
+static uint8_t fetchMaxRetries = TBL_FETCH_DEFAULT_RETRIES;
+static uint32_t fetchScanChannels = 0x07FFF800;
+static uint8_t fetchScanDuration = 3;
+
+// protects all of the above
+static sem_t fetchSem;
+// serialises the requests
+static sem_t fetchSendSem;
+
+static uint8_t fetchInitDone = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS DECLARATION
+ */
+
+static uint8_t fetchMgmtRtgRspCb(MgmtRtgRspFormat_t *msg);
+static uint8_t fetchMgmtBindRspCb(MgmtBindRspFormat_t *msg);
+static uint8_t fetchMgmtNwkDiscRspCb(MgmtNwkDiscRspFormat_t *msg);
+static uint8_t fetchMgmtLqiRspCb(MgmtLqiRspFormat_t *msg);
+static uint8_t fetchRsp(uint8_t table, uint16_t srcAddr, uint8_t status,
+        uint16_t entries, uint8_t startIndex, uint8_t count, void *list);
+static void fetchTimeoutCb(void *arg);
+static void fetchPump(void);
+static uint8_t fetchNextIndex(tblFetchJob_t *job, uint16_t *startIndex);
+static uint8_t fetchFail(tblFetchPage_t *page, tblFetchDone_t *done);
+static uint8_t fetchCheck(tblFetchJob_t *job, tblFetchDone_t *done);
+static void fetchFinish(tblFetchDone_t *done);
+static uint16_t fetchItemSize(uint8_t table);
+
+static mtZdoCb_t fetchZdoCbs =
+	{ .pfnZdoMgmtNwkDiscRsp = fetchMgmtNwkDiscRspCb,
+	        .pfnZdoMgmtLqiRsp = fetchMgmtLqiRspCb,
+	        .pfnZdoMgmtRtgRsp = fetchMgmtRtgRspCb,
+	        .pfnZdoMgmtBindRsp = fetchMgmtBindRspCb, };
+
+/*********************************************************************
+ * MACROS
+ */
+
+#define FETCH_BIT_GET(map, idx)  ((map)[(idx) >> 3] & (1 << ((idx) & 7)))
+#define FETCH_BIT_SET(map, idx)  ((map)[(idx) >> 3] |= (1 << ((idx) & 7)))
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      tblFetchInit
+ *
+ * @brief   initialise the table fetcher, must be called once after
+ *          rpcInitMq()
+ *
+ * @param   -
+ *
+ * @return  status, -1 if its observer could not be registered
+ */
+int32_t tblFetchInit(void)
+{
+	memset(fetchJobs, 0, sizeof(fetchJobs));
+	memset(fetchPages, 0, sizeof(fetchPages));
+	memset(&fetchStats, 0, sizeof(fetchStats));
+	fetchQueueHead = 0;
+	fetchQueueCnt = 0;
+
+	sem_init(&fetchSem, 0, 1);
+	sem_init(&fetchSendSem, 0, 1);
+
+	if (!fetchInitDone)
+	{
+		if (zdoRegisterObserver(&fetchZdoCbs) != 0)
+		{
+			dbg_print(PRINT_LEVEL_WARNING,
+			        "tblFetchInit: no free observer entry\n");
+			return -1;
+		}
+		fetchInitDone = 1;
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      tblFetchConfig
+ *
+ * @brief   set the concurrency, the pipelining and the retries
+ *
+ * @param   concurrency - tables fetched at the same time, at most
+ *          TBL_FETCH_MAX_CONCURRENCY
+ * @param   pipeline - page requests in flight per table, at most
+ *          TBL_FETCH_MAX_PIPELINE
+ * @param   timeout - time to wait for a page in ms
+ * @param   maxRetries - requests repeated per page before it is given up
+ *
+ * @return  -
+ */
+void tblFetchConfig(uint8_t concurrency, uint8_t pipeline, uint32_t timeout,
+        uint8_t maxRetries)
+{
+	if (concurrency == 0)
+	{
+		concurrency = 1;
+	}
+	if (concurrency > TBL_FETCH_MAX_CONCURRENCY)
+	{
+		concurrency = TBL_FETCH_MAX_CONCURRENCY;
+	}
+	if (pipeline == 0)
+	{
+		pipeline = 1;
+	}
+	if (pipeline > TBL_FETCH_MAX_PIPELINE)
+	{
+		pipeline = TBL_FETCH_MAX_PIPELINE;
+	}
+
+	sem_wait(&fetchSem);
+
+	fetchConcurrency = concurrency;
+	fetchPipeline = pipeline;
+	fetchTimeout = timeout;
+	fetchMaxRetries = maxRetries;
+
+	sem_post(&fetchSem);
+
+	fetchPump();
+}
+
+/*********************************************************************
+ * @fn      tblFetchSetScan
+ *
+ * @brief   set the scan of the TBL_FETCH_NWK_DISC fetches
+ *
+ * @param   scanChannels - channel mask
+ * @param   scanDuration - scan duration exponent
+ *
+ * @return  -
+ */
+void tblFetchSetScan(uint32_t scanChannels, uint8_t scanDuration)
+{
+	sem_wait(&fetchSem);
+
+	fetchScanChannels = scanChannels;
+	fetchScanDuration = scanDuration;
+
+	sem_post(&fetchSem);
+}
+
+/*********************************************************************
+ * @fn      tblFetchStart
+ *
+ * @brief   fetch a whole table of a device. Once the first page gives
+ *          the table size, the other pages are requested in parallel.
+ *          Short pages are completed by requesting from the first item
+ *          missing, failed pages are repeated and then given up.
+ *
+ * @param   table - TBL_FETCH_xxx
+ * @param   dstAddr - short address of the device
+ * @param   cb - called once with the table
+ * @param   arg - passed to cb
+ *
+ * @return  status, -1 if the queue is full
+ */
+int32_t tblFetchStart(uint8_t table, uint16_t dstAddr, tblFetchCb_t cb,
+        void *arg)
+{
+	tblFetchQueued_t *queued;
+
+	if (!fetchInitDone || (table > TBL_FETCH_LQI))
+	{
+		return -1;
+	}
+
+	sem_wait(&fetchSem);
+
+	if (fetchQueueCnt == TBL_FETCH_MAX_QUEUED)
+	{
+		fetchStats.dropped++;
+		sem_post(&fetchSem);
+		return -1;
+	}
+
+	queued = &fetchQueue[(fetchQueueHead + fetchQueueCnt++)
+	        % TBL_FETCH_MAX_QUEUED];
+	queued->table = table;
+	queued->dstAddr = dstAddr;
+	queued->cb = cb;
+	queued->arg = arg;
+
+	sem_post(&fetchSem);
+
+	fetchPump();
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      tblFetchGetStats
+ *
+ * @brief   get the table fetcher counters
+ *
+ * @param   stats - filled in with the counters
+ *
+ * @return  -
+ */
+void tblFetchGetStats(tblFetchStats_t *stats)
+{
+	sem_wait(&fetchSem);
+
+	memcpy(stats, &fetchStats, sizeof(tblFetchStats_t));
+
+	sem_post(&fetchSem);
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      fetchMgmtRtgRspCb
+ *
+ * @brief   MT_ZDO_MGMT_RTG_RSP observer
+ *
+ * @param   msg - response
+ *
+ * @return  1 if the response belongs to a fetch
+ */
+static uint8_t fetchMgmtRtgRspCb(MgmtRtgRspFormat_t *msg)
+{
+	return fetchRsp(TBL_FETCH_RTG, msg->SrcAddr, msg->Status,
+	        msg->RoutingTableEntries, msg->StartIndex,
+	        msg->RoutingTableListCount, msg->RoutingTableList);
+}
+
+/*********************************************************************
+ * @fn      fetchMgmtBindRspCb
+ *
+ * @brief   MT_ZDO_MGMT_BIND_RSP observer
+ *
+ * @param   msg - response
+ *
+ * @return  1 if the response belongs to a fetch
+ */
+static uint8_t fetchMgmtBindRspCb(MgmtBindRspFormat_t *msg)
+{
+	return fetchRsp(TBL_FETCH_BIND, msg->SrcAddr, msg->Status,
+	        msg->BindingTableEntries, msg->StartIndex,
+	        msg->BindingTableListCount, msg->BindingTableList);
+}
+
+/*********************************************************************
+ * @fn      fetchMgmtNwkDiscRspCb
+ *
+ * @brief   MT_ZDO_MGMT_NWK_DISC_RSP observer
+ *
+ * @param   msg - response
+ *
+ * @return  1 if the response belongs to a fetch
+ */
+static uint8_t fetchMgmtNwkDiscRspCb(MgmtNwkDiscRspFormat_t *msg)
+{
+	return fetchRsp(TBL_FETCH_NWK_DISC, msg->SrcAddr, msg->Status,
+	        msg->NetworkCount, msg->StartIndex, msg->NetworkListCount,
+	        msg->NetworkList);
+}
+
+/*********************************************************************
+ * @fn      fetchMgmtLqiRspCb
+ *
+ * @brief   MT_ZDO_MGMT_LQI_RSP observer
+ *
+ * @param   msg - response
+ *
+ * @return  1 if the response belongs to a fetch
+ */
+static uint8_t fetchMgmtLqiRspCb(MgmtLqiRspFormat_t *msg)
+{
+	return fetchRsp(TBL_FETCH_LQI, msg->SrcAddr, msg->Status,
+	        msg->NeighborTableEntries, msg->StartIndex,
+	        msg->NeighborLqiListCount, msg->NeighborLqiList);
+}
+
+/*********************************************************************
+ * @fn      fetchRsp
+ *
+ * @brief   record a page of a table
+ *
+ * @param   table - TBL_FETCH_xxx
+ * @param   srcAddr - device answering
+ * @param   status - status of the response
+ * @param   entries - table size
+ * @param   startIndex - index of the first item of the page
+ * @param   count - items in the page
+ * @param   list - items of the page
+ *
+ * @return  1 if the response belongs to a fetch
+ */
+static uint8_t fetchRsp(uint8_t table, uint16_t srcAddr, uint8_t status,
+        uint16_t entries, uint8_t startIndex, uint8_t count, void *list)
+{
+	tblFetchPage_t *page = NULL;
+	tblFetchJob_t *job;
+	tblFetchDone_t done;
+	uint16_t itemSize = fetchItemSize(table);
+	uint16_t idx, item;
+	uint8_t *items, finished = 0;
+
+	sem_wait(&fetchSem);
+
+	for (idx = 0; idx < TBL_FETCH_MAX_PAGES; idx++)
+	{
+		job = &fetchJobs[fetchPages[idx].job];
+		if (fetchPages[idx].used && !fetchPages[idx].send
+		        && (fetchPages[idx].startIndex == startIndex)
+		        && (job->table == table) && (job->dstAddr == srcAddr))
+		{
+			page = &fetchPages[idx];
+			break;
+		}
+	}
+
+	if (page == NULL)
+	{
+		sem_post(&fetchSem);
+		return 0;
+	}
+
+	rpcTimerStop(&page->timer);
+
+	if (entries > TBL_FETCH_MAX_ENTRIES)
+	{
+		entries = TBL_FETCH_MAX_ENTRIES;
+	}
+
+	items = NULL;
+	if ((status == MT_RPC_SUCCESS)
+	        && (!job->known || (entries > job->entries)))
+	{
+		items = realloc(job->items, entries * itemSize + 1);
+		if (items == NULL)
+		{
+			dbg_print(PRINT_LEVEL_WARNING,
+			        "tblFetch: could not allocate %d items\n", entries);
+		}
+		else
+		{
+			job->items = items;
+		}
+	}
+
+	if (status != MT_RPC_SUCCESS)
+	{
+		finished = fetchFail(page, &done);
+	}
+	else if ((items == NULL) && !job->known)
+	{
+		// without the first page the fetch can only fail
+		page->used = 0;
+		job->outstanding--;
+		finished = fetchCheck(job, &done);
+	}
+	else
+	{
+		if ((items == NULL) && (entries > job->entries))
+		{
+			// the items past the ones allocated are given up
+			entries = job->entries;
+			job->partial = 1;
+		}
+		job->entries = entries;
+		job->known = 1;
+		if (count > job->pageSize)
+		{
+			job->pageSize = count;
+		}
+		else if ((startIndex + count) < entries)
+		{
+			fetchStats.shortPages++;
+		}
+
+		for (item = 0; (item < count) && ((startIndex + item) < entries);
+		        item++)
+		{
+			memcpy(&job->items[(startIndex + item) * itemSize],
+			        (uint8_t *) list + item * itemSize, itemSize);
+			FETCH_BIT_SET(job->received, startIndex + item);
+		}
+
+		// an empty page inside the table would be asked for forever
+		if ((count == 0) && (startIndex < entries))
+		{
+			FETCH_BIT_SET(job->skipped, startIndex);
+			job->partial = 1;
+		}
+
+		page->used = 0;
+		job->outstanding--;
+		finished = fetchCheck(job, &done);
+	}
+
+	sem_post(&fetchSem);
+
+	if (finished)
+	{
+		fetchFinish(&done);
+	}
+	fetchPump();
+
+	return 1;
+}
+
+/*********************************************************************
+ * @fn      fetchTimeoutCb
+ *
+ * @brief   response timeout of a page request
+ *
+ * @param   arg - page
+ *
+ * @return  -
+ */
+static void fetchTimeoutCb(void *arg)
+{
+	tblFetchPage_t *page = (tblFetchPage_t *) arg;
+	tblFetchDone_t done;
+	uint8_t expired, finished = 0;
+
+	sem_wait(&fetchSem);
+
+	// the response may have arrived while the timer callback was being
+	// called
+	expired = page->used && !page->send
+	        && (rpcTimerNow() >= (page->sent + fetchTimeout));
+	if (expired)
+	{
+		dbg_print(PRINT_LEVEL_INFO,
+		        "tblFetch: no response from 0x%04X for index %d\n",
+		        fetchJobs[page->job].dstAddr, page->startIndex);
+		finished = fetchFail(page, &done);
+	}
+
+	sem_post(&fetchSem);
+
+	if (finished)
+	{
+		fetchFinish(&done);
+	}
+	if (expired)
+	{
+		fetchPump();
+	}
+}
+
+/*********************************************************************
+ * @fn      fetchPump
+ *
+ * @brief   send the page requests that are due, add pages to the
+ *          pipelines and start queued fetches while slots are free
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+static void fetchPump(void)
+{
+	tblFetchPage_t *page;
+	tblFetchJob_t *job;
+	tblFetchQueued_t *queued;
+	tblFetchDone_t done;
+	uint16_t idx, startIndex, gen, dstAddr;
+	uint8_t jobIdx, table, status, finished, limit;
+	uint32_t scanChannels;
+	uint8_t scanDuration;
+
+	while (1)
+	{
+		sem_wait(&fetchSem);
+
+		page = NULL;
+		for (idx = 0; idx < TBL_FETCH_MAX_PAGES; idx++)
+		{
+			if (fetchPages[idx].used && fetchPages[idx].send)
+			{
+				page = &fetchPages[idx];
+				break;
+			}
+		}
+
+		// start the fetches waiting for a slot
+		for (jobIdx = 0; (jobIdx < fetchConcurrency) && (fetchQueueCnt > 0);
+		        jobIdx++)
+		{
+			job = &fetchJobs[jobIdx];
+			if (!job->used)
+			{
+				queued = &fetchQueue[fetchQueueHead];
+				fetchQueueHead = (fetchQueueHead + 1) % TBL_FETCH_MAX_QUEUED;
+				fetchQueueCnt--;
+
+				memset(job, 0, sizeof(tblFetchJob_t));
+				job->used = 1;
+				job->table = queued->table;
+				job->dstAddr = queued->dstAddr;
+				job->cb = queued->cb;
+				job->arg = queued->arg;
+			}
+		}
+
+		// one page until the table size is known, then the pipeline
+		for (jobIdx = 0; (jobIdx < TBL_FETCH_MAX_CONCURRENCY) && !page;
+		        jobIdx++)
+		{
+			job = &fetchJobs[jobIdx];
+			limit = job->known ? fetchPipeline : 1;
+			if (!job->used || (job->outstanding >= limit)
+			        || !fetchNextIndex(job, &startIndex))
+			{
+				continue;
+			}
+
+			for (idx = 0; idx < TBL_FETCH_MAX_PAGES; idx++)
+			{
+				if (!fetchPages[idx].used)
+				{
+					page = &fetchPages[idx];
+					page->used = 1;
+					page->send = 1;
+					page->job = jobIdx;
+					page->startIndex = (uint8_t) startIndex;
+					page->attempts = 0;
+					job->outstanding++;
+					break;
+				}
+			}
+		}
+
+		if (page == NULL)
+		{
+			sem_post(&fetchSem);
+			break;
+		}
+
+		job = &fetchJobs[page->job];
+		page->send = 0;
+		page->attempts++;
+		page->gen++;
+		page->sent = rpcTimerNow();
+		gen = page->gen;
+		table = job->table;
+		dstAddr = job->dstAddr;
+		startIndex = page->startIndex;
+		scanChannels = fetchScanChannels;
+		scanDuration = fetchScanDuration;
+		fetchStats.requests++;
+		if (page->attempts > 1)
+		{
+			fetchStats.retries++;
+		}
+		rpcTimerStart(&page->timer, fetchTimeout, 0, fetchTimeoutCb, page);
+
+		sem_post(&fetchSem);
+
+		sem_wait(&fetchSendSem);
+		switch (table)
+		{
+		case TBL_FETCH_RTG:
+		{
+			MgmtRtgReqFormat_t req;
+			req.DstAddr = dstAddr;
+			req.StartIndex = (uint8_t) startIndex;
+			status = zdoMgmtRtgReq(&req);
+			break;
+		}
+		case TBL_FETCH_BIND:
+		{
+			MgmtBindReqFormat_t req;
+			req.DstAddr = dstAddr;
+			req.StartIndex = (uint8_t) startIndex;
+			status = zdoMgmtBindReq(&req);
+			break;
+		}
+		case TBL_FETCH_NWK_DISC:
+		{
+			MgmtNwkDiscReqFormat_t req;
+			req.DstAddr = dstAddr;
+			req.ScanChannels[0] = BREAK_UINT32(scanChannels, 0);
+			req.ScanChannels[1] = BREAK_UINT32(scanChannels, 1);
+			req.ScanChannels[2] = BREAK_UINT32(scanChannels, 2);
+			req.ScanChannels[3] = BREAK_UINT32(scanChannels, 3);
+			req.ScanDuration = scanDuration;
+			req.StartIndex = (uint8_t) startIndex;
+			status = zdoMgmtNwkDiscReq(&req);
+			break;
+		}
+		default:
+		{
+			MgmtLqiReqFormat_t req;
+			req.DstAddr = dstAddr;
+			req.StartIndex = (uint8_t) startIndex;
+			status = zdoMgmtLqiReq(&req);
+			break;
+		}
+		}
+		sem_post(&fetchSendSem);
+
+		if (status != MT_RPC_SUCCESS)
+		{
+			finished = 0;
+
+			sem_wait(&fetchSem);
+			if (page->used && !page->send && (page->gen == gen))
+			{
+				rpcTimerStop(&page->timer);
+				finished = fetchFail(page, &done);
+			}
+			sem_post(&fetchSem);
+
+			if (finished)
+			{
+				fetchFinish(&done);
+			}
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      fetchNextIndex
+ *
+ * @brief   find the first item of a table neither received, given up
+ *          nor covered by a page in flight, called with fetchSem held
+ *
+ * @param   job - the fetch
+ * @param   startIndex - filled in with the index of the item
+ *
+ * @return  1 if a page is to be requested
+ */
+static uint8_t fetchNextIndex(tblFetchJob_t *job, uint16_t *startIndex)
+{
+	uint16_t item, idx, width;
+	uint16_t end = job->known ? job->entries : 1;
+	uint8_t covered;
+
+	width = job->pageSize ? job->pageSize : 1;
+
+	for (item = 0; item < end; item++)
+	{
+		if (FETCH_BIT_GET(job->received, item)
+		        || FETCH_BIT_GET(job->skipped, item))
+		{
+			continue;
+		}
+
+		covered = 0;
+		for (idx = 0; (idx < TBL_FETCH_MAX_PAGES) && !covered; idx++)
+		{
+			covered = fetchPages[idx].used
+			        && (&fetchJobs[fetchPages[idx].job] == job)
+			        && (item >= fetchPages[idx].startIndex)
+			        && (item < (fetchPages[idx].startIndex + width));
+		}
+		if (!covered)
+		{
+			*startIndex = item;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      fetchFail
+ *
+ * @brief   repeat a page request that failed or give the page up,
+ *          called with fetchSem held
+ *
+ * @param   page - the page
+ * @param   done - filled in if the fetch is over
+ *
+ * @return  1 if the fetch is over
+ */
+static uint8_t fetchFail(tblFetchPage_t *page, tblFetchDone_t *done)
+{
+	tblFetchJob_t *job = &fetchJobs[page->job];
+	uint16_t item, width;
+
+	if (page->attempts <= fetchMaxRetries)
+	{
+		page->send = 1;
+		return 0;
+	}
+
+	page->used = 0;
+	job->outstanding--;
+	job->partial = 1;
+
+	if (job->known)
+	{
+		width = job->pageSize ? job->pageSize : 1;
+		for (item = page->startIndex;
+		        (item < (page->startIndex + width)) && (item < job->entries);
+		        item++)
+		{
+			if (!FETCH_BIT_GET(job->received, item))
+			{
+				FETCH_BIT_SET(job->skipped, item);
+			}
+		}
+	}
+
+	return fetchCheck(job, done);
+}
+
+/*********************************************************************
+ * @fn      fetchCheck
+ *
+ * @brief   end a fetch once no item is left to request, compacting the
+ *          items received, called with fetchSem held
+ *
+ * @param   job - the fetch
+ * @param   done - filled in if the fetch is over
+ *
+ * @return  1 if the fetch is over
+ */
+static uint8_t fetchCheck(tblFetchJob_t *job, tblFetchDone_t *done)
+{
+	uint16_t itemSize = fetchItemSize(job->table);
+	uint16_t item, count = 0, startIndex;
+
+	if (job->outstanding > 0)
+	{
+		return 0;
+	}
+	if (job->known && fetchNextIndex(job, &startIndex))
+	{
+		return 0;
+	}
+
+	for (item = 0; job->known && (item < job->entries); item++)
+	{
+		if (FETCH_BIT_GET(job->received, item))
+		{
+			if (item != count)
+			{
+				memmove(&job->items[count * itemSize],
+				        &job->items[item * itemSize], itemSize);
+			}
+			count++;
+		}
+	}
+
+	if (!job->known)
+	{
+		done->status = TBL_FETCH_FAILED;
+		fetchStats.failed++;
+	}
+	else if (job->partial)
+	{
+		done->status = TBL_FETCH_PARTIAL;
+		fetchStats.partial++;
+		fetchStats.fetches++;
+	}
+	else
+	{
+		done->status = TBL_FETCH_SUCCESS;
+		fetchStats.fetches++;
+	}
+
+	done->table = job->table;
+	done->dstAddr = job->dstAddr;
+	done->items = job->items;
+	done->count = count;
+	done->entries = job->entries;
+	done->cb = job->cb;
+	done->arg = job->arg;
+
+	job->items = NULL;
+	job->used = 0;
+
+	return 1;
+}
+
+/*********************************************************************
+ * @fn      fetchFinish
+ *
+ * @brief   report a fetch and free its items
+ *
+ * @param   done - the fetch
+ *
+ * @return  -
+ */
+static void fetchFinish(tblFetchDone_t *done)
+{
+	dbg_print(PRINT_LEVEL_INFO, "tblFetch: table %d of 0x%04X, %d of %d items\n",
+	        done->table, done->dstAddr, done->count, done->entries);
+
+	if (done->cb != NULL)
+	{
+		done->cb(done->status, done->table, done->dstAddr, done->items,
+		        done->count, done->entries, done->arg);
+	}
+
+	free(done->items);
+}
+
+/*********************************************************************
+ * @fn      fetchItemSize
+ *
+ * @brief   size of the items of a table
+ *
+ * @param   table - TBL_FETCH_xxx
+ *
+ * @return  size in bytes
+ */
+static uint16_t fetchItemSize(uint8_t table)
+{
+	switch (table)
+	{
+	case TBL_FETCH_RTG:
+		return sizeof(RoutingTableListItemFormat_t);
+	case TBL_FETCH_BIND:
+		return sizeof(BindingTableListItemFormat_t);
+	case TBL_FETCH_NWK_DISC:
+		return sizeof(NetworkListItemFormat_t);
+	default:
+		return sizeof(NeighborLqiListItemFormat_t);
+	}
+}
@@ -0,0 +1,121 @@
+/*
+ * tblFetch.h
+ *
+ * This module contains the paginated table fetcher of the ZigBee
+ * Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TBLFETCH_H
+#define TBLFETCH_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// tables, the items are of the MT list item type
+#define TBL_FETCH_RTG                 (0)  // RoutingTableListItemFormat_t
+#define TBL_FETCH_BIND                (1)  // BindingTableListItemFormat_t
+#define TBL_FETCH_NWK_DISC            (2)  // NetworkListItemFormat_t
+#define TBL_FETCH_LQI                 (3)  // NeighborLqiListItemFormat_t
+
+// tables fetched at the same time, one device each
+#define TBL_FETCH_MAX_CONCURRENCY     (8)
+
+// page requests in flight per table
+#define TBL_FETCH_MAX_PIPELINE        (4)
+
+// fetches waiting for a free slot
+#define TBL_FETCH_MAX_QUEUED          (64)
+
+// defaults of tblFetchConfig()
+#define TBL_FETCH_DEFAULT_CONCURRENCY (4)
+#define TBL_FETCH_DEFAULT_PIPELINE    (2)
+#define TBL_FETCH_DEFAULT_TIMEOUT     (3000)
+#define TBL_FETCH_DEFAULT_RETRIES     (2)
+
+// status of tblFetchCb_t
+#define TBL_FETCH_SUCCESS             (0)
+#define TBL_FETCH_PARTIAL             (1)  // pages failed, the rest is there
+#define TBL_FETCH_FAILED              (2)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint32_t fetches;      // tables completed, whole or partial
+	uint32_t partial;
+	uint32_t failed;
+	uint32_t requests;     // pages requested
+	uint32_t retries;
+	uint32_t shortPages;   // pages with fewer items than requested
+	uint32_t dropped;      // fetches not queued
+} tblFetchStats_t;
+
+// items is a contiguous array of count items in table order, valid
+// until the callback returns. entries is the table size reported by the
+// device.
+typedef void (*tblFetchCb_t)(uint8_t status, uint8_t table,
+        uint16_t dstAddr, void *items, uint16_t count, uint16_t entries,
+        void *arg);
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+int32_t tblFetchInit(void);
+void tblFetchConfig(uint8_t concurrency, uint8_t pipeline, uint32_t timeout,
+        uint8_t maxRetries);
+void tblFetchSetScan(uint32_t scanChannels, uint8_t scanDuration);
+int32_t tblFetchStart(uint8_t table, uint16_t dstAddr, tblFetchCb_t cb,
+        void *arg);
+void tblFetchGetStats(tblFetchStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TBLFETCH_H */
@@ -0,0 +1,718 @@
+/*
+ * topoCrawl.c
+ *
+ * This module contains the network topology crawler of the ZigBee
+ * Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include <semaphore.h>
+
+#include "topoCrawl.h"
+#include "mtZdo.h"
+#include "mtSys.h"
+#include "rpc.h"
+#include "rpcTimer.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// buckets of the address index, must be a power of 2
+#define TOPO_CRAWL_HASH_SIZE          (1024)
+
+#define TOPO_CRAWL_NONE               (0xFFFF)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint8_t used;
+	uint8_t send;          // a request is due
+	uint8_t startIndex;    // first neighbor table entry requested
+	uint8_t attempts;      // requests sent for this page
+	uint16_t node;         // index in crawlNodes
+	uint16_t gen;          // incremented for each request
+	uint64_t sent;         // time of the request
+	rpcTimer_t timer;      // response timeout
+} topoCrawlSlot_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static topoCrawlNode_t crawlNodes[TOPO_CRAWL_MAX_NODES];
+static topoCrawlLink_t crawlLinks[TOPO_CRAWL_MAX_LINKS];
+// first node of each bucket and next node of the same bucket
+static uint16_t crawlHash[TOPO_CRAWL_HASH_SIZE];
+static uint16_t crawlHashNext[TOPO_CRAWL_MAX_NODES];
+static topoCrawlSlot_t crawlSlots[TOPO_CRAWL_MAX_CONCURRENCY];
+static topoCrawlResult_t crawlResult;
+
+// nodes are added in the order they are found, so queried in that
+// order the crawl is breadth first. No node before crawlNext is queued.
+static uint16_t crawlNext;
+static uint8_t crawlActive = 0;
+static uint64_t crawlStartTime;
+static topoCrawlDoneCb_t crawlCb = NULL;
+static void *crawlArg = NULL;
+
+static uint8_t crawlConcurrency = TOPO_CRAWL_DEFAULT_CONCURRENCY;
+static uint32_t crawlTimeout = TOPO_CRAWL_DEFAULT_TIMEOUT;
+static uint8_t crawlMaxRetries = TOPO_CRAWL_DEFAULT_RETRIES;
+
+// protects all of the above
+static sem_t crawlSem;
+// serialises the ZDO_MGMT_LQI_REQs
+static sem_t crawlSendSem;
+
+static uint8_t crawlInitDone = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS DECLARATION
+ */
+
+static uint8_t crawlMgmtLqiRspCb(MgmtLqiRspFormat_t *msg);
+static void crawlTimeoutCb(void *arg);
+static void crawlPump(void);
+static void crawlFail(topoCrawlSlot_t *slot);
+static void crawlNeighbor(uint16_t from, NeighborLqiListItemFormat_t *item);
+static uint16_t crawlAddNode(uint16_t nwkAddr);
+static uint16_t crawlFind(uint16_t nwkAddr);
+
+static mtZdoCb_t crawlZdoCbs =
+	{ .pfnZdoMgmtLqiRsp = crawlMgmtLqiRspCb, };
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      topoCrawlInit
+ *
+ * @brief   initialise the topology crawler, must be called once after
+ *          rpcInitMq()
+ *
+ * @param   -
+ *
+ * @return  status, -1 if its observer could not be registered
+ */
+int32_t topoCrawlInit(void)
+{
+	memset(crawlSlots, 0, sizeof(crawlSlots));
+	memset(&crawlResult, 0, sizeof(crawlResult));
+	memset(crawlHash, 0xFF, sizeof(crawlHash));
+	crawlActive = 0;
+
+	sem_init(&crawlSem, 0, 1);
+	sem_init(&crawlSendSem, 0, 1);
+
+	if (!crawlInitDone)
+	{
+		if (zdoRegisterObserver(&crawlZdoCbs) != 0)
+		{
+			dbg_print(PRINT_LEVEL_WARNING,
+			        "topoCrawlInit: no free observer entry\n");
+			return -1;
+		}
+		crawlInitDone = 1;
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      topoCrawlConfig
+ *
+ * @brief   set the concurrency and the retries of the next crawl
+ *
+ * @param   concurrency - routers queried at the same time, at most
+ *          TOPO_CRAWL_MAX_CONCURRENCY
+ * @param   timeout - time to wait for a ZDO_MGMT_LQI_RSP in ms
+ * @param   maxRetries - requests repeated per page before the router
+ *          is given up
+ *
+ * @return  -
+ */
+void topoCrawlConfig(uint8_t concurrency, uint32_t timeout,
+        uint8_t maxRetries)
+{
+	if (concurrency == 0)
+	{
+		concurrency = 1;
+	}
+	if (concurrency > TOPO_CRAWL_MAX_CONCURRENCY)
+	{
+		concurrency = TOPO_CRAWL_MAX_CONCURRENCY;
+	}
+
+	sem_wait(&crawlSem);
+
+	crawlConcurrency = concurrency;
+	crawlTimeout = timeout;
+	crawlMaxRetries = maxRetries;
+
+	sem_post(&crawlSem);
+}
+
+/*********************************************************************
+ * @fn      topoCrawlStart
+ *
+ * @brief   start a crawl from a router. The neighbor tables are read
+ *          page by page with ZDO_MGMT_LQI_REQs, the routers found are
+ *          queried in turn. The graph of the previous crawl is cleared.
+ *
+ * @param   rootAddr - short address of the first router, 0 for the
+ *          coordinator
+ * @param   cb - called once the crawl is over, the graph can then be
+ *          read with topoCrawlGetNode() and topoCrawlGetLink()
+ * @param   arg - passed to cb
+ *
+ * @return  status, -1 if a crawl is already running
+ */
+int32_t topoCrawlStart(uint16_t rootAddr, topoCrawlDoneCb_t cb, void *arg)
+{
+	uint16_t root;
+
+	sem_wait(&crawlSem);
+
+	if (crawlActive)
+	{
+		sem_post(&crawlSem);
+		return -1;
+	}
+
+	memset(&crawlResult, 0, sizeof(crawlResult));
+	memset(crawlHash, 0xFF, sizeof(crawlHash));
+	crawlNext = 0;
+
+	root = crawlAddNode(rootAddr);
+	if (rootAddr == 0)
+	{
+		crawlNodes[root].devType = DEVICETYPE_COORDINATOR;
+	}
+	else
+	{
+		crawlNodes[root].devType = DEVICETYPE_ROUTER;
+	}
+	crawlNodes[root].rxOnWhenIdle = 1;
+
+	crawlCb = cb;
+	crawlArg = arg;
+	crawlStartTime = rpcTimerNow();
+	crawlActive = 1;
+
+	sem_post(&crawlSem);
+
+	dbg_print(PRINT_LEVEL_INFO, "topoCrawlStart: from 0x%04X\n", rootAddr);
+
+	crawlPump();
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      topoCrawlGetNode
+ *
+ * @brief   get a node of the graph
+ *
+ * @param   idx - index of the node, from 0 to topoCrawlResult_t.nodes - 1
+ * @param   node - filled in with the node
+ *
+ * @return  status, -1 if there is no such node
+ */
+int32_t topoCrawlGetNode(uint16_t idx, topoCrawlNode_t *node)
+{
+	int32_t status = -1;
+
+	sem_wait(&crawlSem);
+
+	if (idx < crawlResult.nodes)
+	{
+		memcpy(node, &crawlNodes[idx], sizeof(topoCrawlNode_t));
+		status = 0;
+	}
+
+	sem_post(&crawlSem);
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      topoCrawlGetLink
+ *
+ * @brief   get a link of the graph, there is one per neighbor table
+ *          entry read
+ *
+ * @param   idx - index of the link, from 0 to topoCrawlResult_t.links - 1
+ * @param   link - filled in with the link
+ *
+ * @return  status, -1 if there is no such link
+ */
+int32_t topoCrawlGetLink(uint16_t idx, topoCrawlLink_t *link)
+{
+	int32_t status = -1;
+
+	sem_wait(&crawlSem);
+
+	if (idx < crawlResult.links)
+	{
+		memcpy(link, &crawlLinks[idx], sizeof(topoCrawlLink_t));
+		status = 0;
+	}
+
+	sem_post(&crawlSem);
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      topoCrawlFindNode
+ *
+ * @brief   find a node of the graph by its short address
+ *
+ * @param   nwkAddr - short address
+ *
+ * @return  index of the node, -1 if it was not found
+ */
+int32_t topoCrawlFindNode(uint16_t nwkAddr)
+{
+	uint16_t idx;
+
+	sem_wait(&crawlSem);
+
+	idx = crawlFind(nwkAddr);
+
+	sem_post(&crawlSem);
+
+	return (idx == TOPO_CRAWL_NONE) ? -1 : idx;
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      crawlMgmtLqiRspCb
+ *
+ * @brief   MT_ZDO_MGMT_LQI_RSP observer, records a page of a neighbor
+ *          table and requests the next one
+ *
+ * @param   msg - response
+ *
+ * @return  1 if the response belongs to the crawl
+ */
+static uint8_t crawlMgmtLqiRspCb(MgmtLqiRspFormat_t *msg)
+{
+	topoCrawlSlot_t *slot = NULL;
+	topoCrawlNode_t *node;
+	uint16_t next;
+	uint8_t idx;
+
+	sem_wait(&crawlSem);
+
+	if (crawlActive)
+	{
+		for (idx = 0; idx < TOPO_CRAWL_MAX_CONCURRENCY; idx++)
+		{
+			if (crawlSlots[idx].used && !crawlSlots[idx].send
+			        && (crawlNodes[crawlSlots[idx].node].nwkAddr
+			                == msg->SrcAddr)
+			        && (crawlSlots[idx].startIndex == msg->StartIndex))
+			{
+				slot = &crawlSlots[idx];
+				break;
+			}
+		}
+	}
+
+	if (slot == NULL)
+	{
+		sem_post(&crawlSem);
+		return 0;
+	}
+
+	rpcTimerStop(&slot->timer);
+
+	if (msg->Status != MT_RPC_SUCCESS)
+	{
+		crawlFail(slot);
+	}
+	else
+	{
+		node = &crawlNodes[slot->node];
+		node->entries = msg->NeighborTableEntries;
+		for (idx = 0; idx < msg->NeighborLqiListCount; idx++)
+		{
+			crawlNeighbor(slot->node, &msg->NeighborLqiList[idx]);
+		}
+
+		next = msg->StartIndex + msg->NeighborLqiListCount;
+		if ((msg->NeighborLqiListCount > 0)
+		        && (next < msg->NeighborTableEntries))
+		{
+			// the rest of the table is on the next pages
+			slot->startIndex = (uint8_t) next;
+			slot->attempts = 0;
+			slot->send = 1;
+		}
+		else
+		{
+			node->state = TOPO_CRAWL_NODE_DONE;
+			slot->used = 0;
+		}
+	}
+
+	sem_post(&crawlSem);
+
+	crawlPump();
+
+	return 1;
+}
+
+/*********************************************************************
+ * @fn      crawlTimeoutCb
+ *
+ * @brief   response timeout of a request
+ *
+ * @param   arg - slot
+ *
+ * @return  -
+ */
+static void crawlTimeoutCb(void *arg)
+{
+	topoCrawlSlot_t *slot = (topoCrawlSlot_t *) arg;
+	uint8_t expired;
+
+	sem_wait(&crawlSem);
+
+	// the response may have arrived while the timer callback was being
+	// called
+	expired = crawlActive && slot->used && !slot->send
+	        && (rpcTimerNow() >= (slot->sent + crawlTimeout));
+	if (expired)
+	{
+		dbg_print(PRINT_LEVEL_INFO,
+		        "topoCrawl: no response from 0x%04X for index %d\n",
+		        crawlNodes[slot->node].nwkAddr, slot->startIndex);
+		crawlFail(slot);
+	}
+
+	sem_post(&crawlSem);
+
+	if (expired)
+	{
+		crawlPump();
+	}
+}
+
+/*********************************************************************
+ * @fn      crawlPump
+ *
+ * @brief   send the requests that are due and start querying queued
+ *          routers while slots are free. The crawl is over when no
+ *          slot is used and no router is queued.
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+static void crawlPump(void)
+{
+	MgmtLqiReqFormat_t req;
+	topoCrawlSlot_t *slot;
+	topoCrawlResult_t result;
+	topoCrawlDoneCb_t cb;
+	void *arg;
+	uint8_t idx, busy;
+	uint16_t gen;
+	uint8_t status;
+
+	while (1)
+	{
+		sem_wait(&crawlSem);
+
+		if (!crawlActive)
+		{
+			sem_post(&crawlSem);
+			break;
+		}
+
+		slot = NULL;
+		busy = 0;
+		for (idx = 0; idx < TOPO_CRAWL_MAX_CONCURRENCY; idx++)
+		{
+			if (crawlSlots[idx].used)
+			{
+				busy = 1;
+				if (crawlSlots[idx].send)
+				{
+					slot = &crawlSlots[idx];
+					break;
+				}
+			}
+		}
+
+		if (slot == NULL)
+		{
+			while ((crawlNext < crawlResult.nodes)
+			        && (crawlNodes[crawlNext].state != TOPO_CRAWL_NODE_QUEUED))
+			{
+				crawlNext++;
+			}
+
+			for (idx = 0; (idx < crawlConcurrency) && (crawlNext
+			        < crawlResult.nodes); idx++)
+			{
+				if (!crawlSlots[idx].used)
+				{
+					slot = &crawlSlots[idx];
+					slot->used = 1;
+					slot->send = 1;
+					slot->node = crawlNext;
+					slot->startIndex = 0;
+					slot->attempts = 0;
+					crawlNodes[crawlNext++].state = TOPO_CRAWL_NODE_PENDING;
+					break;
+				}
+			}
+		}
+
+		if ((slot == NULL) && !busy && (crawlNext >= crawlResult.nodes))
+		{
+			crawlActive = 0;
+			crawlResult.time = (uint32_t) (rpcTimerNow() - crawlStartTime);
+			memcpy(&result, &crawlResult, sizeof(topoCrawlResult_t));
+			cb = crawlCb;
+			arg = crawlArg;
+
+			sem_post(&crawlSem);
+
+			dbg_print(PRINT_LEVEL_INFO,
+			        "topoCrawl: %d nodes, %d links, %d failed in %d ms\n",
+			        result.nodes, result.links, result.failed, result.time);
+
+			if (cb != NULL)
+			{
+				cb(&result, arg);
+			}
+			break;
+		}
+
+		if (slot == NULL)
+		{
+			sem_post(&crawlSem);
+			break;
+		}
+
+		slot->send = 0;
+		slot->attempts++;
+		slot->gen++;
+		slot->sent = rpcTimerNow();
+		gen = slot->gen;
+		req.DstAddr = crawlNodes[slot->node].nwkAddr;
+		req.StartIndex = slot->startIndex;
+		crawlResult.requests++;
+		if (slot->attempts > 1)
+		{
+			crawlResult.retries++;
+		}
+		rpcTimerStart(&slot->timer, crawlTimeout, 0, crawlTimeoutCb, slot);
+
+		sem_post(&crawlSem);
+
+		sem_wait(&crawlSendSem);
+		status = zdoMgmtLqiReq(&req);
+		sem_post(&crawlSendSem);
+
+		if (status != MT_RPC_SUCCESS)
+		{
+			sem_wait(&crawlSem);
+			if (slot->used && !slot->send && (slot->gen == gen))
+			{
+				rpcTimerStop(&slot->timer);
+				crawlFail(slot);
+			}
+			sem_post(&crawlSem);
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      crawlFail
+ *
+ * @brief   repeat a request that failed or give the router up, called
+ *          with crawlSem held
+ *
+ * @param   slot - slot of the request
+ *
+ * @return  -
+ */
+static void crawlFail(topoCrawlSlot_t *slot)
+{
+	if (slot->attempts <= crawlMaxRetries)
+	{
+		slot->send = 1;
+	}
+	else
+	{
+		crawlNodes[slot->node].state = TOPO_CRAWL_NODE_FAILED;
+		crawlResult.failed++;
+		slot->used = 0;
+	}
+}
+
+/*********************************************************************
+ * @fn      crawlNeighbor
+ *
+ * @brief   record a neighbor table entry, called with crawlSem held.
+ *          A router seen for the first time is queued.
+ *
+ * @param   from - index of the node the entry was read from
+ * @param   item - neighbor table entry
+ *
+ * @return  -
+ */
+static void crawlNeighbor(uint16_t from, NeighborLqiListItemFormat_t *item)
+{
+	topoCrawlNode_t *node;
+	topoCrawlLink_t *link;
+	uint16_t idx;
+	uint8_t devType = item->DevTyp_RxOnWhenIdle_Relat & 0x03;
+
+	// unused or invalid short address
+	if (item->NetworkAddress >= 0xFFF8)
+	{
+		return;
+	}
+
+	idx = crawlFind(item->NetworkAddress);
+	if (idx == TOPO_CRAWL_NONE)
+	{
+		idx = crawlAddNode(item->NetworkAddress);
+		if (idx == TOPO_CRAWL_NONE)
+		{
+			crawlResult.dropped++;
+			return;
+		}
+
+		node = &crawlNodes[idx];
+		node->devType = devType;
+		node->rxOnWhenIdle = (item->DevTyp_RxOnWhenIdle_Relat >> 2) & 0x03;
+		node->depth = item->Depth;
+		if ((devType != DEVICETYPE_COORDINATOR)
+		        && (devType != DEVICETYPE_ROUTER))
+		{
+			node->state = TOPO_CRAWL_NODE_LEAF;
+		}
+	}
+
+	node = &crawlNodes[idx];
+	if (node->extAddr == 0)
+	{
+		node->extAddr = item->ExtendedAddress;
+	}
+
+	if (crawlResult.links >= TOPO_CRAWL_MAX_LINKS)
+	{
+		crawlResult.dropped++;
+		return;
+	}
+
+	link = &crawlLinks[crawlResult.links++];
+	link->from = from;
+	link->to = idx;
+	link->relation = (item->DevTyp_RxOnWhenIdle_Relat >> 4) & 0x07;
+	link->lqi = item->LQI;
+}
+
+/*********************************************************************
+ * @fn      crawlAddNode
+ *
+ * @brief   add a queued node to the graph, called with crawlSem held
+ *
+ * @param   nwkAddr - short address
+ *
+ * @return  index of the node, TOPO_CRAWL_NONE if the table is full
+ */
+static uint16_t crawlAddNode(uint16_t nwkAddr)
+{
+	topoCrawlNode_t *node;
+	uint16_t idx, bucket;
+
+	if (crawlResult.nodes >= TOPO_CRAWL_MAX_NODES)
+	{
+		return TOPO_CRAWL_NONE;
+	}
+
+	idx = crawlResult.nodes++;
+	node = &crawlNodes[idx];
+	memset(node, 0, sizeof(topoCrawlNode_t));
+	node->nwkAddr = nwkAddr;
+	node->state = TOPO_CRAWL_NODE_QUEUED;
+
+	bucket = nwkAddr & (TOPO_CRAWL_HASH_SIZE - 1);
+	crawlHashNext[idx] = crawlHash[bucket];
+	crawlHash[bucket] = idx;
+
+	return idx;
+}
+
+/*********************************************************************
+ * @fn      crawlFind
+ *
+ * @brief   find a node by its short address, called with crawlSem held
+ *
+ * @param   nwkAddr - short address
+ *
+ * @return  index of the node, TOPO_CRAWL_NONE if it is not known
+ */
+static uint16_t crawlFind(uint16_t nwkAddr)
+{
+	uint16_t idx = crawlHash[nwkAddr & (TOPO_CRAWL_HASH_SIZE - 1)];
+
+	while ((idx != TOPO_CRAWL_NONE) && (crawlNodes[idx].nwkAddr != nwkAddr))
+	{
+		idx = crawlHashNext[idx];
+	}
+
+	return idx;
+}
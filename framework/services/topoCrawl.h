@@ -0,0 +1,135 @@
+/*
+ * topoCrawl.h
+ *
+ * This module contains the network topology crawler of the ZigBee
+ * Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TOPOCRAWL_H
+#define TOPOCRAWL_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// nodes and links of the graph, more are not recorded
+#define TOPO_CRAWL_MAX_NODES          (1024)
+#define TOPO_CRAWL_MAX_LINKS          (4096)
+
+// ZDO_MGMT_LQI_REQs in flight at the same time
+#define TOPO_CRAWL_MAX_CONCURRENCY    (8)
+
+// defaults of topoCrawlConfig()
+#define TOPO_CRAWL_DEFAULT_CONCURRENCY  (4)
+#define TOPO_CRAWL_DEFAULT_TIMEOUT      (3000)
+#define TOPO_CRAWL_DEFAULT_RETRIES      (2)
+
+// topoCrawlNode_t state
+#define TOPO_CRAWL_NODE_QUEUED        (0)  // router not queried yet
+#define TOPO_CRAWL_NODE_PENDING       (1)  // being queried
+#define TOPO_CRAWL_NODE_DONE          (2)  // neighbor table read
+#define TOPO_CRAWL_NODE_FAILED        (3)  // did not answer
+#define TOPO_CRAWL_NODE_LEAF          (4)  // end device, not queried
+
+// topoCrawlLink_t relation, as in the neighbor table
+#define TOPO_CRAWL_REL_PARENT         (0)
+#define TOPO_CRAWL_REL_CHILD          (1)
+#define TOPO_CRAWL_REL_SIBLING        (2)
+#define TOPO_CRAWL_REL_NONE           (3)
+#define TOPO_CRAWL_REL_PREV_CHILD     (4)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint16_t nwkAddr;
+	uint64_t extAddr;
+	uint8_t devType;       // DEVICETYPE_xxx
+	uint8_t rxOnWhenIdle;
+	uint8_t depth;
+	uint8_t state;         // TOPO_CRAWL_NODE_xxx
+	uint8_t entries;       // neighbor table entries the node reported
+} topoCrawlNode_t;
+
+typedef struct
+{
+	uint16_t from;         // index of the node reporting the neighbor
+	uint16_t to;           // index of the neighbor
+	uint8_t relation;      // TOPO_CRAWL_REL_xxx of the neighbor
+	uint8_t lqi;
+} topoCrawlLink_t;
+
+typedef struct
+{
+	uint16_t nodes;
+	uint16_t links;
+	uint16_t failed;       // routers that did not answer
+	uint16_t dropped;      // nodes and links not recorded, tables full
+	uint32_t requests;     // ZDO_MGMT_LQI_REQs sent
+	uint32_t retries;
+	uint32_t time;         // duration of the crawl in ms
+} topoCrawlResult_t;
+
+typedef void (*topoCrawlDoneCb_t)(topoCrawlResult_t *result, void *arg);
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+int32_t topoCrawlInit(void);
+void topoCrawlConfig(uint8_t concurrency, uint32_t timeout,
+        uint8_t maxRetries);
+int32_t topoCrawlStart(uint16_t rootAddr, topoCrawlDoneCb_t cb, void *arg);
+int32_t topoCrawlGetNode(uint16_t idx, topoCrawlNode_t *node);
+int32_t topoCrawlGetLink(uint16_t idx, topoCrawlLink_t *link);
+int32_t topoCrawlFindNode(uint16_t nwkAddr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TOPOCRAWL_H */
@@ -0,0 +1,1257 @@
+/*
+ * topoModel.c
+ *
+ * This module contains the incrementally maintained network topology of
+ * the ZigBee Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include <semaphore.h>
+
+#include "topoModel.h"
+#include "topoCrawl.h"
+#include "hashIdx.h"
+#include "mtZdo.h"
+#include "mtAf.h"
+#include "mtSys.h"
+#include "rpc.h"
+#include "rpcTimer.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// changes waiting to be passed to the callback
+#define TOPO_MODEL_MAX_CHANGES        (64)
+
+// slots of each address index, a power of 2 at least twice
+// TOPO_MODEL_MAX_NODES to keep the probes short
+#define TOPO_MODEL_HASH_SIZE          (2048)
+
+// Capabilities of ZDO_END_DEVICE_ANNCE_IND
+#define TOPO_MODEL_CAP_ROUTER         (0x02)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint8_t used;
+	uint8_t listed;        // listed as a child by the router re-queried
+	uint16_t prevParent;   // parent before it was found missing
+	topoModelNode_t node;
+} topoModelEntry_t;
+
+typedef enum
+{
+	TOPO_MODEL_IDLE, TOPO_MODEL_WAITING, TOPO_MODEL_QUERYING
+} topoModelState_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static topoModelEntry_t modelNodes[TOPO_MODEL_MAX_NODES];
+// indexes of modelNodes by short and by IEEE address
+static hashIdxSlot_t modelNwkSlots[TOPO_MODEL_HASH_SIZE];
+static hashIdxSlot_t modelExtSlots[TOPO_MODEL_HASH_SIZE];
+static hashIdx_t modelNwkHash;
+static hashIdx_t modelExtHash;
+static topoModelStats_t modelStats;
+static topoModelChangeCb_t modelCb = NULL;
+
+// changes not passed to the callback yet
+static topoModelChange_t modelChanges[TOPO_MODEL_MAX_CHANGES];
+static uint8_t modelChangeHead;
+static uint8_t modelChangeCnt;
+
+// routers to re-query, in order
+static uint16_t modelRequeries[TOPO_MODEL_MAX_REQUERIES];
+static uint8_t modelRequeryCnt;
+
+// re-query of a router, the neighbor table is read page by page
+static uint8_t modelState = TOPO_MODEL_IDLE;
+static uint16_t modelQueryAddr;
+static uint8_t modelQueryIndex;
+static uint8_t modelQueryAttempts;
+static uint16_t modelQueryGen;
+static uint64_t modelQuerySent;
+static rpcTimer_t modelTimer;   // re-query delay or response timeout
+
+// protects all of the above
+static sem_t modelSem;
+// serialises the ZDO_MGMT_LQI_REQs
+static sem_t modelSendSem;
+
+static uint8_t modelInitDone = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS DECLARATION
+ */
+
+static uint8_t modelEndDeviceAnnceIndCb(EndDeviceAnnceIndFormat_t *msg);
+static uint8_t modelLeaveIndCb(LeaveIndFormat_t *msg);
+static uint8_t modelSrcRtgIndCb(SrcRtgIndFormat_t *msg);
+static uint8_t modelMgmtLqiRspCb(MgmtLqiRspFormat_t *msg);
+static uint8_t modelIncomingMsgCb(IncomingMsgFormat_t *msg);
+static uint8_t modelIncomingMsgExtCb(IncomingMsgExtFormat_t *msg);
+static void modelTimerCb(void *arg);
+static void modelSend(void);
+static void modelEmit(void);
+static void modelNextQuery(void);
+static void modelQueryDone(void);
+static void modelQueryFail(void);
+static void modelNeighbor(NeighborLqiListItemFormat_t *item);
+static void modelSchedule(uint16_t routerAddr);
+static void modelSetParent(topoModelEntry_t *entry, uint16_t parent);
+static void modelChange(uint8_t type, topoModelEntry_t *entry,
+        uint16_t oldParent, uint16_t oldNwkAddr);
+static void modelSeen(uint16_t nwkAddr, uint8_t lqi);
+static topoModelEntry_t *modelAdd(uint16_t nwkAddr);
+static void modelRemove(topoModelEntry_t *entry);
+static void modelSetNwk(topoModelEntry_t *entry, uint16_t nwkAddr);
+static void modelSetExt(topoModelEntry_t *entry, uint64_t extAddr);
+static topoModelEntry_t *modelFindNwk(uint16_t nwkAddr);
+static topoModelEntry_t *modelFindExt(uint64_t extAddr);
+
+static mtZdoCb_t modelZdoCbs =
+	{ .pfnZdoMgmtLqiRsp = modelMgmtLqiRspCb,
+	        .pfnZdoEndDeviceAnnceInd = modelEndDeviceAnnceIndCb,
+	        .pfnZdoSrcRtgInd = modelSrcRtgIndCb,
+	        .pfnZdoLeaveInd = modelLeaveIndCb, };
+
+static mtAfCb_t modelAfCbs =
+	{ NULL,			//MT_AF_DATA_CONFIRM
+	        modelIncomingMsgCb,	//MT_AF_INCOMING_MSG
+	        modelIncomingMsgExtCb,	//MT_AF_INCOMING_MSG_EXT
+	        NULL,			//MT_AF_DATA_RETRIEVE
+	        NULL,			//MT_AF_REFLECT_ERROR
+	    };
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      topoModelInit
+ *
+ * @brief   initialise the topology model, must be called once after
+ *          rpcInitMq(). The model is then kept up to date from device
+ *          announcements, leave indications, route records and the
+ *          link quality of incoming messages, and the routers a change
+ *          concerns are re-queried.
+ *
+ * @param   cb - called for each change of the model, may be NULL
+ *
+ * @return  status, -1 if its observers could not be registered
+ */
+int32_t topoModelInit(topoModelChangeCb_t cb)
+{
+	memset(modelNodes, 0, sizeof(modelNodes));
+	hashIdxInit(&modelNwkHash, modelNwkSlots, TOPO_MODEL_HASH_SIZE);
+	hashIdxInit(&modelExtHash, modelExtSlots, TOPO_MODEL_HASH_SIZE);
+	memset(&modelStats, 0, sizeof(modelStats));
+	modelChangeHead = 0;
+	modelChangeCnt = 0;
+	modelRequeryCnt = 0;
+	modelState = TOPO_MODEL_IDLE;
+	modelCb = cb;
+
+	sem_init(&modelSem, 0, 1);
+	sem_init(&modelSendSem, 0, 1);
+
+	if (!modelInitDone)
+	{
+		if ((zdoRegisterObserver(&modelZdoCbs) != 0)
+		        || (afRegisterObserver(&modelAfCbs) != 0))
+		{
+			dbg_print(PRINT_LEVEL_WARNING,
+			        "topoModelInit: no free observer entry\n");
+			return -1;
+		}
+		modelInitDone = 1;
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      topoModelLoadCrawl
+ *
+ * @brief   replace the model with the graph of the last topoCrawl
+ *          crawl, no changes are reported
+ *
+ * @param   -
+ *
+ * @return  number of nodes loaded
+ */
+int32_t topoModelLoadCrawl(void)
+{
+	topoCrawlNode_t crawlNode;
+	topoCrawlLink_t link;
+	topoModelNode_t *node;
+	uint16_t idx, cnt;
+
+	sem_wait(&modelSem);
+
+	memset(modelNodes, 0, sizeof(modelNodes));
+	hashIdxClear(&modelNwkHash);
+	hashIdxClear(&modelExtHash);
+
+	// the crawl has as many nodes at most, the indexes are kept
+	for (idx = 0; (idx < TOPO_MODEL_MAX_NODES)
+	        && (topoCrawlGetNode(idx, &crawlNode) == 0); idx++)
+	{
+		modelNodes[idx].used = 1;
+		modelNodes[idx].prevParent = TOPO_MODEL_ADDR_UNKNOWN;
+		node = &modelNodes[idx].node;
+		node->nwkAddr = crawlNode.nwkAddr;
+		node->extAddr = crawlNode.extAddr;
+		node->devType = crawlNode.devType;
+		node->parent = TOPO_MODEL_ADDR_UNKNOWN;
+		hashIdxInsert(&modelNwkHash, hashIdxTag16(node->nwkAddr), idx);
+		if (node->extAddr != 0)
+		{
+			hashIdxInsert(&modelExtHash, hashIdxTag64(node->extAddr), idx);
+		}
+	}
+	cnt = idx;
+
+	for (idx = 0; topoCrawlGetLink(idx, &link) == 0; idx++)
+	{
+		if (link.relation == TOPO_CRAWL_REL_CHILD)
+		{
+			modelNodes[link.to].node.parent =
+			        modelNodes[link.from].node.nwkAddr;
+		}
+		else if (link.relation == TOPO_CRAWL_REL_PARENT)
+		{
+			modelNodes[link.from].node.parent =
+			        modelNodes[link.to].node.nwkAddr;
+		}
+	}
+
+	sem_post(&modelSem);
+
+	return cnt;
+}
+
+/*********************************************************************
+ * @fn      topoModelRequery
+ *
+ * @brief   schedule a re-query of the neighbor table of a router
+ *
+ * @param   routerAddr - short address of the router
+ *
+ * @return  status, -1 if too many re-queries are waiting
+ */
+int32_t topoModelRequery(uint16_t routerAddr)
+{
+	uint32_t dropped;
+
+	sem_wait(&modelSem);
+
+	dropped = modelStats.dropped;
+	modelSchedule(routerAddr);
+	dropped = modelStats.dropped - dropped;
+
+	sem_post(&modelSem);
+
+	return dropped ? -1 : 0;
+}
+
+/*********************************************************************
+ * @fn      topoModelGetNode
+ *
+ * @brief   get a node of the model
+ *
+ * @param   nwkAddr - short address of the node
+ * @param   node - filled in with the node
+ *
+ * @return  status, -1 if the node is not in the model
+ */
+int32_t topoModelGetNode(uint16_t nwkAddr, topoModelNode_t *node)
+{
+	topoModelEntry_t *entry;
+
+	sem_wait(&modelSem);
+
+	entry = modelFindNwk(nwkAddr);
+	if (entry != NULL)
+	{
+		memcpy(node, &entry->node, sizeof(topoModelNode_t));
+	}
+
+	sem_post(&modelSem);
+
+	return (entry != NULL) ? 0 : -1;
+}
+
+/*********************************************************************
+ * @fn      topoModelGetNodes
+ *
+ * @brief   get all nodes of the model
+ *
+ * @param   nodes - filled in with the nodes
+ * @param   maxNodes - size of nodes
+ *
+ * @return  number of nodes copied
+ */
+uint16_t topoModelGetNodes(topoModelNode_t *nodes, uint16_t maxNodes)
+{
+	uint16_t idx, cnt = 0;
+
+	sem_wait(&modelSem);
+
+	for (idx = 0; (idx < TOPO_MODEL_MAX_NODES) && (cnt < maxNodes); idx++)
+	{
+		if (modelNodes[idx].used)
+		{
+			memcpy(&nodes[cnt++], &modelNodes[idx].node,
+			        sizeof(topoModelNode_t));
+		}
+	}
+
+	sem_post(&modelSem);
+
+	return cnt;
+}
+
+/*********************************************************************
+ * @fn      topoModelGetStats
+ *
+ * @brief   get the topology model counters
+ *
+ * @param   stats - filled in with the counters
+ *
+ * @return  -
+ */
+void topoModelGetStats(topoModelStats_t *stats)
+{
+	uint16_t idx;
+
+	sem_wait(&modelSem);
+
+	memcpy(stats, &modelStats, sizeof(topoModelStats_t));
+	stats->nodes = 0;
+	for (idx = 0; idx < TOPO_MODEL_MAX_NODES; idx++)
+	{
+		if (modelNodes[idx].used)
+		{
+			stats->nodes++;
+		}
+	}
+
+	sem_post(&modelSem);
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      modelEndDeviceAnnceIndCb
+ *
+ * @brief   MT_ZDO_END_DEVICE_ANNCE_IND observer, a device joined or
+ *          rejoined. A router is re-queried for its neighbors, the old
+ *          parent of an end device to learn if it moved.
+ *
+ * @param   msg - announcement
+ *
+ * @return  0, the application still gets the indication
+ */
+static uint8_t modelEndDeviceAnnceIndCb(EndDeviceAnnceIndFormat_t *msg)
+{
+	topoModelEntry_t *entry;
+	uint16_t oldNwkAddr;
+
+	sem_wait(&modelSem);
+
+	entry = modelFindExt(msg->IEEEAddr);
+	if (entry == NULL)
+	{
+		entry = modelFindNwk(msg->NwkAddr);
+	}
+
+	if (entry == NULL)
+	{
+		entry = modelAdd(msg->NwkAddr);
+		if (entry != NULL)
+		{
+			modelSetExt(entry, msg->IEEEAddr);
+			modelChange(TOPO_MODEL_NODE_ADDED, entry, TOPO_MODEL_ADDR_UNKNOWN,
+			        TOPO_MODEL_ADDR_UNKNOWN);
+		}
+	}
+	else if (entry->node.nwkAddr != msg->NwkAddr)
+	{
+		oldNwkAddr = entry->node.nwkAddr;
+		modelSetNwk(entry, msg->NwkAddr);
+		modelChange(TOPO_MODEL_NODE_READDRESSED, entry, entry->node.parent,
+		        oldNwkAddr);
+	}
+
+	if (entry != NULL)
+	{
+		modelSetExt(entry, msg->IEEEAddr);
+		entry->node.devType =
+		        (msg->Capabilities & TOPO_MODEL_CAP_ROUTER) ?
+		                DEVICETYPE_ROUTER : DEVICETYPE_ENDDEVICE;
+		entry->node.lastSeen = rpcTimerNow();
+
+		if (entry->node.devType == DEVICETYPE_ROUTER)
+		{
+			modelSchedule(entry->node.nwkAddr);
+		}
+		else if (entry->node.parent != TOPO_MODEL_ADDR_UNKNOWN)
+		{
+			modelSchedule(entry->node.parent);
+		}
+	}
+
+	sem_post(&modelSem);
+
+	modelEmit();
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      modelLeaveIndCb
+ *
+ * @brief   MT_ZDO_LEAVE_IND observer, removes a device leaving for good
+ *          and re-queries its parent. A device leaving to rejoin is
+ *          kept, its announcement follows.
+ *
+ * @param   msg - leave indication
+ *
+ * @return  0, the application still gets the indication
+ */
+static uint8_t modelLeaveIndCb(LeaveIndFormat_t *msg)
+{
+	topoModelEntry_t *entry;
+
+	if (msg->Rejoin)
+	{
+		return 0;
+	}
+
+	sem_wait(&modelSem);
+
+	entry = modelFindExt(msg->ExtAddr);
+	if (entry == NULL)
+	{
+		entry = modelFindNwk(msg->SrcAddr);
+	}
+
+	if (entry != NULL)
+	{
+		modelChange(TOPO_MODEL_NODE_REMOVED, entry, entry->node.parent,
+		        TOPO_MODEL_ADDR_UNKNOWN);
+		if (entry->node.parent != TOPO_MODEL_ADDR_UNKNOWN)
+		{
+			modelSchedule(entry->node.parent);
+		}
+		modelRemove(entry);
+	}
+
+	sem_post(&modelSem);
+
+	modelEmit();
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      modelSrcRtgIndCb
+ *
+ * @brief   MT_ZDO_SRC_RTG_IND observer. The first relay of the route
+ *          record of an end device is its parent, a different one than
+ *          in the model is re-queried to confirm the move.
+ *
+ * @param   msg - route record
+ *
+ * @return  0, the application still gets the indication
+ */
+static uint8_t modelSrcRtgIndCb(SrcRtgIndFormat_t *msg)
+{
+	topoModelEntry_t *entry;
+	uint16_t firstHop;
+
+	// a direct neighbor of the coordinator
+	firstHop = (msg->RelayCount > 0) ? msg->RelayList[0] : 0x0000;
+
+	sem_wait(&modelSem);
+
+	entry = modelFindNwk(msg->DstAddr);
+	if (entry == NULL)
+	{
+		entry = modelAdd(msg->DstAddr);
+		if (entry != NULL)
+		{
+			modelChange(TOPO_MODEL_NODE_ADDED, entry, TOPO_MODEL_ADDR_UNKNOWN,
+			        TOPO_MODEL_ADDR_UNKNOWN);
+			modelSchedule(firstHop);
+		}
+	}
+	else if ((entry->node.devType != DEVICETYPE_ROUTER)
+	        && (entry->node.devType != DEVICETYPE_COORDINATOR)
+	        && (entry->node.parent != firstHop))
+	{
+		modelSchedule(firstHop);
+	}
+
+	if (entry != NULL)
+	{
+		entry->node.lastSeen = rpcTimerNow();
+	}
+
+	sem_post(&modelSem);
+
+	modelEmit();
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      modelIncomingMsgCb
+ *
+ * @brief   MT_AF_INCOMING_MSG observer, records the link quality
+ *
+ * @param   msg - incoming message
+ *
+ * @return  0, the application still gets the message
+ */
+static uint8_t modelIncomingMsgCb(IncomingMsgFormat_t *msg)
+{
+	modelSeen(msg->SrcAddr, msg->LinkQuality);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      modelIncomingMsgExtCb
+ *
+ * @brief   MT_AF_INCOMING_MSG_EXT observer, records the link quality
+ *
+ * @param   msg - incoming message
+ *
+ * @return  0, the application still gets the message
+ */
+static uint8_t modelIncomingMsgExtCb(IncomingMsgExtFormat_t *msg)
+{
+	if (msg->SrcAddrMode == Addr16Bit)
+	{
+		modelSeen((uint16_t) msg->SrcAddr, msg->LinkQuality);
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      modelMgmtLqiRspCb
+ *
+ * @brief   MT_ZDO_MGMT_LQI_RSP observer, applies a page of the neighbor
+ *          table of the router being re-queried
+ *
+ * @param   msg - response
+ *
+ * @return  1 if the response belongs to the re-query
+ */
+static uint8_t modelMgmtLqiRspCb(MgmtLqiRspFormat_t *msg)
+{
+	uint16_t next;
+	uint8_t idx;
+
+	sem_wait(&modelSem);
+
+	if ((modelState != TOPO_MODEL_QUERYING) || (msg->SrcAddr != modelQueryAddr)
+	        || (msg->StartIndex != modelQueryIndex))
+	{
+		sem_post(&modelSem);
+		return 0;
+	}
+
+	rpcTimerStop(&modelTimer);
+
+	if (msg->Status != MT_RPC_SUCCESS)
+	{
+		modelQueryFail();
+	}
+	else
+	{
+		for (idx = 0; idx < msg->NeighborLqiListCount; idx++)
+		{
+			modelNeighbor(&msg->NeighborLqiList[idx]);
+		}
+
+		next = msg->StartIndex + msg->NeighborLqiListCount;
+		if ((msg->NeighborLqiListCount > 0)
+		        && (next < msg->NeighborTableEntries))
+		{
+			modelQueryIndex = (uint8_t) next;
+			modelQueryAttempts = 0;
+		}
+		else
+		{
+			modelQueryDone();
+			modelNextQuery();
+		}
+	}
+
+	sem_post(&modelSem);
+
+	modelEmit();
+	modelSend();
+
+	return 1;
+}
+
+/*********************************************************************
+ * @fn      modelTimerCb
+ *
+ * @brief   end of the re-query delay or response timeout
+ *
+ * @param   arg - not used
+ *
+ * @return  -
+ */
+static void modelTimerCb(void *arg)
+{
+	sem_wait(&modelSem);
+
+	if (modelState == TOPO_MODEL_WAITING)
+	{
+		modelNextQuery();
+	}
+	else if ((modelState == TOPO_MODEL_QUERYING)
+	        && (rpcTimerNow() >= (modelQuerySent + TOPO_MODEL_REQUERY_TIMEOUT)))
+	{
+		// the response may have arrived while the timer callback was
+		// being called, then modelQuerySent is recent
+		modelQueryFail();
+	}
+
+	sem_post(&modelSem);
+
+	modelEmit();
+	modelSend();
+}
+
+/*********************************************************************
+ * @fn      modelSend
+ *
+ * @brief   send the ZDO_MGMT_LQI_REQ of the re-query if one is due
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+static void modelSend(void)
+{
+	MgmtLqiReqFormat_t req;
+	uint16_t gen;
+	uint8_t status;
+
+	while (1)
+	{
+		sem_wait(&modelSem);
+
+		if ((modelState != TOPO_MODEL_QUERYING)
+		        || rpcTimerActive(&modelTimer))
+		{
+			sem_post(&modelSem);
+			return;
+		}
+
+		modelQueryAttempts++;
+		modelQueryGen++;
+		modelQuerySent = rpcTimerNow();
+		gen = modelQueryGen;
+		req.DstAddr = modelQueryAddr;
+		req.StartIndex = modelQueryIndex;
+		rpcTimerStart(&modelTimer, TOPO_MODEL_REQUERY_TIMEOUT, 0,
+		        modelTimerCb, NULL);
+
+		sem_post(&modelSem);
+
+		sem_wait(&modelSendSem);
+		status = zdoMgmtLqiReq(&req);
+		sem_post(&modelSendSem);
+
+		if (status == MT_RPC_SUCCESS)
+		{
+			return;
+		}
+
+		sem_wait(&modelSem);
+		if ((modelState == TOPO_MODEL_QUERYING) && (modelQueryGen == gen))
+		{
+			rpcTimerStop(&modelTimer);
+			modelQueryFail();
+		}
+		sem_post(&modelSem);
+
+		modelEmit();
+	}
+}
+
+/*********************************************************************
+ * @fn      modelEmit
+ *
+ * @brief   pass the recorded changes to the callback
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+static void modelEmit(void)
+{
+	topoModelChange_t change;
+
+	while (1)
+	{
+		sem_wait(&modelSem);
+
+		if (modelChangeCnt == 0)
+		{
+			sem_post(&modelSem);
+			return;
+		}
+
+		memcpy(&change, &modelChanges[modelChangeHead],
+		        sizeof(topoModelChange_t));
+		modelChangeHead = (modelChangeHead + 1) % TOPO_MODEL_MAX_CHANGES;
+		modelChangeCnt--;
+
+		sem_post(&modelSem);
+
+		if (modelCb != NULL)
+		{
+			modelCb(&change);
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      modelNextQuery
+ *
+ * @brief   start the re-query of the next router, called with modelSem
+ *          held. The end device children of the router are unmarked
+ *          to find those it no longer lists.
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+static void modelNextQuery(void)
+{
+	uint16_t idx;
+
+	if (modelRequeryCnt == 0)
+	{
+		modelState = TOPO_MODEL_IDLE;
+		return;
+	}
+
+	modelQueryAddr = modelRequeries[0];
+	modelRequeryCnt--;
+	memmove(&modelRequeries[0], &modelRequeries[1],
+	        modelRequeryCnt * sizeof(uint16_t));
+
+	modelQueryIndex = 0;
+	modelQueryAttempts = 0;
+	modelState = TOPO_MODEL_QUERYING;
+	modelStats.requeries++;
+
+	for (idx = 0; idx < TOPO_MODEL_MAX_NODES; idx++)
+	{
+		modelNodes[idx].listed = 0;
+	}
+
+	dbg_print(PRINT_LEVEL_VERBOSE, "topoModel: re-query of 0x%04X\n",
+	        modelQueryAddr);
+}
+
+/*********************************************************************
+ * @fn      modelQueryDone
+ *
+ * @brief   the whole neighbor table of the router has been read, called
+ *          with modelSem held. End devices it no longer lists as
+ *          children lose their parent until another router lists them.
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+static void modelQueryDone(void)
+{
+	topoModelEntry_t *entry;
+	uint16_t idx;
+
+	for (idx = 0; idx < TOPO_MODEL_MAX_NODES; idx++)
+	{
+		entry = &modelNodes[idx];
+		if (entry->used && !entry->listed
+		        && (entry->node.parent == modelQueryAddr)
+		        && (entry->node.devType == DEVICETYPE_ENDDEVICE))
+		{
+			entry->prevParent = modelQueryAddr;
+			entry->node.parent = TOPO_MODEL_ADDR_UNKNOWN;
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      modelQueryFail
+ *
+ * @brief   repeat a request without response or give the router up,
+ *          called with modelSem held
+ *
+ * @param   -
+ *
+ * @return  -
+ */
+static void modelQueryFail(void)
+{
+	if (modelQueryAttempts < TOPO_MODEL_REQUERY_ATTEMPTS)
+	{
+		// modelSend() sends it again
+		return;
+	}
+
+	dbg_print(PRINT_LEVEL_INFO, "topoModel: no response from 0x%04X\n",
+	        modelQueryAddr);
+	modelStats.failed++;
+	modelNextQuery();
+}
+
+/*********************************************************************
+ * @fn      modelNeighbor
+ *
+ * @brief   apply a neighbor table entry of the router being re-queried,
+ *          called with modelSem held
+ *
+ * @param   item - neighbor table entry
+ *
+ * @return  -
+ */
+static void modelNeighbor(NeighborLqiListItemFormat_t *item)
+{
+	topoModelEntry_t *entry;
+	uint16_t oldNwkAddr;
+	uint8_t devType = item->DevTyp_RxOnWhenIdle_Relat & 0x03;
+	uint8_t relation = (item->DevTyp_RxOnWhenIdle_Relat >> 4) & 0x07;
+
+	if (item->NetworkAddress >= 0xFFF8)
+	{
+		return;
+	}
+
+	entry = modelFindNwk(item->NetworkAddress);
+	if ((entry == NULL) && (item->ExtendedAddress != 0))
+	{
+		entry = modelFindExt(item->ExtendedAddress);
+		if (entry != NULL)
+		{
+			oldNwkAddr = entry->node.nwkAddr;
+			modelSetNwk(entry, item->NetworkAddress);
+			modelChange(TOPO_MODEL_NODE_READDRESSED, entry, entry->node.parent,
+			        oldNwkAddr);
+		}
+	}
+
+	if (entry == NULL)
+	{
+		entry = modelAdd(item->NetworkAddress);
+		if (entry == NULL)
+		{
+			return;
+		}
+		modelSetExt(entry, item->ExtendedAddress);
+		entry->node.devType = devType;
+		if (relation == TOPO_CRAWL_REL_CHILD)
+		{
+			entry->node.parent = modelQueryAddr;
+		}
+		entry->listed = (relation == TOPO_CRAWL_REL_CHILD);
+		modelChange(TOPO_MODEL_NODE_ADDED, entry, TOPO_MODEL_ADDR_UNKNOWN,
+		        TOPO_MODEL_ADDR_UNKNOWN);
+
+		// a new router may have new children
+		if (devType == DEVICETYPE_ROUTER)
+		{
+			modelSchedule(item->NetworkAddress);
+		}
+		return;
+	}
+
+	if (entry->node.extAddr == 0)
+	{
+		modelSetExt(entry, item->ExtendedAddress);
+	}
+	if (entry->node.devType == TOPO_MODEL_TYPE_UNKNOWN)
+	{
+		entry->node.devType = devType;
+	}
+
+	if (relation == TOPO_CRAWL_REL_CHILD)
+	{
+		entry->listed = 1;
+		modelSetParent(entry, modelQueryAddr);
+	}
+}
+
+/*********************************************************************
+ * @fn      modelSchedule
+ *
+ * @brief   add a router to the re-queries, called with modelSem held
+ *
+ * @param   routerAddr - short address of the router
+ *
+ * @return  -
+ */
+static void modelSchedule(uint16_t routerAddr)
+{
+	uint8_t idx;
+
+	if ((modelState == TOPO_MODEL_QUERYING) && (modelQueryAddr == routerAddr))
+	{
+		return;
+	}
+
+	for (idx = 0; idx < modelRequeryCnt; idx++)
+	{
+		if (modelRequeries[idx] == routerAddr)
+		{
+			return;
+		}
+	}
+
+	if (modelRequeryCnt >= TOPO_MODEL_MAX_REQUERIES)
+	{
+		modelStats.dropped++;
+		return;
+	}
+
+	modelRequeries[modelRequeryCnt++] = routerAddr;
+
+	if (modelState == TOPO_MODEL_IDLE)
+	{
+		modelState = TOPO_MODEL_WAITING;
+		rpcTimerStart(&modelTimer, TOPO_MODEL_REQUERY_DELAY, 0, modelTimerCb,
+		        NULL);
+	}
+}
+
+/*********************************************************************
+ * @fn      modelSetParent
+ *
+ * @brief   set the parent of a node, reported as a reparenting if it
+ *          had another one. Called with modelSem held.
+ *
+ * @param   entry - node
+ * @param   parent - short address of the parent
+ *
+ * @return  -
+ */
+static void modelSetParent(topoModelEntry_t *entry, uint16_t parent)
+{
+	uint16_t oldParent = entry->node.parent;
+
+	if (oldParent == TOPO_MODEL_ADDR_UNKNOWN)
+	{
+		oldParent = entry->prevParent;
+	}
+
+	entry->node.parent = parent;
+	entry->prevParent = TOPO_MODEL_ADDR_UNKNOWN;
+
+	if ((oldParent != TOPO_MODEL_ADDR_UNKNOWN) && (oldParent != parent))
+	{
+		modelChange(TOPO_MODEL_NODE_REPARENTED, entry, oldParent,
+		        TOPO_MODEL_ADDR_UNKNOWN);
+	}
+}
+
+/*********************************************************************
+ * @fn      modelChange
+ *
+ * @brief   record a change for the callback, called with modelSem held.
+ *          The oldest change is lost if too many are waiting.
+ *
+ * @param   type - TOPO_MODEL_NODE_xxx
+ * @param   entry - node that changed
+ * @param   oldParent - parent before the change
+ * @param   oldNwkAddr - short address before the change
+ *
+ * @return  -
+ */
+static void modelChange(uint8_t type, topoModelEntry_t *entry,
+        uint16_t oldParent, uint16_t oldNwkAddr)
+{
+	topoModelChange_t *change;
+
+	if (modelChangeCnt >= TOPO_MODEL_MAX_CHANGES)
+	{
+		modelChangeHead = (modelChangeHead + 1) % TOPO_MODEL_MAX_CHANGES;
+		modelChangeCnt--;
+		modelStats.dropped++;
+	}
+
+	change = &modelChanges[(modelChangeHead + modelChangeCnt)
+	        % TOPO_MODEL_MAX_CHANGES];
+	modelChangeCnt++;
+	modelStats.changes++;
+
+	change->type = type;
+	change->nwkAddr = entry->node.nwkAddr;
+	change->extAddr = entry->node.extAddr;
+	change->parent = entry->node.parent;
+	change->oldParent = oldParent;
+	change->oldNwkAddr = oldNwkAddr;
+}
+
+/*********************************************************************
+ * @fn      modelSeen
+ *
+ * @brief   record the link quality of a message from a node, an
+ *          unknown source is added to the model
+ *
+ * @param   nwkAddr - short address of the source
+ * @param   lqi - link quality
+ *
+ * @return  -
+ */
+static void modelSeen(uint16_t nwkAddr, uint8_t lqi)
+{
+	topoModelEntry_t *entry;
+	uint8_t added = 0;
+
+	sem_wait(&modelSem);
+
+	entry = modelFindNwk(nwkAddr);
+	if (entry == NULL)
+	{
+		entry = modelAdd(nwkAddr);
+		if (entry != NULL)
+		{
+			modelChange(TOPO_MODEL_NODE_ADDED, entry, TOPO_MODEL_ADDR_UNKNOWN,
+			        TOPO_MODEL_ADDR_UNKNOWN);
+			added = 1;
+		}
+	}
+
+	if (entry != NULL)
+	{
+		entry->node.lqi = lqi;
+		entry->node.lastSeen = rpcTimerNow();
+	}
+
+	sem_post(&modelSem);
+
+	if (added)
+	{
+		modelEmit();
+	}
+}
+
+/*********************************************************************
+ * @fn      modelAdd
+ *
+ * @brief   add a node of unknown type and parent, called with modelSem
+ *          held
+ *
+ * @param   nwkAddr - short address
+ *
+ * @return  node, NULL if the model is full
+ */
+static topoModelEntry_t *modelAdd(uint16_t nwkAddr)
+{
+	topoModelEntry_t *entry;
+	uint16_t idx;
+
+	for (idx = 0; idx < TOPO_MODEL_MAX_NODES; idx++)
+	{
+		entry = &modelNodes[idx];
+		if (!entry->used)
+		{
+			memset(entry, 0, sizeof(topoModelEntry_t));
+			entry->used = 1;
+			entry->prevParent = TOPO_MODEL_ADDR_UNKNOWN;
+			entry->node.nwkAddr = nwkAddr;
+			entry->node.parent = TOPO_MODEL_ADDR_UNKNOWN;
+			entry->node.devType = TOPO_MODEL_TYPE_UNKNOWN;
+			hashIdxInsert(&modelNwkHash, hashIdxTag16(nwkAddr), idx);
+			return entry;
+		}
+	}
+
+	modelStats.dropped++;
+
+	return NULL;
+}
+
+/*********************************************************************
+ * @fn      modelRemove
+ *
+ * @brief   remove a node, called with modelSem held
+ *
+ * @param   entry - node
+ *
+ * @return  -
+ */
+static void modelRemove(topoModelEntry_t *entry)
+{
+	uint16_t idx = (uint16_t) (entry - modelNodes);
+
+	hashIdxDelete(&modelNwkHash, hashIdxTag16(entry->node.nwkAddr), idx);
+	if (entry->node.extAddr != 0)
+	{
+		hashIdxDelete(&modelExtHash, hashIdxTag64(entry->node.extAddr), idx);
+	}
+	entry->used = 0;
+}
+
+/*********************************************************************
+ * @fn      modelSetNwk
+ *
+ * @brief   change the short address of a node, called with modelSem
+ *          held
+ *
+ * @param   entry - node
+ * @param   nwkAddr - short address
+ *
+ * @return  -
+ */
+static void modelSetNwk(topoModelEntry_t *entry, uint16_t nwkAddr)
+{
+	uint16_t idx = (uint16_t) (entry - modelNodes);
+
+	if (entry->node.nwkAddr == nwkAddr)
+	{
+		return;
+	}
+
+	hashIdxDelete(&modelNwkHash, hashIdxTag16(entry->node.nwkAddr), idx);
+	entry->node.nwkAddr = nwkAddr;
+	hashIdxInsert(&modelNwkHash, hashIdxTag16(nwkAddr), idx);
+}
+
+/*********************************************************************
+ * @fn      modelSetExt
+ *
+ * @brief   change the IEEE address of a node, called with modelSem held
+ *
+ * @param   entry - node
+ * @param   extAddr - IEEE address, 0 if unknown
+ *
+ * @return  -
+ */
+static void modelSetExt(topoModelEntry_t *entry, uint64_t extAddr)
+{
+	uint16_t idx = (uint16_t) (entry - modelNodes);
+
+	if (entry->node.extAddr == extAddr)
+	{
+		return;
+	}
+
+	if (entry->node.extAddr != 0)
+	{
+		hashIdxDelete(&modelExtHash, hashIdxTag64(entry->node.extAddr), idx);
+	}
+	entry->node.extAddr = extAddr;
+	if (extAddr != 0)
+	{
+		hashIdxInsert(&modelExtHash, hashIdxTag64(extAddr), idx);
+	}
+}
+
+/*********************************************************************
+ * @fn      modelFindNwk
+ *
+ * @brief   find a node by its short address, called with modelSem held
+ *
+ * @param   nwkAddr - short address
+ *
+ * @return  node, NULL if it is not in the model
+ */
+static topoModelEntry_t *modelFindNwk(uint16_t nwkAddr)
+{
+	uint16_t idx, slot;
+
+	// a short address has its own tag, the node need not be compared
+	idx = hashIdxFirst(&modelNwkHash, hashIdxTag16(nwkAddr), &slot);
+
+	return (idx != HASH_IDX_NONE) ? &modelNodes[idx] : NULL;
+}
+
+/*********************************************************************
+ * @fn      modelFindExt
+ *
+ * @brief   find a node by its IEEE address, called with modelSem held
+ *
+ * @param   extAddr - IEEE address
+ *
+ * @return  node, NULL if it is not in the model or extAddr is 0
+ */
+static topoModelEntry_t *modelFindExt(uint64_t extAddr)
+{
+	uint16_t tag = hashIdxTag64(extAddr);
+	uint16_t idx, slot;
+
+	if (extAddr == 0)
+	{
+		return NULL;
+	}
+
+	idx = hashIdxFirst(&modelExtHash, tag, &slot);
+	while (idx != HASH_IDX_NONE)
+	{
+		if (modelNodes[idx].node.extAddr == extAddr)
+		{
+			return &modelNodes[idx];
+		}
+		idx = hashIdxNext(&modelExtHash, tag, &slot);
+	}
+
+	return NULL;
+}
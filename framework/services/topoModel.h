@@ -0,0 +1,130 @@
+/*
+ * topoModel.h
+ *
+ * This module contains the incrementally maintained network topology of
+ * the ZigBee Network Processor (ZNP) Host Interface.
+ *
+ * Copyright (C) 2014 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TOPOMODEL_H
+#define TOPOMODEL_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// nodes of the model, more are not recorded
+#define TOPO_MODEL_MAX_NODES          (1024)
+
+// routers waiting for a re-query
+#define TOPO_MODEL_MAX_REQUERIES      (32)
+
+// delay in ms before a re-query, so that bursts of events about the
+// same router cause a single one
+#define TOPO_MODEL_REQUERY_DELAY      (2000)
+
+// time to wait for a ZDO_MGMT_LQI_RSP in ms and requests per page
+#define TOPO_MODEL_REQUERY_TIMEOUT    (3000)
+#define TOPO_MODEL_REQUERY_ATTEMPTS   (2)
+
+#define TOPO_MODEL_ADDR_UNKNOWN       (0xFFFF)
+#define TOPO_MODEL_TYPE_UNKNOWN       (0xFF)
+
+// topoModelChange_t type
+#define TOPO_MODEL_NODE_ADDED         (0)
+#define TOPO_MODEL_NODE_REMOVED       (1)
+#define TOPO_MODEL_NODE_REPARENTED    (2)
+#define TOPO_MODEL_NODE_READDRESSED   (3)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint16_t nwkAddr;
+	uint64_t extAddr;      // 0 if not known yet
+	uint16_t parent;       // TOPO_MODEL_ADDR_UNKNOWN if not known
+	uint8_t devType;       // DEVICETYPE_xxx or TOPO_MODEL_TYPE_UNKNOWN
+	uint8_t lqi;           // link quality of the last message received
+	uint64_t lastSeen;     // rpcTimerNow() of the last event, 0 if none
+} topoModelNode_t;
+
+typedef struct
+{
+	uint8_t type;          // TOPO_MODEL_NODE_xxx
+	uint16_t nwkAddr;
+	uint64_t extAddr;
+	uint16_t parent;       // new parent
+	uint16_t oldParent;    // parent before a reparenting
+	uint16_t oldNwkAddr;   // short address before a readdressing
+} topoModelChange_t;
+
+typedef struct
+{
+	uint16_t nodes;
+	uint32_t changes;      // changes reported
+	uint32_t requeries;    // routers re-queried
+	uint32_t failed;       // re-queries without a response
+	uint32_t dropped;      // nodes or re-queries not recorded, tables full
+} topoModelStats_t;
+
+typedef void (*topoModelChangeCb_t)(topoModelChange_t *change);
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+int32_t topoModelInit(topoModelChangeCb_t cb);
+int32_t topoModelLoadCrawl(void);
+int32_t topoModelRequery(uint16_t routerAddr);
+int32_t topoModelGetNode(uint16_t nwkAddr, topoModelNode_t *node);
+uint16_t topoModelGetNodes(topoModelNode_t *nodes, uint16_t maxNodes);
+void topoModelGetStats(topoModelStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TOPOMODEL_H */